@@ -146,6 +146,56 @@ fwupd_client_get_devices (FwupdClient *self, GCancellable *cancellable, GError *
 	}
 	return g_steal_pointer (&helper->array);
 }
+
+static void
+fwupd_client_get_devices_with_keys_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	FwupdClientHelper *helper = (FwupdClientHelper *) user_data;
+	helper->array = fwupd_client_get_devices_with_keys_finish (FWUPD_CLIENT (source), res, &helper->error);
+	g_main_loop_quit (helper->loop);
+}
+
+/**
+ * fwupd_client_get_devices_with_keys:
+ * @self: A #FwupdClient
+ * @keys: (nullable): result keys to include, e.g. `FWUPD_RESULT_KEY_GUID`, or %NULL for all
+ * @cancellable: the #GCancellable, or %NULL
+ * @error: the #GError, or %NULL
+ *
+ * Gets all the devices registered with the daemon, only including the
+ * requested properties.
+ *
+ * Returns: (element-type FwupdDevice) (transfer container): results
+ *
+ * Since: 1.5.0
+ **/
+GPtrArray *
+fwupd_client_get_devices_with_keys (FwupdClient *self,
+				    const gchar * const *keys,
+				    GCancellable *cancellable,
+				    GError **error)
+{
+	g_autoptr(FwupdClientHelper) helper = fwupd_client_helper_new ();
+
+	g_return_val_if_fail (FWUPD_IS_CLIENT (self), NULL);
+	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	/* connect */
+	if (!fwupd_client_connect (self, cancellable, error))
+		return NULL;
+
+	/* call async version and run loop until complete */
+	fwupd_client_get_devices_with_keys_async (self, keys, cancellable,
+						  fwupd_client_get_devices_with_keys_cb,
+						  helper);
+	g_main_loop_run (helper->loop);
+	if (helper->array == NULL) {
+		g_propagate_error (error, g_steal_pointer (&helper->error));
+		return NULL;
+	}
+	return g_steal_pointer (&helper->array);
+}
 static void
 fwupd_client_get_history_cb (GObject *source, GAsyncResult *res, gpointer user_data)
 {
@@ -14,6 +14,10 @@ gboolean	 fwupd_client_connect			(FwupdClient	*self,
 GPtrArray	*fwupd_client_get_devices		(FwupdClient	*self,
 							 GCancellable	*cancellable,
 							 GError		**error);
+GPtrArray	*fwupd_client_get_devices_with_keys	(FwupdClient	*self,
+							 const gchar * const *keys,
+							 GCancellable	*cancellable,
+							 GError		**error);
 GPtrArray	*fwupd_client_get_history		(FwupdClient	*self,
 							 GCancellable	*cancellable,
 							 GError		**error);
@@ -44,6 +44,7 @@ typedef struct {
 	FwupdStatus			 status;
 	gboolean			 tainted;
 	gboolean			 interactive;
+	gboolean			 enumerating;
 	guint				 percentage;
 	gchar				*daemon_version;
 	gchar				*host_product;
@@ -75,6 +76,7 @@ enum {
 	PROP_HOST_MACHINE_ID,
 	PROP_HOST_SECURITY_ID,
 	PROP_INTERACTIVE,
+	PROP_ENUMERATING,
 	PROP_LAST
 };
 
@@ -167,6 +169,14 @@ fwupd_client_properties_changed_cb (GDBusProxy *proxy,
 			g_object_notify (G_OBJECT (self), "tainted");
 		}
 	}
+	if (g_variant_dict_contains (dict, "Enumerating")) {
+		g_autoptr(GVariant) val = NULL;
+		val = g_dbus_proxy_get_cached_property (proxy, "Enumerating");
+		if (val != NULL) {
+			priv->enumerating = g_variant_get_boolean (val);
+			g_object_notify (G_OBJECT (self), "enumerating");
+		}
+	}
 	if (g_variant_dict_contains (dict, "Interactive")) {
 		g_autoptr(GVariant) val = NULL;
 		val = g_dbus_proxy_get_cached_property (proxy, "Interactive");
@@ -356,6 +366,10 @@ fwupd_client_connect_get_proxy_cb (GObject *source,
 	val2 = g_dbus_proxy_get_cached_property (priv->proxy, "Interactive");
 	if (val2 != NULL)
 		priv->interactive = g_variant_get_boolean (val2);
+	g_clear_pointer (&val2, g_variant_unref);
+	val2 = g_dbus_proxy_get_cached_property (priv->proxy, "Enumerating");
+	if (val2 != NULL)
+		priv->enumerating = g_variant_get_boolean (val2);
 	val = g_dbus_proxy_get_cached_property (priv->proxy, "HostProduct");
 	if (val != NULL)
 		fwupd_client_set_host_product (self, g_variant_get_string (val, NULL));
@@ -746,6 +760,69 @@ fwupd_client_get_devices_finish (FwupdClient *self, GAsyncResult *res, GError **
 	return g_task_propagate_pointer (G_TASK(res), error);
 }
 
+/**
+ * fwupd_client_get_devices_with_keys_async:
+ * @self: A #FwupdClient
+ * @keys: (nullable): result keys to include, e.g. `FWUPD_RESULT_KEY_GUID`, or %NULL for all
+ * @cancellable: the #GCancellable, or %NULL
+ * @callback: the function to run on completion
+ * @callback_data: the data to pass to @callback
+ *
+ * Gets all the devices registered with the daemon, only including the
+ * requested properties. This is much faster than
+ * fwupd_client_get_devices_async() when only a few properties are required.
+ *
+ * You must have called fwupd_client_connect_async() on @self before using
+ * this method.
+ *
+ * Since: 1.5.0
+ **/
+void
+fwupd_client_get_devices_with_keys_async (FwupdClient *self,
+					  const gchar * const *keys,
+					  GCancellable *cancellable,
+					  GAsyncReadyCallback callback,
+					  gpointer callback_data)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (self);
+	const gchar *keys_none[] = { NULL };
+	g_autoptr(GTask) task = NULL;
+
+	g_return_if_fail (FWUPD_IS_CLIENT (self));
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+	g_return_if_fail (priv->proxy != NULL);
+
+	/* call into daemon */
+	task = g_task_new (self, cancellable, callback, callback_data);
+	g_dbus_proxy_call (priv->proxy, "GetDevicesWithKeys",
+			   g_variant_new ("(^as)", keys != NULL ? (const gchar **) keys : keys_none),
+			   G_DBUS_CALL_FLAGS_NONE,
+			   -1, cancellable,
+			   fwupd_client_get_devices_cb,
+			   g_steal_pointer (&task));
+}
+
+/**
+ * fwupd_client_get_devices_with_keys_finish:
+ * @self: A #FwupdClient
+ * @res: the #GAsyncResult
+ * @error: the #GError, or %NULL
+ *
+ * Gets the result of fwupd_client_get_devices_with_keys_async().
+ *
+ * Returns: (element-type FwupdDevice) (transfer container): results
+ *
+ * Since: 1.5.0
+ **/
+GPtrArray *
+fwupd_client_get_devices_with_keys_finish (FwupdClient *self, GAsyncResult *res, GError **error)
+{
+	g_return_val_if_fail (FWUPD_IS_CLIENT (self), NULL);
+	g_return_val_if_fail (g_task_is_valid (res, self), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+	return g_task_propagate_pointer (G_TASK(res), error);
+}
+
 static void
 fwupd_client_get_history_cb (GObject *source,
 			     GAsyncResult *res,
@@ -2571,6 +2648,27 @@ fwupd_client_get_daemon_interactive (FwupdClient *self)
 	return priv->interactive;
 }
 
+/**
+ * fwupd_client_get_enumerating:
+ * @self: A #FwupdClient
+ *
+ * Gets if the daemon is still adding devices. Clients that set
+ * %FWUPD_FEATURE_FLAG_PARTIAL_DEVICES are returned the devices found so far
+ * while this is set, and can either wait for the #FwupdClient:enumerating
+ * property to change or watch for #FwupdClient::device-added signals.
+ *
+ * Returns: %TRUE if the daemon is still enumerating hardware
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fwupd_client_get_enumerating (FwupdClient *self)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (self);
+	g_return_val_if_fail (FWUPD_IS_CLIENT (self), FALSE);
+	return priv->enumerating;
+}
+
 #ifdef HAVE_GIO_UNIX
 
 static void
@@ -4177,6 +4275,9 @@ fwupd_client_get_property (GObject *object, guint prop_id,
 	case PROP_INTERACTIVE:
 		g_value_set_boolean (value, priv->interactive);
 		break;
+	case PROP_ENUMERATING:
+		g_value_set_boolean (value, priv->enumerating);
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -4333,6 +4434,17 @@ fwupd_client_class_init (FwupdClientClass *klass)
 				      G_PARAM_READABLE | G_PARAM_STATIC_NAME);
 	g_object_class_install_property (object_class, PROP_INTERACTIVE, pspec);
 
+	/**
+	 * FwupdClient:enumerating:
+	 *
+	 * If the daemon is still adding devices.
+	 *
+	 * Since: 1.5.0
+	 */
+	pspec = g_param_spec_boolean ("enumerating", NULL, NULL, FALSE,
+				      G_PARAM_READABLE | G_PARAM_STATIC_NAME);
+	g_object_class_install_property (object_class, PROP_ENUMERATING, pspec);
+
 	/**
 	 * FwupdClient:percentage:
 	 *
@@ -81,6 +81,14 @@ void		 fwupd_client_get_devices_async		(FwupdClient	*self,
 GPtrArray	*fwupd_client_get_devices_finish	(FwupdClient	*self,
 							 GAsyncResult	*res,
 							 GError		**error);
+void		 fwupd_client_get_devices_with_keys_async (FwupdClient	*self,
+							 const gchar * const *keys,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 callback_data);
+GPtrArray	*fwupd_client_get_devices_with_keys_finish (FwupdClient	*self,
+							 GAsyncResult	*res,
+							 GError		**error);
 void		 fwupd_client_get_history_async		(FwupdClient	*self,
 							 GCancellable	*cancellable,
 							 GAsyncReadyCallback callback,
@@ -279,6 +287,7 @@ GHashTable	*fwupd_client_get_report_metadata_finish(FwupdClient	*self,
 FwupdStatus	 fwupd_client_get_status		(FwupdClient	*self);
 gboolean	 fwupd_client_get_tainted		(FwupdClient	*self);
 gboolean	 fwupd_client_get_daemon_interactive	(FwupdClient	*self);
+gboolean	 fwupd_client_get_enumerating		(FwupdClient	*self);
 guint		 fwupd_client_get_percentage		(FwupdClient	*self);
 const gchar	*fwupd_client_get_daemon_version	(FwupdClient	*self);
 const gchar	*fwupd_client_get_host_product		(FwupdClient	*self);
@@ -16,6 +16,9 @@ G_BEGIN_DECLS
 GVariant	*fwupd_device_to_variant		(FwupdDevice	*device);
 GVariant	*fwupd_device_to_variant_full		(FwupdDevice	*device,
 							 FwupdDeviceFlags flags);
+GVariant	*fwupd_device_to_variant_projection	(FwupdDevice	*device,
+							 FwupdDeviceFlags flags,
+							 const gchar * const *keys);
 void		 fwupd_device_incorporate		(FwupdDevice	*self,
 							 FwupdDevice	*donor);
 void		 fwupd_device_to_json			(FwupdDevice *device,
@@ -1278,97 +1278,148 @@ fwupd_device_incorporate (FwupdDevice *self, FwupdDevice *donor)
 	}
 }
 
-/**
- * fwupd_device_to_variant_full:
- * @device: A #FwupdDevice
- * @flags: #FwupdDeviceFlags for the call
- *
- * Creates a GVariant from the device data.
- * Optionally provides additional data based upon flags
- *
- * Returns: the GVariant, or %NULL for error
- *
- * Since: 1.1.2
- **/
-GVariant *
-fwupd_device_to_variant_full (FwupdDevice *device, FwupdDeviceFlags flags)
+static gboolean
+fwupd_device_variant_want_key (const gchar * const *keys, const gchar *key)
+{
+	if (keys == NULL)
+		return TRUE;
+	return g_strv_contains (keys, key);
+}
+
+/* only canonical lowercase GUIDs survive the round trip through the binary form */
+static gboolean
+fwupd_device_guids_can_pack (GPtrArray *guids)
+{
+	for (guint i = 0; i < guids->len; i++) {
+		const gchar *guid = g_ptr_array_index (guids, i);
+		if (!fwupd_guid_from_string (guid, NULL, FWUPD_GUID_FLAG_NONE, NULL))
+			return FALSE;
+		if (guid[8] != '-' || guid[13] != '-' || guid[18] != '-' || guid[23] != '-')
+			return FALSE;
+		for (guint j = 0; guid[j] != '\0'; j++) {
+			if (g_ascii_isupper (guid[j]))
+				return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+static GVariant *
+fwupd_device_guids_to_variant_packed (GPtrArray *guids)
+{
+	gsize bufsz = guids->len * sizeof(fwupd_guid_t);
+	guint8 *buf = g_malloc0 (bufsz);
+	for (guint i = 0; i < guids->len; i++) {
+		const gchar *guid = g_ptr_array_index (guids, i);
+		fwupd_guid_t *tmp = (fwupd_guid_t *) (buf + (i * sizeof(fwupd_guid_t)));
+		if (!fwupd_guid_from_string (guid, tmp, FWUPD_GUID_FLAG_NONE, NULL))
+			g_warning ("failed to pack GUID %s", guid);
+	}
+	return g_variant_new_from_data (G_VARIANT_TYPE_BYTESTRING,
+					buf, bufsz, TRUE,
+					g_free, buf);
+}
+
+static GVariant *
+fwupd_device_to_variant_internal (FwupdDevice *device,
+				  FwupdDeviceFlags flags,
+				  const gchar * const *keys,
+				  gboolean packed)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (device);
 	GVariantBuilder builder;
 
-	g_return_val_if_fail (FWUPD_IS_DEVICE (device), NULL);
-
 	/* create an array with all the metadata in */
 	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
-	if (priv->id != NULL) {
+	if (priv->id != NULL &&
+	    fwupd_device_variant_want_key (keys, FWUPD_RESULT_KEY_DEVICE_ID)) {
 		g_variant_builder_add (&builder, "{sv}",
 				       FWUPD_RESULT_KEY_DEVICE_ID,
 				       g_variant_new_string (priv->id));
 	}
-	if (priv->parent_id != NULL) {
+	if (priv->parent_id != NULL &&
+	    fwupd_device_variant_want_key (keys, FWUPD_RESULT_KEY_PARENT_DEVICE_ID)) {
 		g_variant_builder_add (&builder, "{sv}",
 				       FWUPD_RESULT_KEY_PARENT_DEVICE_ID,
 				       g_variant_new_string (priv->parent_id));
 	}
-	if (priv->guids->len > 0) {
-		const gchar * const *tmp = (const gchar * const *) priv->guids->pdata;
-		g_variant_builder_add (&builder, "{sv}",
-				       FWUPD_RESULT_KEY_GUID,
-				       g_variant_new_strv (tmp, priv->guids->len));
+	if (priv->guids->len > 0 &&
+	    fwupd_device_variant_want_key (keys, FWUPD_RESULT_KEY_GUID)) {
+		if (packed && fwupd_device_guids_can_pack (priv->guids)) {
+			g_variant_builder_add (&builder, "{sv}",
+					       FWUPD_RESULT_KEY_GUID,
+					       fwupd_device_guids_to_variant_packed (priv->guids));
+		} else {
+			const gchar * const *tmp = (const gchar * const *) priv->guids->pdata;
+			g_variant_builder_add (&builder, "{sv}",
+					       FWUPD_RESULT_KEY_GUID,
+					       g_variant_new_strv (tmp, priv->guids->len));
+		}
 	}
-	if (priv->icons->len > 0) {
+	if (priv->icons->len > 0 &&
+	    fwupd_device_variant_want_key (keys, FWUPD_RESULT_KEY_ICON)) {
 		const gchar * const *tmp = (const gchar * const *) priv->icons->pdata;
 		g_variant_builder_add (&builder, "{sv}",
 				       FWUPD_RESULT_KEY_ICON,
 				       g_variant_new_strv (tmp, priv->icons->len));
 	}
-	if (priv->name != NULL) {
+	if (priv->name != NULL &&
+	    fwupd_device_variant_want_key (keys, FWUPD_RESULT_KEY_NAME)) {
 		g_variant_builder_add (&builder, "{sv}",
 				       FWUPD_RESULT_KEY_NAME,
 				       g_variant_new_string (priv->name));
 	}
-	if (priv->vendor != NULL) {
+	if (priv->vendor != NULL &&
+	    fwupd_device_variant_want_key (keys, FWUPD_RESULT_KEY_VENDOR)) {
 		g_variant_builder_add (&builder, "{sv}",
 				       FWUPD_RESULT_KEY_VENDOR,
 				       g_variant_new_string (priv->vendor));
 	}
-	if (priv->vendor_id != NULL) {
+	if (priv->vendor_id != NULL &&
+	    fwupd_device_variant_want_key (keys, FWUPD_RESULT_KEY_VENDOR_ID)) {
 		g_variant_builder_add (&builder, "{sv}",
 				       FWUPD_RESULT_KEY_VENDOR_ID,
 				       g_variant_new_string (priv->vendor_id));
 	}
-	if (priv->flags > 0) {
+	if (priv->flags > 0 &&
+	    fwupd_device_variant_want_key (keys, FWUPD_RESULT_KEY_FLAGS)) {
 		g_variant_builder_add (&builder, "{sv}",
 				       FWUPD_RESULT_KEY_FLAGS,
 				       g_variant_new_uint64 (priv->flags));
 	}
-	if (priv->created > 0) {
+	if (priv->created > 0 &&
+	    fwupd_device_variant_want_key (keys, FWUPD_RESULT_KEY_CREATED)) {
 		g_variant_builder_add (&builder, "{sv}",
 				       FWUPD_RESULT_KEY_CREATED,
 				       g_variant_new_uint64 (priv->created));
 	}
-	if (priv->modified > 0) {
+	if (priv->modified > 0 &&
+	    fwupd_device_variant_want_key (keys, FWUPD_RESULT_KEY_MODIFIED)) {
 		g_variant_builder_add (&builder, "{sv}",
 				       FWUPD_RESULT_KEY_MODIFIED,
 				       g_variant_new_uint64 (priv->modified));
 	}
 
-	if (priv->description != NULL) {
+	if (priv->description != NULL &&
+	    fwupd_device_variant_want_key (keys, FWUPD_RESULT_KEY_DESCRIPTION)) {
 		g_variant_builder_add (&builder, "{sv}",
 				       FWUPD_RESULT_KEY_DESCRIPTION,
 				       g_variant_new_string (priv->description));
 	}
-	if (priv->summary != NULL) {
+	if (priv->summary != NULL &&
+	    fwupd_device_variant_want_key (keys, FWUPD_RESULT_KEY_SUMMARY)) {
 		g_variant_builder_add (&builder, "{sv}",
 				       FWUPD_RESULT_KEY_SUMMARY,
 				       g_variant_new_string (priv->summary));
 	}
-	if (priv->branch != NULL) {
+	if (priv->branch != NULL &&
+	    fwupd_device_variant_want_key (keys, FWUPD_RESULT_KEY_BRANCH)) {
 		g_variant_builder_add (&builder, "{sv}",
 				       FWUPD_RESULT_KEY_BRANCH,
 				       g_variant_new_string (priv->branch));
 	}
-	if (priv->checksums->len > 0) {
+	if (priv->checksums->len > 0 &&
+	    fwupd_device_variant_want_key (keys, FWUPD_RESULT_KEY_CHECKSUM)) {
 		g_autoptr(GString) str = g_string_new ("");
 		for (guint i = 0; i < priv->checksums->len; i++) {
 			const gchar *checksum = g_ptr_array_index (priv->checksums, i);
@@ -1380,93 +1431,111 @@ fwupd_device_to_variant_full (FwupdDevice *device, FwupdDeviceFlags flags)
 				       FWUPD_RESULT_KEY_CHECKSUM,
 				       g_variant_new_string (str->str));
 	}
-	if (priv->plugin != NULL) {
+	if (priv->plugin != NULL &&
+	    fwupd_device_variant_want_key (keys, FWUPD_RESULT_KEY_PLUGIN)) {
 		g_variant_builder_add (&builder, "{sv}",
 				       FWUPD_RESULT_KEY_PLUGIN,
 				       g_variant_new_string (priv->plugin));
 	}
-	if (priv->protocol != NULL) {
+	if (priv->protocol != NULL &&
+	    fwupd_device_variant_want_key (keys, FWUPD_RESULT_KEY_PROTOCOL)) {
 		g_variant_builder_add (&builder, "{sv}",
 				       FWUPD_RESULT_KEY_PROTOCOL,
 				       g_variant_new_string (priv->protocol));
 	}
-	if (priv->version != NULL) {
+	if (priv->version != NULL &&
+	    fwupd_device_variant_want_key (keys, FWUPD_RESULT_KEY_VERSION)) {
 		g_variant_builder_add (&builder, "{sv}",
 				       FWUPD_RESULT_KEY_VERSION,
 				       g_variant_new_string (priv->version));
 	}
-	if (priv->version_lowest != NULL) {
+	if (priv->version_lowest != NULL &&
+	    fwupd_device_variant_want_key (keys, FWUPD_RESULT_KEY_VERSION_LOWEST)) {
 		g_variant_builder_add (&builder, "{sv}",
 				       FWUPD_RESULT_KEY_VERSION_LOWEST,
 				       g_variant_new_string (priv->version_lowest));
 	}
-	if (priv->version_bootloader != NULL) {
+	if (priv->version_bootloader != NULL &&
+	    fwupd_device_variant_want_key (keys, FWUPD_RESULT_KEY_VERSION_BOOTLOADER)) {
 		g_variant_builder_add (&builder, "{sv}",
 				       FWUPD_RESULT_KEY_VERSION_BOOTLOADER,
 				       g_variant_new_string (priv->version_bootloader));
 	}
-	if (priv->version_raw > 0) {
+	if (priv->version_raw > 0 &&
+	    fwupd_device_variant_want_key (keys, FWUPD_RESULT_KEY_VERSION_RAW)) {
 		g_variant_builder_add (&builder, "{sv}",
 				       FWUPD_RESULT_KEY_VERSION_RAW,
 				       g_variant_new_uint64 (priv->version_raw));
 	}
-	if (priv->version_lowest_raw > 0) {
+	if (priv->version_lowest_raw > 0 &&
+	    fwupd_device_variant_want_key (keys, FWUPD_RESULT_KEY_VERSION_LOWEST_RAW)) {
 		g_variant_builder_add (&builder, "{sv}",
 				       FWUPD_RESULT_KEY_VERSION_LOWEST_RAW,
 				       g_variant_new_uint64 (priv->version_raw));
 	}
-	if (priv->version_bootloader_raw > 0) {
+	if (priv->version_bootloader_raw > 0 &&
+	    fwupd_device_variant_want_key (keys, FWUPD_RESULT_KEY_VERSION_BOOTLOADER_RAW)) {
 		g_variant_builder_add (&builder, "{sv}",
 				       FWUPD_RESULT_KEY_VERSION_BOOTLOADER_RAW,
 				       g_variant_new_uint64 (priv->version_raw));
 	}
-	if (priv->flashes_left > 0) {
+	if (priv->flashes_left > 0 &&
+	    fwupd_device_variant_want_key (keys, FWUPD_RESULT_KEY_FLASHES_LEFT)) {
 		g_variant_builder_add (&builder, "{sv}",
 				       FWUPD_RESULT_KEY_FLASHES_LEFT,
 				       g_variant_new_uint32 (priv->flashes_left));
 	}
-	if (priv->install_duration > 0) {
+	if (priv->install_duration > 0 &&
+	    fwupd_device_variant_want_key (keys, FWUPD_RESULT_KEY_INSTALL_DURATION)) {
 		g_variant_builder_add (&builder, "{sv}",
 				       FWUPD_RESULT_KEY_INSTALL_DURATION,
 				       g_variant_new_uint32 (priv->install_duration));
 	}
-	if (priv->update_error != NULL) {
+	if (priv->update_error != NULL &&
+	    fwupd_device_variant_want_key (keys, FWUPD_RESULT_KEY_UPDATE_ERROR)) {
 		g_variant_builder_add (&builder, "{sv}",
 				       FWUPD_RESULT_KEY_UPDATE_ERROR,
 				       g_variant_new_string (priv->update_error));
 	}
-	if (priv->update_message != NULL) {
+	if (priv->update_message != NULL &&
+	    fwupd_device_variant_want_key (keys, FWUPD_RESULT_KEY_UPDATE_MESSAGE)) {
 		g_variant_builder_add (&builder, "{sv}",
 				       FWUPD_RESULT_KEY_UPDATE_MESSAGE,
 				       g_variant_new_string (priv->update_message));
 	}
-	if (priv->update_image != NULL) {
+	if (priv->update_image != NULL &&
+	    fwupd_device_variant_want_key (keys, FWUPD_RESULT_KEY_UPDATE_IMAGE)) {
 		g_variant_builder_add (&builder, "{sv}",
 				       FWUPD_RESULT_KEY_UPDATE_IMAGE,
 				       g_variant_new_string (priv->update_image));
 	}
-	if (priv->update_state != FWUPD_UPDATE_STATE_UNKNOWN) {
+	if (priv->update_state != FWUPD_UPDATE_STATE_UNKNOWN &&
+	    fwupd_device_variant_want_key (keys, FWUPD_RESULT_KEY_UPDATE_STATE)) {
 		g_variant_builder_add (&builder, "{sv}",
 				       FWUPD_RESULT_KEY_UPDATE_STATE,
 				       g_variant_new_uint32 (priv->update_state));
 	}
-	if (priv->status != FWUPD_STATUS_UNKNOWN) {
+	if (priv->status != FWUPD_STATUS_UNKNOWN &&
+	    fwupd_device_variant_want_key (keys, FWUPD_RESULT_KEY_STATUS)) {
 		g_variant_builder_add (&builder, "{sv}",
 				       FWUPD_RESULT_KEY_STATUS,
 				       g_variant_new_uint32 (priv->status));
 	}
-	if (priv->version_format != FWUPD_VERSION_FORMAT_UNKNOWN) {
+	if (priv->version_format != FWUPD_VERSION_FORMAT_UNKNOWN &&
+	    fwupd_device_variant_want_key (keys, FWUPD_RESULT_KEY_VERSION_FORMAT)) {
 		g_variant_builder_add (&builder, "{sv}",
 				       FWUPD_RESULT_KEY_VERSION_FORMAT,
 				       g_variant_new_uint32 (priv->version_format));
 	}
 	if (flags & FWUPD_DEVICE_FLAG_TRUSTED) {
-		if (priv->serial != NULL) {
+		if (priv->serial != NULL &&
+		    fwupd_device_variant_want_key (keys, FWUPD_RESULT_KEY_SERIAL)) {
 			g_variant_builder_add (&builder, "{sv}",
 					       FWUPD_RESULT_KEY_SERIAL,
 					       g_variant_new_string (priv->serial));
 		}
-		if (priv->instance_ids->len > 0) {
+		if (priv->instance_ids->len > 0 &&
+		    fwupd_device_variant_want_key (keys, FWUPD_RESULT_KEY_INSTANCE_IDS)) {
 			const gchar * const *tmp = (const gchar * const *) priv->instance_ids->pdata;
 			g_variant_builder_add (&builder, "{sv}",
 					       FWUPD_RESULT_KEY_INSTANCE_IDS,
@@ -1475,7 +1544,8 @@ fwupd_device_to_variant_full (FwupdDevice *device, FwupdDeviceFlags flags)
 	}
 
 	/* create an array with all the metadata in */
-	if (priv->releases->len > 0) {
+	if (priv->releases->len > 0 &&
+	    fwupd_device_variant_want_key (keys, FWUPD_RESULT_KEY_RELEASE)) {
 		g_autofree GVariant **children = NULL;
 		children = g_new0 (GVariant *, priv->releases->len);
 		for (guint i = 0; i < priv->releases->len; i++) {
@@ -1491,6 +1561,48 @@ fwupd_device_to_variant_full (FwupdDevice *device, FwupdDeviceFlags flags)
 	return g_variant_new ("a{sv}", &builder);
 }
 
+/**
+ * fwupd_device_to_variant_full:
+ * @device: A #FwupdDevice
+ * @flags: #FwupdDeviceFlags for the call
+ *
+ * Creates a GVariant from the device data.
+ * Optionally provides additional data based upon flags
+ *
+ * Returns: the GVariant, or %NULL for error
+ *
+ * Since: 1.1.2
+ **/
+GVariant *
+fwupd_device_to_variant_full (FwupdDevice *device, FwupdDeviceFlags flags)
+{
+	g_return_val_if_fail (FWUPD_IS_DEVICE (device), NULL);
+	return fwupd_device_to_variant_internal (device, flags, NULL, FALSE);
+}
+
+/**
+ * fwupd_device_to_variant_projection:
+ * @device: A #FwupdDevice
+ * @flags: #FwupdDeviceFlags for the call
+ * @keys: (nullable): result keys to include, e.g. `FWUPD_RESULT_KEY_GUID`, or %NULL for all
+ *
+ * Creates a compact GVariant from the device data, only including the
+ * requested keys. The GUIDs are sent as packed binary data, and so this should
+ * only be used for clients that set %FWUPD_FEATURE_FLAG_COMPACT_VARIANT.
+ *
+ * Returns: the GVariant, or %NULL for error
+ *
+ * Since: 1.5.0
+ **/
+GVariant *
+fwupd_device_to_variant_projection (FwupdDevice *device,
+				    FwupdDeviceFlags flags,
+				    const gchar * const *keys)
+{
+	g_return_val_if_fail (FWUPD_IS_DEVICE (device), NULL);
+	return fwupd_device_to_variant_internal (device, flags, keys, TRUE);
+}
+
 /**
  * fwupd_device_to_variant:
  * @device: A #FwupdDevice
@@ -1542,6 +1654,18 @@ fwupd_device_from_key_value (FwupdDevice *device, const gchar *key, GVariant *va
 		fwupd_device_set_modified (device, g_variant_get_uint64 (value));
 		return;
 	}
+	if (g_strcmp0 (key, FWUPD_RESULT_KEY_GUID) == 0 &&
+	    g_variant_is_of_type (value, G_VARIANT_TYPE_BYTESTRING)) {
+		gsize bufsz = 0;
+		const guint8 *buf = g_variant_get_fixed_array (value, &bufsz, sizeof(guint8));
+		for (gsize i = 0; i + sizeof(fwupd_guid_t) <= bufsz; i += sizeof(fwupd_guid_t)) {
+			g_autofree gchar *guid = NULL;
+			guid = fwupd_guid_to_string ((const fwupd_guid_t *) (buf + i),
+						     FWUPD_GUID_FLAG_NONE);
+			fwupd_device_add_guid (device, guid);
+		}
+		return;
+	}
 	if (g_strcmp0 (key, FWUPD_RESULT_KEY_GUID) == 0) {
 		g_autofree const gchar **guids = g_variant_get_strv (value, NULL);
 		for (guint i = 0; guids != NULL && guids[i] != NULL; i++)
@@ -429,6 +429,10 @@ fwupd_feature_flag_to_string (FwupdFeatureFlags feature_flag)
 		return "update-action";
 	if (feature_flag == FWUPD_FEATURE_FLAG_SWITCH_BRANCH)
 		return "switch-branch";
+	if (feature_flag == FWUPD_FEATURE_FLAG_COMPACT_VARIANT)
+		return "compact-variant";
+	if (feature_flag == FWUPD_FEATURE_FLAG_PARTIAL_DEVICES)
+		return "partial-devices";
 	return NULL;
 }
 
@@ -455,6 +459,10 @@ fwupd_feature_flag_from_string (const gchar *feature_flag)
 		return FWUPD_FEATURE_FLAG_UPDATE_ACTION;
 	if (g_strcmp0 (feature_flag, "switch-branch") == 0)
 		return FWUPD_FEATURE_FLAG_SWITCH_BRANCH;
+	if (g_strcmp0 (feature_flag, "compact-variant") == 0)
+		return FWUPD_FEATURE_FLAG_COMPACT_VARIANT;
+	if (g_strcmp0 (feature_flag, "partial-devices") == 0)
+		return FWUPD_FEATURE_FLAG_PARTIAL_DEVICES;
 	return FWUPD_FEATURE_FLAG_LAST;
 }
 
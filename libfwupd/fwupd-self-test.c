@@ -15,6 +15,7 @@
 #include "fwupd-client-sync.h"
 #include "fwupd-common.h"
 #include "fwupd-enums.h"
+#include "fwupd-enums-private.h"
 #include "fwupd-error.h"
 #include "fwupd-device-private.h"
 #include "fwupd-release-private.h"
@@ -311,10 +312,15 @@ fwupd_device_func (void)
 	gboolean ret;
 	g_autofree gchar *data = NULL;
 	g_autofree gchar *str = NULL;
+	const gchar *keys[] = { FWUPD_RESULT_KEY_DEVICE_ID, FWUPD_RESULT_KEY_GUID, NULL };
 	g_autoptr(FwupdDevice) dev = NULL;
+	g_autoptr(FwupdDevice) dev2 = NULL;
+	g_autoptr(FwupdDevice) dev3 = NULL;
 	g_autoptr(FwupdRelease) rel = NULL;
 	g_autoptr(GError) error = NULL;
 	g_autoptr(GString) str_ascii = NULL;
+	g_autoptr(GVariant) val = NULL;
+	g_autoptr(GVariant) val_projection = NULL;
 	g_autoptr(JsonBuilder) builder = NULL;
 	g_autoptr(JsonGenerator) json_generator = NULL;
 	g_autoptr(JsonNode) json_root = NULL;
@@ -428,6 +434,25 @@ fwupd_device_func (void)
 		"}", &error);
 	g_assert_no_error (error);
 	g_assert (ret);
+
+	/* packed GUIDs survive the round trip */
+	val = g_variant_ref_sink (fwupd_device_to_variant_projection (dev, FWUPD_DEVICE_FLAG_NONE, NULL));
+	dev2 = fwupd_device_from_variant (val);
+	g_assert_nonnull (dev2);
+	g_assert_cmpint (fwupd_device_get_guids(dev2)->len, ==, 2);
+	g_assert (fwupd_device_has_guid (dev2, "2082b5e0-7a64-478a-b1b2-e3404fab6dad"));
+	g_assert (fwupd_device_has_guid (dev2, "00000000-0000-0000-0000-000000000000"));
+	g_assert_cmpstr (fwupd_device_get_name (dev2), ==, "ColorHug2");
+	g_assert_cmpint (fwupd_device_get_releases(dev2)->len, ==, 1);
+
+	/* only the requested keys are included */
+	val_projection = g_variant_ref_sink (fwupd_device_to_variant_projection (dev, FWUPD_DEVICE_FLAG_NONE, keys));
+	dev3 = fwupd_device_from_variant (val_projection);
+	g_assert_nonnull (dev3);
+	g_assert_cmpstr (fwupd_device_get_id (dev3), ==, "USB:foo");
+	g_assert_cmpint (fwupd_device_get_guids(dev3)->len, ==, 2);
+	g_assert_null (fwupd_device_get_name (dev3));
+	g_assert_cmpint (fwupd_device_get_releases(dev3)->len, ==, 0);
 }
 
 static void
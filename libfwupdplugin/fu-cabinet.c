@@ -14,6 +14,7 @@
 #include "fu-cabinet.h"
 #include "fu-common.h"
 
+#include "fwupd-common.h"
 #include "fwupd-enums.h"
 #include "fwupd-error.h"
 
@@ -22,10 +23,12 @@ struct _FuCabinet {
 	guint64			 size_max;
 	GCabCabinet		*gcab_cabinet;
 	gchar			*container_checksum;
+	gchar			*container_checksum_sha256;
 	XbBuilder		*builder;
 	XbSilo			*silo;
 	JcatContext		*jcat_context;
 	JcatFile		*jcat_file;
+	FuJcatCache		*jcat_cache;
 };
 
 G_DEFINE_TYPE (FuCabinet, fu_cabinet, G_TYPE_OBJECT)
@@ -39,9 +42,11 @@ fu_cabinet_finalize (GObject *obj)
 	if (self->builder != NULL)
 		g_object_unref (self->builder);
 	g_free (self->container_checksum);
+	g_free (self->container_checksum_sha256);
 	g_object_unref (self->gcab_cabinet);
 	g_object_unref (self->jcat_context);
 	g_object_unref (self->jcat_file);
+	g_object_unref (self->jcat_cache);
 	G_OBJECT_CLASS (fu_cabinet_parent_class)->finalize (obj);
 }
 
@@ -60,6 +65,7 @@ fu_cabinet_init (FuCabinet *self)
 	self->builder = xb_builder_new ();
 	self->jcat_file = jcat_file_new ();
 	self->jcat_context = jcat_context_new ();
+	self->jcat_cache = fu_jcat_cache_new ();
 }
 
 /**
@@ -96,6 +102,47 @@ fu_cabinet_set_jcat_context (FuCabinet *self, JcatContext *jcat_context)
 	g_set_object (&self->jcat_context, jcat_context);
 }
 
+/**
+ * fu_cabinet_set_jcat_cache: (skip):
+ * @self: A #FuCabinet
+ * @jcat_cache: A #FuJcatCache
+ *
+ * Sets the cache of verification results, so that payloads and metadata that
+ * have already been verified are not verified again.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_cabinet_set_jcat_cache (FuCabinet *self, FuJcatCache *jcat_cache)
+{
+	g_return_if_fail (FU_IS_CABINET (self));
+	g_return_if_fail (FU_IS_JCAT_CACHE (jcat_cache));
+	g_set_object (&self->jcat_cache, jcat_cache);
+}
+
+/**
+ * fu_cabinet_get_container_checksum:
+ * @self: A #FuCabinet
+ * @checksum_type: A #GChecksumType, either %G_CHECKSUM_SHA1 or %G_CHECKSUM_SHA256
+ *
+ * Gets a checksum of the archive. Both the SHA1 and SHA256 checksums are
+ * computed in one pass when parsing.
+ *
+ * Returns: a checksum, or %NULL if the archive has not been parsed
+ *
+ * Since: 1.5.0
+ **/
+const gchar *
+fu_cabinet_get_container_checksum (FuCabinet *self, GChecksumType checksum_type)
+{
+	g_return_val_if_fail (FU_IS_CABINET (self), NULL);
+	if (checksum_type == G_CHECKSUM_SHA1)
+		return self->container_checksum;
+	if (checksum_type == G_CHECKSUM_SHA256)
+		return self->container_checksum_sha256;
+	return NULL;
+}
+
 /**
  * fu_cabinet_get_silo: (skip):
  * @self: A #FuCabinet
@@ -203,14 +250,28 @@ fu_cabinet_parse_release (FuCabinet *self, XbNode *release, GError **error)
 
 	/* set if unspecified, but error out if specified and incorrect */
 	if (csum_tmp != NULL && xb_node_get_text (csum_tmp) != NULL) {
-		g_autofree gchar *checksum = NULL;
-		checksum = g_compute_checksum_for_bytes (G_CHECKSUM_SHA1, blob);
-		if (g_strcmp0 (checksum, xb_node_get_text (csum_tmp)) != 0) {
+		GChecksumType checksum_types[] = { G_CHECKSUM_SHA1 };
+		g_auto(GStrv) checksums = NULL;
+
+		/* MD5 is not good enough to verify the payload */
+		switch (fwupd_checksum_guess_kind (xb_node_get_text (csum_tmp))) {
+		case G_CHECKSUM_SHA256:
+			checksum_types[0] = G_CHECKSUM_SHA256;
+			break;
+		case G_CHECKSUM_SHA512:
+			checksum_types[0] = G_CHECKSUM_SHA512;
+			break;
+		default:
+			break;
+		}
+		checksums = fu_common_get_checksums_for_bytes (blob, checksum_types,
+							       G_N_ELEMENTS (checksum_types));
+		if (g_strcmp0 (checksums[0], xb_node_get_text (csum_tmp)) != 0) {
 			g_set_error (error,
 				     FWUPD_ERROR,
 				     FWUPD_ERROR_INVALID_FILE,
 				     "contents checksum invalid, expected %s, got %s",
-				     checksum,
+				     checksums[0],
 				     xb_node_get_text (csum_tmp));
 			return FALSE;
 		}
@@ -220,18 +281,16 @@ fu_cabinet_parse_release (FuCabinet *self, XbNode *release, GError **error)
 	item = jcat_file_get_item_by_id (self->jcat_file, basename, NULL);
 	if (item != NULL) {
 		g_autoptr(GError) error_local = NULL;
-		g_autoptr(GPtrArray) results = NULL;
-		results = jcat_context_verify_item (self->jcat_context,
-						    blob, item,
-						    JCAT_VERIFY_FLAG_REQUIRE_CHECKSUM |
-						    JCAT_VERIFY_FLAG_REQUIRE_SIGNATURE,
-						    &error_local);
-		if (results == NULL) {
+		if (!fu_jcat_cache_verify_item (self->jcat_cache,
+						self->jcat_context,
+						blob, item,
+						JCAT_VERIFY_FLAG_REQUIRE_CHECKSUM |
+						JCAT_VERIFY_FLAG_REQUIRE_SIGNATURE,
+						NULL, &error_local)) {
 			g_debug ("failed to verify payload %s: %s",
 				 basename, error_local->message);
 		} else {
-			g_debug ("verified payload %s: %u",
-				 basename, results->len);
+			g_debug ("verified payload %s", basename);
 			release_flags |= FWUPD_RELEASE_FLAG_TRUSTED_PAYLOAD;
 		}
 
@@ -300,54 +359,69 @@ fu_cabinet_sort_priority_cb (XbBuilderFixup *self,
 	return TRUE;
 }
 
+/* a container checksum without a type is assumed to be SHA1 */
 static XbBuilderNode *
-_xb_builder_node_get_child_by_element_attr (XbBuilderNode *bn,
-					    const gchar *element,
-					    const gchar *attr_name,
-					    const gchar *attr_value)
+fu_cabinet_get_container_checksum_node (XbBuilderNode *bn, const gchar *kind)
 {
 	GPtrArray *bcs = xb_builder_node_get_children (bn);
 	for (guint i = 0; i < bcs->len; i++) {
 		XbBuilderNode *bc = g_ptr_array_index (bcs, i);
-		if (g_strcmp0 (xb_builder_node_get_element (bc), element) != 0)
+		const gchar *tmp;
+		if (g_strcmp0 (xb_builder_node_get_element (bc), "checksum") != 0)
+			continue;
+		if (g_strcmp0 (xb_builder_node_get_attr (bc, "target"), "container") != 0)
 			continue;
-		if (g_strcmp0 (xb_builder_node_get_attr (bc, attr_name), attr_value) == 0)
+		tmp = xb_builder_node_get_attr (bc, "type");
+		if (tmp == NULL)
+			tmp = "sha1";
+		if (g_strcmp0 (tmp, kind) == 0)
 			return g_object_ref (bc);
 	}
 	return NULL;
 }
 
-static gboolean
-fu_cabinet_set_container_checksum_cb (XbBuilderFixup *builder_fixup,
-				      XbBuilderNode *bn,
-				      gpointer user_data,
-				      GError **error)
+static void
+fu_cabinet_set_container_checksum (XbBuilderNode *bn,
+				   const gchar *kind,
+				   const gchar *checksum)
 {
-	FuCabinet *self = FU_CABINET (user_data);
 	g_autoptr(XbBuilderNode) csum = NULL;
 
-	/* not us */
-	if (g_strcmp0 (xb_builder_node_get_element (bn), "release") != 0)
-		return TRUE;
-
 	/* verify it exists */
-	csum = _xb_builder_node_get_child_by_element_attr (bn, "checksum",
-							   "type", "container");
+	csum = fu_cabinet_get_container_checksum_node (bn, kind);
 	if (csum == NULL) {
 		csum = xb_builder_node_insert (bn, "checksum",
 					       "target", "container",
+					       "type", kind,
 					       NULL);
 	}
 
 	/* verify it is correct */
-	if (g_strcmp0 (xb_builder_node_get_text (csum), self->container_checksum) != 0) {
+	if (g_strcmp0 (xb_builder_node_get_text (csum), checksum) != 0) {
 		if (xb_builder_node_get_text (csum) != NULL) {
 			g_warning ("invalid container checksum %s, fixing up to %s",
 				   xb_builder_node_get_text (csum),
-				   self->container_checksum);
+				   checksum);
 		}
-		xb_builder_node_set_text (csum, self->container_checksum, -1);
+		xb_builder_node_set_text (csum, checksum, -1);
 	}
+}
+
+static gboolean
+fu_cabinet_set_container_checksum_cb (XbBuilderFixup *builder_fixup,
+				      XbBuilderNode *bn,
+				      gpointer user_data,
+				      GError **error)
+{
+	FuCabinet *self = FU_CABINET (user_data);
+
+	/* not us */
+	if (g_strcmp0 (xb_builder_node_get_element (bn), "release") != 0)
+		return TRUE;
+
+	/* SHA1 is first for clients that only read one */
+	fu_cabinet_set_container_checksum (bn, "sha1", self->container_checksum);
+	fu_cabinet_set_container_checksum (bn, "sha256", self->container_checksum_sha256);
 	return TRUE;
 }
 
@@ -412,19 +486,17 @@ fu_cabinet_build_silo_metainfo (FuCabinet *self, GCabFile *cabfile, GError **err
 		g_debug ("failed to verify %s: no JcatItem", fn);
 	} else {
 		g_autoptr(GError) error_local = NULL;
-		g_autoptr(GPtrArray) results = NULL;
-		results = jcat_context_verify_item (self->jcat_context,
-						    gcab_file_get_bytes (cabfile),
-						    item,
-						    JCAT_VERIFY_FLAG_REQUIRE_CHECKSUM |
-						    JCAT_VERIFY_FLAG_REQUIRE_SIGNATURE,
-						    &error_local);
-		if (results == NULL) {
+		if (!fu_jcat_cache_verify_item (self->jcat_cache,
+						self->jcat_context,
+						gcab_file_get_bytes (cabfile),
+						item,
+						JCAT_VERIFY_FLAG_REQUIRE_CHECKSUM |
+						JCAT_VERIFY_FLAG_REQUIRE_SIGNATURE,
+						NULL, &error_local)) {
 			g_debug ("failed to verify %s: %s",
 				 fn, error_local->message);
 		} else {
-			g_debug ("verified metadata %s: %u",
-				 fn, results->len);
+			g_debug ("verified metadata %s", fn);
 			release_flags |= FWUPD_RELEASE_FLAG_TRUSTED_METADATA;
 		}
 	}
@@ -657,6 +729,8 @@ fu_cabinet_parse (FuCabinet *self,
 		  FuCabinetParseFlags flags,
 		  GError **error)
 {
+	GChecksumType checksum_types[] = { G_CHECKSUM_SHA1, G_CHECKSUM_SHA256 };
+	g_auto(GStrv) checksums = NULL;
 	g_autoptr(GError) error_local = NULL;
 	g_autoptr(GPtrArray) components = NULL;
 	g_autoptr(XbQuery) query = NULL;
@@ -671,7 +745,10 @@ fu_cabinet_parse (FuCabinet *self,
 		return FALSE;
 
 	/* build xmlb silo */
-	self->container_checksum = g_compute_checksum_for_bytes (G_CHECKSUM_SHA1, data);
+	checksums = fu_common_get_checksums_for_bytes (data, checksum_types,
+						       G_N_ELEMENTS (checksum_types));
+	self->container_checksum = g_strdup (checksums[0]);
+	self->container_checksum_sha256 = g_strdup (checksums[1]);
 	if (!fu_cabinet_build_silo (self, data, error))
 		return FALSE;
 
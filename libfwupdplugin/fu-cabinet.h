@@ -10,6 +10,8 @@
 #include <xmlb.h>
 #include <jcat.h>
 
+#include "fu-jcat-cache.h"
+
 #define FU_TYPE_CABINET (fu_cabinet_get_type ())
 
 G_DECLARE_FINAL_TYPE (FuCabinet, fu_cabinet, FU, CABINET, GObject)
@@ -31,8 +33,12 @@ void		 fu_cabinet_set_size_max	(FuCabinet		*self,
 						 guint64		 size_max);
 void		 fu_cabinet_set_jcat_context	(FuCabinet		*self,
 						 JcatContext		*jcat_context);
+void		 fu_cabinet_set_jcat_cache	(FuCabinet		*self,
+						 FuJcatCache		*jcat_cache);
 gboolean	 fu_cabinet_parse		(FuCabinet		*self,
 						 GBytes			*data,
 						 FuCabinetParseFlags	 flags,
 						 GError			**error);
 XbSilo		*fu_cabinet_get_silo		(FuCabinet		*self);
+const gchar	*fu_cabinet_get_container_checksum (FuCabinet		*self,
+						 GChecksumType		 checksum_type);
@@ -18,6 +18,9 @@
  *
  * An object that represents a packet of data.
  *
+ * Packets created with fu_chunk_new() are owned by the caller and freed with
+ * g_free(). Packets in an array returned from fu_chunk_array_new() are owned
+ * by the array, and are only valid for as long as the array is.
  */
 
 /**
@@ -103,6 +106,160 @@ fu_chunk_array_to_string (GPtrArray *chunks)
 	return g_string_free (str, FALSE);
 }
 
+/* all the chunks of an array share one allocation, which is freed when the
+ * last chunk has been removed from the array; each chunk carries a pointer
+ * back to the block so that callers are free to modify the #FuChunk */
+typedef struct _FuChunkBlock FuChunkBlock;
+
+typedef struct {
+	FuChunkBlock	*block;
+	FuChunk		 chunk;
+} FuChunkBlockEntry;
+
+struct _FuChunkBlock {
+	gint		 refcount;	/* atomic */
+	FuChunkBlockEntry entries[];
+};
+
+static void
+fu_chunk_block_unref (gpointer data)
+{
+	FuChunkBlockEntry *entry = (FuChunkBlockEntry *) ((guint8 *) data -
+							  G_STRUCT_OFFSET (FuChunkBlockEntry, chunk));
+	FuChunkBlock *block = entry->block;
+	if (g_atomic_int_dec_and_test (&block->refcount))
+		g_free (block);
+}
+
+static guint32
+fu_chunk_count_for_page (guint32 data_sz, guint32 packet_sz)
+{
+	if (packet_sz == 0)
+		return 1;
+	return (data_sz / packet_sz) + (data_sz % packet_sz > 0 ? 1 : 0);
+}
+
+/**
+ * fu_chunk_iter_init:
+ * @iter: an uninitialized #FuChunkIter
+ * @data: a linear blob of memory, or %NULL
+ * @data_sz: size of @data_sz
+ * @addr_start: the hardware address offset, or 0
+ * @page_sz: the hardware page size, or 0
+ * @packet_sz: the transfer size, or 0
+ *
+ * Initializes an iterator that splits a linear blob of memory into packets
+ * without allocating any memory, ensuring each packet does not cross a page
+ * boundary and is less that a specific transfer size.
+ *
+ * This produces the same packets as fu_chunk_array_new() and should be used
+ * when the blob is large and the packets are only needed one at a time.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_chunk_iter_init (FuChunkIter *iter,
+		    const guint8 *data,
+		    guint32 data_sz,
+		    guint32 addr_start,
+		    guint32 page_sz,
+		    guint32 packet_sz)
+{
+	g_return_if_fail (iter != NULL);
+	iter->data = data;
+	iter->data_sz = data_sz;
+	iter->addr_start = addr_start;
+	iter->page_sz = page_sz;
+	iter->packet_sz = packet_sz;
+	iter->offset = 0;
+	iter->idx = 0;
+}
+
+/**
+ * fu_chunk_iter_next:
+ * @iter: a #FuChunkIter
+ * @item: (out caller-allocates): a #FuChunk
+ *
+ * Gets the next packet from the iterator. The data in @item points into
+ * the blob passed to fu_chunk_iter_init() and is not copied.
+ *
+ * Return value: %TRUE if @item was set, %FALSE if there are no more packets
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_chunk_iter_next (FuChunkIter *iter, FuChunk *item)
+{
+	guint64 addr;
+	guint32 address;
+	guint32 page = 0;
+	guint32 sz;
+
+	g_return_val_if_fail (iter != NULL, FALSE);
+	g_return_val_if_fail (item != NULL, FALSE);
+
+	/* done */
+	if (iter->offset >= iter->data_sz)
+		return FALSE;
+
+	/* do not cross a page or packet boundary */
+	addr = (guint64) iter->addr_start + iter->offset;
+	address = (guint32) addr;
+	sz = iter->data_sz - iter->offset;
+	if (iter->page_sz > 0) {
+		page = (guint32) (addr / iter->page_sz);
+		address = (guint32) (addr % iter->page_sz);
+		sz = MIN (sz, iter->page_sz - address);
+	}
+	if (iter->packet_sz > 0)
+		sz = MIN (sz, iter->packet_sz);
+
+	item->idx = iter->idx++;
+	item->page = page;
+	item->address = address;
+	item->data = iter->data != NULL ? iter->data + iter->offset : NULL;
+	item->data_sz = sz;
+	iter->offset += sz;
+	return TRUE;
+}
+
+/**
+ * fu_chunk_iter_get_count:
+ * @iter: a #FuChunkIter
+ *
+ * Gets the total number of packets the iterator will produce, which can be
+ * used for progress reporting. This is calculated without iterating.
+ *
+ * Return value: integer
+ *
+ * Since: 1.5.0
+ **/
+guint32
+fu_chunk_iter_get_count (FuChunkIter *iter)
+{
+	guint32 first;
+	guint32 remaining;
+	guint32 cnt;
+
+	g_return_val_if_fail (iter != NULL, 0);
+
+	if (iter->data_sz == 0)
+		return 0;
+	if (iter->page_sz == 0)
+		return fu_chunk_count_for_page (iter->data_sz, iter->packet_sz);
+
+	/* partial first page, whole pages, then partial last page */
+	first = iter->page_sz - (guint32) (((guint64) iter->addr_start) % iter->page_sz);
+	first = MIN (first, iter->data_sz);
+	cnt = fu_chunk_count_for_page (first, iter->packet_sz);
+	remaining = iter->data_sz - first;
+	cnt += (remaining / iter->page_sz) *
+	       fu_chunk_count_for_page (iter->page_sz, iter->packet_sz);
+	if (remaining % iter->page_sz > 0)
+		cnt += fu_chunk_count_for_page (remaining % iter->page_sz, iter->packet_sz);
+	return cnt;
+}
+
 /**
  * fu_chunk_array_new: (skip):
  * @data: a linear blob of memory, or %NULL
@@ -114,6 +271,13 @@ fu_chunk_array_to_string (GPtrArray *chunks)
  * Chunks a linear blob of memory into packets, ensuring each packet does not
  * cross a package boundary and is less that a specific transfer size.
  *
+ * All the packets are stored in a single allocation and the packet data is not
+ * copied.
+ *
+ * Since 1.5.0 the packets are owned by the array: they can be modified, or
+ * removed with g_ptr_array_remove_index() and friends, but they must not be
+ * stolen from the array, freed with g_free() or added to another array.
+ *
  * Return value: (transfer container) (element-type FuChunk): array of packets
  *
  * Since: 1.1.2
@@ -125,66 +289,31 @@ fu_chunk_array_new (const guint8 *data,
 		    guint32 page_sz,
 		    guint32 packet_sz)
 {
-	GPtrArray *segments = NULL;
-	guint32 page_old = G_MAXUINT32;
-	guint32 idx;
-	guint32 last_flush = 0;
+	FuChunkBlock *block;
+	FuChunkIter iter;
+	GPtrArray *chunks;
+	guint32 cnt;
 
 	g_return_val_if_fail (data_sz > 0, NULL);
 
-	segments = g_ptr_array_new_with_free_func (g_free);
-	for (idx = 1; idx < data_sz; idx++) {
-		guint32 page = 0;
-		if (page_sz > 0)
-			page = (addr_start + idx) / page_sz;
-		if (page_old == G_MAXUINT32) {
-			page_old = page;
-		} else if (page != page_old) {
-			const guint8 *data_offset = data != NULL ? data + last_flush : 0x0;
-			guint32 address_offset = addr_start + last_flush;
-			if (page_sz > 0)
-				address_offset %= page_sz;
-			g_ptr_array_add (segments,
-					 fu_chunk_new (segments->len,
-						       page_old,
-						       address_offset,
-						       data_offset,
-						       idx - last_flush));
-			last_flush = idx;
-			page_old = page;
-			continue;
-		}
-		if (packet_sz > 0 && idx - last_flush >= packet_sz) {
-			const guint8 *data_offset = data != NULL ? data + last_flush : 0x0;
-			guint32 address_offset = addr_start + last_flush;
-			if (page_sz > 0)
-				address_offset %= page_sz;
-			g_ptr_array_add (segments,
-					 fu_chunk_new (segments->len,
-						       page,
-						       address_offset,
-						       data_offset,
-						       idx - last_flush));
-			last_flush = idx;
-			continue;
+	fu_chunk_iter_init (&iter, data, data_sz, addr_start, page_sz, packet_sz);
+	cnt = fu_chunk_iter_get_count (&iter);
+	block = g_malloc (sizeof(FuChunkBlock) + (gsize) cnt * sizeof(FuChunkBlockEntry));
+	block->refcount = (gint) cnt;
+	chunks = g_ptr_array_new_full (cnt, fu_chunk_block_unref);
+	for (guint32 i = 0; i < cnt; i++) {
+		FuChunkBlockEntry *entry = &block->entries[i];
+		entry->block = block;
+		if (!fu_chunk_iter_next (&iter, &entry->chunk)) {
+			g_critical ("expected %u chunks, got %u", cnt, i);
+			block->refcount = (gint) i;
+			if (i == 0)
+				g_free (block);
+			break;
 		}
+		g_ptr_array_add (chunks, &entry->chunk);
 	}
-	if (last_flush != idx) {
-		const guint8 *data_offset = data != NULL ? data + last_flush : 0x0;
-		guint32 address_offset = addr_start + last_flush;
-		guint32 page = 0;
-		if (page_sz > 0) {
-			address_offset %= page_sz;
-			page = (addr_start + (idx - 1)) / page_sz;
-		}
-		g_ptr_array_add (segments,
-				 fu_chunk_new (segments->len,
-					       page,
-					       address_offset,
-					       data_offset,
-					       data_sz - last_flush));
-	}
-	return segments;
+	return chunks;
 }
 
 /**
@@ -197,6 +326,8 @@ fu_chunk_array_new (const guint8 *data,
  * Chunks a linear blob of memory into packets, ensuring each packet does not
  * cross a package boundary and is less that a specific transfer size.
  *
+ * The packets are owned by the array, see fu_chunk_array_new() for details.
+ *
  * Return value: (transfer container) (element-type FuChunk): array of packets
  *
  * Since: 1.1.2
@@ -36,8 +36,7 @@
 #include "fu-volume-private.h"
 
 #define UDISKS_DBUS_SERVICE		"org.freedesktop.UDisks2"
-#define UDISKS_DBUS_PATH		"/org/freedesktop/UDisks2/Manager"
-#define UDISKS_DBUS_MANAGER_INTERFACE	"org.freedesktop.UDisks2.Manager"
+#define UDISKS_DBUS_OBJECT_PATH		"/org/freedesktop/UDisks2"
 #define UDISKS_DBUS_PART_INTERFACE 	"org.freedesktop.UDisks2.Partition"
 #define UDISKS_DBUS_FILE_INTERFACE	"org.freedesktop.UDisks2.Filesystem"
 
@@ -571,171 +570,372 @@ fu_common_firmware_builder (GBytes *bytes,
 }
 
 typedef struct {
-	FuOutputHandler		 handler_cb;
-	gpointer		 handler_user_data;
-	GMainLoop		*loop;
-	GSource			*source;
-	GInputStream		*stream;
-	GCancellable		*cancellable;
-	guint			 timeout_id;
-} FuCommonSpawnHelper;
+	GBytes			*bytes;
+	gchar			*script_fn;
+	gchar			*output_fn;
+} FuCommonBuilderHelper;
 
-static void fu_common_spawn_create_pollable_source (FuCommonSpawnHelper *helper);
+static void
+fu_common_builder_helper_free (FuCommonBuilderHelper *helper)
+{
+	g_bytes_unref (helper->bytes);
+	g_free (helper->script_fn);
+	g_free (helper->output_fn);
+	g_free (helper);
+}
 
-static gboolean
-fu_common_spawn_source_pollable_cb (GObject *stream, gpointer user_data)
+static void
+fu_common_firmware_builder_thread_cb (gpointer data, gpointer user_data)
 {
-	FuCommonSpawnHelper *helper = (FuCommonSpawnHelper *) user_data;
-	gchar buffer[1024];
-	gssize sz;
-	g_auto(GStrv) split = NULL;
+	g_autoptr(GTask) task = G_TASK (data);
+	FuCommonBuilderHelper *helper = g_task_get_task_data (task);
+	g_autoptr(GBytes) blob = NULL;
 	g_autoptr(GError) error = NULL;
 
-	/* read from stream */
-	sz = g_pollable_input_stream_read_nonblocking (G_POLLABLE_INPUT_STREAM (stream),
-						       buffer,
-						       sizeof(buffer) - 1,
-						       NULL,
-						       &error);
-	if (sz < 0) {
-		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK)) {
-			g_warning ("failed to get read from nonblocking fd: %s",
-				   error->message);
-		}
-		return G_SOURCE_REMOVE;
+	if (g_task_return_error_if_cancelled (task))
+		return;
+	blob = fu_common_firmware_builder (helper->bytes,
+					   helper->script_fn,
+					   helper->output_fn,
+					   &error);
+	if (blob == NULL) {
+		g_task_return_error (task, g_steal_pointer (&error));
+		return;
 	}
+	g_task_return_pointer (task, g_steal_pointer (&blob),
+			       (GDestroyNotify) g_bytes_unref);
+}
 
-	/* no read possible */
-	if (sz == 0)
-		g_main_loop_quit (helper->loop);
-
-	/* emit lines */
-	if (helper->handler_cb != NULL) {
-		buffer[sz] = '\0';
-		split = g_strsplit (buffer, "\n", -1);
-		for (guint i = 0; split[i] != NULL; i++) {
-			if (split[i][0] == '\0')
-				continue;
-			helper->handler_cb (split[i], helper->handler_user_data);
-		}
+/* each builder extracts an archive and runs a container, so do not run
+ * more at once than there are CPUs */
+static GThreadPool *
+fu_common_firmware_builder_get_pool (void)
+{
+	static gsize pool_once = 0;
+	static GThreadPool *pool = NULL;
+	if (g_once_init_enter (&pool_once)) {
+		pool = g_thread_pool_new (fu_common_firmware_builder_thread_cb, NULL,
+					  (gint) g_get_num_processors (), FALSE, NULL);
+		g_once_init_leave (&pool_once, 1);
 	}
+	return pool;
+}
 
-	/* set up the source for the next read */
-	fu_common_spawn_create_pollable_source (helper);
-	return G_SOURCE_REMOVE;
+/**
+ * fu_common_firmware_builder_async:
+ * @bytes: The data to use
+ * @script_fn: Name of the script to run in the tarball, e.g. `startup.sh`
+ * @output_fn: Name of the generated firmware, e.g. `firmware.bin`
+ * @cancellable: a #GCancellable, or %NULL
+ * @callback: the function to run on completion
+ * @user_data: the data to pass to @callback
+ *
+ * Runs fu_common_firmware_builder() on a worker thread. Builders are queued
+ * so that no more run at the same time than there are CPUs.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_common_firmware_builder_async (GBytes *bytes,
+				  const gchar *script_fn,
+				  const gchar *output_fn,
+				  GCancellable *cancellable,
+				  GAsyncReadyCallback callback,
+				  gpointer user_data)
+{
+	FuCommonBuilderHelper *helper;
+	GTask *task;
+
+	g_return_if_fail (bytes != NULL);
+	g_return_if_fail (script_fn != NULL);
+	g_return_if_fail (output_fn != NULL);
+
+	helper = g_new0 (FuCommonBuilderHelper, 1);
+	helper->bytes = g_bytes_ref (bytes);
+	helper->script_fn = g_strdup (script_fn);
+	helper->output_fn = g_strdup (output_fn);
+	task = g_task_new (NULL, cancellable, callback, user_data);
+	g_task_set_task_data (task, helper, (GDestroyNotify) fu_common_builder_helper_free);
+	g_thread_pool_push (fu_common_firmware_builder_get_pool (), task, NULL);
 }
 
-static void
-fu_common_spawn_create_pollable_source (FuCommonSpawnHelper *helper)
+/**
+ * fu_common_firmware_builder_finish:
+ * @res: a #GAsyncResult
+ * @error: A #GError or %NULL
+ *
+ * Gets the result of fu_common_firmware_builder_async().
+ *
+ * Returns: a new #GBytes, or %NULL for error
+ *
+ * Since: 1.5.0
+ **/
+GBytes *
+fu_common_firmware_builder_finish (GAsyncResult *res, GError **error)
 {
-	if (helper->source != NULL)
-		g_source_destroy (helper->source);
-	helper->source = g_pollable_input_stream_create_source (G_POLLABLE_INPUT_STREAM (helper->stream),
-								helper->cancellable);
-	g_source_attach (helper->source, NULL);
-	g_source_set_callback (helper->source, (GSourceFunc) fu_common_spawn_source_pollable_cb, helper, NULL);
+	g_return_val_if_fail (G_IS_TASK (res), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+	return g_task_propagate_pointer (G_TASK (res), error);
 }
 
+typedef struct {
+	FuOutputHandler		 handler_cb;
+	gpointer		 handler_user_data;
+	GSubprocess		*subprocess;
+	GDataInputStream	*stream;
+	GCancellable		*cancellable;		/* internal */
+	GCancellable		*cancellable_parent;	/* (nullable) */
+	gulong			 cancellable_id;
+	gulong			 cancellable_parent_id;
+	GSource			*timeout_source;
+} FuCommonSpawnHelper;
+
 static void
 fu_common_spawn_helper_free (FuCommonSpawnHelper *helper)
 {
+	if (helper->cancellable_parent != NULL) {
+		g_cancellable_disconnect (helper->cancellable_parent,
+					  helper->cancellable_parent_id);
+		g_object_unref (helper->cancellable_parent);
+	}
+	g_cancellable_disconnect (helper->cancellable, helper->cancellable_id);
 	g_object_unref (helper->cancellable);
+	if (helper->timeout_source != NULL) {
+		g_source_destroy (helper->timeout_source);
+		g_source_unref (helper->timeout_source);
+	}
 	if (helper->stream != NULL)
 		g_object_unref (helper->stream);
-	if (helper->source != NULL)
-		g_source_destroy (helper->source);
-	if (helper->loop != NULL)
-		g_main_loop_unref (helper->loop);
-	if (helper->timeout_id != 0)
-		g_source_remove (helper->timeout_id);
+	g_object_unref (helper->subprocess);
 	g_free (helper);
 }
 
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wunused-function"
-G_DEFINE_AUTOPTR_CLEANUP_FUNC(FuCommonSpawnHelper, fu_common_spawn_helper_free)
-#pragma clang diagnostic pop
-
 static gboolean
 fu_common_spawn_timeout_cb (gpointer user_data)
 {
 	FuCommonSpawnHelper *helper = (FuCommonSpawnHelper *) user_data;
+	g_debug ("timed out, cancelling");
 	g_cancellable_cancel (helper->cancellable);
-	g_main_loop_quit (helper->loop);
-	helper->timeout_id = 0;
 	return G_SOURCE_REMOVE;
 }
 
 static void
-fu_common_spawn_cancelled_cb (GCancellable *cancellable, FuCommonSpawnHelper *helper)
+fu_common_spawn_parent_cancelled_cb (GCancellable *cancellable, FuCommonSpawnHelper *helper)
 {
 	/* just propagate */
 	g_cancellable_cancel (helper->cancellable);
 }
 
+static void
+fu_common_spawn_cancelled_cb (GCancellable *cancellable, FuCommonSpawnHelper *helper)
+{
+	/* do not leave the process running */
+	g_subprocess_force_exit (helper->subprocess);
+}
+
+static void
+fu_common_spawn_wait_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	g_autoptr(GTask) task = G_TASK (user_data);
+	FuCommonSpawnHelper *helper = g_task_get_task_data (task);
+	g_autoptr(GError) error = NULL;
+
+	if (g_cancellable_set_error_if_cancelled (helper->cancellable, &error)) {
+		g_task_return_error (task, g_steal_pointer (&error));
+		return;
+	}
+	if (!g_subprocess_wait_check_finish (G_SUBPROCESS (source), res, &error)) {
+		g_task_return_error (task, g_steal_pointer (&error));
+		return;
+	}
+	g_task_return_boolean (task, TRUE);
+}
+
+static void
+fu_common_spawn_read_line_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	g_autoptr(GTask) task = G_TASK (user_data);
+	FuCommonSpawnHelper *helper = g_task_get_task_data (task);
+	g_autofree gchar *line = NULL;
+	g_autoptr(GError) error = NULL;
+
+	line = g_data_input_stream_read_line_finish (G_DATA_INPUT_STREAM (source),
+						     res, NULL, &error);
+	if (error != NULL) {
+		g_task_return_error (task, g_steal_pointer (&error));
+		return;
+	}
+
+	/* no more output, so wait for the process to exit */
+	if (line == NULL) {
+		g_subprocess_wait_check_async (helper->subprocess,
+					       helper->cancellable,
+					       fu_common_spawn_wait_cb,
+					       g_steal_pointer (&task));
+		return;
+	}
+
+	/* emit lines */
+	if (helper->handler_cb != NULL && line[0] != '\0')
+		helper->handler_cb (line, helper->handler_user_data);
+	g_data_input_stream_read_line_async (helper->stream,
+					     G_PRIORITY_DEFAULT,
+					     helper->cancellable,
+					     fu_common_spawn_read_line_cb,
+					     g_steal_pointer (&task));
+}
+
 /**
- * fu_common_spawn_sync:
+ * fu_common_spawn_async:
  * @argv: The argument list to run
- * @handler_cb: (scope call): A #FuOutputHandler or %NULL
+ * @handler_cb: (scope async): A #FuOutputHandler or %NULL
  * @handler_user_data: the user data to pass to @handler_cb
  * @timeout_ms: a timeout in ms, or 0 for no limit
  * @cancellable: a #GCancellable, or %NULL
- * @error: A #GError or %NULL
+ * @callback: the function to run on completion
+ * @user_data: the data to pass to @callback
  *
- * Runs a subprocess and waits for it to exit. Any output on standard out or
- * standard error will be forwarded to @handler_cb as whole lines.
+ * Runs a subprocess without waiting for it to exit. Any output on standard
+ * out or standard error will be forwarded to @handler_cb as whole lines as
+ * soon as it is read. The process is killed if @cancellable is cancelled or
+ * if @timeout_ms is reached.
  *
- * Returns: %TRUE for success
+ * @handler_user_data has to remain valid until @callback has been called.
  *
- * Since: 0.9.7
+ * Since: 1.5.0
  **/
-gboolean
-fu_common_spawn_sync (const gchar * const * argv,
-		      FuOutputHandler handler_cb,
-		      gpointer handler_user_data,
-		      guint timeout_ms,
-		      GCancellable *cancellable, GError **error)
-{
-	g_autoptr(FuCommonSpawnHelper) helper = NULL;
-	g_autoptr(GSubprocess) subprocess = NULL;
+void
+fu_common_spawn_async (const gchar * const * argv,
+		       FuOutputHandler handler_cb,
+		       gpointer handler_user_data,
+		       guint timeout_ms,
+		       GCancellable *cancellable,
+		       GAsyncReadyCallback callback,
+		       gpointer user_data)
+{
+	FuCommonSpawnHelper *helper;
 	g_autofree gchar *argv_str = NULL;
-	gulong cancellable_id = 0;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GSubprocess) subprocess = NULL;
+	g_autoptr(GTask) task = g_task_new (NULL, cancellable, callback, user_data);
+
+	g_return_if_fail (argv != NULL);
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
 
 	/* create subprocess */
 	argv_str = g_strjoinv (" ", (gchar **) argv);
 	g_debug ("running '%s'", argv_str);
 	subprocess = g_subprocess_newv (argv, G_SUBPROCESS_FLAGS_STDOUT_PIPE |
-					      G_SUBPROCESS_FLAGS_STDERR_MERGE, error);
-	if (subprocess == NULL)
-		return FALSE;
-
-	/* watch for process to exit */
+					      G_SUBPROCESS_FLAGS_STDERR_MERGE, &error);
+	if (subprocess == NULL) {
+		g_task_return_error (task, g_steal_pointer (&error));
+		return;
+	}
 	helper = g_new0 (FuCommonSpawnHelper, 1);
 	helper->handler_cb = handler_cb;
 	helper->handler_user_data = handler_user_data;
-	helper->loop = g_main_loop_new (NULL, FALSE);
-	helper->stream = g_subprocess_get_stdout_pipe (subprocess);
+	helper->subprocess = g_steal_pointer (&subprocess);
+	helper->stream = g_data_input_stream_new (g_subprocess_get_stdout_pipe (helper->subprocess));
+	g_task_set_task_data (task, helper, (GDestroyNotify) fu_common_spawn_helper_free);
 
 	/* always create a cancellable, and connect up the parent */
 	helper->cancellable = g_cancellable_new ();
-	if (cancellable != NULL) {
-		cancellable_id = g_cancellable_connect (cancellable,
+	helper->cancellable_id = g_cancellable_connect (helper->cancellable,
 							G_CALLBACK (fu_common_spawn_cancelled_cb),
 							helper, NULL);
+	if (cancellable != NULL) {
+		helper->cancellable_parent = g_object_ref (cancellable);
+		helper->cancellable_parent_id =
+			g_cancellable_connect (cancellable,
+					       G_CALLBACK (fu_common_spawn_parent_cancelled_cb),
+					       helper, NULL);
 	}
 
 	/* allow timeout */
 	if (timeout_ms > 0) {
-		helper->timeout_id = g_timeout_add (timeout_ms,
-						    fu_common_spawn_timeout_cb,
-						    helper);
-	}
-	fu_common_spawn_create_pollable_source (helper);
-	g_main_loop_run (helper->loop);
-	g_cancellable_disconnect (cancellable, cancellable_id);
-	if (g_cancellable_set_error_if_cancelled (helper->cancellable, error))
-		return FALSE;
-	return g_subprocess_wait_check (subprocess, cancellable, error);
+		helper->timeout_source = g_timeout_source_new (timeout_ms);
+		g_source_set_callback (helper->timeout_source,
+				       fu_common_spawn_timeout_cb,
+				       helper, NULL);
+		g_source_attach (helper->timeout_source,
+				 g_main_context_get_thread_default ());
+	}
+	g_data_input_stream_read_line_async (helper->stream,
+					     G_PRIORITY_DEFAULT,
+					     helper->cancellable,
+					     fu_common_spawn_read_line_cb,
+					     g_steal_pointer (&task));
+}
+
+/**
+ * fu_common_spawn_finish:
+ * @res: a #GAsyncResult
+ * @error: A #GError or %NULL
+ *
+ * Gets the result of fu_common_spawn_async().
+ *
+ * Returns: %TRUE if the process exited successfully
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_common_spawn_finish (GAsyncResult *res, GError **error)
+{
+	g_return_val_if_fail (G_IS_TASK (res), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+	return g_task_propagate_boolean (G_TASK (res), error);
+}
+
+typedef struct {
+	GMainLoop		*loop;
+	GAsyncResult		*res;
+} FuCommonSyncHelper;
+
+static void
+fu_common_sync_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	FuCommonSyncHelper *helper = (FuCommonSyncHelper *) user_data;
+	helper->res = g_object_ref (res);
+	g_main_loop_quit (helper->loop);
+}
+
+/**
+ * fu_common_spawn_sync:
+ * @argv: The argument list to run
+ * @handler_cb: (scope call): A #FuOutputHandler or %NULL
+ * @handler_user_data: the user data to pass to @handler_cb
+ * @timeout_ms: a timeout in ms, or 0 for no limit
+ * @cancellable: a #GCancellable, or %NULL
+ * @error: A #GError or %NULL
+ *
+ * Runs a subprocess and waits for it to exit. Any output on standard out or
+ * standard error will be forwarded to @handler_cb as whole lines.
+ *
+ * The thread-default main context is iterated while waiting; use
+ * fu_common_spawn_async() to avoid this.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 0.9.7
+ **/
+gboolean
+fu_common_spawn_sync (const gchar * const * argv,
+		      FuOutputHandler handler_cb,
+		      gpointer handler_user_data,
+		      guint timeout_ms,
+		      GCancellable *cancellable, GError **error)
+{
+	FuCommonSyncHelper helper = { NULL };
+	gboolean ret;
+
+	helper.loop = g_main_loop_new (g_main_context_get_thread_default (), FALSE);
+	fu_common_spawn_async (argv, handler_cb, handler_user_data, timeout_ms,
+			       cancellable, fu_common_sync_cb, &helper);
+	g_main_loop_run (helper.loop);
+	ret = fu_common_spawn_finish (helper.res, error);
+	g_object_unref (helper.res);
+	g_main_loop_unref (helper.loop);
+	return ret;
 }
 
 /**
@@ -1631,6 +1831,86 @@ fu_common_bytes_pad (GBytes *bytes, gsize sz)
 	return g_bytes_ref (bytes);
 }
 
+/* hashing in chunks keeps the data in the CPU cache for each digest */
+#define FU_COMMON_CHECKSUM_CHUNK_SIZE		0x10000
+#define FU_COMMON_CHECKSUM_THREAD_MIN		0x1000000
+
+typedef struct {
+	GBytes		*blob;
+	GChecksum	*csum;
+} FuCommonChecksumHelper;
+
+static gpointer
+fu_common_get_checksums_thread_cb (gpointer user_data)
+{
+	FuCommonChecksumHelper *helper = (FuCommonChecksumHelper *) user_data;
+	g_checksum_update (helper->csum,
+			   g_bytes_get_data (helper->blob, NULL),
+			   g_bytes_get_size (helper->blob));
+	return NULL;
+}
+
+/**
+ * fu_common_get_checksums_for_bytes:
+ * @blob: A #GBytes
+ * @checksum_types: (array length=checksum_types_len): #GChecksumType values, e.g. %G_CHECKSUM_SHA1
+ * @checksum_types_len: the number of items in @checksum_types
+ *
+ * Computes several checksums of the same data, reading the data only once.
+ * Large blobs are hashed using one thread for each checksum type.
+ *
+ * Returns: (transfer full): the checksums as hex strings, in the same order
+ * as @checksum_types
+ *
+ * Since: 1.5.0
+ **/
+gchar **
+fu_common_get_checksums_for_bytes (GBytes *blob,
+				   const GChecksumType *checksum_types,
+				   guint checksum_types_len)
+{
+	const guint8 *buf;
+	gsize bufsz = 0;
+	guint csumsz = checksum_types_len;
+	gchar **checksums;
+	g_autoptr(GPtrArray) csums = g_ptr_array_new_with_free_func ((GDestroyNotify) g_checksum_free);
+
+	g_return_val_if_fail (blob != NULL, NULL);
+	g_return_val_if_fail (checksum_types != NULL || checksum_types_len == 0, NULL);
+
+	/* G_CHECKSUM_MD5 is zero, so the array cannot be zero-terminated */
+	for (guint i = 0; i < checksum_types_len; i++)
+		g_ptr_array_add (csums, g_checksum_new (checksum_types[i]));
+
+	/* the digests cannot be split, so run each one in parallel */
+	buf = g_bytes_get_data (blob, &bufsz);
+	if (bufsz >= FU_COMMON_CHECKSUM_THREAD_MIN && csumsz > 1) {
+		g_autofree FuCommonChecksumHelper *helpers = g_new0 (FuCommonChecksumHelper, csumsz);
+		g_autofree GThread **threads = g_new0 (GThread *, csumsz);
+		for (guint i = 0; i < csumsz; i++) {
+			helpers[i].blob = blob;
+			helpers[i].csum = g_ptr_array_index (csums, i);
+			threads[i] = g_thread_new ("fu-checksum",
+						   fu_common_get_checksums_thread_cb,
+						   &helpers[i]);
+		}
+		for (guint i = 0; i < csumsz; i++)
+			g_thread_join (threads[i]);
+	} else {
+		for (gsize off = 0; off < bufsz; off += FU_COMMON_CHECKSUM_CHUNK_SIZE) {
+			gsize chunksz = MIN (bufsz - off, FU_COMMON_CHECKSUM_CHUNK_SIZE);
+			for (guint i = 0; i < csumsz; i++)
+				g_checksum_update (g_ptr_array_index (csums, i), buf + off, chunksz);
+		}
+	}
+
+	/* success */
+	checksums = g_new0 (gchar *, csumsz + 1);
+	for (guint i = 0; i < csumsz; i++)
+		checksums[i] = g_strdup (g_checksum_get_string (g_ptr_array_index (csums, i)));
+	return checksums;
+}
+
 /**
  * fu_common_realpath:
  * @filename: a filename
@@ -2145,40 +2425,168 @@ fu_common_is_live_media (void)
 	return FALSE;
 }
 
-static GPtrArray *
-fu_common_get_block_devices (GDBusConnection *connection, GError **error)
-{
-	GVariantBuilder builder;
-	const gchar *obj;
-	g_autoptr(GVariant) output = NULL;
-	g_autoptr(GDBusProxy) proxy = NULL;
-	g_autoptr(GPtrArray) devices = NULL;
-	g_autoptr(GVariantIter) iter = NULL;
-
-	proxy = g_dbus_proxy_new_sync (connection,
-				       G_DBUS_PROXY_FLAGS_NONE, NULL,
-				       UDISKS_DBUS_SERVICE,
-				       UDISKS_DBUS_PATH,
-				       UDISKS_DBUS_MANAGER_INTERFACE,
-				       NULL, error);
-	if (proxy == NULL) {
-		g_prefix_error (error, "failed to find %s: ", UDISKS_DBUS_SERVICE);
-		return NULL;
+/* all the UDisks objects are fetched with one GetManagedObjects call and then
+ * kept up to date using signals; the partition index is rebuilt on demand */
+static GMutex udisks_mutex;
+static GDBusObjectManager *udisks_manager = NULL;
+static GHashTable *udisks_volumes_by_kind = NULL;	/* kind:GPtrArray of GDBusProxy */
+
+static void
+fu_common_udisks_changed_cb (GDBusObjectManager *manager)
+{
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&udisks_mutex);
+	g_clear_pointer (&udisks_volumes_by_kind, g_hash_table_unref);
+}
+
+static gint
+fu_common_udisks_proxy_sort_cb (gconstpointer a, gconstpointer b)
+{
+	GDBusProxy *proxy_a = *((GDBusProxy **) a);
+	GDBusProxy *proxy_b = *((GDBusProxy **) b);
+	return g_strcmp0 (g_dbus_proxy_get_object_path (proxy_a),
+			  g_dbus_proxy_get_object_path (proxy_b));
+}
+
+static GHashTable *
+fu_common_udisks_build_index (GDBusObjectManager *manager)
+{
+	GDBusConnection *connection;
+	GHashTable *volumes_by_kind;
+	GHashTableIter iter;
+	gpointer value;
+	GList *objs = g_dbus_object_manager_get_objects (manager);
+
+	connection = g_dbus_object_manager_client_get_connection (G_DBUS_OBJECT_MANAGER_CLIENT (manager));
+	volumes_by_kind = g_hash_table_new_full (g_str_hash, g_str_equal,
+						 g_free, (GDestroyNotify) g_ptr_array_unref);
+	for (GList *l = objs; l != NULL; l = l->next) {
+		GDBusObject *obj = G_DBUS_OBJECT (l->data);
+		GPtrArray *proxies;
+		const gchar *type_str;
+		g_autoptr(GDBusInterface) iface_part = NULL;
+		g_autoptr(GDBusInterface) iface_file = NULL;
+		g_autoptr(GVariant) val = NULL;
+
+		iface_part = g_dbus_object_get_interface (obj, UDISKS_DBUS_PART_INTERFACE);
+		if (iface_part == NULL)
+			continue;
+		val = g_dbus_proxy_get_cached_property (G_DBUS_PROXY (iface_part), "Type");
+		if (val == NULL)
+			continue;
+		g_variant_get (val, "&s", &type_str);
+		g_debug ("device %s, type: %s", g_dbus_object_get_object_path (obj), type_str);
+		iface_file = g_dbus_object_get_interface (obj, UDISKS_DBUS_FILE_INTERFACE);
+		if (iface_file == NULL) {
+			g_autoptr(GError) error_local = NULL;
+
+			/* still a volume of this kind, just one that cannot be
+			 * mounted until it is formatted */
+			g_debug ("device %s has no filesystem",
+				 g_dbus_object_get_object_path (obj));
+			iface_file = G_DBUS_INTERFACE (g_dbus_proxy_new_sync (connection,
+									      G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES |
+									      G_DBUS_PROXY_FLAGS_DO_NOT_CONNECT_SIGNALS,
+									      NULL,
+									      UDISKS_DBUS_SERVICE,
+									      g_dbus_object_get_object_path (obj),
+									      UDISKS_DBUS_FILE_INTERFACE,
+									      NULL, &error_local));
+			if (iface_file == NULL) {
+				g_warning ("failed to initialize d-bus proxy %s: %s",
+					   g_dbus_object_get_object_path (obj),
+					   error_local->message);
+				continue;
+			}
+		}
+		proxies = g_hash_table_lookup (volumes_by_kind, type_str);
+		if (proxies == NULL) {
+			proxies = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+			g_hash_table_insert (volumes_by_kind, g_strdup (type_str), proxies);
+		}
+		g_ptr_array_add (proxies, g_object_ref (iface_file));
 	}
-	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
-	output =  g_dbus_proxy_call_sync (proxy,
-					  "GetBlockDevices",
-					  g_variant_new ("(a{sv})", &builder),
-					  G_DBUS_CALL_FLAGS_NONE,
-					  -1, NULL, error);
-	if (output == NULL)
-		return NULL;
-	devices = g_ptr_array_new_with_free_func (g_free);
-	g_variant_get (output, "(ao)", &iter);
-	while (g_variant_iter_next (iter, "&o", &obj))
-		g_ptr_array_add (devices, g_strdup (obj));
+	g_list_free_full (objs, (GDestroyNotify) g_object_unref);
+
+	/* be deterministic */
+	g_hash_table_iter_init (&iter, volumes_by_kind);
+	while (g_hash_table_iter_next (&iter, NULL, &value))
+		g_ptr_array_sort ((GPtrArray *) value, fu_common_udisks_proxy_sort_cb);
+	return volumes_by_kind;
+}
+
+/* must be called with udisks_mutex held */
+static gboolean
+fu_common_udisks_ensure_index (GError **error)
+{
+	/* already valid */
+	if (udisks_volumes_by_kind != NULL)
+		return TRUE;
+
+	/* only created once per process */
+	if (udisks_manager == NULL) {
+		g_autoptr(GDBusConnection) connection = NULL;
+		g_autoptr(GDBusObjectManager) manager = NULL;
+		g_autofree gchar *name_owner = NULL;
+
+		connection = g_bus_get_sync (G_BUS_TYPE_SYSTEM, NULL, error);
+		if (connection == NULL) {
+			g_prefix_error (error, "failed to get system bus: ");
+			return FALSE;
+		}
+		manager = g_dbus_object_manager_client_new_sync (connection,
+								 G_DBUS_OBJECT_MANAGER_CLIENT_FLAGS_NONE,
+								 UDISKS_DBUS_SERVICE,
+								 UDISKS_DBUS_OBJECT_PATH,
+								 NULL, NULL, NULL,
+								 NULL, error);
+		if (manager == NULL) {
+			g_prefix_error (error, "failed to find %s: ", UDISKS_DBUS_SERVICE);
+			return FALSE;
+		}
+		name_owner = g_dbus_object_manager_client_get_name_owner (G_DBUS_OBJECT_MANAGER_CLIENT (manager));
+		if (name_owner == NULL) {
+			g_set_error (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_NOT_FOUND,
+				     "failed to find %s: not running",
+				     UDISKS_DBUS_SERVICE);
+			return FALSE;
+		}
+		g_signal_connect (manager, "object-added",
+				  G_CALLBACK (fu_common_udisks_changed_cb), NULL);
+		g_signal_connect (manager, "object-removed",
+				  G_CALLBACK (fu_common_udisks_changed_cb), NULL);
+		g_signal_connect (manager, "interface-added",
+				  G_CALLBACK (fu_common_udisks_changed_cb), NULL);
+		g_signal_connect (manager, "interface-removed",
+				  G_CALLBACK (fu_common_udisks_changed_cb), NULL);
+		g_signal_connect (manager, "interface-proxy-properties-changed",
+				  G_CALLBACK (fu_common_udisks_changed_cb), NULL);
+		udisks_manager = g_steal_pointer (&manager);
+	}
+	udisks_volumes_by_kind = fu_common_udisks_build_index (udisks_manager);
+	return TRUE;
+}
 
-	return g_steal_pointer (&devices);
+/**
+ * fu_common_udisks_shutdown:
+ *
+ * Frees the UDisks object manager and the volume index used by
+ * fu_common_get_volumes_by_kind(). They are created again if required.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_common_udisks_shutdown (void)
+{
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&udisks_mutex);
+	g_clear_pointer (&udisks_volumes_by_kind, g_hash_table_unref);
+	if (udisks_manager == NULL)
+		return;
+	g_signal_handlers_disconnect_by_func (udisks_manager,
+					      fu_common_udisks_changed_cb,
+					      NULL);
+	g_clear_object (&udisks_manager);
 }
 
 /**
@@ -2186,9 +2594,8 @@ fu_common_get_block_devices (GDBusConnection *connection, GError **error)
  * @kind: A volume kind, typically a GUID
  * @error: A #GError or NULL
  *
- * Call into the plugin's get results routine
- *
- * Finds all volumes of a specific type
+ * Finds all volumes of a specific type. The UDisks objects are only enumerated
+ * the first time this is called, and are then kept up to date automatically.
  *
  * Returns: (transfer container) (element-type FuVolume): a #GPtrArray, or %NULL if the kind was not found
  *
@@ -2197,64 +2604,25 @@ fu_common_get_block_devices (GDBusConnection *connection, GError **error)
 GPtrArray *
 fu_common_get_volumes_by_kind (const gchar *kind, GError **error)
 {
-	g_autoptr(GDBusConnection) connection = NULL;
-	g_autoptr(GPtrArray) devices = NULL;
+	GPtrArray *proxies;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&udisks_mutex);
 	g_autoptr(GPtrArray) volumes = NULL;
 
-	connection = g_bus_get_sync (G_BUS_TYPE_SYSTEM, NULL, error);
-	if (connection == NULL) {
-		g_prefix_error (error, "failed to get system bus: ");
+	if (!fu_common_udisks_ensure_index (error))
 		return NULL;
-	}
-	devices = fu_common_get_block_devices (connection, error);
-	if (devices == NULL)
-		return NULL;
-	volumes = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
-	for (guint i = 0; i < devices->len; i++) {
-		const gchar *obj = g_ptr_array_index (devices, i);
-		const gchar *type_str;
-		g_autoptr(GDBusProxy) proxy_part = NULL;
-		g_autoptr(GDBusProxy) proxy_file = NULL;
-		g_autoptr(GError) error_local = NULL;
-		g_autoptr(GVariant) val = NULL;
-
-		proxy_part = g_dbus_proxy_new_sync (connection,
-						    G_DBUS_PROXY_FLAGS_NONE, NULL,
-						    UDISKS_DBUS_SERVICE,
-						    obj,
-						    UDISKS_DBUS_PART_INTERFACE,
-						    NULL, error);
-		if (proxy_part == NULL) {
-			g_prefix_error (error, "failed to initialize d-bus proxy %s: ", obj);
-			return NULL;
-		}
-		val = g_dbus_proxy_get_cached_property (proxy_part, "Type");
-		if (val == NULL)
-			continue;
-
-		g_variant_get (val, "&s", &type_str);
-		g_debug ("device %s, type: %s", obj, type_str);
-		if (g_strcmp0 (type_str, kind) != 0)
-			continue;
-		proxy_file = g_dbus_proxy_new_sync (connection,
-						    G_DBUS_PROXY_FLAGS_NONE, NULL,
-						    UDISKS_DBUS_SERVICE,
-						    obj,
-						    UDISKS_DBUS_FILE_INTERFACE,
-						    NULL, error);
-		if (proxy_file == NULL) {
-			g_prefix_error (error, "failed to initialize d-bus proxy %s: ", obj);
-			return NULL;
-		}
-		g_ptr_array_add (volumes, fu_volume_new_from_proxy (proxy_file));
-	}
-	if (volumes->len == 0) {
+	proxies = g_hash_table_lookup (udisks_volumes_by_kind, kind);
+	if (proxies == NULL) {
 		g_set_error (error,
 			     G_IO_ERROR,
 			     G_IO_ERROR_NOT_FOUND,
 			     "no volumes of type %s", kind);
 		return NULL;
 	}
+	volumes = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	for (guint i = 0; i < proxies->len; i++) {
+		GDBusProxy *proxy = g_ptr_array_index (proxies, i);
+		g_ptr_array_add (volumes, fu_volume_new_from_proxy (proxy));
+	}
 	return g_steal_pointer (&volumes);
 }
 
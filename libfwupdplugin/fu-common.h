@@ -93,6 +93,15 @@ gboolean	 fu_common_spawn_sync		(const gchar * const *argv,
 						 guint		 timeout_ms,
 						 GCancellable	*cancellable,
 						 GError		**error);
+void		 fu_common_spawn_async		(const gchar * const *argv,
+						 FuOutputHandler handler_cb,
+						 gpointer	 handler_user_data,
+						 guint		 timeout_ms,
+						 GCancellable	*cancellable,
+						 GAsyncReadyCallback callback,
+						 gpointer	 user_data);
+gboolean	 fu_common_spawn_finish		(GAsyncResult	*res,
+						 GError		**error);
 
 gchar		*fu_common_get_path		(FuPathKind	 path_kind);
 gchar		*fu_common_realpath		(const gchar	*filename,
@@ -123,6 +132,14 @@ GBytes		*fu_common_firmware_builder	(GBytes		*bytes,
 						 const gchar	*script_fn,
 						 const gchar	*output_fn,
 						 GError		**error);
+void		 fu_common_firmware_builder_async (GBytes	*bytes,
+						 const gchar	*script_fn,
+						 const gchar	*output_fn,
+						 GCancellable	*cancellable,
+						 GAsyncReadyCallback callback,
+						 gpointer	 user_data);
+GBytes		*fu_common_firmware_builder_finish (GAsyncResult *res,
+						 GError		**error);
 GError		*fu_common_error_array_get_best	(GPtrArray	*errors);
 guint64		 fu_common_strtoull		(const gchar	*str);
 gchar		*fu_common_find_program_in_path	(const gchar	*basename,
@@ -155,6 +172,9 @@ gboolean	 fu_common_bytes_compare_raw	(const guint8	*buf1,
 						 GError		**error);
 GBytes		*fu_common_bytes_pad		(GBytes		*bytes,
 						 gsize		 sz);
+gchar		**fu_common_get_checksums_for_bytes (GBytes	*blob,
+						 const GChecksumType *checksum_types,
+						 guint		 checksum_types_len);
 gsize		 fu_common_strwidth		(const gchar	*text);
 gboolean	 fu_memcpy_safe			(guint8		*dst,
 						 gsize		 dst_sz,
@@ -234,6 +254,7 @@ gboolean	 fu_common_cpuid		(guint32	 leaf,
 						 GError		**error);
 gboolean	 fu_common_is_cpu_intel		(void);
 gboolean	 fu_common_is_live_media	(void);
+void		 fu_common_udisks_shutdown	(void);
 GPtrArray	*fu_common_get_volumes_by_kind	(const gchar	*kind,
 						 GError		**error);
 FuVolume	*fu_common_get_esp_for_path	(const gchar	*esp_path,
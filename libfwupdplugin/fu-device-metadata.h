@@ -54,3 +54,12 @@
  * need to be handled as a capsule update.
  */
 #define FU_DEVICE_METADATA_UEFI_CAPSULE_FLAGS	"UefiCapsuleFlags"
+
+/**
+ * FU_DEVICE_METADATA_TPM_PCRS:
+ *
+ * The PCR values read from the TPM, one `index:checksum` pair per line.
+ * Set by the uefi plugin on the system firmware device and consumed by the
+ * tpm-eventlog plugin to verify the replayed event log.
+ */
+#define FU_DEVICE_METADATA_TPM_PCRS		"TpmPcrs"
@@ -61,6 +61,9 @@ typedef struct {
 	GPtrArray			*possible_plugins;
 	GPtrArray			*retry_recs;	/* of FuDeviceRetryRecovery */
 	guint				 retry_delay;
+	GHashTable			*wait_profile;	/* (nullable): step:ms */
+	gint				 wait_fd;
+	FuTransportTrace		*transport_trace;	/* nullable */
 } FuDevicePrivate;
 
 typedef struct {
@@ -69,6 +72,9 @@ typedef struct {
 	FuDeviceRetryFunc		 recovery_func;
 } FuDeviceRetryRecovery;
 
+#define FU_DEVICE_WAIT_DELAY_MIN		1	/* ms */
+#define FU_DEVICE_WAIT_DELAY_MAX		100	/* ms */
+
 enum {
 	PROP_0,
 	PROP_PROGRESS,
@@ -229,6 +235,240 @@ fu_device_retry_set_delay (FuDevice *self, guint delay)
 	priv->retry_delay = delay;
 }
 
+static void
+fu_device_to_transport_trace (FuDevice *self, FuTransportTrace *trace)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	GPtrArray *guids = fu_device_get_guids (self);
+	g_autoptr(GString) guids_str = g_string_new (NULL);
+
+	fu_transport_trace_set_device_metadata (trace, "GType", G_OBJECT_TYPE_NAME (self));
+	fu_transport_trace_set_device_metadata (trace, "Id", fu_device_get_id (self));
+	fu_transport_trace_set_device_metadata (trace, "Plugin", fu_device_get_plugin (self));
+	fu_transport_trace_set_device_metadata (trace, "Name", fu_device_get_name (self));
+	fu_transport_trace_set_device_metadata (trace, "Vendor", fu_device_get_vendor (self));
+	fu_transport_trace_set_device_metadata (trace, "VendorId", fu_device_get_vendor_id (self));
+	fu_transport_trace_set_device_metadata (trace, "Version", fu_device_get_version (self));
+	fu_transport_trace_set_device_metadata (trace, "VersionFormat",
+						fwupd_version_format_to_string (fu_device_get_version_format (self)));
+	fu_transport_trace_set_device_metadata (trace, "Protocol", fu_device_get_protocol (self));
+	fu_transport_trace_set_device_metadata (trace, "PhysicalId", fu_device_get_physical_id (self));
+	fu_transport_trace_set_device_metadata (trace, "LogicalId", fu_device_get_logical_id (self));
+	fu_transport_trace_set_device_metadata (trace, "CustomFlags", fu_device_get_custom_flags (self));
+	fu_transport_trace_set_device_metadata_integer (trace, "Flags", fu_device_get_flags (self));
+	fu_transport_trace_set_device_metadata_integer (trace, "RemoveDelay", priv->remove_delay);
+	fu_transport_trace_set_device_metadata_integer (trace, "FirmwareSizeMin", priv->size_min);
+	fu_transport_trace_set_device_metadata_integer (trace, "FirmwareSizeMax", priv->size_max);
+	for (guint i = 0; i < guids->len; i++) {
+		const gchar *guid = g_ptr_array_index (guids, i);
+		if (guids_str->len > 0)
+			g_string_append (guids_str, ",");
+		g_string_append (guids_str, guid);
+	}
+	fu_transport_trace_set_device_metadata (trace, "Guids", guids_str->str);
+}
+
+/**
+ * fu_device_get_transport_trace:
+ * @self: A #FuDevice
+ *
+ * Gets the transport trace used to record or replay low-level transfers.
+ *
+ * Returns: (transfer none) (nullable): a #FuTransportTrace, or %NULL if unset
+ *
+ * Since: 1.5.0
+ **/
+FuTransportTrace *
+fu_device_get_transport_trace (FuDevice *self)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	g_return_val_if_fail (FU_IS_DEVICE (self), NULL);
+	return priv->transport_trace;
+}
+
+/**
+ * fu_device_set_transport_trace:
+ * @self: A #FuDevice
+ * @trace: (nullable): a #FuTransportTrace
+ *
+ * Sets the transport trace used by the USB, HID and udev transfer helpers.
+ *
+ * In %FU_TRANSPORT_TRACE_MODE_RECORD mode every transfer made to the hardware
+ * is appended to the trace, and in %FU_TRANSPORT_TRACE_MODE_REPLAY mode the
+ * hardware is not used at all and the recorded responses are returned instead.
+ *
+ * When recording, the device identity is also saved into the trace so that
+ * fu_device_new_from_transport_trace() can create the device when replaying.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_device_set_transport_trace (FuDevice *self, FuTransportTrace *trace)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	FuDeviceClass *klass = FU_DEVICE_GET_CLASS (self);
+	g_return_if_fail (FU_IS_DEVICE (self));
+	g_set_object (&priv->transport_trace, trace);
+	if (trace == NULL ||
+	    fu_transport_trace_get_mode (trace) != FU_TRANSPORT_TRACE_MODE_RECORD)
+		return;
+
+	/* save enough to create the device again without the hardware */
+	fu_device_to_transport_trace (self, trace);
+	if (klass->to_trace != NULL)
+		klass->to_trace (self, trace);
+}
+
+static gboolean
+fu_device_from_transport_trace (FuDevice *self, FuTransportTrace *trace, GError **error)
+{
+	const gchar *tmp;
+	guint64 tmp64;
+	g_auto(GStrv) guids = NULL;
+
+	/* required */
+	tmp = fu_transport_trace_get_device_metadata (trace, "Guids");
+	if (tmp == NULL || tmp[0] == '\0') {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "trace has no device GUIDs");
+		return FALSE;
+	}
+	guids = g_strsplit (tmp, ",", -1);
+	for (guint i = 0; guids[i] != NULL; i++)
+		fu_device_add_guid (self, guids[i]);
+
+	/* optional */
+	tmp = fu_transport_trace_get_device_metadata (trace, "Id");
+	if (tmp != NULL)
+		fu_device_set_id (self, tmp);
+	tmp = fu_transport_trace_get_device_metadata (trace, "Plugin");
+	if (tmp != NULL)
+		fu_device_set_plugin (self, tmp);
+	tmp = fu_transport_trace_get_device_metadata (trace, "Name");
+	if (tmp != NULL)
+		fu_device_set_name (self, tmp);
+	tmp = fu_transport_trace_get_device_metadata (trace, "Vendor");
+	if (tmp != NULL)
+		fu_device_set_vendor (self, tmp);
+	tmp = fu_transport_trace_get_device_metadata (trace, "VendorId");
+	if (tmp != NULL)
+		fu_device_set_vendor_id (self, tmp);
+	tmp = fu_transport_trace_get_device_metadata (trace, "VersionFormat");
+	if (tmp != NULL)
+		fu_device_set_version_format (self, fwupd_version_format_from_string (tmp));
+	tmp = fu_transport_trace_get_device_metadata (trace, "Version");
+	if (tmp != NULL)
+		fu_device_set_version (self, tmp);
+	tmp = fu_transport_trace_get_device_metadata (trace, "Protocol");
+	if (tmp != NULL)
+		fu_device_set_protocol (self, tmp);
+	tmp = fu_transport_trace_get_device_metadata (trace, "PhysicalId");
+	if (tmp != NULL)
+		fu_device_set_physical_id (self, tmp);
+	tmp = fu_transport_trace_get_device_metadata (trace, "LogicalId");
+	if (tmp != NULL)
+		fu_device_set_logical_id (self, tmp);
+	tmp = fu_transport_trace_get_device_metadata (trace, "CustomFlags");
+	if (tmp != NULL)
+		fu_device_set_custom_flags (self, tmp);
+	tmp64 = fu_transport_trace_get_device_metadata_integer (trace, "Flags");
+	if (tmp64 != G_MAXUINT64)
+		fu_device_set_flags (self, tmp64);
+	tmp64 = fu_transport_trace_get_device_metadata_integer (trace, "RemoveDelay");
+	if (tmp64 != G_MAXUINT64)
+		fu_device_set_remove_delay (self, tmp64);
+	tmp64 = fu_transport_trace_get_device_metadata_integer (trace, "FirmwareSizeMin");
+	if (tmp64 != G_MAXUINT64)
+		fu_device_set_firmware_size_min (self, tmp64);
+	tmp64 = fu_transport_trace_get_device_metadata_integer (trace, "FirmwareSizeMax");
+	if (tmp64 != G_MAXUINT64)
+		fu_device_set_firmware_size_max (self, tmp64);
+	return TRUE;
+}
+
+/**
+ * fu_device_new_from_transport_trace:
+ * @trace: A #FuTransportTrace
+ * @error: A #GError, or %NULL
+ *
+ * Creates a device of the recorded type using the identity saved into the
+ * trace, and attaches the trace to the device. The trace must have been
+ * created in %FU_TRANSPORT_TRACE_MODE_REPLAY mode, and the hardware is never
+ * opened.
+ *
+ * The #GType of the device has to be registered, typically by loading the
+ * plugin that created the device when the trace was recorded.
+ *
+ * Returns: (transfer full): a #FuDevice, or %NULL for error
+ *
+ * Since: 1.5.0
+ **/
+FuDevice *
+fu_device_new_from_transport_trace (FuTransportTrace *trace, GError **error)
+{
+	FuDeviceClass *klass;
+	GType gtype;
+	const gchar *gtype_name;
+	g_autoptr(FuDevice) self = NULL;
+
+	g_return_val_if_fail (FU_IS_TRANSPORT_TRACE (trace), NULL);
+	g_return_val_if_fail (fu_transport_trace_get_mode (trace) == FU_TRANSPORT_TRACE_MODE_REPLAY, NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	/* find the recorded type */
+	gtype_name = fu_transport_trace_get_device_metadata (trace, "GType");
+	if (gtype_name == NULL) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "trace has no device type");
+		return NULL;
+	}
+	gtype = g_type_from_name (gtype_name);
+	if (gtype == G_TYPE_INVALID || !g_type_is_a (gtype, FU_TYPE_DEVICE)) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_SUPPORTED,
+			     "device type %s is not available",
+			     gtype_name);
+		return NULL;
+	}
+
+	/* restore the identity, then anything the subclass saved */
+	self = g_object_new (gtype, NULL);
+	if (!fu_device_from_transport_trace (self, trace, error))
+		return NULL;
+	klass = FU_DEVICE_GET_CLASS (self);
+	if (klass->from_trace != NULL) {
+		if (!klass->from_trace (self, trace, error))
+			return NULL;
+	}
+	fu_device_set_transport_trace (self, trace);
+	return g_steal_pointer (&self);
+}
+
+/**
+ * fu_device_is_replay:
+ * @self: A #FuDevice
+ *
+ * Gets if the device transfers are being replayed from a #FuTransportTrace
+ * rather than being sent to the hardware.
+ *
+ * Returns: %TRUE if replaying
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_device_is_replay (FuDevice *self)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	g_return_val_if_fail (FU_IS_DEVICE (self), FALSE);
+	return priv->transport_trace != NULL &&
+	       fu_transport_trace_get_mode (priv->transport_trace) == FU_TRANSPORT_TRACE_MODE_REPLAY;
+}
+
 /**
  * fu_device_retry:
  * @self: A #FuDevice
@@ -320,6 +560,271 @@ fu_device_retry (FuDevice *self,
 	return TRUE;
 }
 
+/**
+ * fu_device_set_wait_fd:
+ * @self: A #FuDevice
+ * @fd: A file descriptor, or -1 to unset
+ *
+ * Sets a file descriptor that becomes readable when the hardware signals an
+ * event, for instance when a HID input report is received. This allows
+ * fu_device_wait_for_condition() to check the condition early rather than
+ * sleeping for the full backoff interval.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_device_set_wait_fd (FuDevice *self, gint fd)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	g_return_if_fail (FU_IS_DEVICE (self));
+	priv->wait_fd = fd;
+}
+
+/**
+ * fu_device_get_wait_profile:
+ * @self: A #FuDevice
+ * @step: A step name, e.g. `erase`
+ *
+ * Gets how long the hardware took to complete a step the last time it was
+ * waited for using fu_device_wait_for_condition().
+ *
+ * Returns: time in ms, or 0 if unknown
+ *
+ * Since: 1.5.0
+ **/
+guint
+fu_device_get_wait_profile (FuDevice *self, const gchar *step)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	g_return_val_if_fail (FU_IS_DEVICE (self), 0);
+	g_return_val_if_fail (step != NULL, 0);
+	if (priv->wait_profile == NULL)
+		return 0;
+	return GPOINTER_TO_UINT (g_hash_table_lookup (priv->wait_profile, step));
+}
+
+/**
+ * fu_device_set_wait_profile:
+ * @self: A #FuDevice
+ * @step: A step name, e.g. `erase`
+ * @delay_ms: time in ms, or 0 to forget the step
+ *
+ * Sets how long the hardware is expected to take to complete a step.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_device_set_wait_profile (FuDevice *self, const gchar *step, guint delay_ms)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	g_return_if_fail (FU_IS_DEVICE (self));
+	g_return_if_fail (step != NULL);
+	if (delay_ms == 0) {
+		if (priv->wait_profile != NULL)
+			g_hash_table_remove (priv->wait_profile, step);
+		return;
+	}
+	if (priv->wait_profile == NULL) {
+		priv->wait_profile = g_hash_table_new_full (g_str_hash,
+							    g_str_equal,
+							    g_free,
+							    NULL);
+	}
+	g_hash_table_insert (priv->wait_profile,
+			     g_strdup (step),
+			     GUINT_TO_POINTER (delay_ms));
+}
+
+/**
+ * fu_device_wait_profile_to_metadata:
+ * @self: A #FuDevice
+ * @metadata: A #GHashTable of string:string
+ *
+ * Adds the learned wait profile to @metadata so that it can be saved in the
+ * history database, using keys like `WaitProfile(erase)`.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_device_wait_profile_to_metadata (FuDevice *self, GHashTable *metadata)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	GHashTableIter iter;
+	gpointer key, value;
+
+	g_return_if_fail (FU_IS_DEVICE (self));
+	g_return_if_fail (metadata != NULL);
+
+	if (priv->wait_profile == NULL)
+		return;
+	g_hash_table_iter_init (&iter, priv->wait_profile);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		g_hash_table_insert (metadata,
+				     g_strdup_printf ("WaitProfile(%s)", (const gchar *) key),
+				     g_strdup_printf ("%u", GPOINTER_TO_UINT (value)));
+	}
+}
+
+/**
+ * fu_device_wait_profile_from_metadata:
+ * @self: A #FuDevice
+ * @metadata: A #GHashTable of string:string
+ *
+ * Loads a wait profile previously saved using
+ * fu_device_wait_profile_to_metadata(). Any unrelated keys are ignored.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_device_wait_profile_from_metadata (FuDevice *self, GHashTable *metadata)
+{
+	GHashTableIter iter;
+	gpointer key, value;
+
+	g_return_if_fail (FU_IS_DEVICE (self));
+	g_return_if_fail (metadata != NULL);
+
+	g_hash_table_iter_init (&iter, metadata);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		const gchar *tmp = key;
+		guint64 delay_ms;
+		gsize len;
+		g_autofree gchar *step = NULL;
+
+		if (!g_str_has_prefix (tmp, "WaitProfile(") ||
+		    !g_str_has_suffix (tmp, ")"))
+			continue;
+		len = strlen (tmp);
+		if (len <= 13)
+			continue;
+		delay_ms = fu_common_strtoull (value);
+		if (delay_ms == 0 || delay_ms > G_MAXUINT)
+			continue;
+		step = g_strndup (tmp + 12, len - 13);
+		fu_device_set_wait_profile (self, step, (guint) delay_ms);
+	}
+}
+
+/* returns %TRUE if woken early by an event on @fd */
+static gboolean
+fu_device_wait_sleep (gint fd, guint delay_ms)
+{
+	if (fd >= 0) {
+		GPollFD pfd = { .fd = fd, .events = G_IO_IN, .revents = 0 };
+		gint rc = g_poll (&pfd, 1, (gint) delay_ms);
+		if (rc > 0)
+			return TRUE;
+		if (rc == 0)
+			return FALSE;
+	}
+	g_usleep ((gulong) delay_ms * 1000);
+	return FALSE;
+}
+
+/**
+ * fu_device_wait_for_condition:
+ * @self: A #FuDevice
+ * @step: (nullable): A step name used to learn the timing, e.g. `erase`
+ * @func: (scope call): A function that checks the condition
+ * @timeout_ms: The maximum time to wait in ms
+ * @user_data: (nullable): a helper to pass to @func
+ * @error: A #GError, or %NULL
+ *
+ * Waits for the hardware to finish an operation, which is typically used
+ * instead of sleeping for the worst-case time after an erase, write or reset.
+ *
+ * The condition function should return %TRUE when the operation has
+ * completed, or set %G_IO_ERROR_BUSY if it should be checked again. Any other
+ * error is returned straight away.
+ *
+ * The condition is polled with an exponential backoff, and if @step is set
+ * the time taken is remembered so that the next wait can sleep for most of
+ * the expected time up front. If fu_device_set_wait_fd() has been used then
+ * an event on the file descriptor also causes the condition to be checked.
+ *
+ * Returns: %TRUE if the condition was met before the timeout
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_device_wait_for_condition (FuDevice *self,
+			      const gchar *step,
+			      FuDeviceRetryFunc func,
+			      guint timeout_ms,
+			      gpointer user_data,
+			      GError **error)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	gint fd = priv->wait_fd;
+	guint delay_ms = FU_DEVICE_WAIT_DELAY_MIN;
+	guint elapsed_ms;
+	guint learned_ms = 0;
+	guint sleep_ms = 0;
+	g_autoptr(GTimer) timer = g_timer_new ();
+
+	g_return_val_if_fail (FU_IS_DEVICE (self), FALSE);
+	g_return_val_if_fail (func != NULL, FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	/* skip most of the time the hardware took last time */
+	if (step != NULL)
+		learned_ms = fu_device_get_wait_profile (self, step);
+	if (learned_ms > 0)
+		sleep_ms = MIN (learned_ms * 3 / 4, timeout_ms);
+
+	for (;;) {
+		gboolean woken = FALSE;
+		g_autoptr(GError) error_local = NULL;
+
+		if (sleep_ms > 0)
+			woken = fu_device_wait_sleep (fd, sleep_ms);
+		if (func (self, user_data, &error_local))
+			break;
+
+		/* sanity check */
+		if (error_local == NULL) {
+			g_set_error (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_FAILED,
+				     "exec failed but no error set!");
+			return FALSE;
+		}
+		if (!g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_BUSY)) {
+			g_propagate_error (error, g_steal_pointer (&error_local));
+			return FALSE;
+		}
+
+		/* the event was not the one we wanted, so do not spin */
+		if (woken)
+			fd = -1;
+
+		elapsed_ms = (guint) (g_timer_elapsed (timer, NULL) * 1000.f);
+		if (elapsed_ms >= timeout_ms) {
+			g_set_error (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_TIMED_OUT,
+				     "timed out after %ums: %s",
+				     timeout_ms,
+				     error_local->message);
+			return FALSE;
+		}
+		sleep_ms = MIN (delay_ms, timeout_ms - elapsed_ms);
+		delay_ms = MIN (delay_ms * 2, FU_DEVICE_WAIT_DELAY_MAX);
+	}
+
+	/* learn how long this takes */
+	if (step != NULL) {
+		elapsed_ms = (guint) (g_timer_elapsed (timer, NULL) * 1000.f);
+		g_debug ("%s completed after %ums", step, elapsed_ms);
+		if (learned_ms > 0)
+			elapsed_ms = (learned_ms + elapsed_ms) / 2;
+		fu_device_set_wait_profile (self, step, MAX (elapsed_ms, 1));
+	}
+
+	/* success */
+	return TRUE;
+}
+
 /**
  * fu_device_poll:
  * @self: A #FuDevice
@@ -3203,6 +3708,15 @@ fu_device_incorporate (FuDevice *self, FuDevice *donor)
 		fu_device_set_proxy_guid (self, priv_donor->proxy_guid);
 	if (priv->quirks == NULL)
 		fu_device_set_quirks (self, fu_device_get_quirks (donor));
+	if (priv->transport_trace == NULL && priv_donor->transport_trace != NULL)
+		fu_device_set_transport_trace (self, priv_donor->transport_trace);
+	if (priv->wait_profile == NULL && priv_donor->wait_profile != NULL) {
+		GHashTableIter iter;
+		gpointer key, value;
+		g_hash_table_iter_init (&iter, priv_donor->wait_profile);
+		while (g_hash_table_iter_next (&iter, &key, &value))
+			fu_device_set_wait_profile (self, key, GPOINTER_TO_UINT (value));
+	}
 	g_rw_lock_reader_lock (&priv_donor->parent_guids_mutex);
 	for (guint i = 0; i < parent_guids->len; i++)
 		fu_device_add_parent_guid (self, g_ptr_array_index (parent_guids, i));
@@ -3339,6 +3853,7 @@ fu_device_init (FuDevice *self)
 	priv->parent_guids = g_ptr_array_new_with_free_func (g_free);
 	priv->possible_plugins = g_ptr_array_new_with_free_func (g_free);
 	priv->retry_recs = g_ptr_array_new_with_free_func (g_free);
+	priv->wait_fd = -1;
 	g_rw_lock_init (&priv->parent_guids_mutex);
 	g_rw_lock_init (&priv->metadata_mutex);
 }
@@ -3364,6 +3879,10 @@ fu_device_finalize (GObject *object)
 		g_source_remove (priv->poll_id);
 	if (priv->metadata != NULL)
 		g_hash_table_unref (priv->metadata);
+	if (priv->wait_profile != NULL)
+		g_hash_table_unref (priv->wait_profile);
+	if (priv->transport_trace != NULL)
+		g_object_unref (priv->transport_trace);
 	g_ptr_array_unref (priv->children);
 	g_ptr_array_unref (priv->parent_guids);
 	g_ptr_array_unref (priv->possible_plugins);
@@ -12,6 +12,7 @@
 #include "fu-firmware.h"
 #include "fu-quirks.h"
 #include "fu-common-version.h"
+#include "fu-transport-trace.h"
 
 #define FU_TYPE_DEVICE (fu_device_get_type ())
 G_DECLARE_DERIVABLE_TYPE (FuDevice, fu_device, FU, DEVICE, FwupdDevice)
@@ -76,8 +77,13 @@ struct _FuDeviceClass
 							 GError		**error);
 	GBytes			*(*dump_firmware)	(FuDevice	*self,
 							 GError		**error);
+	void			 (*to_trace)		(FuDevice	*self,
+							 FuTransportTrace *trace);
+	gboolean		 (*from_trace)		(FuDevice	*self,
+							 FuTransportTrace *trace,
+							 GError		**error);
 	/*< private >*/
-	gpointer	padding[11];
+	gpointer	padding[9];
 };
 
 /**
@@ -117,6 +123,8 @@ typedef gboolean (*FuDeviceRetryFunc)			(FuDevice	*device,
 							 GError		**error);
 
 FuDevice	*fu_device_new				(void);
+FuDevice	*fu_device_new_from_transport_trace	(FuTransportTrace *trace,
+							 GError		**error);
 
 /* helpful casting macros */
 #define fu_device_remove_flag(d,v)		fwupd_device_remove_flag(FWUPD_DEVICE(d),v)
@@ -335,6 +343,27 @@ gboolean	 fu_device_retry			(FuDevice	*self,
 							 guint		 count,
 							 gpointer	 user_data,
 							 GError		**error);
+void		 fu_device_set_wait_fd			(FuDevice	*self,
+							 gint		 fd);
+guint		 fu_device_get_wait_profile		(FuDevice	*self,
+							 const gchar	*step);
+void		 fu_device_set_wait_profile		(FuDevice	*self,
+							 const gchar	*step,
+							 guint		 delay_ms);
+void		 fu_device_wait_profile_to_metadata	(FuDevice	*self,
+							 GHashTable	*metadata);
+void		 fu_device_wait_profile_from_metadata	(FuDevice	*self,
+							 GHashTable	*metadata);
+gboolean	 fu_device_wait_for_condition		(FuDevice	*self,
+							 const gchar	*step,
+							 FuDeviceRetryFunc func,
+							 guint		 timeout_ms,
+							 gpointer	 user_data,
+							 GError		**error);
+FuTransportTrace *fu_device_get_transport_trace		(FuDevice	*self);
+void		 fu_device_set_transport_trace		(FuDevice	*self,
+							 FuTransportTrace *trace);
+gboolean	 fu_device_is_replay			(FuDevice	*self);
 gboolean	 fu_device_bind_driver			(FuDevice	*self,
 							 const gchar	*subsystem,
 							 const gchar	*driver,
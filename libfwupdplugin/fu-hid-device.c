@@ -82,6 +82,10 @@ fu_hid_device_open (FuUsbDevice *device, GError **error)
 	FuHidDevicePrivate *priv = GET_PRIVATE (self);
 	GUsbDevice *usb_device = fu_usb_device_get_dev (device);
 
+	/* no hardware to claim */
+	if (fu_device_is_replay (FU_DEVICE (self)))
+		goto subclass;
+
 	/* auto-detect */
 	if (priv->interface_autodetect) {
 		g_autoptr(GPtrArray) ifaces = NULL;
@@ -114,6 +118,7 @@ fu_hid_device_open (FuUsbDevice *device, GError **error)
 		return FALSE;
 	}
 
+subclass:
 	/* subclassed */
 	if (klass->open != NULL) {
 		if (!klass->open (self, error))
@@ -138,6 +143,10 @@ fu_hid_device_close (FuUsbDevice *device, GError **error)
 			return FALSE;
 	}
 
+	/* no hardware to release */
+	if (fu_device_is_replay (FU_DEVICE (self)))
+		return TRUE;
+
 	/* release */
 	if (!g_usb_device_release_interface (usb_device, priv->interface,
 					     G_USB_DEVICE_CLAIM_INTERFACE_BIND_KERNEL_DRIVER,
@@ -216,7 +225,6 @@ fu_hid_device_set_report (FuHidDevice *self,
 			  GError **error)
 {
 	FuHidDevicePrivate *priv = GET_PRIVATE (self);
-	GUsbDevice *usb_device;
 	gsize actual_len = 0;
 	guint16 wvalue = (FU_HID_REPORT_TYPE_OUTPUT << 8) | value;
 
@@ -230,17 +238,16 @@ fu_hid_device_set_report (FuHidDevice *self,
 
 	if (g_getenv ("FU_HID_DEVICE_VERBOSE") != NULL)
 		fu_common_dump_raw (G_LOG_DOMAIN, "HID::SetReport", buf, bufsz);
-	usb_device = fu_usb_device_get_dev (FU_USB_DEVICE (self));
-	if (!g_usb_device_control_transfer (usb_device,
-					    G_USB_DEVICE_DIRECTION_HOST_TO_DEVICE,
-					    G_USB_DEVICE_REQUEST_TYPE_CLASS,
-					    G_USB_DEVICE_RECIPIENT_INTERFACE,
-					    FU_HID_REPORT_SET,
-					    wvalue, priv->interface,
-					    buf, bufsz,
-					    &actual_len,
-					    timeout,
-					    NULL, error)) {
+	if (!fu_usb_device_control_transfer (FU_USB_DEVICE (self),
+					     G_USB_DEVICE_DIRECTION_HOST_TO_DEVICE,
+					     G_USB_DEVICE_REQUEST_TYPE_CLASS,
+					     G_USB_DEVICE_RECIPIENT_INTERFACE,
+					     FU_HID_REPORT_SET,
+					     wvalue, priv->interface,
+					     buf, bufsz,
+					     &actual_len,
+					     timeout,
+					     NULL, error)) {
 		g_prefix_error (error, "failed to SetReport: ");
 		return FALSE;
 	}
@@ -279,7 +286,6 @@ fu_hid_device_get_report (FuHidDevice *self,
 			  GError **error)
 {
 	FuHidDevicePrivate *priv = GET_PRIVATE (self);
-	GUsbDevice *usb_device;
 	gsize actual_len = 0;
 	guint16 wvalue = (FU_HID_REPORT_TYPE_INPUT << 8) | value;
 
@@ -293,17 +299,16 @@ fu_hid_device_get_report (FuHidDevice *self,
 
 	if (g_getenv ("FU_HID_DEVICE_VERBOSE") != NULL)
 		fu_common_dump_raw (G_LOG_DOMAIN, "HID::GetReport", buf, actual_len);
-	usb_device = fu_usb_device_get_dev (FU_USB_DEVICE (self));
-	if (!g_usb_device_control_transfer (usb_device,
-					    G_USB_DEVICE_DIRECTION_DEVICE_TO_HOST,
-					    G_USB_DEVICE_REQUEST_TYPE_CLASS,
-					    G_USB_DEVICE_RECIPIENT_INTERFACE,
-					    FU_HID_REPORT_GET,
-					    wvalue, priv->interface,
-					    buf, bufsz,
-					    &actual_len, /* actual length */
-					    timeout,
-					    NULL, error)) {
+	if (!fu_usb_device_control_transfer (FU_USB_DEVICE (self),
+					     G_USB_DEVICE_DIRECTION_DEVICE_TO_HOST,
+					     G_USB_DEVICE_REQUEST_TYPE_CLASS,
+					     G_USB_DEVICE_RECIPIENT_INTERFACE,
+					     FU_HID_REPORT_GET,
+					     wvalue, priv->interface,
+					     buf, bufsz,
+					     &actual_len, /* actual length */
+					     timeout,
+					     NULL, error)) {
 		g_prefix_error (error, "failed to GetReport: ");
 		return FALSE;
 	}
@@ -343,10 +348,42 @@ fu_hid_device_new (GUsbDevice *usb_device)
 	return FU_HID_DEVICE (device);
 }
 
+static void
+fu_hid_device_to_trace (FuDevice *device, FuTransportTrace *trace)
+{
+	FuHidDevice *self = FU_HID_DEVICE (device);
+	FuHidDevicePrivate *priv = GET_PRIVATE (self);
+
+	/* FuUsbDevice->to_trace */
+	FU_DEVICE_CLASS (fu_hid_device_parent_class)->to_trace (device, trace);
+
+	/* the interface number is used as the wIndex of each transfer */
+	if (!priv->interface_autodetect)
+		fu_transport_trace_set_device_metadata_integer (trace, "HidInterface", priv->interface);
+}
+
+static gboolean
+fu_hid_device_from_trace (FuDevice *device, FuTransportTrace *trace, GError **error)
+{
+	FuHidDevice *self = FU_HID_DEVICE (device);
+	guint64 tmp;
+
+	/* FuUsbDevice->from_trace */
+	if (!FU_DEVICE_CLASS (fu_hid_device_parent_class)->from_trace (device, trace, error))
+		return FALSE;
+
+	/* nothing to autodetect from */
+	tmp = fu_transport_trace_get_device_metadata_integer (trace, "HidInterface");
+	if (tmp <= G_MAXUINT8)
+		fu_hid_device_set_interface (self, tmp);
+	return TRUE;
+}
+
 static void
 fu_hid_device_class_init (FuHidDeviceClass *klass)
 {
 	FuUsbDeviceClass *klass_usb_device = FU_USB_DEVICE_CLASS (klass);
+	FuDeviceClass *klass_device = FU_DEVICE_CLASS (klass);
 	GObjectClass *object_class = G_OBJECT_CLASS (klass);
 	GParamSpec *pspec;
 
@@ -354,6 +391,8 @@ fu_hid_device_class_init (FuHidDeviceClass *klass)
 	object_class->set_property = fu_hid_device_set_property;
 	klass_usb_device->open = fu_hid_device_open;
 	klass_usb_device->close = fu_hid_device_close;
+	klass_device->to_trace = fu_hid_device_to_trace;
+	klass_device->from_trace = fu_hid_device_from_trace;
 
 	pspec = g_param_spec_uint ("interface", NULL, NULL,
 				   0x00, 0xff, 0x00,
@@ -0,0 +1,362 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#define G_LOG_DOMAIN				"FuJcatCache"
+
+#include "config.h"
+
+#include <gio/gio.h>
+
+/* only needed until we hard depend on jcat 0.1.3 */
+#include <libjcat/jcat-version.h>
+
+#include "fu-common.h"
+#include "fu-jcat-cache.h"
+
+#include "fwupd-error.h"
+
+/**
+ * SECTION:fu-jcat-cache
+ * @short_description: a cache of Jcat verification results
+ *
+ * Signature verification is the most expensive part of refreshing metadata
+ * and parsing cabinet archives, but the same payload and signature is often
+ * verified many times. Only successful results are cached, and the cache is
+ * invalidated when any of the trusted public keys change.
+ *
+ * See also: #FuCabinet
+ */
+
+#define FU_JCAT_CACHE_MAX_ITEMS		256
+
+struct _FuJcatCache {
+	GObject			 parent_instance;
+	gchar			*filename;	/* (nullable) */
+	GChecksum		*keyring_csum;
+	GKeyFile		*kf;		/* (nullable): until loaded */
+	guint			 hits;
+};
+
+G_DEFINE_TYPE (FuJcatCache, fu_jcat_cache, G_TYPE_OBJECT)
+
+static void
+fu_jcat_cache_finalize (GObject *obj)
+{
+	FuJcatCache *self = FU_JCAT_CACHE (obj);
+	g_free (self->filename);
+	g_checksum_free (self->keyring_csum);
+	if (self->kf != NULL)
+		g_key_file_unref (self->kf);
+	G_OBJECT_CLASS (fu_jcat_cache_parent_class)->finalize (obj);
+}
+
+static void
+fu_jcat_cache_class_init (FuJcatCacheClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = fu_jcat_cache_finalize;
+}
+
+static void
+fu_jcat_cache_init (FuJcatCache *self)
+{
+	self->keyring_csum = g_checksum_new (G_CHECKSUM_SHA256);
+}
+
+/**
+ * fu_jcat_cache_set_filename:
+ * @self: A #FuJcatCache
+ * @filename: (nullable): A filename, e.g. `/var/cache/fwupd/jcat.cache`
+ *
+ * Sets the file used to persist results. If unset, results are only cached
+ * for the lifetime of the object.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_jcat_cache_set_filename (FuJcatCache *self, const gchar *filename)
+{
+	g_return_if_fail (FU_IS_JCAT_CACHE (self));
+	g_return_if_fail (self->kf == NULL);
+	g_free (self->filename);
+	self->filename = g_strdup (filename);
+}
+
+/**
+ * fu_jcat_cache_add_keyring_path:
+ * @self: A #FuJcatCache
+ * @path: A directory of public keys, as used by jcat_context_add_public_keys()
+ *
+ * Adds a directory of trusted public keys. Any cached result is discarded if
+ * the directory contents are different to when the result was added.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_jcat_cache_add_keyring_path (FuJcatCache *self, const gchar *path)
+{
+	const gchar *fn;
+	g_autoptr(GDir) dir = NULL;
+	g_autoptr(GPtrArray) filenames = g_ptr_array_new_with_free_func (g_free);
+
+	g_return_if_fail (FU_IS_JCAT_CACHE (self));
+	g_return_if_fail (path != NULL);
+	g_return_if_fail (self->kf == NULL);
+
+	g_checksum_update (self->keyring_csum, (const guchar *) path, -1);
+	dir = g_dir_open (path, 0, NULL);
+	if (dir == NULL)
+		return;
+	while ((fn = g_dir_read_name (dir)) != NULL)
+		g_ptr_array_add (filenames, g_strdup (fn));
+	g_ptr_array_sort (filenames, (GCompareFunc) g_strcmp0);
+	for (guint i = 0; i < filenames->len; i++) {
+		const gchar *basename = g_ptr_array_index (filenames, i);
+		gsize bufsz = 0;
+		g_autofree gchar *buf = NULL;
+		g_autofree gchar *filename = g_build_filename (path, basename, NULL);
+		if (!g_file_get_contents (filename, &buf, &bufsz, NULL))
+			continue;
+		g_checksum_update (self->keyring_csum, (const guchar *) basename, -1);
+		g_checksum_update (self->keyring_csum, (const guchar *) buf, (gssize) bufsz);
+	}
+}
+
+static gchar *
+fu_jcat_cache_get_keyring_id (FuJcatCache *self)
+{
+	g_autoptr(GChecksum) csum = g_checksum_copy (self->keyring_csum);
+	return g_strdup (g_checksum_get_string (csum));
+}
+
+static GKeyFile *
+fu_jcat_cache_get_keyfile (FuJcatCache *self)
+{
+	g_autofree gchar *keyring_id = NULL;
+	g_autofree gchar *keyring_id_old = NULL;
+	g_autoptr(GError) error_local = NULL;
+
+	if (self->kf != NULL)
+		return self->kf;
+	self->kf = g_key_file_new ();
+	if (self->filename == NULL)
+		return self->kf;
+	if (!g_key_file_load_from_file (self->kf, self->filename,
+					G_KEY_FILE_NONE, &error_local)) {
+		if (!g_error_matches (error_local, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+			g_debug ("ignoring %s: %s", self->filename, error_local->message);
+		return self->kf;
+	}
+
+	/* the trusted keys have changed */
+	keyring_id = fu_jcat_cache_get_keyring_id (self);
+	keyring_id_old = g_key_file_get_string (self->kf, "fwupd", "KeyringId", NULL);
+	if (g_strcmp0 (keyring_id_old, keyring_id) != 0) {
+		g_debug ("keyring changed, invalidating %s", self->filename);
+		g_key_file_unref (self->kf);
+		self->kf = g_key_file_new ();
+	}
+	return self->kf;
+}
+
+static void
+fu_jcat_cache_prune (GKeyFile *kf)
+{
+	gsize groupsz = 0;
+	g_auto(GStrv) groups = g_key_file_get_groups (kf, &groupsz);
+	const gchar *oldest = NULL;
+	gint64 oldest_created = G_MAXINT64;
+
+	/* one group is used for the keyring ID */
+	if (groupsz <= FU_JCAT_CACHE_MAX_ITEMS + 1)
+		return;
+	for (guint i = 0; groups[i] != NULL; i++) {
+		gint64 created;
+		if (g_strcmp0 (groups[i], "fwupd") == 0)
+			continue;
+		created = g_key_file_get_int64 (kf, groups[i], "Created", NULL);
+		if (created < oldest_created) {
+			oldest_created = created;
+			oldest = groups[i];
+		}
+	}
+	if (oldest != NULL)
+		g_key_file_remove_group (kf, oldest, NULL);
+}
+
+static void
+fu_jcat_cache_add (FuJcatCache *self, const gchar *key, JcatResult *result)
+{
+	GKeyFile *kf = fu_jcat_cache_get_keyfile (self);
+	g_autofree gchar *keyring_id = NULL;
+	g_autoptr(GError) error_local = NULL;
+
+	g_key_file_set_int64 (kf, key, "Timestamp", jcat_result_get_timestamp (result));
+	if (jcat_result_get_authority (result) != NULL)
+		g_key_file_set_string (kf, key, "Authority", jcat_result_get_authority (result));
+	g_key_file_set_int64 (kf, key, "Created", g_get_real_time () / G_USEC_PER_SEC);
+	fu_jcat_cache_prune (kf);
+
+	/* save */
+	if (self->filename == NULL)
+		return;
+	keyring_id = fu_jcat_cache_get_keyring_id (self);
+	g_key_file_set_string (kf, "fwupd", "KeyringId", keyring_id);
+	if (!fu_common_mkdir_parent (self->filename, &error_local) ||
+	    !g_key_file_save_to_file (kf, self->filename, &error_local))
+		g_warning ("failed to save %s: %s", self->filename, error_local->message);
+}
+
+/* the payload, every blob in the item and the flags all affect the result;
+ * everything is length-prefixed so the sections cannot be shuffled */
+static gchar *
+fu_jcat_cache_get_key (GBytes *blob, JcatItem *item, JcatVerifyFlags flags)
+{
+	guint32 flags_le = GUINT32_TO_LE (flags);
+	guint64 blobsz_le = GUINT64_TO_LE (g_bytes_get_size (blob));
+	g_autoptr(GChecksum) csum = g_checksum_new (G_CHECKSUM_SHA256);
+	g_autoptr(GPtrArray) blobs = jcat_item_get_blobs (item);
+
+	g_checksum_update (csum, (const guchar *) &flags_le, sizeof(flags_le));
+	g_checksum_update (csum, (const guchar *) &blobsz_le, sizeof(blobsz_le));
+	g_checksum_update (csum, g_bytes_get_data (blob, NULL), g_bytes_get_size (blob));
+	for (guint i = 0; i < blobs->len; i++) {
+		JcatBlob *jcat_blob = g_ptr_array_index (blobs, i);
+		GBytes *data = jcat_blob_get_data (jcat_blob);
+		guint32 kind_le = GUINT32_TO_LE (jcat_blob_get_kind (jcat_blob));
+		guint64 datasz_le = GUINT64_TO_LE (g_bytes_get_size (data));
+		g_checksum_update (csum, (const guchar *) &kind_le, sizeof(kind_le));
+		g_checksum_update (csum, (const guchar *) &datasz_le, sizeof(datasz_le));
+		g_checksum_update (csum, g_bytes_get_data (data, NULL), g_bytes_get_size (data));
+	}
+	return g_strdup (g_checksum_get_string (csum));
+}
+
+static gboolean
+fu_jcat_cache_result_is_signature (JcatResult *result)
+{
+#if LIBJCAT_CHECK_VERSION(0, 1, 3)
+	return jcat_result_get_method (result) == JCAT_BLOB_METHOD_SIGNATURE;
+#else
+	guint verify_kind = 0;
+	g_autoptr(JcatEngine) engine = NULL;
+	g_object_get (result, "engine", &engine, NULL);
+	g_object_get (engine, "verify-kind", &verify_kind, NULL);
+	return verify_kind == 2; /* SIGNATURE */
+#endif
+}
+
+/**
+ * fu_jcat_cache_verify_item:
+ * @self: A #FuJcatCache
+ * @context: A #JcatContext
+ * @blob: The payload
+ * @item: A #JcatItem for the payload
+ * @flags: A #JcatVerifyFlags, e.g. %JCAT_VERIFY_FLAG_REQUIRE_SIGNATURE
+ * @timestamp: (out) (optional): the newest signing timestamp, or 0 if unknown
+ * @error: A #GError, or %NULL
+ *
+ * Verifies the payload using jcat_context_verify_item(), unless the same
+ * payload and item have already been verified using the same public keys.
+ *
+ * Returns: %TRUE if the payload was verified
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_jcat_cache_verify_item (FuJcatCache *self,
+			   JcatContext *context,
+			   GBytes *blob,
+			   JcatItem *item,
+			   JcatVerifyFlags flags,
+			   gint64 *timestamp,
+			   GError **error)
+{
+	GKeyFile *kf;
+	JcatResult *result_newest = NULL;
+	g_autofree gchar *key = NULL;
+	g_autoptr(GPtrArray) results = NULL;
+
+	g_return_val_if_fail (FU_IS_JCAT_CACHE (self), FALSE);
+	g_return_val_if_fail (JCAT_IS_CONTEXT (context), FALSE);
+	g_return_val_if_fail (blob != NULL, FALSE);
+	g_return_val_if_fail (JCAT_IS_ITEM (item), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	/* already verified */
+	key = fu_jcat_cache_get_key (blob, item, flags);
+	kf = fu_jcat_cache_get_keyfile (self);
+	if (g_key_file_has_group (kf, key)) {
+		g_debug ("using cached result for %s", key);
+		if (timestamp != NULL)
+			*timestamp = g_key_file_get_int64 (kf, key, "Timestamp", NULL);
+		self->hits++;
+		return TRUE;
+	}
+
+	results = jcat_context_verify_item (context, blob, item, flags, error);
+	if (results == NULL)
+		return FALSE;
+
+	/* use the newest signature, ignoring the checksums */
+	for (guint i = 0; i < results->len; i++) {
+		JcatResult *result = g_ptr_array_index (results, i);
+		if (!fu_jcat_cache_result_is_signature (result))
+			continue;
+		if (result_newest == NULL ||
+		    jcat_result_get_timestamp (result) > jcat_result_get_timestamp (result_newest))
+			result_newest = result;
+	}
+	if (result_newest == NULL) {
+		if ((flags & JCAT_VERIFY_FLAG_REQUIRE_SIGNATURE) > 0) {
+			/* should never happen due to %JCAT_VERIFY_FLAG_REQUIRE_SIGNATURE */
+			g_set_error_literal (error,
+					     FWUPD_ERROR,
+					     FWUPD_ERROR_INVALID_FILE,
+					     "no signature method in results");
+			return FALSE;
+		}
+		if (timestamp != NULL)
+			*timestamp = 0;
+		return TRUE;
+	}
+	if (timestamp != NULL)
+		*timestamp = jcat_result_get_timestamp (result_newest);
+	fu_jcat_cache_add (self, key, result_newest);
+	return TRUE;
+}
+
+/**
+ * fu_jcat_cache_get_hits:
+ * @self: A #FuJcatCache
+ *
+ * Gets the number of verifications that were answered from the cache.
+ *
+ * Returns: integer
+ *
+ * Since: 1.5.0
+ **/
+guint
+fu_jcat_cache_get_hits (FuJcatCache *self)
+{
+	g_return_val_if_fail (FU_IS_JCAT_CACHE (self), G_MAXUINT);
+	return self->hits;
+}
+
+/**
+ * fu_jcat_cache_new:
+ *
+ * Creates a new cache of Jcat verification results.
+ *
+ * Returns: (transfer full): a #FuJcatCache
+ *
+ * Since: 1.5.0
+ **/
+FuJcatCache *
+fu_jcat_cache_new (void)
+{
+	return g_object_new (FU_TYPE_JCAT_CACHE, NULL);
+}
@@ -0,0 +1,28 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#pragma once
+
+#include <glib-object.h>
+#include <jcat.h>
+
+#define FU_TYPE_JCAT_CACHE (fu_jcat_cache_get_type ())
+
+G_DECLARE_FINAL_TYPE (FuJcatCache, fu_jcat_cache, FU, JCAT_CACHE, GObject)
+
+FuJcatCache	*fu_jcat_cache_new			(void);
+void		 fu_jcat_cache_set_filename		(FuJcatCache	*self,
+							 const gchar	*filename);
+void		 fu_jcat_cache_add_keyring_path		(FuJcatCache	*self,
+							 const gchar	*path);
+gboolean	 fu_jcat_cache_verify_item		(FuJcatCache	*self,
+							 JcatContext	*context,
+							 GBytes		*blob,
+							 JcatItem	*item,
+							 JcatVerifyFlags flags,
+							 gint64		*timestamp,
+							 GError		**error);
+guint		 fu_jcat_cache_get_hits			(FuJcatCache	*self);
@@ -0,0 +1,12 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#pragma once
+
+#include "fu-msr-snapshot.h"
+
+void		 fu_msr_snapshot_set_path		(FuMsrSnapshot	*self,
+							 const gchar	*path);
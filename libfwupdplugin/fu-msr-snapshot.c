@@ -0,0 +1,392 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#define G_LOG_DOMAIN				"FuMsrSnapshot"
+
+#include "config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+
+#include "fwupd-error.h"
+
+#include "fu-msr-snapshot-private.h"
+
+/**
+ * SECTION:fu-msr-snapshot
+ * @short_description: a cached copy of model specific registers
+ *
+ * An object that reads a declared set of model specific registers from every
+ * CPU at the same time, and then keeps the values so that plugins do not have
+ * to open each `/dev/cpu/N/msr` node themselves.
+ *
+ * Plugins should declare the registers they need in fu_plugin_startup() using
+ * fu_msr_snapshot_add_address() and then call fu_msr_snapshot_load() when the
+ * values are required; only the first caller pays for the reads.
+ *
+ * See also: #FuPlugin
+ */
+
+typedef struct {
+	guint			 cpu;
+	gchar			*fn;
+	GArray			*values;	/* of guint64, same order as addresses */
+	GArray			*valid;		/* of gboolean */
+	GError			*error;		/* nullable */
+} FuMsrSnapshotCpu;
+
+struct _FuMsrSnapshot {
+	GObject			 parent_instance;
+	gchar			*path;
+	GArray			*addresses;	/* of guint32 */
+	GPtrArray		*cpus;		/* of FuMsrSnapshotCpu, sorted */
+	gboolean		 loaded;
+};
+
+G_DEFINE_TYPE (FuMsrSnapshot, fu_msr_snapshot, G_TYPE_OBJECT)
+
+static void
+fu_msr_snapshot_cpu_free (FuMsrSnapshotCpu *item)
+{
+	g_free (item->fn);
+	g_array_unref (item->values);
+	g_array_unref (item->valid);
+	if (item->error != NULL)
+		g_error_free (item->error);
+	g_free (item);
+}
+
+static gint
+fu_msr_snapshot_cpu_sort_cb (gconstpointer a, gconstpointer b)
+{
+	FuMsrSnapshotCpu *item1 = *((FuMsrSnapshotCpu **) a);
+	FuMsrSnapshotCpu *item2 = *((FuMsrSnapshotCpu **) b);
+	if (item1->cpu < item2->cpu)
+		return -1;
+	if (item1->cpu > item2->cpu)
+		return 1;
+	return 0;
+}
+
+/**
+ * fu_msr_snapshot_set_path:
+ * @self: A #FuMsrSnapshot
+ * @path: A directory, e.g. `/dev/cpu`
+ *
+ * Sets the directory containing the per-CPU directories, which is only
+ * useful for the self tests.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_msr_snapshot_set_path (FuMsrSnapshot *self, const gchar *path)
+{
+	g_return_if_fail (FU_IS_MSR_SNAPSHOT (self));
+	g_return_if_fail (path != NULL);
+	g_free (self->path);
+	self->path = g_strdup (path);
+	self->loaded = FALSE;
+}
+
+/**
+ * fu_msr_snapshot_add_address:
+ * @self: A #FuMsrSnapshot
+ * @address: A MSR address, e.g. `0x8b`
+ *
+ * Declares a register that should be read from each CPU. Adding a register
+ * that was not part of the last snapshot causes the next call to
+ * fu_msr_snapshot_load() to read all the CPUs again.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_msr_snapshot_add_address (FuMsrSnapshot *self, guint32 address)
+{
+	g_return_if_fail (FU_IS_MSR_SNAPSHOT (self));
+
+	for (guint i = 0; i < self->addresses->len; i++) {
+		if (g_array_index (self->addresses, guint32, i) == address)
+			return;
+	}
+	g_array_append_val (self->addresses, address);
+	self->loaded = FALSE;
+}
+
+#ifdef HAVE_PWRITE
+static void
+fu_msr_snapshot_thread_cb (gpointer data, gpointer user_data)
+{
+	FuMsrSnapshot *self = FU_MSR_SNAPSHOT (user_data);
+	FuMsrSnapshotCpu *item = (FuMsrSnapshotCpu *) data;
+	gint fd;
+
+	fd = g_open (item->fn, O_RDONLY, 0);
+	if (fd < 0) {
+		gint errsv = errno;
+		g_set_error (&item->error,
+			     G_IO_ERROR,
+			     g_io_error_from_errno (errsv),
+			     "failed to open %s: %s",
+			     item->fn, strerror (errsv));
+		return;
+	}
+	for (guint i = 0; i < self->addresses->len; i++) {
+		guint32 address = g_array_index (self->addresses, guint32, i);
+		guint64 value = 0;
+
+		/* not all registers are implemented on every CPU */
+		if (pread (fd, &value, sizeof(value), address) != (gssize) sizeof(value)) {
+			g_debug ("failed to read 0x%x from %s: %s",
+				 address, item->fn, strerror (errno));
+			continue;
+		}
+		g_array_index (item->values, guint64, i) = GUINT64_FROM_LE (value);
+		g_array_index (item->valid, gboolean, i) = TRUE;
+	}
+	g_close (fd, NULL);
+}
+#endif
+
+/**
+ * fu_msr_snapshot_load:
+ * @self: A #FuMsrSnapshot
+ * @error: A #GError, or %NULL
+ *
+ * Reads all the declared registers from every CPU using one thread per
+ * processor. If the snapshot is already valid this does nothing.
+ *
+ * Returns: %TRUE if at least one CPU could be read
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_msr_snapshot_load (FuMsrSnapshot *self, GError **error)
+{
+#ifdef HAVE_PWRITE
+	const gchar *fn;
+	FuMsrSnapshotCpu *item_first;
+	GThreadPool *pool;
+	guint cnt_ok = 0;
+	g_autoptr(GDir) dir = NULL;
+
+	g_return_val_if_fail (FU_IS_MSR_SNAPSHOT (self), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	/* already valid */
+	if (self->loaded)
+		return TRUE;
+
+	/* find each CPU */
+	g_ptr_array_set_size (self->cpus, 0);
+	dir = g_dir_open (self->path, 0, error);
+	if (dir == NULL)
+		return FALSE;
+	while ((fn = g_dir_read_name (dir)) != NULL) {
+		FuMsrSnapshotCpu *item;
+		gchar *endptr = NULL;
+		guint64 cpu = g_ascii_strtoull (fn, &endptr, 10);
+		if (endptr == fn || *endptr != '\0' || cpu > G_MAXUINT)
+			continue;
+		item = g_new0 (FuMsrSnapshotCpu, 1);
+		item->cpu = (guint) cpu;
+		item->fn = g_build_filename (self->path, fn, "msr", NULL);
+		item->values = g_array_new (FALSE, TRUE, sizeof(guint64));
+		item->valid = g_array_new (FALSE, TRUE, sizeof(gboolean));
+		g_array_set_size (item->values, self->addresses->len);
+		g_array_set_size (item->valid, self->addresses->len);
+		g_ptr_array_add (self->cpus, item);
+	}
+	if (self->cpus->len == 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_SUPPORTED,
+			     "no CPUs found in %s",
+			     self->path);
+		return FALSE;
+	}
+	g_ptr_array_sort (self->cpus, fu_msr_snapshot_cpu_sort_cb);
+
+	/* each CPU is independent */
+	pool = g_thread_pool_new (fu_msr_snapshot_thread_cb, self,
+				  (gint) MIN (g_get_num_processors (), self->cpus->len),
+				  TRUE, error);
+	if (pool == NULL)
+		return FALSE;
+	for (guint i = 0; i < self->cpus->len; i++) {
+		FuMsrSnapshotCpu *item = g_ptr_array_index (self->cpus, i);
+		if (!g_thread_pool_push (pool, item, error)) {
+			g_thread_pool_free (pool, TRUE, TRUE);
+			return FALSE;
+		}
+	}
+	g_thread_pool_free (pool, FALSE, TRUE);
+
+	/* the kernel module may not be loaded, or we might not be root */
+	for (guint i = 0; i < self->cpus->len; i++) {
+		FuMsrSnapshotCpu *item = g_ptr_array_index (self->cpus, i);
+		if (item->error == NULL)
+			cnt_ok++;
+	}
+	if (cnt_ok == 0) {
+		item_first = g_ptr_array_index (self->cpus, 0);
+		g_propagate_error (error, g_error_copy (item_first->error));
+		return FALSE;
+	}
+	g_debug ("read %u registers from %u/%u CPUs",
+		 self->addresses->len, cnt_ok, self->cpus->len);
+
+	/* success */
+	self->loaded = TRUE;
+	return TRUE;
+#else
+	g_set_error_literal (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_SUPPORTED,
+			     "Not supported as pread() is unavailable");
+	return FALSE;
+#endif
+}
+
+/**
+ * fu_msr_snapshot_get_cpus:
+ * @self: A #FuMsrSnapshot
+ *
+ * Gets the CPUs that could be read in the last snapshot.
+ *
+ * Returns: (transfer container) (element-type guint): CPU numbers
+ *
+ * Since: 1.5.0
+ **/
+GArray *
+fu_msr_snapshot_get_cpus (FuMsrSnapshot *self)
+{
+	GArray *cpus;
+	g_return_val_if_fail (FU_IS_MSR_SNAPSHOT (self), NULL);
+	cpus = g_array_new (FALSE, FALSE, sizeof(guint));
+	for (guint i = 0; i < self->cpus->len; i++) {
+		FuMsrSnapshotCpu *item = g_ptr_array_index (self->cpus, i);
+		if (item->error == NULL)
+			g_array_append_val (cpus, item->cpu);
+	}
+	return cpus;
+}
+
+/**
+ * fu_msr_snapshot_get_value:
+ * @self: A #FuMsrSnapshot
+ * @cpu: A CPU number, e.g. 0
+ * @address: A MSR address added with fu_msr_snapshot_add_address()
+ * @value: (out) (nullable): the register value
+ * @error: A #GError, or %NULL
+ *
+ * Gets a register value from the last snapshot.
+ *
+ * Returns: %TRUE if the register was read successfully
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_msr_snapshot_get_value (FuMsrSnapshot *self,
+			   guint cpu,
+			   guint32 address,
+			   guint64 *value,
+			   GError **error)
+{
+	FuMsrSnapshotCpu *item = NULL;
+
+	g_return_val_if_fail (FU_IS_MSR_SNAPSHOT (self), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	if (!self->loaded) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INTERNAL,
+				     "snapshot has not been loaded");
+		return FALSE;
+	}
+	for (guint i = 0; i < self->cpus->len; i++) {
+		FuMsrSnapshotCpu *item_tmp = g_ptr_array_index (self->cpus, i);
+		if (item_tmp->cpu == cpu) {
+			item = item_tmp;
+			break;
+		}
+	}
+	if (item == NULL) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_FOUND,
+			     "no CPU %u", cpu);
+		return FALSE;
+	}
+	if (item->error != NULL) {
+		g_propagate_error (error, g_error_copy (item->error));
+		return FALSE;
+	}
+	for (guint i = 0; i < self->addresses->len; i++) {
+		if (g_array_index (self->addresses, guint32, i) != address)
+			continue;
+		if (!g_array_index (item->valid, gboolean, i)) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_NOT_SUPPORTED,
+				     "could not read 0x%x on CPU %u",
+				     address, cpu);
+			return FALSE;
+		}
+		if (value != NULL)
+			*value = g_array_index (item->values, guint64, i);
+		return TRUE;
+	}
+	g_set_error (error,
+		     FWUPD_ERROR,
+		     FWUPD_ERROR_NOT_FOUND,
+		     "address 0x%x was not added", address);
+	return FALSE;
+}
+
+static void
+fu_msr_snapshot_finalize (GObject *obj)
+{
+	FuMsrSnapshot *self = FU_MSR_SNAPSHOT (obj);
+	g_free (self->path);
+	g_array_unref (self->addresses);
+	g_ptr_array_unref (self->cpus);
+	G_OBJECT_CLASS (fu_msr_snapshot_parent_class)->finalize (obj);
+}
+
+static void
+fu_msr_snapshot_class_init (FuMsrSnapshotClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = fu_msr_snapshot_finalize;
+}
+
+static void
+fu_msr_snapshot_init (FuMsrSnapshot *self)
+{
+	self->path = g_strdup ("/dev/cpu");
+	self->addresses = g_array_new (FALSE, FALSE, sizeof(guint32));
+	self->cpus = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_msr_snapshot_cpu_free);
+}
+
+/**
+ * fu_msr_snapshot_new:
+ *
+ * Creates a new MSR snapshot.
+ *
+ * Returns: (transfer full): a #FuMsrSnapshot
+ *
+ * Since: 1.5.0
+ **/
+FuMsrSnapshot *
+fu_msr_snapshot_new (void)
+{
+	return g_object_new (FU_TYPE_MSR_SNAPSHOT, NULL);
+}
@@ -0,0 +1,25 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+#define FU_TYPE_MSR_SNAPSHOT (fu_msr_snapshot_get_type ())
+
+G_DECLARE_FINAL_TYPE (FuMsrSnapshot, fu_msr_snapshot, FU, MSR_SNAPSHOT, GObject)
+
+FuMsrSnapshot	*fu_msr_snapshot_new			(void);
+void		 fu_msr_snapshot_add_address		(FuMsrSnapshot	*self,
+							 guint32	 address);
+gboolean	 fu_msr_snapshot_load			(FuMsrSnapshot	*self,
+							 GError		**error);
+GArray		*fu_msr_snapshot_get_cpus		(FuMsrSnapshot	*self);
+gboolean	 fu_msr_snapshot_get_value		(FuMsrSnapshot	*self,
+							 guint		 cpu,
+							 guint32	 address,
+							 guint64	*value,
+							 GError		**error);
@@ -27,6 +27,8 @@ void		 fu_plugin_set_compile_versions		(FuPlugin	*self,
 							 GHashTable	*compile_versions);
 void		 fu_plugin_set_smbios			(FuPlugin	*self,
 							 FuSmbios	*smbios);
+void		 fu_plugin_set_msr_snapshot		(FuPlugin	*self,
+							 FuMsrSnapshot	*msr_snapshot);
 guint		 fu_plugin_get_order			(FuPlugin	*self);
 void		 fu_plugin_set_order			(FuPlugin	*self,
 							 guint		 order);
@@ -367,6 +367,12 @@ void		 fu_plugin_device_registered		(FuPlugin	*plugin,
  *
  * Function that asks plugins to add Host Security Attributes.
  *
+ * This may be called from a #GThreadPool worker rather than the main thread,
+ * at the same time as the same function in other plugins. Implementations
+ * should only read hardware state and the plugin data, and must not emit
+ * signals or add devices. The attributes are cached until the plugin calls
+ * fu_plugin_security_changed() or one of its devices changes.
+ *
  * Since: 1.5.0
  **/
 void		 fu_plugin_add_security_attrs		(FuPlugin	*plugin,
@@ -49,6 +49,7 @@ typedef struct {
 	GHashTable		*compile_versions;
 	GPtrArray		*udev_subsystems;
 	FuSmbios		*smbios;
+	FuMsrSnapshot		*msr_snapshot;
 	GType			 device_gtype;
 	GHashTable		*devices;		/* (nullable): platform_id:GObject */
 	GRWLock			 devices_mutex;
@@ -976,6 +977,41 @@ fu_plugin_set_smbios (FuPlugin *self, FuSmbios *smbios)
 	g_set_object (&priv->smbios, smbios);
 }
 
+/**
+ * fu_plugin_set_msr_snapshot:
+ * @self: A #FuPlugin
+ * @msr_snapshot: A #FuMsrSnapshot
+ *
+ * Sets the MSR snapshot shared by all plugins.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_plugin_set_msr_snapshot (FuPlugin *self, FuMsrSnapshot *msr_snapshot)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (self);
+	g_set_object (&priv->msr_snapshot, msr_snapshot);
+}
+
+/**
+ * fu_plugin_get_msr_snapshot:
+ * @self: A #FuPlugin
+ *
+ * Gets the MSR snapshot shared by all plugins, which should be used rather
+ * than opening each `/dev/cpu/N/msr` device directly.
+ *
+ * Returns: (transfer none) (nullable): a #FuMsrSnapshot
+ *
+ * Since: 1.5.0
+ **/
+FuMsrSnapshot *
+fu_plugin_get_msr_snapshot (FuPlugin *self)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (self);
+	g_return_val_if_fail (FU_IS_PLUGIN (self), NULL);
+	return priv->msr_snapshot;
+}
+
 /**
  * fu_plugin_set_coldplug_delay:
  * @self: A #FuPlugin
@@ -1087,10 +1123,10 @@ fu_plugin_device_read_firmware (FuPlugin *self, FuDevice *device, GError **error
 	g_autoptr(FuDeviceLocker) locker = NULL;
 	g_autoptr(FuFirmware) firmware = NULL;
 	g_autoptr(GBytes) fw = NULL;
+	g_auto(GStrv) checksums = NULL;
 	GChecksumType checksum_types[] = {
 		G_CHECKSUM_SHA1,
-		G_CHECKSUM_SHA256,
-		0 };
+		G_CHECKSUM_SHA256 };
 	locker = fu_device_locker_new (device, error);
 	if (locker == NULL)
 		return FALSE;
@@ -1112,11 +1148,10 @@ fu_plugin_device_read_firmware (FuPlugin *self, FuDevice *device, GError **error
 		g_prefix_error (error, "failed to write firmware: ");
 		return FALSE;
 	}
-	for (guint i = 0; checksum_types[i] != 0; i++) {
-		g_autofree gchar *hash = NULL;
-		hash = g_compute_checksum_for_bytes (checksum_types[i], fw);
-		fu_device_add_checksum (device, hash);
-	}
+	checksums = fu_common_get_checksums_for_bytes (fw, checksum_types,
+						       G_N_ELEMENTS (checksum_types));
+	for (guint i = 0; checksums[i] != NULL; i++)
+		fu_device_add_checksum (device, checksums[i]);
 	return fu_device_attach (device, error);
 }
 
@@ -2807,6 +2842,8 @@ fu_plugin_finalize (GObject *object)
 		g_ptr_array_unref (priv->udev_subsystems);
 	if (priv->smbios != NULL)
 		g_object_unref (priv->smbios);
+	if (priv->msr_snapshot != NULL)
+		g_object_unref (priv->msr_snapshot);
 	if (priv->runtime_versions != NULL)
 		g_hash_table_unref (priv->runtime_versions);
 	if (priv->compile_versions != NULL)
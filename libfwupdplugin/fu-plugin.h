@@ -16,6 +16,7 @@
 #include "fu-device-locker.h"
 #include "fu-quirks.h"
 #include "fu-hwids.h"
+#include "fu-msr-snapshot.h"
 #include "fu-usb-device.h"
 //#include "fu-hid-device.h"
 #ifdef HAVE_GUDEV
@@ -137,6 +138,7 @@ const gchar	*fu_plugin_get_smbios_string		(FuPlugin	*self,
 							 guint8		 offset);
 GBytes		*fu_plugin_get_smbios_data		(FuPlugin	*self,
 							 guint8		 structure_type);
+FuMsrSnapshot	*fu_plugin_get_msr_snapshot		(FuPlugin	*self);
 void		 fu_plugin_add_rule			(FuPlugin	*self,
 							 FuPluginRule	 rule,
 							 const gchar	*name);
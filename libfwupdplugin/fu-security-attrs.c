@@ -280,6 +280,9 @@ fu_security_attrs_sort_cb (gconstpointer item1, gconstpointer item2)
  * It is only required to call this function once, and should be done when all
  * attributes have been added. This will also sort the attrs.
  *
+ * Any existing %FWUPD_SECURITY_ATTR_FLAG_OBSOLETED flags are cleared first, so
+ * it is safe to call this again on attributes that have been reused.
+ *
  * Since: 1.5.0
  **/
 void
@@ -289,10 +292,12 @@ fu_security_attrs_depsolve (FuSecurityAttrs *self)
 
 	g_return_if_fail (FU_IS_SECURITY_ATTRS (self));
 
-	/* make hash of ID -> object */
+	/* make hash of ID -> object, dropping any stale obsoletes */
 	attrs_by_id = g_hash_table_new (g_str_hash, g_str_equal);
 	for (guint i = 0; i < self->attrs->len; i++) {
 		FwupdSecurityAttr *attr = g_ptr_array_index (self->attrs, i);
+		FwupdSecurityAttrFlags flags = fwupd_security_attr_get_flags (attr);
+		fwupd_security_attr_set_flags (attr, flags & ~FWUPD_SECURITY_ATTR_FLAG_OBSOLETED);
 		g_hash_table_insert (attrs_by_id,
 				     (gpointer) fwupd_security_attr_get_appstream_id (attr),
 				     (gpointer) attr);
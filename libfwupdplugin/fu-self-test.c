@@ -11,8 +11,13 @@
 #include <fwupdplugin.h>
 #include <libgcab.h>
 #include <glib/gstdio.h>
+#ifdef HAVE_SCSI_SG_H
+#include <scsi/sg.h>
+#endif
 
 #include "fu-device-private.h"
+#include "fu-jcat-cache.h"
+#include "fu-msr-snapshot-private.h"
 #include "fu-plugin-private.h"
 #include "fu-security-attrs-private.h"
 #include "fu-smbios-private.h"
@@ -107,6 +112,35 @@ fu_archive_cab_func (void)
 	g_assert_null (data_tmp);
 }
 
+static void
+fu_common_checksums_func (void)
+{
+	GChecksumType checksum_types[] = {
+		G_CHECKSUM_MD5,
+		G_CHECKSUM_SHA1,
+		G_CHECKSUM_SHA256,
+		G_CHECKSUM_SHA512 };
+	gsize sizes[] = { 0, 3, 0x12345, 0x1000001 };
+
+	/* same as computing each separately, using both code paths */
+	for (guint j = 0; j < G_N_ELEMENTS (sizes); j++) {
+		g_autofree guint8 *buf = g_malloc (sizes[j] + 1);
+		g_autoptr(GBytes) blob = NULL;
+		g_auto(GStrv) checksums = NULL;
+		for (gsize i = 0; i < sizes[j]; i++)
+			buf[i] = (guint8) i;
+		blob = g_bytes_new (buf, sizes[j]);
+		checksums = fu_common_get_checksums_for_bytes (blob, checksum_types,
+							       G_N_ELEMENTS (checksum_types));
+		g_assert_cmpint (g_strv_length (checksums), ==, G_N_ELEMENTS (checksum_types));
+		for (guint i = 0; i < G_N_ELEMENTS (checksum_types); i++) {
+			g_autofree gchar *csum = NULL;
+			csum = g_compute_checksum_for_bytes (checksum_types[i], blob);
+			g_assert_cmpstr (checksums[i], ==, csum);
+		}
+	}
+}
+
 static void
 fu_common_crc_func (void)
 {
@@ -550,6 +584,80 @@ fu_common_firmware_builder_func (void)
 	g_assert_cmpstr (data, ==, "xobdnas eht ni gninnur");
 }
 
+typedef struct {
+	guint		 pending;
+	GPtrArray	*blobs;
+	GError		*error;
+} FuTestBuilderHelper;
+
+static void
+fu_test_firmware_builder_async_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	FuTestBuilderHelper *helper = (FuTestBuilderHelper *) user_data;
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GError) error = NULL;
+
+	blob = fu_common_firmware_builder_finish (res, &error);
+	if (blob != NULL)
+		g_ptr_array_add (helper->blobs, g_steal_pointer (&blob));
+	else if (helper->error == NULL)
+		helper->error = g_steal_pointer (&error);
+	if (--helper->pending == 0)
+		fu_test_loop_quit ();
+}
+
+static void
+fu_common_firmware_builder_async_func (void)
+{
+	guint builds = g_get_num_processors () + 2;
+	g_autofree gchar *archive_fn = NULL;
+	g_autoptr(GBytes) archive_blob = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) blobs = g_ptr_array_new_with_free_func ((GDestroyNotify) g_bytes_unref);
+	FuTestBuilderHelper helper = { 0 };
+
+	/* get test file */
+	archive_fn = g_build_filename (TESTDATADIR_DST, "builder", "firmware.tar", NULL);
+	archive_blob = fu_common_get_contents_bytes (archive_fn, &error);
+	g_assert_no_error (error);
+	g_assert (archive_blob != NULL);
+
+	/* queue more builds than can run at once */
+	helper.blobs = blobs;
+	helper.pending = builds;
+	for (guint i = 0; i < builds; i++) {
+		fu_common_firmware_builder_async (archive_blob,
+						  "startup.sh",
+						  "firmware.bin",
+						  NULL,
+						  fu_test_firmware_builder_async_cb,
+						  &helper);
+	}
+	fu_test_loop_run_with_timeout (60000);
+	g_assert_cmpint (helper.pending, ==, 0);
+	if (helper.error != NULL) {
+		if (g_error_matches (helper.error, FWUPD_ERROR, FWUPD_ERROR_PERMISSION_DENIED)) {
+			g_test_skip ("Missing permissions to create namespace in container");
+			g_clear_error (&helper.error);
+			return;
+		}
+		if (g_error_matches (helper.error, FWUPD_ERROR, FWUPD_ERROR_NOT_SUPPORTED)) {
+			g_test_skip ("User namespaces not supported in container");
+			g_clear_error (&helper.error);
+			return;
+		}
+		g_assert_no_error (helper.error);
+	}
+
+	/* check them all */
+	g_assert_cmpint (blobs->len, ==, builds);
+	for (guint i = 0; i < blobs->len; i++) {
+		GBytes *blob = g_ptr_array_index (blobs, i);
+		const gchar *data = g_bytes_get_data (blob, NULL);
+		g_assert_cmpstr (data, ==, "xobdnas eht ni gninnur");
+	}
+}
+
 static void
 fu_test_stdout_cb (const gchar *line, gpointer user_data)
 {
@@ -659,6 +767,307 @@ fu_common_spawn_timeout_func (void)
 	g_assert_cmpint (lines, ==, 1);
 }
 
+typedef struct {
+	guint		 lines;
+	GCancellable	*cancellable;
+	gboolean	 ret;
+	GError		*error;
+} FuTestSpawnHelper;
+
+static void
+fu_test_spawn_stdout_cb (const gchar *line, gpointer user_data)
+{
+	FuTestSpawnHelper *helper = (FuTestSpawnHelper *) user_data;
+	helper->lines++;
+	if (helper->cancellable != NULL)
+		g_cancellable_cancel (helper->cancellable);
+}
+
+static void
+fu_test_spawn_async_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	FuTestSpawnHelper *helper = (FuTestSpawnHelper *) user_data;
+	helper->ret = fu_common_spawn_finish (res, &helper->error);
+	fu_test_loop_quit ();
+}
+
+static void
+fu_common_spawn_async_func (void)
+{
+	g_autofree gchar *fn = NULL;
+	g_autoptr(GCancellable) cancellable = g_cancellable_new ();
+	const gchar *argv[3] = { "replace", "test", NULL };
+	FuTestSpawnHelper helper = { 0 };
+
+#ifdef _WIN32
+	g_test_skip ("Known failures on Windows right now, skipping spawn async test");
+	return;
+#endif
+
+	fn = g_build_filename (TESTDATADIR_SRC, "spawn.sh", NULL);
+	argv[0] = fn;
+	fu_common_spawn_async (argv, fu_test_spawn_stdout_cb, &helper, 0, NULL,
+			       fu_test_spawn_async_cb, &helper);
+	fu_test_loop_run_with_timeout (10000);
+	g_assert_no_error (helper.error);
+	g_assert (helper.ret);
+	g_assert_cmpint (helper.lines, ==, 6);
+
+	/* the process is killed as soon as the first line is read */
+	helper.lines = 0;
+	helper.cancellable = cancellable;
+	fu_common_spawn_async (argv, fu_test_spawn_stdout_cb, &helper, 0, cancellable,
+			       fu_test_spawn_async_cb, &helper);
+	fu_test_loop_run_with_timeout (10000);
+	g_assert_error (helper.error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+	g_assert (!helper.ret);
+	g_assert_cmpint (helper.lines, ==, 1);
+	g_clear_error (&helper.error);
+}
+
+/* a UDisks stand-in with one formatted and one unformatted ESP, which runs
+ * in its own thread as the client side uses synchronous calls */
+typedef struct {
+	GMutex		 mutex;
+	GCond		 cond;
+	GMainContext	*context;
+	GMainLoop	*loop;
+	const gchar	*address;
+	gboolean	 ready;
+	gchar		*mount_point;	/* of sda1, changed without any signal */
+} FuCommonUdisksHelper;
+
+#define FU_TEST_UDISKS_SDA1	"/org/freedesktop/UDisks2/block_devices/sda1"
+#define FU_TEST_UDISKS_SDA2	"/org/freedesktop/UDisks2/block_devices/sda2"
+
+static const gchar fu_test_udisks_xml[] =
+	"<node>"
+	"  <interface name='org.freedesktop.DBus.ObjectManager'>"
+	"    <method name='GetManagedObjects'>"
+	"      <arg type='a{oa{sa{sv}}}' name='objects' direction='out'/>"
+	"    </method>"
+	"  </interface>"
+	"  <interface name='org.freedesktop.UDisks2.Partition'>"
+	"    <property type='s' name='Type' access='read'/>"
+	"  </interface>"
+	"  <interface name='org.freedesktop.UDisks2.Filesystem'>"
+	"    <property type='aay' name='MountPoints' access='read'/>"
+	"  </interface>"
+	"</node>";
+
+static GVariant *
+fu_common_udisks_helper_mount_points (FuCommonUdisksHelper *helper)
+{
+	GVariantBuilder builder;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&helper->mutex);
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("aay"));
+	if (helper->mount_point != NULL)
+		g_variant_builder_add_value (&builder, g_variant_new_bytestring (helper->mount_point));
+	return g_variant_builder_end (&builder);
+}
+
+static GVariant *
+fu_common_udisks_helper_get_property_cb (GDBusConnection *connection,
+					 const gchar *sender,
+					 const gchar *object_path,
+					 const gchar *interface_name,
+					 const gchar *property_name,
+					 GError **error,
+					 gpointer user_data)
+{
+	FuCommonUdisksHelper *helper = (FuCommonUdisksHelper *) user_data;
+	if (g_strcmp0 (property_name, "Type") == 0)
+		return g_variant_new_string (FU_VOLUME_KIND_ESP);
+	return fu_common_udisks_helper_mount_points (helper);
+}
+
+static void
+fu_common_udisks_helper_method_call_cb (GDBusConnection *connection,
+					const gchar *sender,
+					const gchar *object_path,
+					const gchar *interface_name,
+					const gchar *method_name,
+					GVariant *parameters,
+					GDBusMethodInvocation *invocation,
+					gpointer user_data)
+{
+	FuCommonUdisksHelper *helper = (FuCommonUdisksHelper *) user_data;
+	GVariantBuilder builder;
+	GVariantBuilder builder_sda1;
+	GVariantBuilder builder_sda2;
+	GVariantBuilder builder_part;
+	GVariantBuilder builder_file;
+
+	g_variant_builder_init (&builder_part, G_VARIANT_TYPE_VARDICT);
+	g_variant_builder_add (&builder_part, "{sv}", "Type",
+			       g_variant_new_string (FU_VOLUME_KIND_ESP));
+	g_variant_builder_init (&builder_file, G_VARIANT_TYPE_VARDICT);
+	g_variant_builder_add (&builder_file, "{sv}", "MountPoints",
+			       fu_common_udisks_helper_mount_points (helper));
+	g_variant_builder_init (&builder_sda1, G_VARIANT_TYPE ("a{sa{sv}}"));
+	g_variant_builder_add (&builder_sda1, "{sa{sv}}",
+			       "org.freedesktop.UDisks2.Partition", &builder_part);
+	g_variant_builder_add (&builder_sda1, "{sa{sv}}",
+			       "org.freedesktop.UDisks2.Filesystem", &builder_file);
+
+	/* no filesystem */
+	g_variant_builder_init (&builder_part, G_VARIANT_TYPE_VARDICT);
+	g_variant_builder_add (&builder_part, "{sv}", "Type",
+			       g_variant_new_string (FU_VOLUME_KIND_ESP));
+	g_variant_builder_init (&builder_sda2, G_VARIANT_TYPE ("a{sa{sv}}"));
+	g_variant_builder_add (&builder_sda2, "{sa{sv}}",
+			       "org.freedesktop.UDisks2.Partition", &builder_part);
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{oa{sa{sv}}}"));
+	g_variant_builder_add (&builder, "{oa{sa{sv}}}", FU_TEST_UDISKS_SDA1, &builder_sda1);
+	g_variant_builder_add (&builder, "{oa{sa{sv}}}", FU_TEST_UDISKS_SDA2, &builder_sda2);
+	g_dbus_method_invocation_return_value (invocation,
+					       g_variant_new ("(a{oa{sa{sv}}})", &builder));
+}
+
+static gpointer
+fu_common_udisks_helper_thread_cb (gpointer user_data)
+{
+	FuCommonUdisksHelper *helper = (FuCommonUdisksHelper *) user_data;
+	GDBusInterfaceVTable vtable = {
+		fu_common_udisks_helper_method_call_cb,
+		fu_common_udisks_helper_get_property_cb,
+		NULL,
+	};
+	const gchar *paths[] = { FU_TEST_UDISKS_SDA1, FU_TEST_UDISKS_SDA2, NULL };
+	guint id;
+	g_autoptr(GDBusConnection) connection = NULL;
+	g_autoptr(GDBusNodeInfo) info = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GVariant) val = NULL;
+
+	g_main_context_push_thread_default (helper->context);
+	connection = g_dbus_connection_new_for_address_sync (helper->address,
+							     G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+							     G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+							     NULL, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (connection);
+	info = g_dbus_node_info_new_for_xml (fu_test_udisks_xml, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (info);
+	id = g_dbus_connection_register_object (connection,
+						"/org/freedesktop/UDisks2",
+						info->interfaces[0],
+						&vtable, helper, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (id, !=, 0);
+	for (guint i = 0; paths[i] != NULL; i++) {
+		for (guint j = 1; j < 3; j++) {
+			/* sda2 has no filesystem */
+			if (i == 1 && j == 2)
+				continue;
+			id = g_dbus_connection_register_object (connection, paths[i],
+								info->interfaces[j],
+								&vtable, helper, NULL, &error);
+			g_assert_no_error (error);
+			g_assert_cmpint (id, !=, 0);
+		}
+	}
+	val = g_dbus_connection_call_sync (connection,
+					   "org.freedesktop.DBus",
+					   "/org/freedesktop/DBus",
+					   "org.freedesktop.DBus",
+					   "RequestName",
+					   g_variant_new ("(su)", "org.freedesktop.UDisks2", 0x4),
+					   G_VARIANT_TYPE ("(u)"),
+					   G_DBUS_CALL_FLAGS_NONE,
+					   -1, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (val);
+
+	/* ready for requests */
+	g_mutex_lock (&helper->mutex);
+	helper->ready = TRUE;
+	g_cond_signal (&helper->cond);
+	g_mutex_unlock (&helper->mutex);
+	g_main_loop_run (helper->loop);
+	g_dbus_connection_close_sync (connection, NULL, NULL);
+	g_main_context_pop_thread_default (helper->context);
+	return NULL;
+}
+
+static void
+fu_common_udisks_func (void)
+{
+	FuVolume *volume;
+	GThread *thread;
+	FuCommonUdisksHelper helper = { 0 };
+	g_autofree gchar *dbus_daemon = g_find_program_in_path ("dbus-daemon");
+	g_autofree gchar *mount_point = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) volumes = NULL;
+	g_autoptr(GPtrArray) volumes2 = NULL;
+	g_autoptr(GTestDBus) bus = NULL;
+
+	if (dbus_daemon == NULL) {
+		g_test_skip ("no dbus-daemon, skipping UDisks test");
+		return;
+	}
+
+	/* use a private bus as the system bus */
+	bus = g_test_dbus_new (G_TEST_DBUS_NONE);
+	g_test_dbus_up (bus);
+	g_setenv ("DBUS_SYSTEM_BUS_ADDRESS", g_test_dbus_get_bus_address (bus), TRUE);
+	helper.address = g_test_dbus_get_bus_address (bus);
+	helper.context = g_main_context_new ();
+	helper.loop = g_main_loop_new (helper.context, FALSE);
+	g_mutex_init (&helper.mutex);
+	g_cond_init (&helper.cond);
+	thread = g_thread_new ("udisks", fu_common_udisks_helper_thread_cb, &helper);
+	g_mutex_lock (&helper.mutex);
+	while (!helper.ready)
+		g_cond_wait (&helper.cond, &helper.mutex);
+	g_mutex_unlock (&helper.mutex);
+
+	/* the partition without a filesystem is still an ESP */
+	volumes = fu_common_get_volumes_by_kind (FU_VOLUME_KIND_ESP, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (volumes);
+	g_assert_cmpint (volumes->len, ==, 2);
+	volume = g_ptr_array_index (volumes, 0);
+	g_assert_cmpstr (fu_volume_get_id (volume), ==, FU_TEST_UDISKS_SDA1);
+	g_assert_false (fu_volume_is_mounted (volume));
+	volume = g_ptr_array_index (volumes, 1);
+	g_assert_cmpstr (fu_volume_get_id (volume), ==, FU_TEST_UDISKS_SDA2);
+	g_assert_false (fu_volume_is_mounted (volume));
+
+	/* mounted by something else, and nothing told the proxy */
+	g_mutex_lock (&helper.mutex);
+	helper.mount_point = g_strdup ("/boot/efi");
+	g_mutex_unlock (&helper.mutex);
+	volume = g_ptr_array_index (volumes, 0);
+	g_assert_true (fu_volume_is_mounted (volume));
+	mount_point = fu_volume_get_mount_point (volume);
+	g_assert_cmpstr (mount_point, ==, "/boot/efi");
+
+	/* created again after being freed */
+	fu_common_udisks_shutdown ();
+	volumes2 = fu_common_get_volumes_by_kind (FU_VOLUME_KIND_ESP, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (volumes2);
+	g_assert_cmpint (volumes2->len, ==, 2);
+	fu_common_udisks_shutdown ();
+
+	/* tear down */
+	g_clear_pointer (&volumes, g_ptr_array_unref);
+	g_clear_pointer (&volumes2, g_ptr_array_unref);
+	g_main_loop_quit (helper.loop);
+	g_thread_join (thread);
+	g_main_loop_unref (helper.loop);
+	g_main_context_unref (helper.context);
+	g_mutex_clear (&helper.mutex);
+	g_cond_clear (&helper.cond);
+	g_free (helper.mount_point);
+	g_unsetenv ("DBUS_SYSTEM_BUS_ADDRESS");
+	g_test_dbus_down (bus);
+}
+
 static void
 fu_common_endian_func (void)
 {
@@ -1182,6 +1591,507 @@ fu_chunk_func (void)
 					   "#05: page:02 addr:0004 len:02 ZZ\n");
 }
 
+/* chunks a blob one byte at a time, which is slow but obviously correct */
+static GPtrArray *
+fu_chunk_iter_reference (guint32 data_sz,
+			 guint32 addr_start,
+			 guint32 page_sz,
+			 guint32 packet_sz)
+{
+	FuChunk *chk = NULL;
+	GPtrArray *chunks = g_ptr_array_new_with_free_func (g_free);
+	for (guint32 i = 0; i < data_sz; i++) {
+		guint64 addr = (guint64) addr_start + i;
+		guint32 page = page_sz > 0 ? (guint32) (addr / page_sz) : 0;
+		if (chk == NULL || chk->page != page ||
+		    (packet_sz > 0 && chk->data_sz == packet_sz)) {
+			chk = g_new0 (FuChunk, 1);
+			chk->idx = chunks->len;
+			chk->page = page;
+			chk->address = page_sz > 0 ? (guint32) (addr % page_sz) : (guint32) addr;
+			g_ptr_array_add (chunks, chk);
+		}
+		chk->data_sz++;
+	}
+	return chunks;
+}
+
+static void
+fu_chunk_iter_func (void)
+{
+	FuChunk item;
+	FuChunkIter iter;
+	const guint8 data[] = "0123456789";
+	const guint32 addrs[] = { 0x0, 0x4, 0x7ff, 0x10000 };
+	const guint32 page_szs[] = { 0x0, 0x3, 0x40, 0x1000 };
+	const guint32 packet_szs[] = { 0x0, 0x1, 0x20, 0x40, 0x1001 };
+	struct {
+		guint32 page;
+		guint32 address;
+		guint32 data_sz;
+	} expected[] = {
+		{ 0x1, 0x2, 0x2 },
+		{ 0x2, 0x0, 0x3 },
+		{ 0x2, 0x3, 0x1 },
+		{ 0x3, 0x0, 0x3 },
+		{ 0x3, 0x3, 0x1 },
+	};
+	guint32 cnt = 0;
+
+	/* known layout: starting mid-page, pages of 4, packets of 3 */
+	fu_chunk_iter_init (&iter, data, 10, 0x6, 0x4, 0x3);
+	g_assert_cmpint (fu_chunk_iter_get_count (&iter), ==, G_N_ELEMENTS (expected));
+	while (fu_chunk_iter_next (&iter, &item)) {
+		g_assert_cmpint (cnt, <, G_N_ELEMENTS (expected));
+		g_assert_cmpint (item.idx, ==, cnt);
+		g_assert_cmpint (item.page, ==, expected[cnt].page);
+		g_assert_cmpint (item.address, ==, expected[cnt].address);
+		g_assert_cmpint (item.data_sz, ==, expected[cnt].data_sz);
+		cnt++;
+	}
+	g_assert_cmpint (cnt, ==, G_N_ELEMENTS (expected));
+	fu_chunk_iter_init (&iter, data, 10, 0x6, 0x4, 0x3);
+	g_assert_true (fu_chunk_iter_next (&iter, &item));
+	g_assert_true (item.data == data);
+	g_assert_true (fu_chunk_iter_next (&iter, &item));
+	g_assert_true (item.data == data + 2);
+
+	/* compare with a byte-at-a-time reference for lots of layouts */
+	for (guint a = 0; a < G_N_ELEMENTS (addrs); a++) {
+		for (guint p = 0; p < G_N_ELEMENTS (page_szs); p++) {
+			for (guint k = 0; k < G_N_ELEMENTS (packet_szs); k++) {
+				g_autoptr(GPtrArray) chunks = NULL;
+				g_autoptr(GPtrArray) chunks_ref = NULL;
+
+				chunks_ref = fu_chunk_iter_reference (0x2345, addrs[a],
+								      page_szs[p], packet_szs[k]);
+				fu_chunk_iter_init (&iter, NULL, 0x2345, addrs[a],
+						    page_szs[p], packet_szs[k]);
+				g_assert_cmpint (fu_chunk_iter_get_count (&iter), ==, chunks_ref->len);
+				cnt = 0;
+				while (fu_chunk_iter_next (&iter, &item)) {
+					FuChunk *chk = g_ptr_array_index (chunks_ref, cnt++);
+					g_assert_cmpint (item.idx, ==, chk->idx);
+					g_assert_cmpint (item.page, ==, chk->page);
+					g_assert_cmpint (item.address, ==, chk->address);
+					g_assert_cmpint (item.data_sz, ==, chk->data_sz);
+				}
+				g_assert_cmpint (cnt, ==, chunks_ref->len);
+
+				/* the array is built from the same layout */
+				chunks = fu_chunk_array_new (NULL, 0x2345, addrs[a],
+							     page_szs[p], packet_szs[k]);
+				g_assert_cmpint (chunks->len, ==, chunks_ref->len);
+			}
+		}
+	}
+}
+
+static void
+fu_chunk_array_modify_func (void)
+{
+	g_autoptr(GPtrArray) chunks = fu_chunk_array_new (NULL, 0x100, 0x0, 0x0, 0x10);
+
+	/* callers may renumber the packets without breaking the free */
+	g_assert_cmpint (chunks->len, ==, 0x10);
+	for (guint i = 0; i < chunks->len; i++) {
+		FuChunk *chk = g_ptr_array_index (chunks, i);
+		chk->idx = 0xffff - i;
+	}
+	g_ptr_array_remove_index (chunks, 3);
+	g_ptr_array_remove_index (chunks, 0);
+	g_assert_cmpint (chunks->len, ==, 0xe);
+}
+
+static void
+fu_device_transport_trace_func (void)
+{
+	gboolean ret;
+	guint8 buf[2] = { 0x0 };
+	const guint8 buf_wr[] = { 0x01 };
+	const guint8 buf_rd[] = { 0xab, 0xcd };
+	const gchar *fn = "/tmp/fwupd-self-test/transport-trace.json";
+	g_autoptr(FuTransportTrace) trace_rec = fu_transport_trace_new (FU_TRANSPORT_TRACE_MODE_RECORD);
+	g_autoptr(FuTransportTrace) trace_rep = fu_transport_trace_new (FU_TRANSPORT_TRACE_MODE_REPLAY);
+	g_autoptr(FuUdevDevice) device = g_object_new (FU_TYPE_UDEV_DEVICE, NULL);
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GError) error_timeout = NULL;
+
+	/* record what real hardware would have done */
+	fu_transport_trace_record (trace_rec, "Pwrite", 0x10,
+				   buf_wr, sizeof(buf_wr), NULL, 0,
+				   sizeof(buf_wr), NULL);
+	fu_transport_trace_record (trace_rec, "Pread", 0x20,
+				   NULL, 0, buf_rd, sizeof(buf_rd),
+				   sizeof(buf_rd), NULL);
+	g_set_error_literal (&error_timeout, G_IO_ERROR, G_IO_ERROR_TIMED_OUT, "timeout");
+	fu_transport_trace_record (trace_rec, "Pread", 0x30,
+				   NULL, 0, NULL, 0, 0, error_timeout);
+	g_assert_cmpint (fu_transport_trace_get_roundtrips (trace_rec), ==, 3);
+	g_assert_cmpint (fu_transport_trace_get_bytes (trace_rec), ==, 3);
+	ret = fu_common_mkdir_parent (fn, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = fu_transport_trace_save_file (trace_rec, fn, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+
+	/* replay without any hardware */
+	ret = fu_transport_trace_load_file (trace_rep, fn, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpint (fu_transport_trace_get_remaining (trace_rep), ==, 3);
+	fu_device_set_transport_trace (FU_DEVICE (device), trace_rep);
+	ret = fu_udev_device_pwrite_full (device, 0x10, buf_wr, sizeof(buf_wr), &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = fu_udev_device_pread_full (device, 0x20, buf, sizeof(buf), &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpint (buf[0], ==, 0xab);
+	g_assert_cmpint (buf[1], ==, 0xcd);
+	ret = fu_udev_device_pread_full (device, 0x30, buf, sizeof(buf), &error);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT);
+	g_assert_false (ret);
+	g_clear_error (&error);
+	g_assert_cmpint (fu_transport_trace_get_remaining (trace_rep), ==, 0);
+	g_assert_cmpint (fu_transport_trace_get_roundtrips (trace_rep), ==, 3);
+
+	/* the plugin did something different to the recording */
+	ret = fu_transport_trace_load_file (trace_rep, fn, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = fu_udev_device_pwrite_full (device, 0x11, buf_wr, sizeof(buf_wr), &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_INVALID_FILE);
+	g_assert_false (ret);
+}
+
+static void
+fu_device_transport_trace_rc_func (void)
+{
+	gboolean ret;
+	gint rc = 0;
+	guint8 buf[4] = { 0x0 };
+	const gchar *fn = "/tmp/fwupd-self-test/transport-trace-rc.json";
+	g_autoptr(FuTransportTrace) trace_rec = fu_transport_trace_new (FU_TRANSPORT_TRACE_MODE_RECORD);
+	g_autoptr(FuTransportTrace) trace_rep = fu_transport_trace_new (FU_TRANSPORT_TRACE_MODE_REPLAY);
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GError) error_perm = NULL;
+
+	/* a successful ioctl that returned a positive value, then a failure */
+	fu_transport_trace_record_full (trace_rec, "Ioctl", 0x1234,
+					buf, sizeof(buf), buf, sizeof(buf),
+					sizeof(buf), 5, NULL);
+	g_set_error_literal (&error_perm, FWUPD_ERROR,
+			     FWUPD_ERROR_PERMISSION_DENIED, "permission denied");
+	fu_transport_trace_record_full (trace_rec, "Ioctl", 0x1234,
+					buf, sizeof(buf), buf, sizeof(buf),
+					sizeof(buf), -1, error_perm);
+	ret = fu_common_mkdir_parent (fn, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = fu_transport_trace_save_file (trace_rec, fn, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+
+	/* the recorded return code is returned, even for the failure */
+	ret = fu_transport_trace_load_file (trace_rep, fn, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = fu_transport_trace_replay_full (trace_rep, "Ioctl", 0x1234,
+					     buf, sizeof(buf), buf, sizeof(buf),
+					     NULL, &rc, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpint (rc, ==, 5);
+	ret = fu_transport_trace_replay_full (trace_rep, "Ioctl", 0x1234,
+					     buf, sizeof(buf), buf, sizeof(buf),
+					     NULL, &rc, &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_PERMISSION_DENIED);
+	g_assert_false (ret);
+	g_assert_cmpint (rc, ==, -1);
+}
+
+static guint64
+fu_device_transport_trace_control_key (GUsbDeviceDirection direction,
+				       GUsbDeviceRequestType request_type,
+				       GUsbDeviceRecipient recipient,
+				       guint8 request,
+				       guint16 value,
+				       guint16 idx)
+{
+	return ((guint64) direction << 44) |
+	       ((guint64) request_type << 42) |
+	       ((guint64) recipient << 40) |
+	       ((guint64) request << 32) |
+	       ((guint64) value << 16) | idx;
+}
+
+static void
+fu_device_transport_trace_usb_func (void)
+{
+	gboolean ret;
+	gsize actual_len = 0;
+	guint8 buf[2] = { 0x0 };
+	guint8 buf_wr[] = { 0x01, 0x02 };
+	const guint8 buf_rd[] = { 0xab, 0xcd };
+	guint64 key_in;
+	guint64 key_out;
+	g_autoptr(FuTransportTrace) trace = fu_transport_trace_new (FU_TRANSPORT_TRACE_MODE_REPLAY);
+	g_autoptr(FuUsbDevice) device = g_object_new (FU_TYPE_USB_DEVICE, NULL);
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GError) error_timeout = NULL;
+
+	/* what a device would have done when the recording was made */
+	key_out = fu_device_transport_trace_control_key (G_USB_DEVICE_DIRECTION_HOST_TO_DEVICE,
+							 G_USB_DEVICE_REQUEST_TYPE_VENDOR,
+							 G_USB_DEVICE_RECIPIENT_DEVICE,
+							 0x42, 0x1234, 0x0);
+	key_in = fu_device_transport_trace_control_key (G_USB_DEVICE_DIRECTION_DEVICE_TO_HOST,
+							G_USB_DEVICE_REQUEST_TYPE_VENDOR,
+							G_USB_DEVICE_RECIPIENT_DEVICE,
+							0x43, 0x0, 0x0);
+	fu_transport_trace_record (trace, "ControlTransfer", key_out,
+				   buf_wr, sizeof(buf_wr), NULL, 0,
+				   sizeof(buf_wr), NULL);
+	fu_transport_trace_record (trace, "ControlTransfer", key_in,
+				   NULL, 0, buf_rd, sizeof(buf_rd),
+				   sizeof(buf_rd), NULL);
+	fu_transport_trace_record (trace, "BulkTransfer", 0x02,
+				   buf_wr, sizeof(buf_wr), NULL, 0,
+				   sizeof(buf_wr), NULL);
+	fu_transport_trace_record (trace, "InterruptTransfer", 0x81,
+				   NULL, 0, buf_rd, 1, 1, NULL);
+	g_set_error_literal (&error_timeout, G_USB_DEVICE_ERROR,
+			     G_USB_DEVICE_ERROR_TIMED_OUT, "timeout");
+	fu_transport_trace_record (trace, "InterruptTransfer", 0x81,
+				   NULL, 0, NULL, 0, 0, error_timeout);
+
+	/* replay without any hardware */
+	fu_device_set_transport_trace (FU_DEVICE (device), trace);
+	g_assert_true (fu_device_is_replay (FU_DEVICE (device)));
+	ret = fu_usb_device_control_transfer (device,
+					      G_USB_DEVICE_DIRECTION_HOST_TO_DEVICE,
+					      G_USB_DEVICE_REQUEST_TYPE_VENDOR,
+					      G_USB_DEVICE_RECIPIENT_DEVICE,
+					      0x42, 0x1234, 0x0,
+					      buf_wr, sizeof(buf_wr),
+					      &actual_len, 1000, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpint (actual_len, ==, sizeof(buf_wr));
+	ret = fu_usb_device_control_transfer (device,
+					      G_USB_DEVICE_DIRECTION_DEVICE_TO_HOST,
+					      G_USB_DEVICE_REQUEST_TYPE_VENDOR,
+					      G_USB_DEVICE_RECIPIENT_DEVICE,
+					      0x43, 0x0, 0x0,
+					      buf, sizeof(buf),
+					      &actual_len, 1000, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpint (actual_len, ==, sizeof(buf_rd));
+	g_assert_cmpint (buf[0], ==, 0xab);
+	g_assert_cmpint (buf[1], ==, 0xcd);
+	ret = fu_usb_device_bulk_transfer (device, 0x02,
+					   buf_wr, sizeof(buf_wr),
+					   &actual_len, 1000, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	memset (buf, 0x0, sizeof(buf));
+	ret = fu_usb_device_interrupt_transfer (device, 0x81,
+						buf, sizeof(buf),
+						&actual_len, 1000, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpint (actual_len, ==, 1);
+	g_assert_cmpint (buf[0], ==, 0xab);
+	ret = fu_usb_device_interrupt_transfer (device, 0x81,
+						buf, sizeof(buf),
+						&actual_len, 1000, NULL, &error);
+	g_assert_error (error, G_USB_DEVICE_ERROR, G_USB_DEVICE_ERROR_TIMED_OUT);
+	g_assert_false (ret);
+	g_clear_error (&error);
+	g_assert_cmpint (fu_transport_trace_get_remaining (trace), ==, 0);
+
+	/* the plugin used a different endpoint to the recording */
+	ret = fu_usb_device_bulk_transfer (device, 0x03,
+					   buf_wr, sizeof(buf_wr),
+					   &actual_len, 1000, NULL, &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_NOT_FOUND);
+	g_assert_false (ret);
+}
+
+static void
+fu_device_transport_trace_hid_func (void)
+{
+	gboolean ret;
+	guint8 buf[3] = { 0x0 };
+	guint8 buf_wr[] = { 0x05, 0x01, 0x02 };
+	const guint8 buf_rd[] = { 0x06, 0xab, 0xcd };
+	g_autoptr(FuTransportTrace) trace = fu_transport_trace_new (FU_TRANSPORT_TRACE_MODE_REPLAY);
+	g_autoptr(FuHidDevice) device = g_object_new (FU_TYPE_HID_DEVICE, NULL);
+	g_autoptr(GError) error = NULL;
+
+	/* SetReport and GetReport are class requests to the HID interface */
+	fu_transport_trace_record (trace, "ControlTransfer",
+				   fu_device_transport_trace_control_key (G_USB_DEVICE_DIRECTION_HOST_TO_DEVICE,
+									  G_USB_DEVICE_REQUEST_TYPE_CLASS,
+									  G_USB_DEVICE_RECIPIENT_INTERFACE,
+									  0x09, 0x0205, 0x0),
+				   buf_wr, sizeof(buf_wr), NULL, 0,
+				   sizeof(buf_wr), NULL);
+	fu_transport_trace_record (trace, "ControlTransfer",
+				   fu_device_transport_trace_control_key (G_USB_DEVICE_DIRECTION_DEVICE_TO_HOST,
+									  G_USB_DEVICE_REQUEST_TYPE_CLASS,
+									  G_USB_DEVICE_RECIPIENT_INTERFACE,
+									  0x01, 0x0306, 0x0),
+				   NULL, 0, buf_rd, sizeof(buf_rd),
+				   sizeof(buf_rd), NULL);
+	fu_transport_trace_record (trace, "ControlTransfer",
+				   fu_device_transport_trace_control_key (G_USB_DEVICE_DIRECTION_DEVICE_TO_HOST,
+									  G_USB_DEVICE_REQUEST_TYPE_CLASS,
+									  G_USB_DEVICE_RECIPIENT_INTERFACE,
+									  0x01, 0x0306, 0x0),
+				   NULL, 0, buf_rd, 1, 1, NULL);
+
+	/* replay without any hardware */
+	fu_device_set_transport_trace (FU_DEVICE (device), trace);
+	ret = fu_hid_device_set_report (device, 0x05, buf_wr, sizeof(buf_wr),
+					1000, FU_HID_DEVICE_FLAG_NONE, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = fu_hid_device_get_report (device, 0x06, buf, sizeof(buf),
+					1000, FU_HID_DEVICE_FLAG_IS_FEATURE, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpint (buf[1], ==, 0xab);
+	g_assert_cmpint (buf[2], ==, 0xcd);
+
+	/* short read is still detected when replaying */
+	ret = fu_hid_device_get_report (device, 0x06, buf, sizeof(buf),
+					1000, FU_HID_DEVICE_FLAG_IS_FEATURE, &error);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+	g_assert_false (ret);
+	g_assert_cmpint (fu_transport_trace_get_remaining (trace), ==, 0);
+}
+
+static void
+fu_device_transport_trace_identity_func (void)
+{
+	gboolean ret;
+	const gchar *fn = "/tmp/fwupd-self-test/transport-trace-identity.json";
+	g_autoptr(FuDevice) device_new = NULL;
+	g_autoptr(FuHidDevice) device = g_object_new (FU_TYPE_HID_DEVICE, NULL);
+	g_autoptr(FuTransportTrace) trace_rec = fu_transport_trace_new (FU_TRANSPORT_TRACE_MODE_RECORD);
+	g_autoptr(FuTransportTrace) trace_rep = fu_transport_trace_new (FU_TRANSPORT_TRACE_MODE_REPLAY);
+	g_autoptr(GError) error = NULL;
+
+	/* enumerated device */
+	fu_device_set_id (FU_DEVICE (device), "usb:00:01");
+	fu_device_set_plugin (FU_DEVICE (device), "test");
+	fu_device_set_name (FU_DEVICE (device), "ColorHug");
+	fu_device_set_version_format (FU_DEVICE (device), FWUPD_VERSION_FORMAT_TRIPLET);
+	fu_device_set_version (FU_DEVICE (device), "1.2.3");
+	fu_device_set_remove_delay (FU_DEVICE (device), 5000);
+	fu_device_add_guid (FU_DEVICE (device), "2082b5e0-7a64-478a-b1b2-e3404fab6dad");
+	fu_device_add_flag (FU_DEVICE (device), FWUPD_DEVICE_FLAG_UPDATABLE);
+	fu_hid_device_set_interface (device, 0x02);
+	fu_device_set_transport_trace (FU_DEVICE (device), trace_rec);
+	g_assert_cmpstr (fu_transport_trace_get_device_metadata (trace_rec, "GType"), ==, "FuHidDevice");
+	ret = fu_common_mkdir_parent (fn, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = fu_transport_trace_save_file (trace_rec, fn, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+
+	/* created again without any hardware */
+	ret = fu_transport_trace_load_file (trace_rep, fn, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	device_new = fu_device_new_from_transport_trace (trace_rep, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (device_new);
+	g_assert_true (FU_IS_HID_DEVICE (device_new));
+	g_assert_true (fu_device_is_replay (device_new));
+	g_assert_cmpstr (fu_device_get_id (device_new), ==, fu_device_get_id (FU_DEVICE (device)));
+	g_assert_cmpstr (fu_device_get_plugin (device_new), ==, "test");
+	g_assert_cmpstr (fu_device_get_name (device_new), ==, "ColorHug");
+	g_assert_cmpstr (fu_device_get_version (device_new), ==, "1.2.3");
+	g_assert_cmpint (fu_device_get_version_format (device_new), ==, FWUPD_VERSION_FORMAT_TRIPLET);
+	g_assert_cmpint (fu_device_get_remove_delay (device_new), ==, 5000);
+	g_assert_true (fu_device_has_guid (device_new, "2082b5e0-7a64-478a-b1b2-e3404fab6dad"));
+	g_assert_true (fu_device_has_flag (device_new, FWUPD_DEVICE_FLAG_UPDATABLE));
+	g_assert_cmpint (fu_hid_device_get_interface (FU_HID_DEVICE (device_new)), ==, 0x02);
+
+	/* no identity in the trace */
+	g_clear_object (&trace_rep);
+	trace_rep = fu_transport_trace_new (FU_TRANSPORT_TRACE_MODE_REPLAY);
+	g_clear_object (&device_new);
+	device_new = fu_device_new_from_transport_trace (trace_rep, &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_INVALID_FILE);
+	g_assert_null (device_new);
+}
+
+static void
+fu_device_transport_trace_ioctl_func (void)
+{
+#ifdef HAVE_SCSI_SG_H
+	gboolean ret;
+	gint rc = 0;
+	guint8 cdb[2] = { 0x01, 0x02 };
+	guint8 data[4] = { 0x0 };
+	guint8 sb[2] = { 0x0 };
+	const guint8 data_rd[] = { 0xde, 0xad, 0xbe, 0xef };
+	const guint8 sb_rd[] = { 0x70, 0x00 };
+	sg_io_hdr_t hdr = { 0x0 };
+	sg_io_hdr_t hdr_tmp;
+	g_autoptr(FuTransportTrace) trace = fu_transport_trace_new (FU_TRANSPORT_TRACE_MODE_REPLAY);
+	g_autoptr(FuUdevDevice) device = g_object_new (FU_TYPE_UDEV_DEVICE, NULL);
+	g_autoptr(GByteArray) blob_in = g_byte_array_new ();
+	g_autoptr(GByteArray) blob_out = g_byte_array_new ();
+	g_autoptr(GError) error = NULL;
+
+	/* the pointers are cleared and the data they point to follows */
+	hdr.interface_id = 'S';
+	hdr.cmd_len = sizeof(cdb);
+	hdr.dxfer_direction = SG_DXFER_FROM_DEV;
+	hdr.dxfer_len = sizeof(data);
+	hdr.mx_sb_len = sizeof(sb);
+	hdr_tmp = hdr;
+	g_byte_array_append (blob_in, (const guint8 *) &hdr_tmp, sizeof(hdr_tmp));
+	g_byte_array_append (blob_in, cdb, sizeof(cdb));
+	hdr_tmp.status = 0x02;
+	g_byte_array_append (blob_out, (const guint8 *) &hdr_tmp, sizeof(hdr_tmp));
+	g_byte_array_append (blob_out, data_rd, sizeof(data_rd));
+	g_byte_array_append (blob_out, sb_rd, sizeof(sb_rd));
+	fu_transport_trace_record_full (trace, "Ioctl", SG_IO,
+					blob_in->data, blob_in->len,
+					blob_out->data, blob_out->len,
+					blob_out->len, 0, NULL);
+
+	/* replayed with pointers that are different to the recording */
+	hdr.cmdp = cdb;
+	hdr.dxferp = data;
+	hdr.sbp = sb;
+	fu_device_set_transport_trace (FU_DEVICE (device), trace);
+	ret = fu_udev_device_ioctl (device, SG_IO, (guint8 *) &hdr, &rc, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpint (rc, ==, 0);
+	g_assert_cmpint (hdr.status, ==, 0x02);
+	g_assert_true (hdr.cmdp == cdb);
+	g_assert_true (hdr.dxferp == data);
+	g_assert_true (hdr.sbp == sb);
+	g_assert_cmpint (data[0], ==, 0xde);
+	g_assert_cmpint (data[3], ==, 0xef);
+	g_assert_cmpint (sb[0], ==, 0x70);
+	g_assert_cmpint (fu_transport_trace_get_remaining (trace), ==, 0);
+#else
+	g_test_skip ("no scsi/sg.h support");
+#endif
+}
+
 static void
 fu_common_strstrip_func (void)
 {
@@ -1356,6 +2266,208 @@ fu_common_vercmp_func (void)
 	g_assert_cmpint (fu_common_vercmp (NULL, NULL), ==, G_MAXINT);
 }
 
+static void
+fu_jcat_cache_func (void)
+{
+	gboolean ret;
+	gint64 timestamp = -1;
+	g_autofree gchar *csum = NULL;
+	g_autoptr(FuJcatCache) jcat_cache = fu_jcat_cache_new ();
+	g_autoptr(GBytes) blob = g_bytes_new_static ("hello world", 11);
+	g_autoptr(GBytes) blob_bad = g_bytes_new_static ("hello wOrld", 11);
+	g_autoptr(GError) error = NULL;
+	g_autoptr(JcatBlob) jcat_blob = NULL;
+	g_autoptr(JcatContext) jcat_context = jcat_context_new ();
+	g_autoptr(JcatItem) jcat_item = jcat_item_new ("hello.txt");
+
+	csum = g_compute_checksum_for_bytes (G_CHECKSUM_SHA256, blob);
+	jcat_blob = jcat_blob_new_utf8 (JCAT_BLOB_KIND_SHA256, csum);
+	jcat_item_add_blob (jcat_item, jcat_blob);
+
+	/* checksums are cheap, so are verified every time */
+	for (guint i = 0; i < 2; i++) {
+		ret = fu_jcat_cache_verify_item (jcat_cache, jcat_context,
+						 blob, jcat_item,
+						 JCAT_VERIFY_FLAG_REQUIRE_CHECKSUM,
+						 &timestamp, &error);
+		g_assert_no_error (error);
+		g_assert (ret);
+		g_assert_cmpint (timestamp, ==, 0);
+	}
+	g_assert_cmpint (fu_jcat_cache_get_hits (jcat_cache), ==, 0);
+
+	/* wrong payload */
+	ret = fu_jcat_cache_verify_item (jcat_cache, jcat_context,
+					 blob_bad, jcat_item,
+					 JCAT_VERIFY_FLAG_REQUIRE_CHECKSUM,
+					 NULL, &error);
+	g_assert_nonnull (error);
+	g_assert (!ret);
+	g_clear_error (&error);
+
+	/* no signature */
+	ret = fu_jcat_cache_verify_item (jcat_cache, jcat_context,
+					 blob, jcat_item,
+					 JCAT_VERIFY_FLAG_REQUIRE_SIGNATURE,
+					 NULL, &error);
+	g_assert_nonnull (error);
+	g_assert (!ret);
+	g_assert_cmpint (fu_jcat_cache_get_hits (jcat_cache), ==, 0);
+}
+
+static void
+fu_jcat_cache_verify_pkcs7 (const gchar *keyring_path, guint hits)
+{
+	gboolean ret;
+	gint64 timestamp = 0;
+	g_autofree gchar *fn = NULL;
+	g_autofree gchar *fn_sig = NULL;
+	g_autofree gchar *pkidir = g_build_filename (TESTDATADIR_SRC, "..", "pki", NULL);
+	g_autoptr(FuJcatCache) jcat_cache = fu_jcat_cache_new ();
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GBytes) blob_sig = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(JcatBlob) jcat_blob = NULL;
+	g_autoptr(JcatContext) jcat_context = jcat_context_new ();
+	g_autoptr(JcatItem) jcat_item = jcat_item_new ("firmware.bin");
+
+	fn = g_build_filename (TESTDATADIR_SRC, "colorhug", "firmware.bin", NULL);
+	blob = fu_common_get_contents_bytes (fn, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (blob);
+	fn_sig = g_build_filename (TESTDATADIR_SRC, "colorhug", "firmware.bin.p7b", NULL);
+	blob_sig = fu_common_get_contents_bytes (fn_sig, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (blob_sig);
+	jcat_blob = jcat_blob_new (JCAT_BLOB_KIND_PKCS7, blob_sig);
+	jcat_item_add_blob (jcat_item, jcat_blob);
+	jcat_context_add_public_keys (jcat_context, pkidir);
+
+	fu_jcat_cache_set_filename (jcat_cache, "/tmp/fwupd-self-test/jcat.cache");
+	fu_jcat_cache_add_keyring_path (jcat_cache, keyring_path);
+	for (guint i = 0; i < 2; i++) {
+		ret = fu_jcat_cache_verify_item (jcat_cache, jcat_context,
+						 blob, jcat_item,
+						 JCAT_VERIFY_FLAG_REQUIRE_SIGNATURE,
+						 &timestamp, &error);
+		g_assert_no_error (error);
+		g_assert_true (ret);
+		g_assert_cmpint (timestamp, >, 0);
+	}
+	g_assert_cmpint (fu_jcat_cache_get_hits (jcat_cache), ==, hits);
+}
+
+static void
+fu_jcat_cache_pkcs7_func (void)
+{
+	g_autofree gchar *pkidir = g_build_filename (TESTDATADIR_SRC, "..", "pki", NULL);
+	g_autofree gchar *pkidir_other = g_build_filename (TESTDATADIR_SRC, "colorhug", NULL);
+
+	/* the second signature check is answered from the cache */
+	g_unlink ("/tmp/fwupd-self-test/jcat.cache");
+	fu_jcat_cache_verify_pkcs7 (pkidir, 1);
+
+	/* both answered from the file saved by the previous instance */
+	fu_jcat_cache_verify_pkcs7 (pkidir, 2);
+
+	/* different trusted keys, so the first check is a miss */
+	fu_jcat_cache_verify_pkcs7 (pkidir_other, 1);
+}
+
+static void
+fu_version_key_func (void)
+{
+	struct {
+		const gchar *a;
+		const gchar *b;
+	} map[] = {
+		{ "1.2.3",	"1.2.3" },
+		{ "001.002.003", "1.2.3" },
+		{ "1.2.3",	"1.2.4" },
+		{ "1.2.3",	"1.2.3.1" },
+		{ "1.2.3.1",	"1.2.4" },
+		{ "1.2.3a",	"1.2.3b" },
+		{ "1.2.3",	"1.2.3a" },
+		{ "alpha",	"beta" },
+		{ "1.2a.3",	"1.2b.3" },
+		{ "1.2.3~rc1",	"1.2.3" },
+		{ "1.2.3~rc2",	"1.2.3~rc1" },
+		{ "",		"0" },
+		{ "1.",		"1" },
+		{ "1",		NULL },
+		{ NULL,		NULL },
+	};
+	FwupdVersionFormat fmts[] = {
+		FWUPD_VERSION_FORMAT_TRIPLET,
+		FWUPD_VERSION_FORMAT_PLAIN,
+	};
+
+	/* same result as the string compare, in both directions */
+	for (guint j = 0; j < G_N_ELEMENTS (fmts); j++) {
+		for (guint i = 0; i < G_N_ELEMENTS (map); i++) {
+			g_autoptr(FuVersionKey) key_a = fu_version_key_new (map[i].a, fmts[j]);
+			g_autoptr(FuVersionKey) key_b = fu_version_key_new (map[i].b, fmts[j]);
+			gint rc1 = fu_common_vercmp_full (map[i].a, map[i].b, fmts[j]);
+			gint rc2 = fu_common_vercmp_full (map[i].b, map[i].a, fmts[j]);
+			g_assert_cmpint (fu_version_key_compare (key_a, key_b), ==, rc1);
+			g_assert_cmpint (fu_version_key_compare (key_b, key_a), ==, rc2);
+		}
+	}
+}
+
+static gint
+fu_version_key_sort_cb (gconstpointer a, gconstpointer b)
+{
+	return fu_version_key_compare (*((FuVersionKey **) a), *((FuVersionKey **) b));
+}
+
+static gint
+fu_version_key_sort_str_cb (gconstpointer a, gconstpointer b)
+{
+	return fu_common_vercmp_full (*((const gchar **) a), *((const gchar **) b),
+				      FWUPD_VERSION_FORMAT_QUAD);
+}
+
+static void
+fu_version_key_performance_func (void)
+{
+	g_autoptr(GPtrArray) keys = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_version_key_free);
+	g_autoptr(GPtrArray) strs = g_ptr_array_new_with_free_func (g_free);
+	g_autoptr(GTimer) timer = g_timer_new ();
+
+	/* lots of releases in a random order */
+	for (guint i = 0; i < 1000; i++) {
+		guint32 tmp = g_random_int ();
+		g_ptr_array_add (strs, g_strdup_printf ("%u.%u.%u.%u",
+							(tmp >> 24) & 0xff,
+							(tmp >> 16) & 0xff,
+							(tmp >> 8) & 0xff,
+							tmp & 0xff));
+	}
+
+	/* parse each string every time it is compared */
+	g_timer_reset (timer);
+	g_ptr_array_sort (strs, fu_version_key_sort_str_cb);
+	g_print ("vercmp=%.3fms ", g_timer_elapsed (timer, NULL) * 1000.f);
+	g_ptr_array_sort (strs, (GCompareFunc) g_strcmp0);
+
+	/* parse each string once */
+	g_timer_reset (timer);
+	for (guint i = 0; i < strs->len; i++) {
+		const gchar *str = g_ptr_array_index (strs, i);
+		g_ptr_array_add (keys, fu_version_key_new (str, FWUPD_VERSION_FORMAT_QUAD));
+	}
+	g_ptr_array_sort (keys, fu_version_key_sort_cb);
+	g_print ("key=%.3fms ", g_timer_elapsed (timer, NULL) * 1000.f);
+
+	/* still sorted */
+	for (guint i = 1; i < keys->len; i++) {
+		FuVersionKey *key1 = g_ptr_array_index (keys, i - 1);
+		FuVersionKey *key2 = g_ptr_array_index (keys, i);
+		g_assert_cmpint (fu_version_key_compare (key1, key2), <=, 0);
+	}
+}
+
 static void
 fu_firmware_ihex_func (void)
 {
@@ -1947,6 +3059,176 @@ fu_device_retry_hardware_func (void)
 	g_assert_cmpint (helper.cnt_failed, ==, 2);
 }
 
+static gboolean
+fu_device_wait_3rd_try_cb (FuDevice *device, gpointer user_data, GError **error)
+{
+	guint *cnt = (guint *) user_data;
+	if ((*cnt)++ < 2) {
+		g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_BUSY, "busy");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static gboolean
+fu_device_wait_busy_cb (FuDevice *device, gpointer user_data, GError **error)
+{
+	g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_BUSY, "busy");
+	return FALSE;
+}
+
+static void
+fu_device_wait_func (void)
+{
+	gboolean ret;
+	guint cnt = 0;
+	g_autoptr(FuDevice) device = fu_device_new ();
+	g_autoptr(FuDevice) device2 = fu_device_new ();
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GHashTable) metadata = NULL;
+	FuDeviceRetryHelper helper = {
+		.cnt_success = 0,
+		.cnt_failed = 0,
+	};
+
+	/* completes after some polling, and remembers how long it took */
+	g_assert_cmpint (fu_device_get_wait_profile (device, "erase"), ==, 0);
+	ret = fu_device_wait_for_condition (device, "erase",
+					    fu_device_wait_3rd_try_cb,
+					    1000, &cnt, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpint (cnt, ==, 3);
+	g_assert_cmpint (fu_device_get_wait_profile (device, "erase"), >, 0);
+
+	/* never completes */
+	ret = fu_device_wait_for_condition (device, "write",
+					    fu_device_wait_busy_cb,
+					    20, NULL, &error);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT);
+	g_assert_false (ret);
+	g_assert_cmpint (fu_device_get_wait_profile (device, "write"), ==, 0);
+	g_clear_error (&error);
+
+	/* other errors are fatal */
+	ret = fu_device_wait_for_condition (device, NULL,
+					    fu_device_retry_failed,
+					    1000, &helper, &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL);
+	g_assert_false (ret);
+	g_assert_cmpint (helper.cnt_failed, ==, 1);
+
+	/* save and restore */
+	metadata = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	fu_device_set_wait_profile (device, "erase", 123);
+	fu_device_wait_profile_to_metadata (device, metadata);
+	g_assert_cmpstr (g_hash_table_lookup (metadata, "WaitProfile(erase)"), ==, "123");
+	g_hash_table_insert (metadata, g_strdup ("BootTime"), g_strdup ("456"));
+	fu_device_wait_profile_from_metadata (device2, metadata);
+	g_assert_cmpint (fu_device_get_wait_profile (device2, "erase"), ==, 123);
+	g_assert_cmpint (fu_device_get_wait_profile (device2, "BootTime"), ==, 0);
+}
+
+static void
+fu_msr_snapshot_func (void)
+{
+	gboolean ret;
+	guint64 value = 0;
+	g_autofree gchar *tmpdir = NULL;
+	g_autoptr(FuMsrSnapshot) msr_snapshot = fu_msr_snapshot_new ();
+	g_autoptr(GArray) cpus = NULL;
+	g_autoptr(GError) error = NULL;
+
+	/* fake two CPUs, only the second of which implements 0x20 */
+	tmpdir = g_dir_make_tmp ("fwupd-msr-XXXXXX", &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (tmpdir);
+	for (guint i = 0; i < 2; i++) {
+		guint8 buf[0x28] = { 0x0 };
+		g_autofree gchar *fn = NULL;
+		g_autofree gchar *cpu = g_strdup_printf ("%u", i);
+		fn = g_build_filename (tmpdir, cpu, "msr", NULL);
+		ret = fu_common_mkdir_parent (fn, &error);
+		g_assert_no_error (error);
+		g_assert_true (ret);
+		buf[0x10] = 0x10 + i;
+		buf[0x20] = 0x20;
+		ret = g_file_set_contents (fn, (const gchar *) buf,
+					   i == 0 ? 0x18 : sizeof(buf), &error);
+		g_assert_no_error (error);
+		g_assert_true (ret);
+	}
+	fu_msr_snapshot_set_path (msr_snapshot, tmpdir);
+	fu_msr_snapshot_add_address (msr_snapshot, 0x10);
+	fu_msr_snapshot_add_address (msr_snapshot, 0x20);
+
+	/* not loaded yet */
+	ret = fu_msr_snapshot_get_value (msr_snapshot, 0, 0x10, &value, &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL);
+	g_assert_false (ret);
+	g_clear_error (&error);
+
+	ret = fu_msr_snapshot_load (msr_snapshot, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	cpus = fu_msr_snapshot_get_cpus (msr_snapshot);
+	g_assert_cmpint (cpus->len, ==, 2);
+	ret = fu_msr_snapshot_get_value (msr_snapshot, 0, 0x10, &value, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpint (value, ==, 0x10);
+	ret = fu_msr_snapshot_get_value (msr_snapshot, 1, 0x10, &value, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpint (value, ==, 0x11);
+	ret = fu_msr_snapshot_get_value (msr_snapshot, 1, 0x20, &value, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpint (value, ==, 0x20);
+
+	/* short read */
+	ret = fu_msr_snapshot_get_value (msr_snapshot, 0, 0x20, &value, &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_NOT_SUPPORTED);
+	g_assert_false (ret);
+	g_clear_error (&error);
+
+	/* never declared */
+	ret = fu_msr_snapshot_get_value (msr_snapshot, 0, 0x30, &value, &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_NOT_FOUND);
+	g_assert_false (ret);
+	g_clear_error (&error);
+
+	ret = fu_common_rmtree (tmpdir, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+}
+
+static void
+fu_security_attrs_depsolve_func (void)
+{
+	g_autoptr(FuSecurityAttrs) attrs = fu_security_attrs_new ();
+	g_autoptr(FwupdSecurityAttr) attr1 = NULL;
+	g_autoptr(FwupdSecurityAttr) attr2 = NULL;
+
+	attr1 = fwupd_security_attr_new ("org.fwupd.hsi.PRX");
+	fwupd_security_attr_set_plugin (attr1, "test");
+	fwupd_security_attr_set_url (attr1, "http://test");
+	attr2 = fwupd_security_attr_new ("org.fwupd.hsi.BIOSGuard");
+	fwupd_security_attr_set_plugin (attr2, "test");
+	fwupd_security_attr_set_url (attr2, "http://test");
+	fwupd_security_attr_add_obsolete (attr2, "org.fwupd.hsi.PRX");
+	fu_security_attrs_append (attrs, attr1);
+	fu_security_attrs_append (attrs, attr2);
+	fu_security_attrs_depsolve (attrs);
+	g_assert_true (fwupd_security_attr_has_flag (attr1, FWUPD_SECURITY_ATTR_FLAG_OBSOLETED));
+
+	/* reuse the first attr without the one that obsoleted it */
+	fu_security_attrs_remove_all (attrs);
+	fu_security_attrs_append (attrs, attr1);
+	fu_security_attrs_depsolve (attrs);
+	g_assert_false (fwupd_security_attr_has_flag (attr1, FWUPD_SECURITY_ATTR_FLAG_OBSOLETED));
+}
+
 static void
 fu_security_attrs_hsi_func (void)
 {
@@ -2065,18 +3347,28 @@ main (int argc, char **argv)
 	g_setenv ("FWUPD_LOCALSTATEDIR", "/tmp/fwupd-self-test/var", TRUE);
 
 	g_test_add_func ("/fwupd/security-attrs{hsi}", fu_security_attrs_hsi_func);
+	g_test_add_func ("/fwupd/security-attrs{depsolve}", fu_security_attrs_depsolve_func);
+	g_test_add_func ("/fwupd/msr-snapshot", fu_msr_snapshot_func);
 	g_test_add_func ("/fwupd/plugin{delay}", fu_plugin_delay_func);
 	g_test_add_func ("/fwupd/plugin{quirks}", fu_plugin_quirks_func);
 	g_test_add_func ("/fwupd/plugin{quirks-performance}", fu_plugin_quirks_performance_func);
 	g_test_add_func ("/fwupd/plugin{quirks-device}", fu_plugin_quirks_device_func);
 	g_test_add_func ("/fwupd/chunk", fu_chunk_func);
+	g_test_add_func ("/fwupd/chunk{iter}", fu_chunk_iter_func);
+	g_test_add_func ("/fwupd/chunk{modify}", fu_chunk_array_modify_func);
+	g_test_add_func ("/fwupd/common{checksums}", fu_common_checksums_func);
 	g_test_add_func ("/fwupd/common{crc}", fu_common_crc_func);
 	g_test_add_func ("/fwupd/common{string-append-kv}", fu_common_string_append_kv_func);
 	g_test_add_func ("/fwupd/common{version-guess-format}", fu_common_version_guess_format_func);
 	g_test_add_func ("/fwupd/common{version}", fu_common_version_func);
 	g_test_add_func ("/fwupd/common{vercmp}", fu_common_vercmp_func);
+	g_test_add_func ("/fwupd/jcat-cache", fu_jcat_cache_func);
+	g_test_add_func ("/fwupd/jcat-cache{pkcs7}", fu_jcat_cache_pkcs7_func);
+	g_test_add_func ("/fwupd/version-key", fu_version_key_func);
+	g_test_add_func ("/fwupd/version-key{performance}", fu_version_key_performance_func);
 	g_test_add_func ("/fwupd/common{strstrip}", fu_common_strstrip_func);
 	g_test_add_func ("/fwupd/common{endian}", fu_common_endian_func);
+	g_test_add_func ("/fwupd/common{udisks}", fu_common_udisks_func);
 	g_test_add_func ("/fwupd/common{cab-success}", fu_common_store_cab_func);
 	g_test_add_func ("/fwupd/common{cab-success-unsigned}", fu_common_store_cab_unsigned_func);
 	g_test_add_func ("/fwupd/common{cab-success-folder}", fu_common_store_cab_folder_func);
@@ -2087,7 +3379,9 @@ main (int argc, char **argv)
 	g_test_add_func ("/fwupd/common{cab-error-size}", fu_common_store_cab_error_size_func);
 	g_test_add_func ("/fwupd/common{spawn)", fu_common_spawn_func);
 	g_test_add_func ("/fwupd/common{spawn-timeout)", fu_common_spawn_timeout_func);
+	g_test_add_func ("/fwupd/common{spawn-async}", fu_common_spawn_async_func);
 	g_test_add_func ("/fwupd/common{firmware-builder}", fu_common_firmware_builder_func);
+	g_test_add_func ("/fwupd/common{firmware-builder-async}", fu_common_firmware_builder_async_func);
 	g_test_add_func ("/fwupd/common{kernel-lockdown}", fu_common_kernel_lockdown_func);
 	g_test_add_func ("/fwupd/efivar", fu_efivar_func);
 	g_test_add_func ("/fwupd/hwids", fu_hwids_func);
@@ -2106,6 +3400,12 @@ main (int argc, char **argv)
 	g_test_add_func ("/fwupd/archive{invalid}", fu_archive_invalid_func);
 	g_test_add_func ("/fwupd/archive{cab}", fu_archive_cab_func);
 	g_test_add_func ("/fwupd/device{flags}", fu_device_flags_func);
+	g_test_add_func ("/fwupd/device{transport-trace}", fu_device_transport_trace_func);
+	g_test_add_func ("/fwupd/device{transport-trace-rc}", fu_device_transport_trace_rc_func);
+	g_test_add_func ("/fwupd/device{transport-trace-usb}", fu_device_transport_trace_usb_func);
+	g_test_add_func ("/fwupd/device{transport-trace-hid}", fu_device_transport_trace_hid_func);
+	g_test_add_func ("/fwupd/device{transport-trace-identity}", fu_device_transport_trace_identity_func);
+	g_test_add_func ("/fwupd/device{transport-trace-ioctl}", fu_device_transport_trace_ioctl_func);
 	g_test_add_func ("/fwupd/device{parent}", fu_device_parent_func);
 	g_test_add_func ("/fwupd/device{incorporate}", fu_device_incorporate_func);
 	if (g_test_slow ())
@@ -2118,5 +3418,6 @@ main (int argc, char **argv)
 	g_test_add_func ("/fwupd/device{retry-success}", fu_device_retry_success_func);
 	g_test_add_func ("/fwupd/device{retry-failed}", fu_device_retry_failed_func);
 	g_test_add_func ("/fwupd/device{retry-hardware}", fu_device_retry_hardware_func);
+	g_test_add_func ("/fwupd/device{wait}", fu_device_wait_func);
 	return g_test_run ();
 }
@@ -0,0 +1,770 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#define G_LOG_DOMAIN				"FuTransportTrace"
+
+#include "config.h"
+
+#include <string.h>
+#include <json-glib/json-glib.h>
+
+#include "fwupd-error.h"
+
+#include "fu-transport-trace.h"
+
+/**
+ * SECTION:fu-transport-trace
+ * @short_description: a record of low-level device transfers
+ *
+ * An object that records the transfers made to a device, e.g. USB control
+ * transfers, HID reports or ioctls, and that can replay them deterministically
+ * without the hardware being present.
+ *
+ * This allows the plugin write paths to be benchmarked and regression-tested
+ * on machines without the physical device attached. The identity of the
+ * device is saved with the transfers so that an equivalent #FuDevice can be
+ * created when replaying.
+ *
+ * See also: #FuDevice
+ */
+
+typedef struct {
+	gchar			*kind;
+	guint64			 request;
+	GBytes			*data_in;	/* nullable */
+	GBytes			*data_out;	/* nullable */
+	gsize			 actual_len;
+	gint			 rc;
+	gchar			*error_domain;	/* nullable */
+	gint			 error_code;
+	gchar			*error_message;	/* nullable */
+} FuTransportTraceEvent;
+
+struct _FuTransportTrace {
+	GObject			 parent_instance;
+	FuTransportTraceMode	 mode;
+	GPtrArray		*events;	/* of FuTransportTraceEvent */
+	GHashTable		*device_metadata;	/* key:value */
+	guint			 idx;		/* replay cursor */
+	guint			 latency;	/* us */
+	guint			 roundtrips;
+	guint64			 bytes;
+};
+
+G_DEFINE_TYPE (FuTransportTrace, fu_transport_trace, G_TYPE_OBJECT)
+
+static void
+fu_transport_trace_event_free (FuTransportTraceEvent *event)
+{
+	if (event->data_in != NULL)
+		g_bytes_unref (event->data_in);
+	if (event->data_out != NULL)
+		g_bytes_unref (event->data_out);
+	g_free (event->kind);
+	g_free (event->error_domain);
+	g_free (event->error_message);
+	g_free (event);
+}
+
+static GBytes *
+fu_transport_trace_bytes_new (const guint8 *buf, gsize bufsz)
+{
+	if (buf == NULL || bufsz == 0)
+		return NULL;
+	return g_bytes_new (buf, bufsz);
+}
+
+static gboolean
+fu_transport_trace_bytes_equal (GBytes *bytes, const guint8 *buf, gsize bufsz)
+{
+	if (bytes == NULL)
+		return buf == NULL || bufsz == 0;
+	if (g_bytes_get_size (bytes) != bufsz)
+		return FALSE;
+	return memcmp (g_bytes_get_data (bytes, NULL), buf, bufsz) == 0;
+}
+
+/**
+ * fu_transport_trace_get_mode:
+ * @self: A #FuTransportTrace
+ *
+ * Gets the trace mode.
+ *
+ * Returns: a #FuTransportTraceMode, e.g. %FU_TRANSPORT_TRACE_MODE_REPLAY
+ *
+ * Since: 1.5.0
+ **/
+FuTransportTraceMode
+fu_transport_trace_get_mode (FuTransportTrace *self)
+{
+	g_return_val_if_fail (FU_IS_TRANSPORT_TRACE (self), FU_TRANSPORT_TRACE_MODE_LAST);
+	return self->mode;
+}
+
+/**
+ * fu_transport_trace_set_latency:
+ * @self: A #FuTransportTrace
+ * @latency: simulated latency in us, or 0
+ *
+ * Sets the simulated latency added to each replayed transfer, which can be
+ * used to model the round-trip time of a slow device or bus.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_transport_trace_set_latency (FuTransportTrace *self, guint latency)
+{
+	g_return_if_fail (FU_IS_TRANSPORT_TRACE (self));
+	self->latency = latency;
+}
+
+/**
+ * fu_transport_trace_get_latency:
+ * @self: A #FuTransportTrace
+ *
+ * Gets the simulated latency added to each replayed transfer.
+ *
+ * Returns: latency in us
+ *
+ * Since: 1.5.0
+ **/
+guint
+fu_transport_trace_get_latency (FuTransportTrace *self)
+{
+	g_return_val_if_fail (FU_IS_TRANSPORT_TRACE (self), 0);
+	return self->latency;
+}
+
+/**
+ * fu_transport_trace_get_roundtrips:
+ * @self: A #FuTransportTrace
+ *
+ * Gets the number of transfers that have been recorded or replayed.
+ *
+ * Returns: integer
+ *
+ * Since: 1.5.0
+ **/
+guint
+fu_transport_trace_get_roundtrips (FuTransportTrace *self)
+{
+	g_return_val_if_fail (FU_IS_TRANSPORT_TRACE (self), 0);
+	return self->roundtrips;
+}
+
+/**
+ * fu_transport_trace_get_bytes:
+ * @self: A #FuTransportTrace
+ *
+ * Gets the total number of bytes sent to and received from the device.
+ *
+ * Returns: integer
+ *
+ * Since: 1.5.0
+ **/
+guint64
+fu_transport_trace_get_bytes (FuTransportTrace *self)
+{
+	g_return_val_if_fail (FU_IS_TRANSPORT_TRACE (self), 0);
+	return self->bytes;
+}
+
+/**
+ * fu_transport_trace_get_remaining:
+ * @self: A #FuTransportTrace
+ *
+ * Gets the number of recorded transfers that have not yet been replayed.
+ *
+ * Returns: integer
+ *
+ * Since: 1.5.0
+ **/
+guint
+fu_transport_trace_get_remaining (FuTransportTrace *self)
+{
+	g_return_val_if_fail (FU_IS_TRANSPORT_TRACE (self), 0);
+	return self->events->len - self->idx;
+}
+
+/**
+ * fu_transport_trace_set_device_metadata:
+ * @self: A #FuTransportTrace
+ * @key: a string, e.g. `GType`
+ * @value: (nullable): a string, or %NULL to remove the key
+ *
+ * Sets a value that describes the device the transfers were made to, for
+ * instance the plugin name or the USB VID.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_transport_trace_set_device_metadata (FuTransportTrace *self,
+					const gchar *key,
+					const gchar *value)
+{
+	g_return_if_fail (FU_IS_TRANSPORT_TRACE (self));
+	g_return_if_fail (key != NULL);
+	if (value == NULL) {
+		g_hash_table_remove (self->device_metadata, key);
+		return;
+	}
+	g_hash_table_insert (self->device_metadata, g_strdup (key), g_strdup (value));
+}
+
+/**
+ * fu_transport_trace_set_device_metadata_integer:
+ * @self: A #FuTransportTrace
+ * @key: a string, e.g. `UsbVid`
+ * @value: an integer
+ *
+ * Sets an integer value that describes the device the transfers were made to.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_transport_trace_set_device_metadata_integer (FuTransportTrace *self,
+						const gchar *key,
+						guint64 value)
+{
+	g_autofree gchar *tmp = g_strdup_printf ("0x%" G_GINT64_MODIFIER "x", value);
+	fu_transport_trace_set_device_metadata (self, key, tmp);
+}
+
+/**
+ * fu_transport_trace_get_device_metadata:
+ * @self: A #FuTransportTrace
+ * @key: a string, e.g. `GType`
+ *
+ * Gets a value that describes the device the transfers were made to.
+ *
+ * Returns: a string, or %NULL if unset
+ *
+ * Since: 1.5.0
+ **/
+const gchar *
+fu_transport_trace_get_device_metadata (FuTransportTrace *self, const gchar *key)
+{
+	g_return_val_if_fail (FU_IS_TRANSPORT_TRACE (self), NULL);
+	g_return_val_if_fail (key != NULL, NULL);
+	return g_hash_table_lookup (self->device_metadata, key);
+}
+
+/**
+ * fu_transport_trace_get_device_metadata_integer:
+ * @self: A #FuTransportTrace
+ * @key: a string, e.g. `UsbVid`
+ *
+ * Gets an integer value that describes the device the transfers were made to.
+ *
+ * Returns: an integer, or %G_MAXUINT64 if unset
+ *
+ * Since: 1.5.0
+ **/
+guint64
+fu_transport_trace_get_device_metadata_integer (FuTransportTrace *self, const gchar *key)
+{
+	const gchar *tmp = fu_transport_trace_get_device_metadata (self, key);
+	if (tmp == NULL)
+		return G_MAXUINT64;
+	return g_ascii_strtoull (tmp, NULL, 0);
+}
+
+/**
+ * fu_transport_trace_record:
+ * @self: A #FuTransportTrace
+ * @kind: transfer kind, e.g. `SetReport`
+ * @request: the transfer-specific request key, e.g. the ioctl number
+ * @buf_in: (nullable): data sent to the device
+ * @buf_insz: size of @buf_in
+ * @buf_out: (nullable): data received from the device
+ * @buf_outsz: size of @buf_out
+ * @actual_len: the number of bytes actually transferred
+ * @error: (nullable): the error returned by the transfer
+ *
+ * Records a transfer made to the real hardware.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_transport_trace_record (FuTransportTrace *self,
+			   const gchar *kind,
+			   guint64 request,
+			   const guint8 *buf_in,
+			   gsize buf_insz,
+			   const guint8 *buf_out,
+			   gsize buf_outsz,
+			   gsize actual_len,
+			   const GError *error)
+{
+	fu_transport_trace_record_full (self, kind, request,
+					buf_in, buf_insz,
+					buf_out, buf_outsz,
+					actual_len, 0, error);
+}
+
+/**
+ * fu_transport_trace_record_full:
+ * @self: A #FuTransportTrace
+ * @kind: transfer kind, e.g. `Ioctl`
+ * @request: the transfer-specific request key, e.g. the ioctl number
+ * @buf_in: (nullable): data sent to the device
+ * @buf_insz: size of @buf_in
+ * @buf_out: (nullable): data received from the device
+ * @buf_outsz: size of @buf_out
+ * @actual_len: the number of bytes actually transferred
+ * @rc: the raw return code of the transfer, e.g. from ioctl()
+ * @error: (nullable): the error returned by the transfer
+ *
+ * Records a transfer made to the real hardware, including the raw return code
+ * so that it can be returned when replayed.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_transport_trace_record_full (FuTransportTrace *self,
+				const gchar *kind,
+				guint64 request,
+				const guint8 *buf_in,
+				gsize buf_insz,
+				const guint8 *buf_out,
+				gsize buf_outsz,
+				gsize actual_len,
+				gint rc,
+				const GError *error)
+{
+	FuTransportTraceEvent *event;
+
+	g_return_if_fail (FU_IS_TRANSPORT_TRACE (self));
+	g_return_if_fail (kind != NULL);
+
+	event = g_new0 (FuTransportTraceEvent, 1);
+	event->kind = g_strdup (kind);
+	event->request = request;
+	event->rc = rc;
+	event->data_in = fu_transport_trace_bytes_new (buf_in, buf_insz);
+	if (error != NULL) {
+		event->error_domain = g_strdup (g_quark_to_string (error->domain));
+		event->error_code = error->code;
+		event->error_message = g_strdup (error->message);
+	} else {
+		event->data_out = fu_transport_trace_bytes_new (buf_out, buf_outsz);
+		event->actual_len = actual_len;
+		self->bytes += buf_outsz;
+	}
+	self->bytes += buf_insz;
+	self->roundtrips++;
+	g_ptr_array_add (self->events, event);
+}
+
+/**
+ * fu_transport_trace_replay:
+ * @self: A #FuTransportTrace
+ * @kind: transfer kind, e.g. `SetReport`
+ * @request: the transfer-specific request key, e.g. the ioctl number
+ * @buf_in: (nullable): data sent to the device
+ * @buf_insz: size of @buf_in
+ * @buf_out: (nullable): buffer for data received from the device
+ * @buf_outsz: size of @buf_out
+ * @actual_len: (out) (optional): the number of bytes actually transferred
+ * @error: A #GError, or %NULL
+ *
+ * Replays the next recorded transfer, checking that the request matches what
+ * was sent to the real hardware when the trace was captured.
+ *
+ * Returns: %TRUE for success, or the recorded error if the transfer failed
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_transport_trace_replay (FuTransportTrace *self,
+			   const gchar *kind,
+			   guint64 request,
+			   const guint8 *buf_in,
+			   gsize buf_insz,
+			   guint8 *buf_out,
+			   gsize buf_outsz,
+			   gsize *actual_len,
+			   GError **error)
+{
+	return fu_transport_trace_replay_full (self, kind, request,
+					       buf_in, buf_insz,
+					       buf_out, buf_outsz,
+					       actual_len, NULL, error);
+}
+
+/**
+ * fu_transport_trace_replay_full:
+ * @self: A #FuTransportTrace
+ * @kind: transfer kind, e.g. `Ioctl`
+ * @request: the transfer-specific request key, e.g. the ioctl number
+ * @buf_in: (nullable): data sent to the device
+ * @buf_insz: size of @buf_in
+ * @buf_out: (nullable): buffer for data received from the device
+ * @buf_outsz: size of @buf_out
+ * @actual_len: (out) (optional): the number of bytes actually transferred
+ * @rc: (out) (optional): the recorded raw return code
+ * @error: A #GError, or %NULL
+ *
+ * Replays the next recorded transfer, also returning the raw return code
+ * that was recorded with fu_transport_trace_record_full(). The return code is
+ * set even when the recorded transfer failed.
+ *
+ * Returns: %TRUE for success, or the recorded error if the transfer failed
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_transport_trace_replay_full (FuTransportTrace *self,
+				const gchar *kind,
+				guint64 request,
+				const guint8 *buf_in,
+				gsize buf_insz,
+				guint8 *buf_out,
+				gsize buf_outsz,
+				gsize *actual_len,
+				gint *rc,
+				GError **error)
+{
+	FuTransportTraceEvent *event;
+
+	g_return_val_if_fail (FU_IS_TRANSPORT_TRACE (self), FALSE);
+	g_return_val_if_fail (kind != NULL, FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	/* simulate the bus */
+	if (self->latency > 0)
+		g_usleep (self->latency);
+
+	/* sanity check */
+	if (self->idx >= self->events->len) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_FOUND,
+			     "no recorded event for %s 0x%" G_GINT64_MODIFIER "x",
+			     kind, request);
+		return FALSE;
+	}
+	event = g_ptr_array_index (self->events, self->idx);
+	if (g_strcmp0 (event->kind, kind) != 0 || event->request != request) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "event %u expected %s 0x%" G_GINT64_MODIFIER "x, "
+			     "got %s 0x%" G_GINT64_MODIFIER "x",
+			     self->idx,
+			     event->kind, event->request,
+			     kind, request);
+		return FALSE;
+	}
+	if (!fu_transport_trace_bytes_equal (event->data_in, buf_in, buf_insz)) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "event %u %s data did not match recording",
+			     self->idx, kind);
+		return FALSE;
+	}
+	self->idx++;
+	self->roundtrips++;
+	self->bytes += buf_insz;
+	if (rc != NULL)
+		*rc = event->rc;
+
+	/* recorded failure */
+	if (event->error_domain != NULL) {
+		g_set_error_literal (error,
+				     g_quark_from_string (event->error_domain),
+				     event->error_code,
+				     event->error_message);
+		return FALSE;
+	}
+
+	/* copy out response */
+	if (event->data_out != NULL) {
+		gsize sz = 0;
+		const guint8 *buf = g_bytes_get_data (event->data_out, &sz);
+		if (buf_out == NULL || sz > buf_outsz) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "event %u %s response of 0x%x bytes "
+				     "does not fit into 0x%x",
+				     self->idx - 1, kind,
+				     (guint) sz, (guint) buf_outsz);
+			return FALSE;
+		}
+		memcpy (buf_out, buf, sz);
+		self->bytes += sz;
+	}
+	if (actual_len != NULL)
+		*actual_len = event->actual_len;
+	return TRUE;
+}
+
+static void
+fu_transport_trace_add_bytes_member (JsonBuilder *builder,
+				     const gchar *name,
+				     GBytes *bytes)
+{
+	g_autofree gchar *tmp = NULL;
+	if (bytes == NULL)
+		return;
+	tmp = g_base64_encode (g_bytes_get_data (bytes, NULL),
+			       g_bytes_get_size (bytes));
+	json_builder_set_member_name (builder, name);
+	json_builder_add_string_value (builder, tmp);
+}
+
+/**
+ * fu_transport_trace_save_file:
+ * @self: A #FuTransportTrace
+ * @filename: a filename
+ * @error: A #GError, or %NULL
+ *
+ * Saves all recorded transfers to a JSON file, with the transfer data encoded
+ * as base64.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_transport_trace_save_file (FuTransportTrace *self,
+			      const gchar *filename,
+			      GError **error)
+{
+	g_autofree gchar *data = NULL;
+	g_autoptr(JsonBuilder) builder = json_builder_new ();
+	g_autoptr(JsonGenerator) json_generator = NULL;
+	g_autoptr(JsonNode) json_root = NULL;
+
+	g_return_val_if_fail (FU_IS_TRANSPORT_TRACE (self), FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	json_builder_begin_object (builder);
+	if (g_hash_table_size (self->device_metadata) > 0) {
+		g_autoptr(GList) keys = g_hash_table_get_keys (self->device_metadata);
+		keys = g_list_sort (keys, (GCompareFunc) g_strcmp0);
+		json_builder_set_member_name (builder, "Device");
+		json_builder_begin_object (builder);
+		for (GList *l = keys; l != NULL; l = l->next) {
+			const gchar *key = l->data;
+			json_builder_set_member_name (builder, key);
+			json_builder_add_string_value (builder,
+						       g_hash_table_lookup (self->device_metadata, key));
+		}
+		json_builder_end_object (builder);
+	}
+	json_builder_set_member_name (builder, "Events");
+	json_builder_begin_array (builder);
+	for (guint i = 0; i < self->events->len; i++) {
+		FuTransportTraceEvent *event = g_ptr_array_index (self->events, i);
+		g_autofree gchar *request = NULL;
+		json_builder_begin_object (builder);
+		json_builder_set_member_name (builder, "Kind");
+		json_builder_add_string_value (builder, event->kind);
+		request = g_strdup_printf ("0x%" G_GINT64_MODIFIER "x", event->request);
+		json_builder_set_member_name (builder, "Request");
+		json_builder_add_string_value (builder, request);
+		fu_transport_trace_add_bytes_member (builder, "DataIn", event->data_in);
+		fu_transport_trace_add_bytes_member (builder, "DataOut", event->data_out);
+		json_builder_set_member_name (builder, "ActualLength");
+		json_builder_add_int_value (builder, event->actual_len);
+		if (event->rc != 0) {
+			json_builder_set_member_name (builder, "ReturnCode");
+			json_builder_add_int_value (builder, event->rc);
+		}
+		if (event->error_domain != NULL) {
+			json_builder_set_member_name (builder, "ErrorDomain");
+			json_builder_add_string_value (builder, event->error_domain);
+			json_builder_set_member_name (builder, "ErrorCode");
+			json_builder_add_int_value (builder, event->error_code);
+			json_builder_set_member_name (builder, "ErrorMessage");
+			json_builder_add_string_value (builder, event->error_message);
+		}
+		json_builder_end_object (builder);
+	}
+	json_builder_end_array (builder);
+	json_builder_end_object (builder);
+
+	/* export as a string */
+	json_root = json_builder_get_root (builder);
+	json_generator = json_generator_new ();
+	json_generator_set_pretty (json_generator, TRUE);
+	json_generator_set_root (json_generator, json_root);
+	data = json_generator_to_data (json_generator, NULL);
+	if (data == NULL) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INTERNAL,
+				     "failed to convert trace to JSON");
+		return FALSE;
+	}
+	return g_file_set_contents (filename, data, -1, error);
+}
+
+static const gchar *
+fu_transport_trace_get_string_member (JsonObject *obj, const gchar *name)
+{
+	if (!json_object_has_member (obj, name))
+		return NULL;
+	return json_object_get_string_member (obj, name);
+}
+
+static GBytes *
+fu_transport_trace_get_bytes_member (JsonObject *obj, const gchar *name)
+{
+	const gchar *tmp = fu_transport_trace_get_string_member (obj, name);
+	guchar *buf;
+	gsize bufsz = 0;
+	if (tmp == NULL)
+		return NULL;
+	buf = g_base64_decode (tmp, &bufsz);
+	return g_bytes_new_take (buf, bufsz);
+}
+
+/**
+ * fu_transport_trace_load_file:
+ * @self: A #FuTransportTrace
+ * @filename: a filename
+ * @error: A #GError, or %NULL
+ *
+ * Loads recorded transfers and the device metadata from a JSON file created
+ * by fu_transport_trace_save_file(), replacing any existing events.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_transport_trace_load_file (FuTransportTrace *self,
+			      const gchar *filename,
+			      GError **error)
+{
+	JsonArray *json_events;
+	JsonNode *json_root;
+	JsonObject *json_obj;
+	g_autoptr(JsonParser) parser = json_parser_new ();
+
+	g_return_val_if_fail (FU_IS_TRANSPORT_TRACE (self), FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	if (!json_parser_load_from_file (parser, filename, error)) {
+		g_prefix_error (error, "failed to parse %s: ", filename);
+		return FALSE;
+	}
+	json_root = json_parser_get_root (parser);
+	if (json_root == NULL || !JSON_NODE_HOLDS_OBJECT (json_root)) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "no root object");
+		return FALSE;
+	}
+	json_obj = json_node_get_object (json_root);
+	if (!json_object_has_member (json_obj, "Events")) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "no Events array");
+		return FALSE;
+	}
+
+	/* start again */
+	g_ptr_array_set_size (self->events, 0);
+	g_hash_table_remove_all (self->device_metadata);
+	self->idx = 0;
+	self->roundtrips = 0;
+	self->bytes = 0;
+
+	/* optional, as only needed to create the device */
+	if (json_object_has_member (json_obj, "Device")) {
+		JsonObject *json_device = json_object_get_object_member (json_obj, "Device");
+		g_autoptr(GList) members = json_object_get_members (json_device);
+		for (GList *l = members; l != NULL; l = l->next) {
+			const gchar *key = l->data;
+			const gchar *value = fu_transport_trace_get_string_member (json_device, key);
+			if (value != NULL)
+				fu_transport_trace_set_device_metadata (self, key, value);
+		}
+	}
+
+	json_events = json_object_get_array_member (json_obj, "Events");
+	for (guint i = 0; i < json_array_get_length (json_events); i++) {
+		JsonObject *json_event = json_array_get_object_element (json_events, i);
+		FuTransportTraceEvent *event;
+		const gchar *kind;
+		const gchar *request;
+
+		kind = fu_transport_trace_get_string_member (json_event, "Kind");
+		request = fu_transport_trace_get_string_member (json_event, "Request");
+		if (kind == NULL || request == NULL) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "event %u has no Kind or Request", i);
+			return FALSE;
+		}
+		event = g_new0 (FuTransportTraceEvent, 1);
+		event->kind = g_strdup (kind);
+		event->request = g_ascii_strtoull (request, NULL, 16);
+		event->data_in = fu_transport_trace_get_bytes_member (json_event, "DataIn");
+		event->data_out = fu_transport_trace_get_bytes_member (json_event, "DataOut");
+		event->error_domain = g_strdup (fu_transport_trace_get_string_member (json_event, "ErrorDomain"));
+		event->error_message = g_strdup (fu_transport_trace_get_string_member (json_event, "ErrorMessage"));
+		if (json_object_has_member (json_event, "ActualLength"))
+			event->actual_len = json_object_get_int_member (json_event, "ActualLength");
+		if (json_object_has_member (json_event, "ReturnCode"))
+			event->rc = json_object_get_int_member (json_event, "ReturnCode");
+		if (json_object_has_member (json_event, "ErrorCode"))
+			event->error_code = json_object_get_int_member (json_event, "ErrorCode");
+		g_ptr_array_add (self->events, event);
+	}
+	return TRUE;
+}
+
+static void
+fu_transport_trace_finalize (GObject *obj)
+{
+	FuTransportTrace *self = FU_TRANSPORT_TRACE (obj);
+	g_ptr_array_unref (self->events);
+	g_hash_table_unref (self->device_metadata);
+	G_OBJECT_CLASS (fu_transport_trace_parent_class)->finalize (obj);
+}
+
+static void
+fu_transport_trace_class_init (FuTransportTraceClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = fu_transport_trace_finalize;
+}
+
+static void
+fu_transport_trace_init (FuTransportTrace *self)
+{
+	self->events = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_transport_trace_event_free);
+	self->device_metadata = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+}
+
+/**
+ * fu_transport_trace_new:
+ * @mode: a #FuTransportTraceMode, e.g. %FU_TRANSPORT_TRACE_MODE_RECORD
+ *
+ * Creates a new transport trace.
+ *
+ * Returns: (transfer full): a #FuTransportTrace
+ *
+ * Since: 1.5.0
+ **/
+FuTransportTrace *
+fu_transport_trace_new (FuTransportTraceMode mode)
+{
+	FuTransportTrace *self = g_object_new (FU_TYPE_TRANSPORT_TRACE, NULL);
+	self->mode = mode;
+	return self;
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+#define FU_TYPE_TRANSPORT_TRACE (fu_transport_trace_get_type ())
+
+G_DECLARE_FINAL_TYPE (FuTransportTrace, fu_transport_trace, FU, TRANSPORT_TRACE, GObject)
+
+/**
+ * FuTransportTraceMode:
+ * @FU_TRANSPORT_TRACE_MODE_RECORD:		Record transfers sent to real hardware
+ * @FU_TRANSPORT_TRACE_MODE_REPLAY:		Replay previously recorded transfers
+ *
+ * The mode of the transport trace.
+ **/
+typedef enum {
+	FU_TRANSPORT_TRACE_MODE_RECORD,
+	FU_TRANSPORT_TRACE_MODE_REPLAY,
+	/*< private >*/
+	FU_TRANSPORT_TRACE_MODE_LAST
+} FuTransportTraceMode;
+
+FuTransportTrace *fu_transport_trace_new		(FuTransportTraceMode mode);
+FuTransportTraceMode fu_transport_trace_get_mode	(FuTransportTrace *self);
+void		 fu_transport_trace_set_latency		(FuTransportTrace *self,
+							 guint		 latency);
+guint		 fu_transport_trace_get_latency		(FuTransportTrace *self);
+guint		 fu_transport_trace_get_roundtrips	(FuTransportTrace *self);
+guint64		 fu_transport_trace_get_bytes		(FuTransportTrace *self);
+guint		 fu_transport_trace_get_remaining	(FuTransportTrace *self);
+void		 fu_transport_trace_set_device_metadata	(FuTransportTrace *self,
+							 const gchar	*key,
+							 const gchar	*value);
+void		 fu_transport_trace_set_device_metadata_integer (FuTransportTrace *self,
+							 const gchar	*key,
+							 guint64	 value);
+const gchar	*fu_transport_trace_get_device_metadata	(FuTransportTrace *self,
+							 const gchar	*key);
+guint64		 fu_transport_trace_get_device_metadata_integer (FuTransportTrace *self,
+							 const gchar	*key);
+void		 fu_transport_trace_record		(FuTransportTrace *self,
+							 const gchar	*kind,
+							 guint64	 request,
+							 const guint8	*buf_in,
+							 gsize		 buf_insz,
+							 const guint8	*buf_out,
+							 gsize		 buf_outsz,
+							 gsize		 actual_len,
+							 const GError	*error);
+void		 fu_transport_trace_record_full		(FuTransportTrace *self,
+							 const gchar	*kind,
+							 guint64	 request,
+							 const guint8	*buf_in,
+							 gsize		 buf_insz,
+							 const guint8	*buf_out,
+							 gsize		 buf_outsz,
+							 gsize		 actual_len,
+							 gint		 rc,
+							 const GError	*error);
+gboolean	 fu_transport_trace_replay		(FuTransportTrace *self,
+							 const gchar	*kind,
+							 guint64	 request,
+							 const guint8	*buf_in,
+							 gsize		 buf_insz,
+							 guint8		*buf_out,
+							 gsize		 buf_outsz,
+							 gsize		*actual_len,
+							 GError		**error);
+gboolean	 fu_transport_trace_replay_full		(FuTransportTrace *self,
+							 const gchar	*kind,
+							 guint64	 request,
+							 const guint8	*buf_in,
+							 gsize		 buf_insz,
+							 guint8		*buf_out,
+							 gsize		 buf_outsz,
+							 gsize		*actual_len,
+							 gint		*rc,
+							 GError		**error);
+gboolean	 fu_transport_trace_load_file		(FuTransportTrace *self,
+							 const gchar	*filename,
+							 GError		**error);
+gboolean	 fu_transport_trace_save_file		(FuTransportTrace *self,
+							 const gchar	*filename,
+							 GError		**error);
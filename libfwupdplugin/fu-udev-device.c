@@ -16,6 +16,15 @@
 #ifdef HAVE_IOCTL_H
 #include <sys/ioctl.h>
 #endif
+#ifdef HAVE_SCSI_SG_H
+#include <scsi/sg.h>
+#endif
+#ifdef HAVE_MMC_IOCTL_H
+#include <linux/mmc/ioctl.h>
+#endif
+#ifdef HAVE_NVME_IOCTL_H
+#include <linux/nvme_ioctl.h>
+#endif
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -667,6 +676,47 @@ fu_udev_device_incorporate (FuDevice *self, FuDevice *donor)
 	}
 }
 
+static void
+fu_udev_device_to_trace (FuDevice *device, FuTransportTrace *trace)
+{
+	FuUdevDevice *self = FU_UDEV_DEVICE (device);
+	FuUdevDevicePrivate *priv = GET_PRIVATE (self);
+	fu_transport_trace_set_device_metadata (trace, "UdevSubsystem", priv->subsystem);
+	fu_transport_trace_set_device_metadata (trace, "UdevDeviceFile", priv->device_file);
+	fu_transport_trace_set_device_metadata_integer (trace, "UdevVendor", priv->vendor);
+	fu_transport_trace_set_device_metadata_integer (trace, "UdevModel", priv->model);
+	fu_transport_trace_set_device_metadata_integer (trace, "UdevSubsystemVendor", priv->subsystem_vendor);
+	fu_transport_trace_set_device_metadata_integer (trace, "UdevSubsystemModel", priv->subsystem_model);
+	fu_transport_trace_set_device_metadata_integer (trace, "UdevRevision", priv->revision);
+}
+
+static gboolean
+fu_udev_device_from_trace (FuDevice *device, FuTransportTrace *trace, GError **error)
+{
+	FuUdevDevice *self = FU_UDEV_DEVICE (device);
+	FuUdevDevicePrivate *priv = GET_PRIVATE (self);
+	guint64 tmp;
+
+	fu_udev_device_set_subsystem (self, fu_transport_trace_get_device_metadata (trace, "UdevSubsystem"));
+	fu_udev_device_set_device_file (self, fu_transport_trace_get_device_metadata (trace, "UdevDeviceFile"));
+	tmp = fu_transport_trace_get_device_metadata_integer (trace, "UdevVendor");
+	if (tmp <= G_MAXUINT32)
+		priv->vendor = tmp;
+	tmp = fu_transport_trace_get_device_metadata_integer (trace, "UdevModel");
+	if (tmp <= G_MAXUINT32)
+		priv->model = tmp;
+	tmp = fu_transport_trace_get_device_metadata_integer (trace, "UdevSubsystemVendor");
+	if (tmp <= G_MAXUINT32)
+		priv->subsystem_vendor = tmp;
+	tmp = fu_transport_trace_get_device_metadata_integer (trace, "UdevSubsystemModel");
+	if (tmp <= G_MAXUINT32)
+		priv->subsystem_model = tmp;
+	tmp = fu_transport_trace_get_device_metadata_integer (trace, "UdevRevision");
+	if (tmp <= G_MAXUINT8)
+		priv->revision = tmp;
+	return TRUE;
+}
+
 /**
  * fu_udev_device_get_dev:
  * @self: A #FuUdevDevice
@@ -1099,7 +1149,9 @@ fu_udev_device_open (FuDevice *device, GError **error)
 	FuUdevDeviceClass *klass = FU_UDEV_DEVICE_GET_CLASS (device);
 
 	/* open device */
-	if (priv->device_file != NULL && priv->flags != FU_UDEV_DEVICE_FLAG_NONE) {
+	if (priv->device_file != NULL &&
+	    priv->flags != FU_UDEV_DEVICE_FLAG_NONE &&
+	    !fu_device_is_replay (FU_DEVICE (self))) {
 		gint flags;
 		if (priv->flags & FU_UDEV_DEVICE_FLAG_OPEN_READ &&
 		    priv->flags & FU_UDEV_DEVICE_FLAG_OPEN_WRITE) {
@@ -1123,6 +1175,10 @@ fu_udev_device_open (FuDevice *device, GError **error)
 				     strerror (errno));
 			return FALSE;
 		}
+
+		/* input reports can signal that an operation has completed */
+		if (g_strcmp0 (fu_udev_device_get_subsystem (self), "hidraw") == 0)
+			fu_device_set_wait_fd (device, priv->fd);
 	}
 
 	/* subclassed */
@@ -1149,6 +1205,7 @@ fu_udev_device_close (FuDevice *device, GError **error)
 	}
 
 	/* close device */
+	fu_device_set_wait_fd (device, -1);
 	if (priv->fd > 0) {
 		if (!g_close (priv->fd, error))
 			return FALSE;
@@ -1159,6 +1216,200 @@ fu_udev_device_close (FuDevice *device, GError **error)
 	return TRUE;
 }
 
+#ifdef HAVE_IOCTL_H
+/* a buffer the ioctl argument points to */
+typedef struct {
+	gsize			 offset;	/* of the pointer in the argument */
+	gsize			 ptrsz;
+	guint8			*data;
+	gsize			 datasz;
+	gboolean		 is_in;		/* read by the kernel */
+	gboolean		 is_out;	/* written by the kernel */
+} FuUdevDeviceIoctlPtr;
+
+static void
+fu_udev_device_ioctl_add_ptr (GArray *ptrs,
+			      const guint8 *buf,
+			      gsize offset,
+			      gsize ptrsz,
+			      gsize datasz,
+			      gboolean is_in,
+			      gboolean is_out)
+{
+	FuUdevDeviceIoctlPtr ptr = {
+		.offset = offset,
+		.ptrsz = ptrsz,
+		.datasz = datasz,
+		.is_in = is_in,
+		.is_out = is_out,
+	};
+	if (ptrsz == sizeof(guint64)) {
+		guint64 tmp = 0;
+		memcpy (&tmp, buf + offset, sizeof(tmp));
+		ptr.data = (guint8 *) (guintptr) tmp;
+	} else {
+		memcpy (&ptr.data, buf + offset, sizeof(ptr.data));
+	}
+	if (ptr.data == NULL)
+		ptr.datasz = 0;
+	g_array_append_val (ptrs, ptr);
+}
+
+#ifdef HAVE_MMC_IOCTL_H
+static void
+fu_udev_device_ioctl_add_mmc_cmd (GArray *ptrs, const guint8 *buf, gsize offset)
+{
+	const struct mmc_ioc_cmd *cmd = (const struct mmc_ioc_cmd *) (buf + offset);
+	fu_udev_device_ioctl_add_ptr (ptrs, buf,
+				      offset + G_STRUCT_OFFSET (struct mmc_ioc_cmd, data_ptr),
+				      sizeof(guint64),
+				      (gsize) cmd->blksz * cmd->blocks,
+				      cmd->write_flag != 0,
+				      cmd->write_flag == 0);
+}
+#endif
+
+/* the raw argument of these ioctls contains user pointers, which are different
+ * every run, so find them to be able to record what they point to instead */
+static void
+fu_udev_device_ioctl_get_ptrs (gulong request, const guint8 *buf, gsize *bufsz, GArray *ptrs)
+{
+#ifdef HAVE_SCSI_SG_H
+	if (request == SG_IO) {
+		const sg_io_hdr_t *hdr = (const sg_io_hdr_t *) buf;
+		gboolean dxfer_in = hdr->dxfer_direction == SG_DXFER_TO_DEV ||
+				    hdr->dxfer_direction == SG_DXFER_TO_FROM_DEV;
+		gboolean dxfer_out = hdr->dxfer_direction == SG_DXFER_FROM_DEV ||
+				     hdr->dxfer_direction == SG_DXFER_TO_FROM_DEV;
+
+		/* the size is not encoded in the request number */
+		*bufsz = sizeof(sg_io_hdr_t);
+		fu_udev_device_ioctl_add_ptr (ptrs, buf,
+					      G_STRUCT_OFFSET (sg_io_hdr_t, cmdp),
+					      sizeof(gpointer), hdr->cmd_len,
+					      TRUE, FALSE);
+		fu_udev_device_ioctl_add_ptr (ptrs, buf,
+					      G_STRUCT_OFFSET (sg_io_hdr_t, dxferp),
+					      sizeof(gpointer), hdr->dxfer_len,
+					      dxfer_in, dxfer_out);
+		fu_udev_device_ioctl_add_ptr (ptrs, buf,
+					      G_STRUCT_OFFSET (sg_io_hdr_t, sbp),
+					      sizeof(gpointer), hdr->mx_sb_len,
+					      FALSE, TRUE);
+		return;
+	}
+#endif
+#ifdef HAVE_MMC_IOCTL_H
+	if (request == MMC_IOC_CMD) {
+		fu_udev_device_ioctl_add_mmc_cmd (ptrs, buf, 0);
+		return;
+	}
+	if (request == MMC_IOC_MULTI_CMD) {
+		const struct mmc_ioc_multi_cmd *multi_cmd = (const struct mmc_ioc_multi_cmd *) buf;
+		gsize offset = G_STRUCT_OFFSET (struct mmc_ioc_multi_cmd, cmds);
+
+		/* the commands follow the header and are not in the size */
+		*bufsz = offset + multi_cmd->num_of_cmds * sizeof(struct mmc_ioc_cmd);
+		for (guint64 i = 0; i < multi_cmd->num_of_cmds; i++) {
+			fu_udev_device_ioctl_add_mmc_cmd (ptrs, buf, offset);
+			offset += sizeof(struct mmc_ioc_cmd);
+		}
+		return;
+	}
+#endif
+#ifdef HAVE_NVME_IOCTL_H
+	if (request == NVME_IOCTL_ADMIN_CMD) {
+		const struct nvme_admin_cmd *cmd = (const struct nvme_admin_cmd *) buf;
+		gboolean is_write = (cmd->opcode & 0x01) > 0;
+		fu_udev_device_ioctl_add_ptr (ptrs, buf,
+					      G_STRUCT_OFFSET (struct nvme_admin_cmd, addr),
+					      sizeof(guint64), cmd->data_len,
+					      is_write, !is_write);
+		fu_udev_device_ioctl_add_ptr (ptrs, buf,
+					      G_STRUCT_OFFSET (struct nvme_admin_cmd, metadata),
+					      sizeof(guint64), cmd->metadata_len,
+					      is_write, !is_write);
+		return;
+	}
+#endif
+}
+
+/* the argument with the pointers cleared, then each buffer in order */
+static GByteArray *
+fu_udev_device_ioctl_encode (const guint8 *buf, gsize bufsz, GArray *ptrs, gboolean is_out)
+{
+	GByteArray *blob = g_byte_array_new ();
+
+	/* the argument is an integer, e.g. I2C_SLAVE */
+	if (bufsz == 0) {
+		guint64 tmp = (guintptr) buf;
+		if (!is_out)
+			g_byte_array_append (blob, (const guint8 *) &tmp, sizeof(tmp));
+		return blob;
+	}
+
+	g_byte_array_append (blob, buf, bufsz);
+	for (guint i = 0; i < ptrs->len; i++) {
+		FuUdevDeviceIoctlPtr *ptr = &g_array_index (ptrs, FuUdevDeviceIoctlPtr, i);
+		memset (blob->data + ptr->offset, 0x0, ptr->ptrsz);
+	}
+	for (guint i = 0; i < ptrs->len; i++) {
+		FuUdevDeviceIoctlPtr *ptr = &g_array_index (ptrs, FuUdevDeviceIoctlPtr, i);
+		if (ptr->datasz == 0)
+			continue;
+		if (is_out ? ptr->is_out : ptr->is_in)
+			g_byte_array_append (blob, ptr->data, ptr->datasz);
+	}
+	return blob;
+}
+
+/* copy a recorded response into the argument and the buffers it points to */
+static gboolean
+fu_udev_device_ioctl_decode (guint8 *buf,
+			     gsize bufsz,
+			     GArray *ptrs,
+			     const guint8 *blob,
+			     gsize blobsz,
+			     GError **error)
+{
+	gsize offset = bufsz;
+	gsize required = bufsz;
+
+	if (bufsz == 0)
+		return TRUE;
+	for (guint i = 0; i < ptrs->len; i++) {
+		FuUdevDeviceIoctlPtr *ptr = &g_array_index (ptrs, FuUdevDeviceIoctlPtr, i);
+		if (ptr->is_out)
+			required += ptr->datasz;
+	}
+	if (blobsz != required) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "ioctl response of 0x%x bytes, expected 0x%x",
+			     (guint) blobsz, (guint) required);
+		return FALSE;
+	}
+
+	/* the pointers have to be the ones from the caller */
+	memcpy (buf, blob, bufsz);
+	for (guint i = 0; i < ptrs->len; i++) {
+		FuUdevDeviceIoctlPtr *ptr = &g_array_index (ptrs, FuUdevDeviceIoctlPtr, i);
+		if (ptr->ptrsz == sizeof(guint64)) {
+			guint64 tmp = (guintptr) ptr->data;
+			memcpy (buf + ptr->offset, &tmp, sizeof(tmp));
+		} else {
+			memcpy (buf + ptr->offset, &ptr->data, sizeof(ptr->data));
+		}
+		if (ptr->is_out && ptr->datasz > 0) {
+			memcpy (ptr->data, blob + offset, ptr->datasz);
+			offset += ptr->datasz;
+		}
+	}
+	return TRUE;
+}
+#endif
+
 /**
  * fu_udev_device_ioctl:
  * @self: A #FuUdevDevice
@@ -1182,29 +1433,71 @@ fu_udev_device_ioctl (FuUdevDevice *self,
 {
 #ifdef HAVE_IOCTL_H
 	FuUdevDevicePrivate *priv = GET_PRIVATE (self);
+	FuTransportTrace *trace = fu_device_get_transport_trace (FU_DEVICE (self));
 	gint rc_tmp;
+	gsize bufsz = 0;
+	g_autoptr(GArray) ptrs = NULL;
+	g_autoptr(GByteArray) blob_in = NULL;
+	g_autoptr(GError) error_local = NULL;
 
 	g_return_val_if_fail (FU_IS_UDEV_DEVICE (self), FALSE);
 	g_return_val_if_fail (request != 0x0, FALSE);
 	g_return_val_if_fail (buf != NULL, FALSE);
-	g_return_val_if_fail (priv->fd > 0, FALSE);
 
+	/* the buffer size is encoded in the request number */
+#ifdef _IOC_SIZE
+	bufsz = _IOC_SIZE (request);
+#endif
+
+	/* record what the pointers in the argument refer to */
+	if (trace != NULL) {
+		ptrs = g_array_new (FALSE, FALSE, sizeof(FuUdevDeviceIoctlPtr));
+		fu_udev_device_ioctl_get_ptrs (request, buf, &bufsz, ptrs);
+		blob_in = fu_udev_device_ioctl_encode (buf, bufsz, ptrs, FALSE);
+	}
+
+	/* no hardware required */
+	if (fu_device_is_replay (FU_DEVICE (self))) {
+		gsize blob_outsz = 0;
+		g_autoptr(GByteArray) blob_out = fu_udev_device_ioctl_encode (buf, bufsz, ptrs, TRUE);
+		if (!fu_transport_trace_replay_full (trace, "Ioctl", request,
+						     blob_in->data, blob_in->len,
+						     blob_out->data, blob_out->len,
+						     &blob_outsz, rc, error))
+			return FALSE;
+		return fu_udev_device_ioctl_decode (buf, bufsz, ptrs,
+						    blob_out->data, blob_outsz,
+						    error);
+	}
+
+	g_return_val_if_fail (priv->fd > 0, FALSE);
 	rc_tmp = ioctl (priv->fd, request, buf);
 	if (rc != NULL)
 		*rc = rc_tmp;
 	if (rc_tmp < 0) {
 		if (rc_tmp == -EPERM) {
-			g_set_error_literal (error,
+			g_set_error_literal (&error_local,
 					     FWUPD_ERROR,
 					     FWUPD_ERROR_PERMISSION_DENIED,
 					     "permission denied");
-			return FALSE;
+		} else {
+			g_set_error (&error_local,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INTERNAL,
+				     "ioctl not supported: %s",
+				     strerror (errno));
 		}
-		g_set_error (error,
-			     FWUPD_ERROR,
-			     FWUPD_ERROR_INTERNAL,
-			     "ioctl not supported: %s",
-			     strerror (errno));
+	}
+	if (trace != NULL) {
+		g_autoptr(GByteArray) blob_out = fu_udev_device_ioctl_encode (buf, bufsz, ptrs, TRUE);
+		fu_transport_trace_record_full (trace, "Ioctl", request,
+						blob_in->data, blob_in->len,
+						blob_out->data, blob_out->len,
+						blob_out->len,
+						rc_tmp, error_local);
+	}
+	if (error_local != NULL) {
+		g_propagate_error (error, g_steal_pointer (&error_local));
 		return FALSE;
 	}
 	return TRUE;
@@ -1237,21 +1530,42 @@ fu_udev_device_pread_full (FuUdevDevice *self, goffset port,
 			   GError **error)
 {
 	FuUdevDevicePrivate *priv = GET_PRIVATE (self);
+	FuTransportTrace *trace = fu_device_get_transport_trace (FU_DEVICE (self));
 
 	g_return_val_if_fail (FU_IS_UDEV_DEVICE (self), FALSE);
 	g_return_val_if_fail (buf != NULL, FALSE);
+
+	/* no hardware required */
+	if (fu_device_is_replay (FU_DEVICE (self))) {
+		return fu_transport_trace_replay (trace, "Pread", port,
+						  NULL, 0, buf, bufsz,
+						  NULL, error);
+	}
+
 	g_return_val_if_fail (priv->fd > 0, FALSE);
 
 #ifdef HAVE_PWRITE
 	if (pread (priv->fd, buf, bufsz, port) != (gssize) bufsz) {
-		g_set_error (error,
+		g_autoptr(GError) error_local = NULL;
+		g_set_error (&error_local,
 			     G_IO_ERROR,
 			     G_IO_ERROR_FAILED,
 			     "failed to read from port 0x%04x: %s",
 			     (guint) port,
 			     strerror (errno));
+		if (trace != NULL) {
+			fu_transport_trace_record (trace, "Pread", port,
+						   NULL, 0, NULL, 0, 0,
+						   error_local);
+		}
+		g_propagate_error (error, g_steal_pointer (&error_local));
 		return FALSE;
 	}
+	if (trace != NULL) {
+		fu_transport_trace_record (trace, "Pread", port,
+					   NULL, 0, buf, bufsz, bufsz,
+					   NULL);
+	}
 	return TRUE;
 #else
 	g_set_error_literal (error,
@@ -1282,20 +1596,41 @@ fu_udev_device_pwrite_full (FuUdevDevice *self, goffset port,
 			    GError **error)
 {
 	FuUdevDevicePrivate *priv = GET_PRIVATE (self);
+	FuTransportTrace *trace = fu_device_get_transport_trace (FU_DEVICE (self));
 
 	g_return_val_if_fail (FU_IS_UDEV_DEVICE (self), FALSE);
+
+	/* no hardware required */
+	if (fu_device_is_replay (FU_DEVICE (self))) {
+		return fu_transport_trace_replay (trace, "Pwrite", port,
+						  buf, bufsz, NULL, 0,
+						  NULL, error);
+	}
+
 	g_return_val_if_fail (priv->fd > 0, FALSE);
 
 #ifdef HAVE_PWRITE
 	if (pwrite (priv->fd, buf, bufsz, port) != (gssize) bufsz) {
-		g_set_error (error,
+		g_autoptr(GError) error_local = NULL;
+		g_set_error (&error_local,
 			     G_IO_ERROR,
 			     G_IO_ERROR_FAILED,
 			     "failed to write to port %04x: %s",
 			     (guint) port,
 			     strerror (errno));
+		if (trace != NULL) {
+			fu_transport_trace_record (trace, "Pwrite", port,
+						   buf, bufsz, NULL, 0, 0,
+						   error_local);
+		}
+		g_propagate_error (error, g_steal_pointer (&error_local));
 		return FALSE;
 	}
+	if (trace != NULL) {
+		fu_transport_trace_record (trace, "Pwrite", port,
+					   buf, bufsz, NULL, 0, bufsz,
+					   NULL);
+	}
 	return TRUE;
 #else
 	g_set_error_literal (error,
@@ -1595,6 +1930,8 @@ fu_udev_device_class_init (FuUdevDeviceClass *klass)
 	object_class->set_property = fu_udev_device_set_property;
 	device_class->probe = fu_udev_device_probe;
 	device_class->incorporate = fu_udev_device_incorporate;
+	device_class->to_trace = fu_udev_device_to_trace;
+	device_class->from_trace = fu_udev_device_from_trace;
 	device_class->open = fu_udev_device_open;
 	device_class->close = fu_udev_device_close;
 	device_class->to_string = fu_udev_device_to_string;
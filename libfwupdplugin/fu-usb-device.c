@@ -24,6 +24,11 @@ typedef struct
 {
 	GUsbDevice		*usb_device;
 	FuDeviceLocker		*usb_device_locker;
+	/* only used when created from a #FuTransportTrace */
+	guint16			 replay_vid;
+	guint16			 replay_pid;
+	guint16			 replay_spec;
+	gchar			*replay_platform_id;
 } FuUsbDevicePrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (FuUsbDevice, fu_usb_device, FU_TYPE_DEVICE)
@@ -76,6 +81,7 @@ fu_usb_device_finalize (GObject *object)
 		g_object_unref (priv->usb_device_locker);
 	if (priv->usb_device != NULL)
 		g_object_unref (priv->usb_device);
+	g_free (priv->replay_platform_id);
 
 	G_OBJECT_CLASS (fu_usb_device_parent_class)->finalize (object);
 }
@@ -170,6 +176,13 @@ fu_usb_device_open (FuDevice *device, GError **error)
 	if (priv->usb_device_locker != NULL)
 		return TRUE;
 
+	/* no hardware to open */
+	if (fu_device_is_replay (FU_DEVICE (self))) {
+		if (klass->open != NULL)
+			return klass->open (self, error);
+		return TRUE;
+	}
+
 	/* open */
 	locker = fu_device_locker_new (priv->usb_device, error);
 	if (locker == NULL)
@@ -280,6 +293,13 @@ fu_usb_device_close (FuDevice *device, GError **error)
 	g_return_val_if_fail (FU_IS_USB_DEVICE (self), FALSE);
 	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
 
+	/* no hardware to close */
+	if (fu_device_is_replay (FU_DEVICE (self))) {
+		if (klass->close != NULL)
+			return klass->close (self, error);
+		return TRUE;
+	}
+
 	/* already open */
 	if (priv->usb_device_locker == NULL)
 		return TRUE;
@@ -388,7 +408,7 @@ fu_usb_device_get_vid (FuUsbDevice *self)
 	FuUsbDevicePrivate *priv = GET_PRIVATE (self);
 	g_return_val_if_fail (FU_IS_USB_DEVICE (self), 0x0000);
 	if (priv->usb_device == NULL)
-		return 0x0;
+		return priv->replay_vid;
 	return g_usb_device_get_vid (priv->usb_device);
 }
 
@@ -408,7 +428,7 @@ fu_usb_device_get_pid (FuUsbDevice *self)
 	FuUsbDevicePrivate *priv = GET_PRIVATE (self);
 	g_return_val_if_fail (FU_IS_USB_DEVICE (self), 0x0000);
 	if (priv->usb_device == NULL)
-		return 0x0;
+		return priv->replay_pid;
 	return g_usb_device_get_pid (priv->usb_device);
 }
 
@@ -428,7 +448,7 @@ fu_usb_device_get_platform_id (FuUsbDevice *self)
 	FuUsbDevicePrivate *priv = GET_PRIVATE (self);
 	g_return_val_if_fail (FU_IS_USB_DEVICE (self), NULL);
 	if (priv->usb_device == NULL)
-		return NULL;
+		return priv->replay_platform_id;
 	return g_usb_device_get_platform_id (priv->usb_device);
 }
 
@@ -449,7 +469,7 @@ fu_usb_device_get_spec (FuUsbDevice *self)
 	FuUsbDevicePrivate *priv = GET_PRIVATE (self);
 	g_return_val_if_fail (FU_IS_USB_DEVICE (self), 0x0);
 	if (priv->usb_device == NULL)
-		return 0x0;
+		return priv->replay_spec;
 	return g_usb_device_get_spec (priv->usb_device);
 #else
 	return 0x0;
@@ -561,6 +581,225 @@ fu_usb_device_get_dev (FuUsbDevice *device)
 	return priv->usb_device;
 }
 
+/**
+ * fu_usb_device_control_transfer:
+ * @self: A #FuUsbDevice
+ * @direction: the #GUsbDeviceDirection
+ * @request_type: the #GUsbDeviceRequestType
+ * @recipient: the #GUsbDeviceRecipient
+ * @request: the request field for the setup packet
+ * @value: the value field for the setup packet
+ * @idx: the index field for the setup packet
+ * @data: (array length=length): a suitably-sized data buffer for
+ * either input or output
+ * @length: the length field for the setup packet
+ * @actual_length: (out) (optional): the actual number of bytes sent, or %NULL
+ * @timeout: timeout timer in milliseconds, or 0 for no timeout
+ * @cancellable: a #GCancellable, or %NULL
+ * @error: A #GError, or %NULL
+ *
+ * Performs a USB control transfer, recording or replaying the transfer if
+ * a #FuTransportTrace has been set on the device.
+ *
+ * Returns: %TRUE on success
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_usb_device_control_transfer (FuUsbDevice *self,
+				GUsbDeviceDirection direction,
+				GUsbDeviceRequestType request_type,
+				GUsbDeviceRecipient recipient,
+				guint8 request,
+				guint16 value,
+				guint16 idx,
+				guint8 *data,
+				gsize length,
+				gsize *actual_length,
+				guint timeout,
+				GCancellable *cancellable,
+				GError **error)
+{
+	FuUsbDevicePrivate *priv = GET_PRIVATE (self);
+	FuTransportTrace *trace = fu_device_get_transport_trace (FU_DEVICE (self));
+	gboolean is_in = direction == G_USB_DEVICE_DIRECTION_DEVICE_TO_HOST;
+	gboolean ret;
+	gsize actual_length_tmp = 0;
+	guint64 key;
+	g_autoptr(GError) error_local = NULL;
+
+	g_return_val_if_fail (FU_IS_USB_DEVICE (self), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	/* no hardware required */
+	key = ((guint64) direction << 44) |
+	      ((guint64) request_type << 42) |
+	      ((guint64) recipient << 40) |
+	      ((guint64) request << 32) |
+	      ((guint64) value << 16) | idx;
+	if (fu_device_is_replay (FU_DEVICE (self))) {
+		return fu_transport_trace_replay (trace, "ControlTransfer", key,
+						  is_in ? NULL : data,
+						  is_in ? 0 : length,
+						  is_in ? data : NULL,
+						  is_in ? length : 0,
+						  actual_length, error);
+	}
+	ret = g_usb_device_control_transfer (priv->usb_device,
+					     direction, request_type, recipient,
+					     request, value, idx,
+					     data, length,
+					     &actual_length_tmp,
+					     timeout, cancellable,
+					     &error_local);
+	if (trace != NULL) {
+		fu_transport_trace_record (trace, "ControlTransfer", key,
+					   is_in ? NULL : data,
+					   is_in ? 0 : length,
+					   ret && is_in ? data : NULL,
+					   ret && is_in ? actual_length_tmp : 0,
+					   actual_length_tmp,
+					   error_local);
+	}
+	if (!ret) {
+		g_propagate_error (error, g_steal_pointer (&error_local));
+		return FALSE;
+	}
+	if (actual_length != NULL)
+		*actual_length = actual_length_tmp;
+	return TRUE;
+}
+
+static gboolean
+fu_usb_device_endpoint_transfer (FuUsbDevice *self,
+				 const gchar *kind,
+				 guint8 endpoint,
+				 guint8 *data,
+				 gsize length,
+				 gsize *actual_length,
+				 guint timeout,
+				 GCancellable *cancellable,
+				 GError **error)
+{
+	FuUsbDevicePrivate *priv = GET_PRIVATE (self);
+	FuTransportTrace *trace = fu_device_get_transport_trace (FU_DEVICE (self));
+	gboolean is_in = (endpoint & 0x80) > 0;
+	gboolean ret;
+	gsize actual_length_tmp = 0;
+	g_autoptr(GError) error_local = NULL;
+
+	/* no hardware required */
+	if (fu_device_is_replay (FU_DEVICE (self))) {
+		return fu_transport_trace_replay (trace, kind, endpoint,
+						  is_in ? NULL : data,
+						  is_in ? 0 : length,
+						  is_in ? data : NULL,
+						  is_in ? length : 0,
+						  actual_length, error);
+	}
+	if (g_strcmp0 (kind, "BulkTransfer") == 0) {
+		ret = g_usb_device_bulk_transfer (priv->usb_device, endpoint,
+						  data, length,
+						  &actual_length_tmp,
+						  timeout, cancellable,
+						  &error_local);
+	} else {
+		ret = g_usb_device_interrupt_transfer (priv->usb_device, endpoint,
+						       data, length,
+						       &actual_length_tmp,
+						       timeout, cancellable,
+						       &error_local);
+	}
+	if (trace != NULL) {
+		fu_transport_trace_record (trace, kind, endpoint,
+					   is_in ? NULL : data,
+					   is_in ? 0 : length,
+					   ret && is_in ? data : NULL,
+					   ret && is_in ? actual_length_tmp : 0,
+					   actual_length_tmp,
+					   error_local);
+	}
+	if (!ret) {
+		g_propagate_error (error, g_steal_pointer (&error_local));
+		return FALSE;
+	}
+	if (actual_length != NULL)
+		*actual_length = actual_length_tmp;
+	return TRUE;
+}
+
+/**
+ * fu_usb_device_bulk_transfer:
+ * @self: A #FuUsbDevice
+ * @endpoint: the address of a valid endpoint to communicate with
+ * @data: (array length=length): a suitably-sized data buffer for
+ * either input or output
+ * @length: the size of @data
+ * @actual_length: (out) (optional): the actual number of bytes sent, or %NULL
+ * @timeout: timeout timer in milliseconds, or 0 for no timeout
+ * @cancellable: a #GCancellable, or %NULL
+ * @error: A #GError, or %NULL
+ *
+ * Performs a USB bulk transfer, recording or replaying the transfer if
+ * a #FuTransportTrace has been set on the device.
+ *
+ * Returns: %TRUE on success
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_usb_device_bulk_transfer (FuUsbDevice *self,
+			     guint8 endpoint,
+			     guint8 *data,
+			     gsize length,
+			     gsize *actual_length,
+			     guint timeout,
+			     GCancellable *cancellable,
+			     GError **error)
+{
+	g_return_val_if_fail (FU_IS_USB_DEVICE (self), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+	return fu_usb_device_endpoint_transfer (self, "BulkTransfer", endpoint,
+						data, length, actual_length,
+						timeout, cancellable, error);
+}
+
+/**
+ * fu_usb_device_interrupt_transfer:
+ * @self: A #FuUsbDevice
+ * @endpoint: the address of a valid endpoint to communicate with
+ * @data: (array length=length): a suitably-sized data buffer for
+ * either input or output
+ * @length: the size of @data
+ * @actual_length: (out) (optional): the actual number of bytes sent, or %NULL
+ * @timeout: timeout timer in milliseconds, or 0 for no timeout
+ * @cancellable: a #GCancellable, or %NULL
+ * @error: A #GError, or %NULL
+ *
+ * Performs a USB interrupt transfer, recording or replaying the transfer if
+ * a #FuTransportTrace has been set on the device.
+ *
+ * Returns: %TRUE on success
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_usb_device_interrupt_transfer (FuUsbDevice *self,
+				  guint8 endpoint,
+				  guint8 *data,
+				  gsize length,
+				  gsize *actual_length,
+				  guint timeout,
+				  GCancellable *cancellable,
+				  GError **error)
+{
+	g_return_val_if_fail (FU_IS_USB_DEVICE (self), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+	return fu_usb_device_endpoint_transfer (self, "InterruptTransfer", endpoint,
+						data, length, actual_length,
+						timeout, cancellable, error);
+}
+
 static void
 fu_usb_device_incorporate (FuDevice *self, FuDevice *donor)
 {
@@ -570,6 +809,53 @@ fu_usb_device_incorporate (FuDevice *self, FuDevice *donor)
 			       fu_usb_device_get_dev (FU_USB_DEVICE (donor)));
 }
 
+static void
+fu_usb_device_to_trace (FuDevice *device, FuTransportTrace *trace)
+{
+	FuUsbDevice *self = FU_USB_DEVICE (device);
+	fu_transport_trace_set_device_metadata_integer (trace, "UsbVid",
+							fu_usb_device_get_vid (self));
+	fu_transport_trace_set_device_metadata_integer (trace, "UsbPid",
+							fu_usb_device_get_pid (self));
+	fu_transport_trace_set_device_metadata_integer (trace, "UsbSpec",
+							fu_usb_device_get_spec (self));
+	fu_transport_trace_set_device_metadata (trace, "UsbPlatformId",
+						fu_usb_device_get_platform_id (self));
+}
+
+static gboolean
+fu_usb_device_from_trace (FuDevice *device, FuTransportTrace *trace, GError **error)
+{
+	FuUsbDevice *self = FU_USB_DEVICE (device);
+	FuUsbDevicePrivate *priv = GET_PRIVATE (self);
+	guint64 tmp;
+
+	tmp = fu_transport_trace_get_device_metadata_integer (trace, "UsbVid");
+	if (tmp > G_MAXUINT16) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "trace has no USB VID");
+		return FALSE;
+	}
+	priv->replay_vid = tmp;
+	tmp = fu_transport_trace_get_device_metadata_integer (trace, "UsbPid");
+	if (tmp > G_MAXUINT16) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "trace has no USB PID");
+		return FALSE;
+	}
+	priv->replay_pid = tmp;
+	tmp = fu_transport_trace_get_device_metadata_integer (trace, "UsbSpec");
+	if (tmp <= G_MAXUINT16)
+		priv->replay_spec = tmp;
+	g_free (priv->replay_platform_id);
+	priv->replay_platform_id = g_strdup (fu_transport_trace_get_device_metadata (trace, "UsbPlatformId"));
+	return TRUE;
+}
+
 static gboolean
 fu_udev_device_bind_driver (FuDevice *device,
 			    const gchar *subsystem,
@@ -636,6 +922,8 @@ fu_usb_device_class_init (FuUsbDeviceClass *klass)
 	device_class->close = fu_usb_device_close;
 	device_class->probe = fu_usb_device_probe;
 	device_class->incorporate = fu_usb_device_incorporate;
+	device_class->to_trace = fu_usb_device_to_trace;
+	device_class->from_trace = fu_usb_device_from_trace;
 	device_class->bind_driver = fu_udev_device_bind_driver;
 	device_class->unbind_driver = fu_udev_device_unbind_driver;
 
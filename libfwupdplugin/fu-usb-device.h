@@ -37,3 +37,32 @@ void		 fu_usb_device_set_dev			(FuUsbDevice	*device,
 gboolean	 fu_usb_device_is_open			(FuUsbDevice	*device);
 GUdevDevice	*fu_usb_device_find_udev_device		(FuUsbDevice	*device,
 							 GError		**error);
+gboolean	 fu_usb_device_control_transfer		(FuUsbDevice	*self,
+							 GUsbDeviceDirection direction,
+							 GUsbDeviceRequestType request_type,
+							 GUsbDeviceRecipient recipient,
+							 guint8		 request,
+							 guint16	 value,
+							 guint16	 idx,
+							 guint8		*data,
+							 gsize		 length,
+							 gsize		*actual_length,
+							 guint		 timeout,
+							 GCancellable	*cancellable,
+							 GError		**error);
+gboolean	 fu_usb_device_bulk_transfer		(FuUsbDevice	*self,
+							 guint8		 endpoint,
+							 guint8		*data,
+							 gsize		 length,
+							 gsize		*actual_length,
+							 guint		 timeout,
+							 GCancellable	*cancellable,
+							 GError		**error);
+gboolean	 fu_usb_device_interrupt_transfer	(FuUsbDevice	*self,
+							 guint8		 endpoint,
+							 guint8		*data,
+							 gsize		 length,
+							 gsize		*actual_length,
+							 guint		 timeout,
+							 GCancellable	*cancellable,
+							 GError		**error);
@@ -0,0 +1,223 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#define G_LOG_DOMAIN				"FuVersionKey"
+
+#include "config.h"
+
+#include "fu-common-version.h"
+#include "fu-version-key.h"
+
+/**
+ * SECTION:fu-version-key
+ * @short_description: a pre-parsed version number
+ *
+ * A version number split into integer sections once, so that it can be
+ * compared many times without parsing the string again. The ordering is
+ * identical to fu_common_vercmp_full().
+ *
+ * See also: fu_common_vercmp_full()
+ */
+
+typedef struct {
+	gint64			 val;
+	const gchar		*suffix;	/* points into buf */
+} FuVersionKeySection;
+
+struct _FuVersionKey {
+	gchar			*version;	/* (nullable) */
+	gchar			*buf;		/* (nullable): sections, NUL separated */
+	FwupdVersionFormat	 fmt;
+	guint			 sectionsz;
+	FuVersionKeySection	*sections;
+};
+
+/**
+ * fu_version_key_new: (skip):
+ * @version: (nullable): a version number, e.g. `1.2.3`
+ * @fmt: a #FwupdVersionFormat, e.g. %FWUPD_VERSION_FORMAT_TRIPLET
+ *
+ * Parses a version number so that it can be compared quickly using
+ * fu_version_key_compare().
+ *
+ * Returns: (transfer full): a #FuVersionKey
+ *
+ * Since: 1.5.0
+ **/
+FuVersionKey *
+fu_version_key_new (const gchar *version, FwupdVersionFormat fmt)
+{
+	FuVersionKey *self = g_new0 (FuVersionKey, 1);
+
+	self->version = g_strdup (version);
+	self->fmt = fmt;
+
+	/* nothing to parse */
+	if (version == NULL || fmt == FWUPD_VERSION_FORMAT_PLAIN)
+		return self;
+
+	/* split into sections in one buffer */
+	self->buf = g_strdup (version);
+	if (self->buf[0] == '\0')
+		return self;
+	self->sectionsz = 1;
+	for (guint i = 0; self->buf[i] != '\0'; i++) {
+		if (self->buf[i] == '.')
+			self->sectionsz++;
+	}
+	self->sections = g_new0 (FuVersionKeySection, self->sectionsz);
+	for (guint i = 0, j = 0; j < self->sectionsz; j++) {
+		gchar *endptr = NULL;
+		gchar *str = self->buf + i;
+		while (self->buf[i] != '.' && self->buf[i] != '\0')
+			i++;
+		self->buf[i++] = '\0';
+		self->sections[j].val = g_ascii_strtoll (str, &endptr, 10);
+		self->sections[j].suffix = endptr;
+	}
+	return self;
+}
+
+/**
+ * fu_version_key_free: (skip):
+ * @self: a #FuVersionKey
+ *
+ * Frees a version key.
+ *
+ * Since: 1.5.0
+ **/
+void
+fu_version_key_free (FuVersionKey *self)
+{
+	if (self == NULL)
+		return;
+	g_free (self->version);
+	g_free (self->buf);
+	g_free (self->sections);
+	g_free (self);
+}
+
+/**
+ * fu_version_key_get_version: (skip):
+ * @self: a #FuVersionKey
+ *
+ * Gets the version number the key was created from.
+ *
+ * Returns: (nullable): a version number, or %NULL
+ *
+ * Since: 1.5.0
+ **/
+const gchar *
+fu_version_key_get_version (const FuVersionKey *self)
+{
+	g_return_val_if_fail (self != NULL, NULL);
+	return self->version;
+}
+
+/**
+ * fu_version_key_get_format: (skip):
+ * @self: a #FuVersionKey
+ *
+ * Gets the version format the key was created with.
+ *
+ * Returns: a #FwupdVersionFormat
+ *
+ * Since: 1.5.0
+ **/
+FwupdVersionFormat
+fu_version_key_get_format (const FuVersionKey *self)
+{
+	g_return_val_if_fail (self != NULL, FWUPD_VERSION_FORMAT_UNKNOWN);
+	return self->fmt;
+}
+
+static gint
+fu_version_key_compare_char (gchar chr1, gchar chr2)
+{
+	if (chr1 == chr2)
+		return 0;
+	if (chr1 == '~')
+		return -1;
+	if (chr2 == '~')
+		return 1;
+	return chr1 < chr2 ? -1 : 1;
+}
+
+static gint
+fu_version_key_compare_suffix (const gchar *str1, const gchar *str2)
+{
+	guint i;
+	for (i = 0; str1[i] != '\0' && str2[i] != '\0'; i++) {
+		gint rc = fu_version_key_compare_char (str1[i], str2[i]);
+		if (rc != 0)
+			return rc;
+	}
+	return fu_version_key_compare_char (str1[i], str2[i]);
+}
+
+/**
+ * fu_version_key_compare: (skip):
+ * @key_a: a #FuVersionKey
+ * @key_b: a #FuVersionKey
+ *
+ * Compares two version keys for sorting. The version format of @key_a is used,
+ * and so both keys should normally be created with the same format.
+ *
+ * Returns: -1 if a < b, +1 if a > b, 0 if they are equal, and %G_MAXINT on error
+ *
+ * Since: 1.5.0
+ **/
+gint
+fu_version_key_compare (const FuVersionKey *key_a, const FuVersionKey *key_b)
+{
+	guint longest;
+
+	g_return_val_if_fail (key_a != NULL, G_MAXINT);
+	g_return_val_if_fail (key_b != NULL, G_MAXINT);
+
+	/* compare as strings */
+	if (key_a->fmt == FWUPD_VERSION_FORMAT_PLAIN)
+		return g_strcmp0 (key_a->version, key_b->version);
+
+	/* sanity check */
+	if (key_a->version == NULL || key_b->version == NULL)
+		return G_MAXINT;
+
+	/* @key_b was created as plain, so was never split */
+	if (key_b->buf == NULL)
+		return fu_common_vercmp_full (key_a->version, key_b->version, key_a->fmt);
+
+	/* compare each section */
+	longest = MAX (key_a->sectionsz, key_b->sectionsz);
+	for (guint i = 0; i < longest; i++) {
+		const FuVersionKeySection *sect_a;
+		const FuVersionKeySection *sect_b;
+
+		/* we lost or gained a dot */
+		if (i >= key_a->sectionsz)
+			return -1;
+		if (i >= key_b->sectionsz)
+			return 1;
+		sect_a = &key_a->sections[i];
+		sect_b = &key_b->sections[i];
+
+		/* compare integers */
+		if (sect_a->val < sect_b->val)
+			return -1;
+		if (sect_a->val > sect_b->val)
+			return 1;
+
+		/* compare strings */
+		if (sect_a->suffix[0] != '\0' || sect_b->suffix[0] != '\0') {
+			gint rc = fu_version_key_compare_suffix (sect_a->suffix, sect_b->suffix);
+			if (rc < 0)
+				return -1;
+			if (rc > 0)
+				return 1;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,22 @@
+/*
+ * Copyright (C) 2020 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#pragma once
+
+#include <glib.h>
+#include <fwupd.h>
+
+typedef struct _FuVersionKey FuVersionKey;
+
+FuVersionKey	*fu_version_key_new		(const gchar	*version,
+						 FwupdVersionFormat fmt);
+void		 fu_version_key_free		(FuVersionKey	*self);
+const gchar	*fu_version_key_get_version	(const FuVersionKey *self);
+FwupdVersionFormat fu_version_key_get_format	(const FuVersionKey *self);
+gint		 fu_version_key_compare		(const FuVersionKey *key_a,
+						 const FuVersionKey *key_b);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(FuVersionKey, fu_version_key_free)
@@ -83,6 +83,7 @@ fu_volume_get_mount_point (FuVolume *self)
 {
 	g_autofree const gchar **mountpoints = NULL;
 	g_autoptr(GVariant) val = NULL;
+	g_autoptr(GVariant) val_tmp = NULL;
 	g_autoptr(GError) error_local = NULL;
 
 	g_return_val_if_fail (FU_IS_VOLUME (self), NULL);
@@ -91,10 +92,29 @@ fu_volume_get_mount_point (FuVolume *self)
 	if (self->mount_path != NULL)
 		return g_strdup (self->mount_path);
 
-	/* something else mounted it */
-	val = g_dbus_proxy_get_cached_property (self->proxy, "MountPoints");
-	if (val == NULL)
+	/* device from the self tests */
+	if (self->proxy == NULL)
 		return NULL;
+
+	/* something else mounted it; the cached property may be out of date
+	 * if nothing is iterating the main context the proxy was created in */
+	val_tmp = g_dbus_connection_call_sync (g_dbus_proxy_get_connection (self->proxy),
+					       g_dbus_proxy_get_name (self->proxy),
+					       g_dbus_proxy_get_object_path (self->proxy),
+					       "org.freedesktop.DBus.Properties",
+					       "Get",
+					       g_variant_new ("(ss)",
+							      g_dbus_proxy_get_interface_name (self->proxy),
+							      "MountPoints"),
+					       G_VARIANT_TYPE ("(v)"),
+					       G_DBUS_CALL_FLAGS_NONE,
+					       -1, NULL, &error_local);
+	if (val_tmp == NULL) {
+		g_debug ("failed to get MountPoints for %s: %s",
+			 fu_volume_get_id (self), error_local->message);
+		return NULL;
+	}
+	g_variant_get (val_tmp, "(v)", &val);
 	mountpoints = g_variant_get_bytestring_array (val, NULL);
 	return g_strdup (mountpoints[0]);
 }
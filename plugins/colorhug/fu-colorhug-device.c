@@ -55,7 +55,6 @@ fu_colorhug_device_msg (FuColorhugDevice *self, guint8 cmd,
 			guint8 *obuf, gsize obufsz,
 			GError **error)
 {
-	GUsbDevice *usb_device = fu_usb_device_get_dev (FU_USB_DEVICE (self));
 	guint8 buf[] = { [0] = cmd, [1 ... CH_USB_HID_EP_SIZE - 1] = 0x00 };
 	gsize actual_length = 0;
 
@@ -88,14 +87,14 @@ fu_colorhug_device_msg (FuColorhugDevice *self, guint8 cmd,
 	/* request */
 	if (g_getenv ("FWUPD_COLORHUG_VERBOSE") != NULL)
 		fu_common_dump_raw (G_LOG_DOMAIN, "REQ", buf, ibufsz + 1);
-	if (!g_usb_device_interrupt_transfer (usb_device,
-					      CH_USB_HID_EP_OUT,
-					      buf,
-					      sizeof(buf),
-					      &actual_length,
-					      CH_DEVICE_USB_TIMEOUT,
-					      NULL, /* cancellable */
-					      error)) {
+	if (!fu_usb_device_interrupt_transfer (FU_USB_DEVICE (self),
+					       CH_USB_HID_EP_OUT,
+					       buf,
+					       sizeof(buf),
+					       &actual_length,
+					       CH_DEVICE_USB_TIMEOUT,
+					       NULL, /* cancellable */
+					       error)) {
 		g_prefix_error (error, "failed to send request: ");
 		return FALSE;
 	}
@@ -109,14 +108,14 @@ fu_colorhug_device_msg (FuColorhugDevice *self, guint8 cmd,
 	}
 
 	/* read reply */
-	if (!g_usb_device_interrupt_transfer (usb_device,
-					      CH_USB_HID_EP_IN,
-					      buf,
-					      sizeof(buf),
-					      &actual_length,
-					      CH_DEVICE_USB_TIMEOUT,
-					      NULL, /* cancellable */
-					      error)) {
+	if (!fu_usb_device_interrupt_transfer (FU_USB_DEVICE (self),
+					       CH_USB_HID_EP_IN,
+					       buf,
+					       sizeof(buf),
+					       &actual_length,
+					       CH_DEVICE_USB_TIMEOUT,
+					       NULL, /* cancellable */
+					       error)) {
 		g_prefix_error (error, "failed to get reply: ");
 		return FALSE;
 	}
@@ -314,6 +313,10 @@ fu_colorhug_device_open (FuUsbDevice *device, GError **error)
 {
 	GUsbDevice *usb_device = fu_usb_device_get_dev (device);
 
+	/* no hardware to claim */
+	if (fu_device_is_replay (FU_DEVICE (device)))
+		return TRUE;
+
 	/* got the version using the HID API */
 	if (!g_usb_device_set_configuration (usb_device, CH_USB_CONFIG, error))
 		return FALSE;
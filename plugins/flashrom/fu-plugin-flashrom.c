@@ -34,6 +34,7 @@ struct FuPluginData {
 	struct flashrom_flashctx	*flashctx;
 	struct flashrom_layout		*layout;
 	struct flashrom_programmer	*flashprog;
+	GBytes				*flash_contents;	/* from update_prepare */
 };
 
 void
@@ -50,6 +51,8 @@ fu_plugin_destroy (FuPlugin *plugin)
 	flashrom_layout_release (data->layout);
 	flashrom_programmer_shutdown (data->flashprog);
 	flashrom_flash_release (data->flashctx);
+	if (data->flash_contents != NULL)
+		g_bytes_unref (data->flash_contents);
 }
 
 static int
@@ -173,37 +176,54 @@ fu_plugin_update_prepare (FuPlugin *plugin,
 	FuPluginData *data = fu_plugin_get_data (plugin);
 	g_autofree gchar *firmware_orig = NULL;
 	g_autofree gchar *basename = NULL;
+	g_autofree guint8 *newcontents = NULL;
 
 	/* not us */
 	if (fu_plugin_cache_lookup (plugin, fu_device_get_id (device)) == NULL)
 		return TRUE;
 
-	/* if the original firmware doesn't exist, grab it now */
+	/* read the current contents, which libflashrom uses to decide what
+	 * to erase rather than reading the whole chip again */
+	if (data->flash_contents != NULL)
+		g_clear_pointer (&data->flash_contents, g_bytes_unref);
+	fu_device_set_status (device, FWUPD_STATUS_DEVICE_READ);
+	newcontents = g_malloc0 (data->flash_size);
+	if (flashrom_image_read (data->flashctx, newcontents, data->flash_size)) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_READ,
+				     "failed to read current firmware");
+		return FALSE;
+	}
+	data->flash_contents = g_bytes_new_take (g_steal_pointer (&newcontents),
+						 data->flash_size);
+
+	/* if the original firmware doesn't exist, save it now */
 	basename = g_strdup_printf ("flashrom-%s.bin", fu_device_get_id (device));
 	firmware_orig = g_build_filename (FWUPD_LOCALSTATEDIR, "lib", "fwupd",
 					  "builder", basename, NULL);
 	if (!fu_common_mkdir_parent (firmware_orig, error))
 		return FALSE;
 	if (!g_file_test (firmware_orig, G_FILE_TEST_EXISTS)) {
-		g_autofree guint8 *newcontents = g_malloc0 (data->flash_size);
-		g_autoptr(GBytes) buf = NULL;
-
-		fu_device_set_status (device, FWUPD_STATUS_DEVICE_READ);
-		if (flashrom_image_read (data->flashctx, newcontents, data->flash_size)) {
-			g_set_error_literal (error,
-					     FWUPD_ERROR,
-					     FWUPD_ERROR_READ,
-					     "failed to back up original firmware");
-			return FALSE;
-		}
-		buf = g_bytes_new_static (newcontents, data->flash_size);
-		if (!fu_common_set_contents_bytes (firmware_orig, buf, error))
+		if (!fu_common_set_contents_bytes (firmware_orig, data->flash_contents, error))
 			return FALSE;
 	}
 
 	return TRUE;
 }
 
+gboolean
+fu_plugin_update_cleanup (FuPlugin *plugin,
+			  FwupdInstallFlags flags,
+			  FuDevice *device,
+			  GError **error)
+{
+	FuPluginData *data = fu_plugin_get_data (plugin);
+	if (data->flash_contents != NULL)
+		g_clear_pointer (&data->flash_contents, g_bytes_unref);
+	return TRUE;
+}
+
 gboolean
 fu_plugin_update (FuPlugin *plugin,
 		  FuDevice *device,
@@ -215,6 +235,7 @@ fu_plugin_update (FuPlugin *plugin,
 	gsize sz = 0;
 	gint rc;
 	const guint8 *buf = g_bytes_get_data (blob_fw, &sz);
+	const guint8 *refbuffer = NULL;
 
 	if (flashrom_layout_read_from_ifd (&data->layout, data->flashctx, NULL, 0)) {
 		g_set_error_literal (error,
@@ -244,22 +265,23 @@ fu_plugin_update (FuPlugin *plugin,
 		return FALSE;
 	}
 
+	/* use the contents read in prepare, otherwise libflashrom reads the
+	 * whole chip again */
+	if (data->flash_contents != NULL &&
+	    g_bytes_get_size (data->flash_contents) == data->flash_size)
+		refbuffer = g_bytes_get_data (data->flash_contents, NULL);
+
+	/* only verify the regions in the layout, not the whole chip */
+	flashrom_flag_set (data->flashctx, FLASHROM_FLAG_VERIFY_AFTER_WRITE, TRUE);
+	flashrom_flag_set (data->flashctx, FLASHROM_FLAG_VERIFY_WHOLE_CHIP, FALSE);
+
 	fu_device_set_status (device, FWUPD_STATUS_DEVICE_WRITE);
-	rc = flashrom_image_write (data->flashctx, (void *) buf, sz, NULL /* refbuffer */);
+	rc = flashrom_image_write (data->flashctx, (void *) buf, sz, refbuffer);
 	if (rc != 0) {
 		g_set_error (error,
 			     FWUPD_ERROR,
 			     FWUPD_ERROR_WRITE,
-			     "image write failed, err=%i", rc);
-		return FALSE;
-	}
-
-	fu_device_set_status (device, FWUPD_STATUS_DEVICE_VERIFY);
-	if (flashrom_image_verify (data->flashctx, (void *) buf, sz)) {
-		g_set_error (error,
-			     FWUPD_ERROR,
-			     FWUPD_ERROR_WRITE,
-			     "image verify failed");
+			     "image write or verify failed, err=%i", rc);
 		return FALSE;
 	}
 
@@ -34,76 +34,96 @@ fu_plugin_init (FuPlugin *plugin)
 {
 	fu_plugin_alloc_data (plugin, sizeof (FuPluginData));
 	fu_plugin_set_build_hash (plugin, FU_BUILD_HASH);
-	fu_plugin_add_udev_subsystem (plugin, "msr");
+	fu_plugin_add_rule (plugin, FU_PLUGIN_RULE_RUN_AFTER, "cpu");
 }
 
 gboolean
 fu_plugin_startup (FuPlugin *plugin, GError **error)
 {
 	FuPluginData *priv = fu_plugin_get_data (plugin);
+	FuMsrSnapshot *msr_snapshot = fu_plugin_get_msr_snapshot (plugin);
 	guint ecx = 0;
 
 	/* sdbg is supported: https://en.wikipedia.org/wiki/CPUID */
 	if (!fu_common_cpuid (0x01, NULL, NULL, &ecx, NULL, error))
 		return FALSE;
 	priv->ia32_debug_supported = ((ecx >> 11) & 0x1) > 0;
+
+	/* read by all the CPUs at the same time in coldplug */
+	if (msr_snapshot == NULL) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_NOT_SUPPORTED,
+				     "no MSR snapshot");
+		return FALSE;
+	}
+	if (priv->ia32_debug_supported)
+		fu_msr_snapshot_add_address (msr_snapshot, PCI_MSR_IA32_DEBUG_INTERFACE);
+	fu_msr_snapshot_add_address (msr_snapshot, PCI_MSR_IA32_BIOS_SIGN_ID);
 	return TRUE;
 }
 
+static void
+fu_plugin_msr_ensure_ia32_debug (FuPlugin *plugin)
+{
+	FuPluginData *priv = fu_plugin_get_data (plugin);
+	FuMsrSnapshot *msr_snapshot = fu_plugin_get_msr_snapshot (plugin);
+	g_autoptr(GArray) cpus = fu_msr_snapshot_get_cpus (msr_snapshot);
+
+	/* enabled on any core is enabled, and all cores have to be locked */
+	priv->ia32_debug.data = 0x0;
+	priv->ia32_debug.fields.locked = cpus->len > 0;
+	for (guint i = 0; i < cpus->len; i++) {
+		FuMsrIa32Debug ia32_debug;
+		guint cpu = g_array_index (cpus, guint, i);
+		guint64 value = 0;
+		g_autoptr(GError) error_local = NULL;
+
+		if (!fu_msr_snapshot_get_value (msr_snapshot, cpu,
+						PCI_MSR_IA32_DEBUG_INTERFACE,
+						&value, &error_local)) {
+			g_debug ("could not read IA32_DEBUG_INTERFACE: %s",
+				 error_local->message);
+			priv->ia32_debug.fields.locked = FALSE;
+			continue;
+		}
+		ia32_debug.data = (guint32) value;
+		priv->ia32_debug.fields.enabled |= ia32_debug.fields.enabled;
+		priv->ia32_debug.fields.locked &= ia32_debug.fields.locked;
+		priv->ia32_debug.fields.debug_occurred |= ia32_debug.fields.debug_occurred;
+	}
+	g_debug ("IA32_DEBUG_INTERFACE: enabled=%i, locked=%i, debug_occurred=%i",
+		 priv->ia32_debug.fields.enabled,
+		 priv->ia32_debug.fields.locked,
+		 priv->ia32_debug.fields.debug_occurred);
+}
+
 gboolean
-fu_plugin_udev_device_added (FuPlugin *plugin, FuUdevDevice *device, GError **error)
+fu_plugin_coldplug (FuPlugin *plugin, GError **error)
 {
 	FuDevice *device_cpu = fu_plugin_cache_lookup (plugin, "cpu");
 	FuPluginData *priv = fu_plugin_get_data (plugin);
-	guint8 buf[8] = { 0x0 };
-	g_autoptr(FuDeviceLocker) locker = NULL;
-	g_autofree gchar *basename = NULL;
-
-	/* interesting device? */
-	if (g_strcmp0 (fu_udev_device_get_subsystem (device), "msr") != 0)
-		return TRUE;
-
-	/* we only care about the first processor */
-	basename = g_path_get_basename (fu_udev_device_get_sysfs_path (device));
-	if (g_strcmp0 (basename, "msr0") != 0)
-		return TRUE;
-
-	/* open the config */
-	fu_device_set_physical_id (FU_DEVICE (device), "msr");
-	locker = fu_device_locker_new (device, error);
-	if (locker == NULL)
+	FuMsrSnapshot *msr_snapshot = fu_plugin_get_msr_snapshot (plugin);
+
+	/* only the first plugin to ask actually reads the hardware */
+	if (!fu_msr_snapshot_load (msr_snapshot, error))
 		return FALSE;
 
 	/* grab MSR */
-	if (priv->ia32_debug_supported) {
-		if (!fu_udev_device_pread_full (device, PCI_MSR_IA32_DEBUG_INTERFACE,
-						buf, sizeof(buf), error)) {
-			g_prefix_error (error, "could not read IA32_DEBUG_INTERFACE: ");
-			return FALSE;
-		}
-		if (!fu_common_read_uint32_safe (buf, sizeof(buf), 0x0,
-						 &priv->ia32_debug.data, G_LITTLE_ENDIAN,
-						 error))
-			return FALSE;
-		g_debug ("IA32_DEBUG_INTERFACE: enabled=%i, locked=%i, debug_occurred=%i",
-			 priv->ia32_debug.fields.enabled,
-			 priv->ia32_debug.fields.locked,
-			 priv->ia32_debug.fields.debug_occurred);
-	}
+	if (priv->ia32_debug_supported)
+		fu_plugin_msr_ensure_ia32_debug (plugin);
 
 	/* get microcode version */
 	if (device_cpu != NULL) {
 		guint32 ver_raw;
-		if (!fu_udev_device_pread_full (device, PCI_MSR_IA32_BIOS_SIGN_ID,
-						buf, sizeof(buf), error)) {
+		guint64 value = 0;
+		if (!fu_msr_snapshot_get_value (msr_snapshot, 0,
+						PCI_MSR_IA32_BIOS_SIGN_ID,
+						&value, error)) {
 			g_prefix_error (error, "could not read IA32_BIOS_SIGN_ID: ");
 			return FALSE;
 		}
-		fu_common_dump_raw (G_LOG_DOMAIN, "IA32_BIOS_SIGN_ID", buf, sizeof(buf));
-		if (!fu_common_read_uint32_safe (buf, sizeof(buf), 0x4,
-						 &ver_raw, G_LITTLE_ENDIAN,
-						 error))
-			return FALSE;
+		ver_raw = (guint32) (value >> 32);
 		if (ver_raw != 0) {
 			FwupdVersionFormat verfmt = fu_device_get_version_format (device_cpu);
 			g_autofree gchar *ver_str = NULL;
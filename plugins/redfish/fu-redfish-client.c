@@ -18,6 +18,13 @@
 #include "fu-redfish-client.h"
 #include "fu-redfish-common.h"
 
+/* BMCs are slow per-request, but also do not cope with many connections */
+#define FU_REDFISH_CLIENT_MAX_REQUESTS		4
+
+/* how long to wait for the BMC to deploy the firmware */
+#define FU_REDFISH_CLIENT_TASK_POLL_MS		1000
+#define FU_REDFISH_CLIENT_TASK_TIMEOUT_MS	(30 * 60 * 1000)
+
 struct _FuRedfishClient
 {
 	GObject			 parent_instance;
@@ -28,12 +35,20 @@ struct _FuRedfishClient
 	gchar			*password;
 	gchar			*update_uri_path;
 	gchar			*push_uri_path;
+	gchar			*expand_query;		/* (nullable) */
 	gboolean		 auth_created;
 	gboolean		 use_https;
 	gboolean		 cacheck;
+	guint			 task_poll_ms;
 	GPtrArray		*devices;
+	GHashTable		*cache;			/* uri:FuRedfishClientCacheItem */
 };
 
+typedef struct {
+	gchar			*etag;
+	GBytes			*blob;
+} FuRedfishClientCacheItem;
+
 G_DEFINE_TYPE (FuRedfishClient, fu_redfish_client, G_TYPE_OBJECT)
 
 static void
@@ -58,17 +73,30 @@ fu_redfish_client_set_auth (FuRedfishClient *self, SoupURI *uri,
 	}
 }
 
-static GBytes *
-fu_redfish_client_fetch_data (FuRedfishClient *self, const gchar *uri_path, GError **error)
+static void
+fu_redfish_client_cache_item_free (FuRedfishClientCacheItem *item)
 {
-	guint status_code;
-	g_autoptr(SoupMessage) msg = NULL;
+	g_free (item->etag);
+	g_bytes_unref (item->blob);
+	g_free (item);
+}
+
+static SoupMessage *
+fu_redfish_client_new_message (FuRedfishClient *self,
+			       const gchar *uri_path,
+			       const gchar *query,
+			       GError **error)
+{
+	FuRedfishClientCacheItem *item;
+	SoupMessage *msg;
+	g_autofree gchar *key = NULL;
 	g_autoptr(SoupURI) uri = NULL;
 
 	/* create URI */
 	uri = soup_uri_new (NULL);
 	soup_uri_set_scheme (uri, self->use_https ? "https" : "http");
 	soup_uri_set_path (uri, uri_path);
+	soup_uri_set_query (uri, query);
 	soup_uri_set_host (uri, self->hostname);
 	soup_uri_set_port (uri, self->port);
 	msg = soup_message_new_from_uri (SOUP_METHOD_GET, uri);
@@ -81,17 +109,201 @@ fu_redfish_client_fetch_data (FuRedfishClient *self, const gchar *uri_path, GErr
 		return NULL;
 	}
 	fu_redfish_client_set_auth (self, uri, msg);
-	status_code = soup_session_send_message (self->session, msg);
-	if (status_code != SOUP_STATUS_OK) {
+
+	/* only download again if it has changed */
+	key = soup_uri_to_string (uri, TRUE);
+	item = g_hash_table_lookup (self->cache, key);
+	if (item != NULL) {
+		soup_message_headers_append (msg->request_headers,
+					     "If-None-Match", item->etag);
+	}
+	return msg;
+}
+
+static GBytes *
+fu_redfish_client_process_message (FuRedfishClient *self, SoupMessage *msg, GError **error)
+{
+	SoupURI *uri = soup_message_get_uri (msg);
+	const gchar *etag;
+	g_autofree gchar *key = soup_uri_to_string (uri, TRUE);
+	g_autoptr(GBytes) blob = NULL;
+
+	/* use the cached copy */
+	if (msg->status_code == SOUP_STATUS_NOT_MODIFIED) {
+		FuRedfishClientCacheItem *item = g_hash_table_lookup (self->cache, key);
+		if (item != NULL) {
+			g_debug ("%s not modified", key);
+			return g_bytes_ref (item->blob);
+		}
+	}
+	if (msg->status_code != SOUP_STATUS_OK) {
 		g_autofree gchar *tmp = soup_uri_to_string (uri, FALSE);
 		g_set_error (error,
 			     FWUPD_ERROR,
 			     FWUPD_ERROR_INVALID_FILE,
 			     "failed to download %s: %s",
-			     tmp, soup_status_get_phrase (status_code));
+			     tmp, soup_status_get_phrase (msg->status_code));
+		return NULL;
+	}
+	blob = g_bytes_new (msg->response_body->data, msg->response_body->length);
+
+	/* save for next time */
+	etag = soup_message_headers_get_one (msg->response_headers, "ETag");
+	if (etag != NULL) {
+		FuRedfishClientCacheItem *item = g_new0 (FuRedfishClientCacheItem, 1);
+		item->etag = g_strdup (etag);
+		item->blob = g_bytes_ref (blob);
+		g_hash_table_insert (self->cache, g_steal_pointer (&key), item);
+	} else {
+		g_hash_table_remove (self->cache, key);
+	}
+	return g_steal_pointer (&blob);
+}
+
+static GBytes *
+fu_redfish_client_fetch_data_full (FuRedfishClient *self,
+				   const gchar *uri_path,
+				   const gchar *query,
+				   GError **error)
+{
+	g_autoptr(SoupMessage) msg = NULL;
+
+	msg = fu_redfish_client_new_message (self, uri_path, query, error);
+	if (msg == NULL)
+		return NULL;
+	soup_session_send_message (self->session, msg);
+	return fu_redfish_client_process_message (self, msg, error);
+}
+
+static GBytes *
+fu_redfish_client_fetch_data (FuRedfishClient *self, const gchar *uri_path, GError **error)
+{
+	return fu_redfish_client_fetch_data_full (self, uri_path, NULL, error);
+}
+
+typedef struct {
+	FuRedfishClient		*self;
+	GMainLoop		*loop;
+	GPtrArray		*uris;		/* element-type utf8 */
+	GPtrArray		*blobs;		/* element-type GBytes, same order as uris */
+	guint			 idx_next;
+	guint			 in_flight;
+	GError			*error;
+} FuRedfishClientBatch;
+
+typedef struct {
+	FuRedfishClientBatch	*batch;
+	guint			 idx;
+} FuRedfishClientBatchItem;
+
+static void fu_redfish_client_batch_queue (FuRedfishClientBatch *batch);
+
+static void
+fu_redfish_client_batch_cb (SoupSession *session, SoupMessage *msg, gpointer user_data)
+{
+	FuRedfishClientBatchItem *item = (FuRedfishClientBatchItem *) user_data;
+	FuRedfishClientBatch *batch = item->batch;
+	g_autoptr(GError) error_local = NULL;
+	GBytes *blob;
+
+	batch->in_flight--;
+	blob = fu_redfish_client_process_message (batch->self, msg, &error_local);
+	if (blob == NULL) {
+		if (batch->error == NULL)
+			batch->error = g_steal_pointer (&error_local);
+	} else {
+		g_ptr_array_index (batch->blobs, item->idx) = blob;
+	}
+	g_free (item);
+
+	/* keep the pipeline full, or finish */
+	if (batch->error == NULL)
+		fu_redfish_client_batch_queue (batch);
+	if (batch->in_flight == 0)
+		g_main_loop_quit (batch->loop);
+}
+
+static void
+fu_redfish_client_batch_queue (FuRedfishClientBatch *batch)
+{
+	while (batch->in_flight < FU_REDFISH_CLIENT_MAX_REQUESTS &&
+	       batch->idx_next < batch->uris->len) {
+		const gchar *uri_path = g_ptr_array_index (batch->uris, batch->idx_next);
+		FuRedfishClientBatchItem *item;
+		SoupMessage *msg;
+
+		msg = fu_redfish_client_new_message (batch->self, uri_path, NULL, &batch->error);
+		if (msg == NULL)
+			return;
+		item = g_new0 (FuRedfishClientBatchItem, 1);
+		item->batch = batch;
+		item->idx = batch->idx_next++;
+		batch->in_flight++;
+		soup_session_queue_message (batch->self->session, msg,
+					    fu_redfish_client_batch_cb, item);
+	}
+}
+
+/* download all the URIs concurrently, returning the blobs in the same order */
+static GPtrArray *
+fu_redfish_client_fetch_data_batch (FuRedfishClient *self, GPtrArray *uris, GError **error)
+{
+	g_autoptr(GMainContext) context = g_main_context_new ();
+	g_autoptr(GMainLoop) loop = g_main_loop_new (context, FALSE);
+	g_autoptr(GPtrArray) blobs = NULL;
+	FuRedfishClientBatch batch = {
+		.self = self,
+		.loop = loop,
+		.uris = uris,
+	};
+
+	blobs = g_ptr_array_new_with_free_func ((GDestroyNotify) g_bytes_unref);
+	g_ptr_array_set_size (blobs, uris->len);
+	batch.blobs = blobs;
+
+	/* the session uses the thread-default context for queued messages */
+	g_main_context_push_thread_default (context);
+	fu_redfish_client_batch_queue (&batch);
+	if (batch.in_flight > 0)
+		g_main_loop_run (loop);
+	g_main_context_pop_thread_default (context);
+	if (batch.error != NULL) {
+		g_propagate_error (error, batch.error);
+		return NULL;
+	}
+	return g_steal_pointer (&blobs);
+}
+
+static JsonObject *
+fu_redfish_client_parse_object (JsonParser *parser, GBytes *blob, GError **error)
+{
+	JsonNode *node_root;
+	JsonObject *obj;
+
+	if (!json_parser_load_from_data (parser,
+					 g_bytes_get_data (blob, NULL),
+					 (gssize) g_bytes_get_size (blob),
+					 error)) {
+		g_prefix_error (error, "failed to parse node: ");
+		return NULL;
+	}
+	node_root = json_parser_get_root (parser);
+	if (node_root == NULL) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "no root node");
+		return NULL;
+	}
+	obj = json_node_get_object (node_root);
+	if (obj == NULL) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "no root object");
 		return NULL;
 	}
-	return g_bytes_new (msg->response_body->data, msg->response_body->length);
+	return obj;
 }
 
 static gboolean
@@ -148,24 +360,32 @@ fu_redfish_client_coldplug_member (FuRedfishClient *self,
 	return TRUE;
 }
 
+/* members only have an @odata.id link unless they were expanded */
+static gboolean
+fu_redfish_client_member_is_expanded (JsonObject *member)
+{
+	return json_object_has_member (member, "Id");
+}
+
 static gboolean
 fu_redfish_client_coldplug_collection (FuRedfishClient *self,
 				       JsonObject *collection,
 				       GError **error)
 {
 	JsonArray *members;
-	JsonNode *node_root;
-	JsonObject *member;
+	g_autoptr(JsonParser) parser = json_parser_new ();
+	g_autoptr(GPtrArray) blobs = NULL;
+	g_autoptr(GPtrArray) uris = g_ptr_array_new ();
 
+	/* get the links that need downloading */
 	members = json_object_get_array_member (collection, "Members");
 	for (guint i = 0; i < json_array_get_length (members); i++) {
-		g_autoptr(JsonParser) parser = json_parser_new ();
-		g_autoptr(GBytes) blob = NULL;
-		JsonObject *member_id;
+		JsonObject *member = json_array_get_object_element (members, i);
 		const gchar *member_uri;
 
-		member_id = json_array_get_object_element (members, i);
-		member_uri = json_object_get_string_member (member_id, "@odata.id");
+		if (fu_redfish_client_member_is_expanded (member))
+			continue;
+		member_uri = json_object_get_string_member (member, "@odata.id");
 		if (member_uri == NULL) {
 			g_set_error_literal (error,
 					     FWUPD_ERROR,
@@ -173,38 +393,23 @@ fu_redfish_client_coldplug_collection (FuRedfishClient *self,
 					     "no @odata.id string");
 			return FALSE;
 		}
+		g_ptr_array_add (uris, (gpointer) member_uri);
+	}
 
-		/* try to connect */
-		blob = fu_redfish_client_fetch_data (self, member_uri, error);
-		if (blob == NULL)
-			return FALSE;
+	/* try to connect */
+	blobs = fu_redfish_client_fetch_data_batch (self, uris, error);
+	if (blobs == NULL)
+		return FALSE;
 
-		/* get the member object */
-		if (!json_parser_load_from_data (parser,
-						 g_bytes_get_data (blob, NULL),
-						 (gssize) g_bytes_get_size (blob),
-						 error)) {
-			g_prefix_error (error, "failed to parse node: ");
-			return FALSE;
-		}
-		node_root = json_parser_get_root (parser);
-		if (node_root == NULL) {
-			g_set_error_literal (error,
-					     FWUPD_ERROR,
-					     FWUPD_ERROR_INVALID_FILE,
-					     "no root node");
-			return FALSE;
-		}
-		member = json_node_get_object (node_root);
-		if (member == NULL) {
-			g_set_error_literal (error,
-					     FWUPD_ERROR,
-					     FWUPD_ERROR_INVALID_FILE,
-					     "no member object");
-			return FALSE;
+	/* create the device for each member, in the original order */
+	for (guint i = 0, j = 0; i < json_array_get_length (members); i++) {
+		JsonObject *member = json_array_get_object_element (members, i);
+		if (!fu_redfish_client_member_is_expanded (member)) {
+			GBytes *blob = g_ptr_array_index (blobs, j++);
+			member = fu_redfish_client_parse_object (parser, blob, error);
+			if (member == NULL)
+				return FALSE;
 		}
-
-		/* Create the device for the member */
 		if (!fu_redfish_client_coldplug_member (self, member, error))
 			return FALSE;
 	}
@@ -218,7 +423,6 @@ fu_redfish_client_coldplug_inventory (FuRedfishClient *self,
 {
 	g_autoptr(JsonParser) parser = json_parser_new ();
 	g_autoptr(GBytes) blob = NULL;
-	JsonNode *node_root;
 	JsonObject *collection;
 	const gchar *collection_uri;
 
@@ -239,36 +443,27 @@ fu_redfish_client_coldplug_inventory (FuRedfishClient *self,
 		return FALSE;
 	}
 
+	/* get all the members in one request if supported */
+	if (self->expand_query != NULL) {
+		g_autoptr(GError) error_local = NULL;
+		blob = fu_redfish_client_fetch_data_full (self, collection_uri,
+							  self->expand_query,
+							  &error_local);
+		if (blob == NULL)
+			g_debug ("ignoring %s: %s", self->expand_query, error_local->message);
+	}
+
 	/* try to connect */
-	blob = fu_redfish_client_fetch_data (self, collection_uri, error);
-	if (blob == NULL)
-		return FALSE;
+	if (blob == NULL) {
+		blob = fu_redfish_client_fetch_data (self, collection_uri, error);
+		if (blob == NULL)
+			return FALSE;
+	}
 
 	/* get the inventory object */
-	if (!json_parser_load_from_data (parser,
-					 g_bytes_get_data (blob, NULL),
-					 (gssize) g_bytes_get_size (blob),
-					 error)) {
-		g_prefix_error (error, "failed to parse node: ");
+	collection = fu_redfish_client_parse_object (parser, blob, error);
+	if (collection == NULL)
 		return FALSE;
-	}
-	node_root = json_parser_get_root (parser);
-	if (node_root == NULL) {
-		g_set_error_literal (error,
-				     FWUPD_ERROR,
-				     FWUPD_ERROR_INVALID_FILE,
-				     "no root node");
-		return FALSE;
-	}
-	collection = json_node_get_object (node_root);
-	if (collection == NULL) {
-		g_set_error_literal (error,
-				     FWUPD_ERROR,
-				     FWUPD_ERROR_INVALID_FILE,
-				     "no collection object");
-		return FALSE;
-	}
-
 	return fu_redfish_client_coldplug_collection (self, collection, error);
 }
 
@@ -289,6 +484,9 @@ fu_redfish_client_coldplug (FuRedfishClient *self, GError **error)
 		return FALSE;
 	}
 
+	/* start again */
+	g_ptr_array_set_size (self->devices, 0);
+
 	/* try to connect */
 	blob = fu_redfish_client_fetch_data (self, self->update_uri_path, error);
 	if (blob == NULL)
@@ -568,19 +766,272 @@ fu_redfish_client_set_smbios_interfaces (FuRedfishClient *self,
 	return TRUE;
 }
 
+typedef struct {
+	FuRedfishClient		*self;
+	FuDevice		*device;
+	GMainContext		*context;
+	GMainLoop		*loop;
+	SoupURI			*task_uri;	/* (nullable) */
+	gint64			 task_started;
+	gboolean		 task_seen;
+	goffset			 upload_sz;
+	goffset			 upload_done;
+	GError			*error;
+} FuRedfishClientUpdateHelper;
+
+static void fu_redfish_client_update_schedule_poll (FuRedfishClientUpdateHelper *helper,
+						    guint delay_ms);
+
+static void
+fu_redfish_client_update_finish (FuRedfishClientUpdateHelper *helper, GError *error)
+{
+	if (error != NULL && helper->error == NULL)
+		helper->error = error;
+	else if (error != NULL)
+		g_error_free (error);
+	g_main_loop_quit (helper->loop);
+}
+
+static void
+fu_redfish_client_update_wrote_body_data_cb (SoupMessage *msg,
+					     SoupBuffer *chunk,
+					     gpointer user_data)
+{
+	FuRedfishClientUpdateHelper *helper = (FuRedfishClientUpdateHelper *) user_data;
+	helper->upload_done += chunk->length;
+	fu_device_set_progress_full (helper->device,
+				     (gsize) helper->upload_done,
+				     (gsize) helper->upload_sz);
+}
+
+/* the BMC can tell us how long to wait before asking again, although an
+ * HTTP-date or zero is treated as the default poll interval */
+static guint
+fu_redfish_client_get_retry_after (FuRedfishClient *self, SoupMessage *msg)
+{
+	const gchar *tmp = soup_message_headers_get_one (msg->response_headers, "Retry-After");
+	guint64 val;
+	if (tmp == NULL)
+		return self->task_poll_ms;
+	val = g_ascii_strtoull (tmp, NULL, 10);
+	if (val > FU_REDFISH_CLIENT_TASK_TIMEOUT_MS / 1000)
+		return self->task_poll_ms;
+	return MAX (val * 1000, self->task_poll_ms);
+}
+
+/* returns TRUE if the task has finished, successfully or not */
+static gboolean
+fu_redfish_client_update_parse_task (FuRedfishClientUpdateHelper *helper,
+				     SoupMessage *msg,
+				     GError **error)
+{
+	JsonObject *obj;
+	const gchar *state;
+	const gchar *status = NULL;
+	g_autoptr(JsonParser) parser = json_parser_new ();
+	g_autoptr(GBytes) blob = NULL;
+
+	/* no task body, e.g. 204 */
+	if (msg->response_body->length == 0)
+		return msg->status_code != SOUP_STATUS_ACCEPTED;
+	blob = g_bytes_new (msg->response_body->data, msg->response_body->length);
+	obj = fu_redfish_client_parse_object (parser, blob, NULL);
+	if (obj == NULL || !json_object_has_member (obj, "TaskState"))
+		return msg->status_code != SOUP_STATUS_ACCEPTED;
+
+	/* still in progress */
+	if (json_object_has_member (obj, "PercentComplete")) {
+		gint64 pc = json_object_get_int_member (obj, "PercentComplete");
+		if (pc >= 0 && pc <= 100)
+			fu_device_set_progress (helper->device, (guint) pc);
+	}
+	state = json_object_get_string_member (obj, "TaskState");
+	if (json_object_has_member (obj, "TaskStatus"))
+		status = json_object_get_string_member (obj, "TaskStatus");
+	g_debug ("task %s is %s [%s]",
+		 json_object_get_string_member (obj, "Id"), state,
+		 status != NULL ? status : "unknown");
+
+	/* a task can complete and still have failed to deploy the image */
+	if (g_strcmp0 (state, "Completed") == 0 &&
+	    g_strcmp0 (status, "Critical") != 0)
+		return TRUE;
+	if (g_strcmp0 (state, "Completed") == 0 ||
+	    g_strcmp0 (state, "Exception") == 0 ||
+	    g_strcmp0 (state, "Killed") == 0 ||
+	    g_strcmp0 (state, "Cancelled") == 0) {
+		const gchar *message = NULL;
+		if (json_object_has_member (obj, "Messages")) {
+			JsonArray *messages = json_object_get_array_member (obj, "Messages");
+			if (messages != NULL && json_array_get_length (messages) > 0) {
+				JsonObject *tmp = json_array_get_object_element (messages, 0);
+				if (tmp != NULL && json_object_has_member (tmp, "Message"))
+					message = json_object_get_string_member (tmp, "Message");
+			}
+		}
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_WRITE,
+			     "task %s [%s]: %s",
+			     state,
+			     status != NULL ? status : "unknown",
+			     message != NULL ? message : "no details");
+		return TRUE;
+	}
+	return FALSE;
+}
+
+static void
+fu_redfish_client_update_task_cb (SoupSession *session, SoupMessage *msg, gpointer user_data)
+{
+	FuRedfishClientUpdateHelper *helper = (FuRedfishClientUpdateHelper *) user_data;
+	g_autoptr(GError) error_local = NULL;
+
+	/* the task monitor is deleted once the final response has been read */
+	if (msg->status_code == SOUP_STATUS_NOT_FOUND && helper->task_seen) {
+		fu_redfish_client_update_finish (helper, NULL);
+		return;
+	}
+	if (msg->status_code != SOUP_STATUS_OK &&
+	    msg->status_code != SOUP_STATUS_ACCEPTED &&
+	    msg->status_code != SOUP_STATUS_NO_CONTENT) {
+		g_autofree gchar *tmp = soup_uri_to_string (helper->task_uri, FALSE);
+		fu_redfish_client_update_finish (helper,
+						 g_error_new (FWUPD_ERROR,
+							      FWUPD_ERROR_WRITE,
+							      "failed to get task %s: %s",
+							      tmp,
+							      soup_status_get_phrase (msg->status_code)));
+		return;
+	}
+	helper->task_seen = TRUE;
+	if (fu_redfish_client_update_parse_task (helper, msg, &error_local)) {
+		fu_redfish_client_update_finish (helper, g_steal_pointer (&error_local));
+		return;
+	}
+
+	/* give up eventually */
+	if (g_get_monotonic_time () - helper->task_started >
+	    (gint64) FU_REDFISH_CLIENT_TASK_TIMEOUT_MS * 1000) {
+		fu_redfish_client_update_finish (helper,
+						 g_error_new_literal (FWUPD_ERROR,
+								      FWUPD_ERROR_TIMED_OUT,
+								      "task did not complete"));
+		return;
+	}
+	fu_redfish_client_update_schedule_poll (helper,
+						fu_redfish_client_get_retry_after (helper->self, msg));
+}
+
+static gboolean
+fu_redfish_client_update_poll_cb (gpointer user_data)
+{
+	FuRedfishClientUpdateHelper *helper = (FuRedfishClientUpdateHelper *) user_data;
+	SoupMessage *msg = soup_message_new_from_uri (SOUP_METHOD_GET, helper->task_uri);
+	fu_redfish_client_set_auth (helper->self, helper->task_uri, msg);
+	soup_session_queue_message (helper->self->session, msg,
+				    fu_redfish_client_update_task_cb, helper);
+	return G_SOURCE_REMOVE;
+}
+
+static void
+fu_redfish_client_update_schedule_poll (FuRedfishClientUpdateHelper *helper, guint delay_ms)
+{
+	g_autoptr(GSource) source = g_timeout_source_new (delay_ms);
+	g_source_set_callback (source, fu_redfish_client_update_poll_cb, helper, NULL);
+	g_source_attach (source, helper->context);
+}
+
+/* the task monitor is in the Location header, or the body is the Task itself */
+static gchar *
+fu_redfish_client_get_task_location (SoupMessage *msg)
+{
+	JsonObject *obj;
+	const gchar *tmp;
+	g_autoptr(JsonParser) parser = json_parser_new ();
+	g_autoptr(GBytes) blob = NULL;
+
+	tmp = soup_message_headers_get_one (msg->response_headers, "Location");
+	if (tmp != NULL)
+		return g_strdup (tmp);
+	if (msg->response_body->length == 0)
+		return NULL;
+	blob = g_bytes_new (msg->response_body->data, msg->response_body->length);
+	obj = fu_redfish_client_parse_object (parser, blob, NULL);
+	if (obj == NULL)
+		return NULL;
+	if (json_object_has_member (obj, "TaskMonitor"))
+		return g_strdup (json_object_get_string_member (obj, "TaskMonitor"));
+	if (json_object_has_member (obj, "TaskState") &&
+	    json_object_has_member (obj, "@odata.id"))
+		return g_strdup (json_object_get_string_member (obj, "@odata.id"));
+	return NULL;
+}
+
+static void
+fu_redfish_client_update_upload_cb (SoupSession *session, SoupMessage *msg, gpointer user_data)
+{
+	FuRedfishClientUpdateHelper *helper = (FuRedfishClientUpdateHelper *) user_data;
+	g_autofree gchar *location = NULL;
+
+	if (msg->status_code != SOUP_STATUS_OK &&
+	    msg->status_code != SOUP_STATUS_CREATED &&
+	    msg->status_code != SOUP_STATUS_ACCEPTED &&
+	    msg->status_code != SOUP_STATUS_NO_CONTENT) {
+		g_autofree gchar *tmp = soup_uri_to_string (soup_message_get_uri (msg), FALSE);
+		fu_redfish_client_update_finish (helper,
+						 g_error_new (FWUPD_ERROR,
+							      FWUPD_ERROR_INVALID_FILE,
+							      "failed to upload to %s: %s",
+							      tmp,
+							      soup_status_get_phrase (msg->status_code)));
+		return;
+	}
+
+	/* nothing to wait for */
+	location = fu_redfish_client_get_task_location (msg);
+	if (location == NULL) {
+		fu_redfish_client_update_finish (helper, NULL);
+		return;
+	}
+	helper->task_uri = soup_uri_new_with_base (soup_message_get_uri (msg), location);
+	if (helper->task_uri == NULL) {
+		fu_redfish_client_update_finish (helper,
+						 g_error_new (FWUPD_ERROR,
+							      FWUPD_ERROR_INVALID_FILE,
+							      "invalid task monitor %s",
+							      location));
+		return;
+	}
+
+	/* wait for the BMC to deploy the firmware */
+	g_debug ("waiting for task %s", location);
+	helper->task_started = g_get_monotonic_time ();
+	fu_device_set_status (helper->device, FWUPD_STATUS_DEVICE_BUSY);
+	fu_device_set_progress (helper->device, 0);
+	fu_redfish_client_update_schedule_poll (helper,
+						fu_redfish_client_get_retry_after (helper->self, msg));
+}
+
 gboolean
 fu_redfish_client_update (FuRedfishClient *self, FuDevice *device, GBytes *blob_fw,
 			  GError **error)
 {
 	FwupdRelease *release;
 	g_autofree gchar *filename = NULL;
-
-	guint status_code;
-	g_autoptr(SoupMessage) msg = NULL;
+	g_autoptr(GMainContext) context = g_main_context_new ();
+	g_autoptr(GMainLoop) loop = g_main_loop_new (context, FALSE);
 	g_autoptr(SoupURI) uri = NULL;
 	g_autoptr(SoupMultipart) multipart = NULL;
 	g_autoptr(SoupBuffer) buffer = NULL;
 	g_autofree gchar *uri_str = NULL;
+	SoupMessage *msg;
+	FuRedfishClientUpdateHelper helper = {
+		.self = self,
+		.device = device,
+		.context = context,
+		.loop = loop,
+	};
 
 	/* Get the update version */
 	release = fwupd_device_get_release_default (FWUPD_DEVICE (device));
@@ -601,11 +1052,12 @@ fu_redfish_client_update (FuRedfishClient *self, FuDevice *device, GBytes *blob_
 	soup_uri_set_port (uri, self->port);
 	uri_str = soup_uri_to_string (uri, FALSE);
 
-	/* Create the multipart request */
+	/* Create the multipart request, referencing the firmware without a copy */
 	multipart = soup_multipart_new (SOUP_FORM_MIME_TYPE_MULTIPART);
-	buffer = soup_buffer_new (SOUP_MEMORY_COPY,
-				  g_bytes_get_data (blob_fw, NULL),
-				  g_bytes_get_size (blob_fw));
+	buffer = soup_buffer_new_with_owner (g_bytes_get_data (blob_fw, NULL),
+					     g_bytes_get_size (blob_fw),
+					     g_bytes_ref (blob_fw),
+					     (GDestroyNotify) g_bytes_unref);
 	soup_multipart_append_form_file (multipart, filename, filename,
 					 "application/octet-stream",
 					 buffer);
@@ -618,20 +1070,69 @@ fu_redfish_client_update (FuRedfishClient *self, FuDevice *device, GBytes *blob_
 		return FALSE;
 	}
 	fu_redfish_client_set_auth (self, uri, msg);
-	status_code = soup_session_send_message (self->session, msg);
-	if (status_code != SOUP_STATUS_OK) {
-		g_set_error (error,
-			     FWUPD_ERROR,
-			     FWUPD_ERROR_INVALID_FILE,
-			     "failed to upload %s to %s: %s",
-			     filename, uri_str,
-			     soup_status_get_phrase (status_code));
+
+	helper.upload_sz = msg->request_body->length;
+	g_signal_connect (msg, "wrote-body-data",
+			  G_CALLBACK (fu_redfish_client_update_wrote_body_data_cb),
+			  &helper);
+
+	/* upload and then wait for the task; only the sources for this update are
+	 * dispatched from the private context, so the caller is blocked until the
+	 * task has finished or timed out */
+	fu_device_set_status (device, FWUPD_STATUS_DEVICE_WRITE);
+	g_main_context_push_thread_default (context);
+	soup_session_queue_message (self->session, msg,
+				    fu_redfish_client_update_upload_cb, &helper);
+	g_main_loop_run (loop);
+	g_main_context_pop_thread_default (context);
+	if (helper.task_uri != NULL)
+		soup_uri_free (helper.task_uri);
+	if (helper.error != NULL) {
+		g_propagate_prefixed_error (error, helper.error,
+					    "failed to upload %s: ", filename);
 		return FALSE;
 	}
-
 	return TRUE;
 }
 
+static gboolean
+fu_redfish_client_get_boolean (JsonObject *obj, const gchar *member_name)
+{
+	if (!json_object_has_member (obj, member_name))
+		return FALSE;
+	return json_object_get_boolean_member (obj, member_name);
+}
+
+/* use $expand if the service advertises it in ProtocolFeaturesSupported */
+static void
+fu_redfish_client_setup_expand (FuRedfishClient *self, JsonObject *obj_root)
+{
+	JsonObject *obj_features;
+	JsonObject *obj_expand;
+	const gchar *kind = NULL;
+
+	g_clear_pointer (&self->expand_query, g_free);
+	if (!json_object_has_member (obj_root, "ProtocolFeaturesSupported"))
+		return;
+	obj_features = json_object_get_object_member (obj_root, "ProtocolFeaturesSupported");
+	if (obj_features == NULL || !json_object_has_member (obj_features, "ExpandQuery"))
+		return;
+	obj_expand = json_object_get_object_member (obj_features, "ExpandQuery");
+	if (obj_expand == NULL)
+		return;
+	if (fu_redfish_client_get_boolean (obj_expand, "NoLinks"))
+		kind = ".";
+	else if (fu_redfish_client_get_boolean (obj_expand, "ExpandAll"))
+		kind = "*";
+	if (kind == NULL)
+		return;
+	if (fu_redfish_client_get_boolean (obj_expand, "Levels"))
+		self->expand_query = g_strdup_printf ("$expand=%s($levels=1)", kind);
+	else
+		self->expand_query = g_strdup_printf ("$expand=%s", kind);
+	g_debug ("Expand:   %s", self->expand_query);
+}
+
 gboolean
 fu_redfish_client_setup (FuRedfishClient *self, GBytes *smbios_table, GError **error)
 {
@@ -665,6 +1166,8 @@ fu_redfish_client_setup (FuRedfishClient *self, GBytes *smbios_table, GError **e
 	user_agent = g_strdup_printf ("%s/%s", PACKAGE_NAME, PACKAGE_VERSION);
 	self->session = soup_session_new_with_options (SOUP_SESSION_USER_AGENT, user_agent,
 						       SOUP_SESSION_TIMEOUT, 60,
+						       SOUP_SESSION_MAX_CONNS_PER_HOST,
+						       FU_REDFISH_CLIENT_MAX_REQUESTS,
 						       NULL);
 	if (self->session == NULL) {
 		g_set_error_literal (error,
@@ -743,6 +1246,7 @@ fu_redfish_client_setup (FuRedfishClient *self, GBytes *smbios_table, GError **e
 	g_debug ("Version:  %s", version);
 	g_debug ("UUID:     %s",
 		 json_object_get_string_member (obj_root, "UUID"));
+	fu_redfish_client_setup_expand (self, obj_root);
 
 	if (json_object_has_member (obj_root, "UpdateService"))
 		obj_update_service = json_object_get_object_member (obj_root, "UpdateService");
@@ -810,6 +1314,13 @@ fu_redfish_client_set_password (FuRedfishClient *self, const gchar *password)
 	self->password = g_strdup (password);
 }
 
+/* only useful for the self tests, as BMCs cannot be polled this quickly */
+void
+fu_redfish_client_set_task_poll_interval (FuRedfishClient *self, guint task_poll_ms)
+{
+	self->task_poll_ms = task_poll_ms;
+}
+
 static void
 fu_redfish_client_finalize (GObject *object)
 {
@@ -818,10 +1329,12 @@ fu_redfish_client_finalize (GObject *object)
 		g_object_unref (self->session);
 	g_free (self->update_uri_path);
 	g_free (self->push_uri_path);
+	g_free (self->expand_query);
 	g_free (self->hostname);
 	g_free (self->username);
 	g_free (self->password);
 	g_ptr_array_unref (self->devices);
+	g_hash_table_unref (self->cache);
 	G_OBJECT_CLASS (fu_redfish_client_parent_class)->finalize (object);
 }
 
@@ -835,7 +1348,10 @@ fu_redfish_client_class_init (FuRedfishClientClass *klass)
 static void
 fu_redfish_client_init (FuRedfishClient *self)
 {
+	self->task_poll_ms = FU_REDFISH_CLIENT_TASK_POLL_MS;
 	self->devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	self->cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+					     (GDestroyNotify) fu_redfish_client_cache_item_free);
 }
 
 FuRedfishClient *
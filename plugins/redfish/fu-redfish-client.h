@@ -25,6 +25,8 @@ void		 fu_redfish_client_set_https	(FuRedfishClient	*self,
 						 gboolean		 use_https);
 void		 fu_redfish_client_set_cacheck	(FuRedfishClient	*self,
 						 gboolean		 cacheck);
+void		 fu_redfish_client_set_task_poll_interval (FuRedfishClient *self,
+							   guint	 task_poll_ms);
 gboolean	 fu_redfish_client_update       (FuRedfishClient	*self,
 						 FuDevice		*device,
 						 GBytes			*blob_fw,
@@ -7,9 +7,12 @@
 #include "config.h"
 
 #include <fwupd.h>
+#include <libsoup/soup.h>
+#include <string.h>
 
 #include "fu-plugin-private.h"
 
+#include "fu-redfish-client.h"
 #include "fu-redfish-common.h"
 
 static void
@@ -26,11 +29,314 @@ fu_test_redfish_common_func (void)
 	g_assert_cmpstr (ipv6, ==, "00010203:04050607:08090a0b:0c0d0e0f");
 }
 
+typedef struct {
+	GMainContext		*context;
+	GMainLoop		*loop;
+	GThread			*thread;
+	SoupServer		*server;
+	guint			 port;
+	gboolean		 expand;
+	guint			 member_cnt;
+	gint			 requests;
+	gint			 not_modified;
+	const gchar		*task_final;	/* (nullable) */
+	gint			 task_polls;
+	goffset			 upload_sz;
+} FuTestRedfishServer;
+
+static void
+fu_test_redfish_server_reply (SoupMessage *msg, const gchar *json)
+{
+	soup_message_set_status (msg, SOUP_STATUS_OK);
+	soup_message_set_response (msg, "application/json",
+				   SOUP_MEMORY_COPY, json, strlen (json));
+}
+
+static GString *
+fu_test_redfish_server_member (guint idx)
+{
+	GString *str = g_string_new (NULL);
+	g_string_append_printf (str,
+				"{\"@odata.id\":\"/redfish/v1/UpdateService/FirmwareInventory/%u\","
+				"\"Id\":\"%u\",\"Name\":\"Device %u\",\"Version\":\"1.2.%u\","
+				"\"SoftwareId\":\"12345678-1234-1234-1234-%012u\"}",
+				idx, idx, idx, idx, idx);
+	return str;
+}
+
+static void
+fu_test_redfish_server_cb (SoupServer *server,
+			   SoupMessage *msg,
+			   const gchar *path,
+			   GHashTable *query,
+			   SoupClientContext *client,
+			   gpointer user_data)
+{
+	FuTestRedfishServer *self = (FuTestRedfishServer *) user_data;
+
+	g_atomic_int_inc (&self->requests);
+	if (g_strcmp0 (path, "/redfish/v1/") == 0) {
+		fu_test_redfish_server_reply (msg, self->expand ?
+			"{\"RedfishVersion\":\"1.6.0\","
+			"\"UpdateService\":{\"@odata.id\":\"/redfish/v1/UpdateService\"},"
+			"\"ProtocolFeaturesSupported\":{\"ExpandQuery\":{\"NoLinks\":true,\"Levels\":true}}}" :
+			"{\"RedfishVersion\":\"1.6.0\","
+			"\"UpdateService\":{\"@odata.id\":\"/redfish/v1/UpdateService\"}}");
+		return;
+	}
+	if (g_strcmp0 (path, "/redfish/v1/UpdateService") == 0) {
+		fu_test_redfish_server_reply (msg,
+			"{\"ServiceEnabled\":true,\"HttpPushUri\":\"/FWUpdate\","
+			"\"FirmwareInventory\":{\"@odata.id\":\"/redfish/v1/UpdateService/FirmwareInventory\"}}");
+		return;
+	}
+	if (g_strcmp0 (path, "/redfish/v1/UpdateService/FirmwareInventory") == 0) {
+		gboolean expand = self->expand && query != NULL &&
+				  g_hash_table_lookup (query, "$expand") != NULL;
+		g_autoptr(GString) str = g_string_new ("{\"Members\":[");
+		for (guint i = 0; i < self->member_cnt; i++) {
+			if (i > 0)
+				g_string_append (str, ",");
+			if (expand) {
+				g_autoptr(GString) member = fu_test_redfish_server_member (i);
+				g_string_append (str, member->str);
+			} else {
+				g_string_append_printf (str,
+							"{\"@odata.id\":\"/redfish/v1/UpdateService/FirmwareInventory/%u\"}",
+							i);
+			}
+		}
+		g_string_append (str, "]}");
+		fu_test_redfish_server_reply (msg, str->str);
+		return;
+	}
+	if (g_str_has_prefix (path, "/redfish/v1/UpdateService/FirmwareInventory/")) {
+		const gchar *id = path + strlen ("/redfish/v1/UpdateService/FirmwareInventory/");
+		guint idx = g_ascii_strtoull (id, NULL, 10);
+		const gchar *etag_old;
+		g_autofree gchar *etag = g_strdup_printf ("\"v%u\"", idx);
+		g_autoptr(GString) member = fu_test_redfish_server_member (idx);
+
+		/* a real BMC is this slow, or even slower */
+		g_usleep (20 * 1000);
+		etag_old = soup_message_headers_get_one (msg->request_headers, "If-None-Match");
+		soup_message_headers_append (msg->response_headers, "ETag", etag);
+		if (g_strcmp0 (etag_old, etag) == 0) {
+			g_atomic_int_inc (&self->not_modified);
+			soup_message_set_status (msg, SOUP_STATUS_NOT_MODIFIED);
+			return;
+		}
+		fu_test_redfish_server_reply (msg, member->str);
+		return;
+	}
+	if (g_strcmp0 (path, "/FWUpdate") == 0) {
+		self->upload_sz = msg->request_body->length;
+		soup_message_headers_append (msg->response_headers, "Location",
+					     "/redfish/v1/TaskService/Tasks/1");
+		soup_message_headers_append (msg->response_headers, "Retry-After", "0");
+		soup_message_set_status (msg, SOUP_STATUS_ACCEPTED);
+		return;
+	}
+	if (g_strcmp0 (path, "/redfish/v1/TaskService/Tasks/1") == 0) {
+		gint polls = g_atomic_int_add (&self->task_polls, 1) + 1;
+		soup_message_headers_append (msg->response_headers, "Retry-After", "0");
+		if (polls < 3) {
+			g_autofree gchar *json = NULL;
+			json = g_strdup_printf ("{\"Id\":\"1\",\"TaskState\":\"Running\","
+						"\"PercentComplete\":%i}", polls * 30);
+			fu_test_redfish_server_reply (msg, json);
+			soup_message_set_status (msg, SOUP_STATUS_ACCEPTED);
+			return;
+		}
+		fu_test_redfish_server_reply (msg, self->task_final != NULL ?
+			self->task_final :
+			"{\"Id\":\"1\",\"TaskState\":\"Completed\",\"TaskStatus\":\"OK\","
+			"\"PercentComplete\":100}");
+		return;
+	}
+	soup_message_set_status (msg, SOUP_STATUS_NOT_FOUND);
+}
+
+static gpointer
+fu_test_redfish_server_thread_cb (gpointer user_data)
+{
+	FuTestRedfishServer *self = (FuTestRedfishServer *) user_data;
+	g_main_context_push_thread_default (self->context);
+	g_main_loop_run (self->loop);
+	g_main_context_pop_thread_default (self->context);
+	return NULL;
+}
+
+static FuTestRedfishServer *
+fu_test_redfish_server_new (gboolean expand, guint member_cnt)
+{
+	FuTestRedfishServer *self = g_new0 (FuTestRedfishServer, 1);
+	GSList *uris;
+	gboolean ret;
+	g_autoptr(GError) error = NULL;
+
+	self->expand = expand;
+	self->member_cnt = member_cnt;
+	self->context = g_main_context_new ();
+	self->loop = g_main_loop_new (self->context, FALSE);
+
+	/* the listening socket is attached to the thread-default context */
+	g_main_context_push_thread_default (self->context);
+	self->server = soup_server_new (NULL, NULL);
+	soup_server_add_handler (self->server, NULL, fu_test_redfish_server_cb, self, NULL);
+	ret = soup_server_listen_local (self->server, 0, SOUP_SERVER_LISTEN_IPV4_ONLY, &error);
+	g_main_context_pop_thread_default (self->context);
+	g_assert_no_error (error);
+	g_assert (ret);
+	uris = soup_server_get_uris (self->server);
+	g_assert_nonnull (uris);
+	self->port = soup_uri_get_port (uris->data);
+	g_slist_free_full (uris, (GDestroyNotify) soup_uri_free);
+
+	self->thread = g_thread_new ("redfish-server", fu_test_redfish_server_thread_cb, self);
+	return self;
+}
+
+static void
+fu_test_redfish_server_free (FuTestRedfishServer *self)
+{
+	g_main_loop_quit (self->loop);
+	g_main_context_wakeup (self->context);
+	g_thread_join (self->thread);
+	g_object_unref (self->server);
+	g_main_loop_unref (self->loop);
+	g_main_context_unref (self->context);
+	g_free (self);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(FuTestRedfishServer, fu_test_redfish_server_free)
+
+static void
+fu_test_redfish_client_coldplug (gboolean expand)
+{
+	GPtrArray *devices;
+	gboolean ret;
+	g_autoptr(FuRedfishClient) client = fu_redfish_client_new ();
+	g_autoptr(FuTestRedfishServer) server = fu_test_redfish_server_new (expand, 10);
+	g_autoptr(GError) error = NULL;
+
+	fu_redfish_client_set_hostname (client, "127.0.0.1");
+	fu_redfish_client_set_port (client, server->port);
+	ret = fu_redfish_client_setup (client, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	ret = fu_redfish_client_coldplug (client, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	/* all members, in the right order */
+	devices = fu_redfish_client_get_devices (client);
+	g_assert_cmpint (devices->len, ==, 10);
+	for (guint i = 0; i < devices->len; i++) {
+		FuDevice *dev = g_ptr_array_index (devices, i);
+		g_autofree gchar *version = g_strdup_printf ("1.2.%u", i);
+		g_assert_cmpstr (fu_device_get_version (dev), ==, version);
+	}
+
+	/* root, update service, collection, and maybe each member */
+	g_assert_cmpint (g_atomic_int_get (&server->requests), ==, expand ? 3 : 13);
+
+	/* again, using the cache */
+	ret = fu_redfish_client_coldplug (client, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	devices = fu_redfish_client_get_devices (client);
+	g_assert_cmpint (devices->len, ==, 10);
+	g_assert_cmpint (g_atomic_int_get (&server->not_modified), ==, expand ? 0 : 10);
+}
+
+static void
+fu_test_redfish_client_coldplug_func (void)
+{
+	fu_test_redfish_client_coldplug (FALSE);
+}
+
+static void
+fu_test_redfish_client_coldplug_expand_func (void)
+{
+	fu_test_redfish_client_coldplug (TRUE);
+}
+
+static void
+fu_test_redfish_client_update (const gchar *task_final, const gchar *error_msg)
+{
+	FuDevice *device;
+	GPtrArray *devices;
+	gboolean ret;
+	g_autofree guint8 *buf = g_malloc0 (0x40000);
+	g_autoptr(FuRedfishClient) client = fu_redfish_client_new ();
+	g_autoptr(FuTestRedfishServer) server = fu_test_redfish_server_new (FALSE, 1);
+	g_autoptr(GBytes) blob_fw = NULL;
+	g_autoptr(GError) error = NULL;
+
+	fu_redfish_client_set_hostname (client, "127.0.0.1");
+	fu_redfish_client_set_port (client, server->port);
+	fu_redfish_client_set_task_poll_interval (client, 10);
+	ret = fu_redfish_client_setup (client, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	ret = fu_redfish_client_coldplug (client, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	devices = fu_redfish_client_get_devices (client);
+	g_assert_cmpint (devices->len, ==, 1);
+	device = g_ptr_array_index (devices, 0);
+
+	/* upload, then wait for the task to finish */
+	server->task_final = task_final;
+	blob_fw = g_bytes_new_static (buf, 0x40000);
+	ret = fu_redfish_client_update (client, device, blob_fw, &error);
+	g_assert_cmpint (server->upload_sz, >, 0x40000);
+	g_assert_cmpint (g_atomic_int_get (&server->task_polls), ==, 3);
+	if (error_msg != NULL) {
+		g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_WRITE);
+		g_assert_nonnull (strstr (error->message, error_msg));
+		g_assert (!ret);
+		return;
+	}
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpint (fu_device_get_progress (device), ==, 100);
+}
+
+static void
+fu_test_redfish_client_update_func (void)
+{
+	fu_test_redfish_client_update (NULL, NULL);
+}
+
+static void
+fu_test_redfish_client_update_fail_func (void)
+{
+	fu_test_redfish_client_update ("{\"Id\":\"1\",\"TaskState\":\"Exception\","
+				       "\"Messages\":[{\"Message\":\"image is not signed\"}]}",
+				       "image is not signed");
+}
+
+static void
+fu_test_redfish_client_update_critical_func (void)
+{
+	fu_test_redfish_client_update ("{\"Id\":\"1\",\"TaskState\":\"Completed\","
+				       "\"TaskStatus\":\"Critical\",\"PercentComplete\":100,"
+				       "\"Messages\":[{\"Message\":\"flash verify failed\"}]}",
+				       "flash verify failed");
+}
+
 int
 main (int argc, char **argv)
 {
 	g_test_init (&argc, &argv, NULL);
 	g_log_set_fatal_mask (NULL, G_LOG_LEVEL_ERROR | G_LOG_LEVEL_CRITICAL);
 	g_test_add_func ("/redfish/common", fu_test_redfish_common_func);
+	g_test_add_func ("/redfish/client{coldplug}", fu_test_redfish_client_coldplug_func);
+	g_test_add_func ("/redfish/client{coldplug-expand}", fu_test_redfish_client_coldplug_expand_func);
+	g_test_add_func ("/redfish/client{update}", fu_test_redfish_client_update_func);
+	g_test_add_func ("/redfish/client{update-fail}", fu_test_redfish_client_update_fail_func);
+	g_test_add_func ("/redfish/client{update-critical}", fu_test_redfish_client_update_critical_func);
 	return g_test_run ();
 }
@@ -20,6 +20,10 @@ fu_steelseries_device_open (FuUsbDevice *device, GError **error)
 	GUsbDevice *usb_device = fu_usb_device_get_dev (device);
 	const guint8 iface_idx = 0x00;
 
+	/* no hardware to claim */
+	if (fu_device_is_replay (FU_DEVICE (device)))
+		return TRUE;
+
 	/* get firmware version on SteelSeries Rival 100 */
 	if (!g_usb_device_claim_interface (usb_device, iface_idx,
 					   G_USB_DEVICE_CLAIM_INTERFACE_BIND_KERNEL_DRIVER,
@@ -35,7 +39,6 @@ fu_steelseries_device_open (FuUsbDevice *device, GError **error)
 static gboolean
 fu_steelseries_device_setup (FuDevice *device, GError **error)
 {
-	GUsbDevice *usb_device = fu_usb_device_get_dev (FU_USB_DEVICE (device));
 	gboolean ret;
 	gsize actual_len = 0;
 	guint8 data[32];
@@ -43,19 +46,19 @@ fu_steelseries_device_setup (FuDevice *device, GError **error)
 
 	memset (data, 0x00, sizeof(data));
 	data[0] = 0x16;
-	ret = g_usb_device_control_transfer (usb_device,
-					     G_USB_DEVICE_DIRECTION_HOST_TO_DEVICE,
-					     G_USB_DEVICE_REQUEST_TYPE_CLASS,
-					     G_USB_DEVICE_RECIPIENT_INTERFACE,
-					     0x09,
-					     0x0200,
-					     0x0000,
-					     data,
-					     sizeof(data),
-					     &actual_len,
-					     STEELSERIES_TRANSACTION_TIMEOUT,
-					     NULL,
-					     error);
+	ret = fu_usb_device_control_transfer (FU_USB_DEVICE (device),
+					      G_USB_DEVICE_DIRECTION_HOST_TO_DEVICE,
+					      G_USB_DEVICE_REQUEST_TYPE_CLASS,
+					      G_USB_DEVICE_RECIPIENT_INTERFACE,
+					      0x09,
+					      0x0200,
+					      0x0000,
+					      data,
+					      sizeof(data),
+					      &actual_len,
+					      STEELSERIES_TRANSACTION_TIMEOUT,
+					      NULL,
+					      error);
 	if (!ret) {
 		g_prefix_error (error, "failed to do control transfer: ");
 		return FALSE;
@@ -67,14 +70,14 @@ fu_steelseries_device_setup (FuDevice *device, GError **error)
 			     "only wrote %" G_GSIZE_FORMAT "bytes", actual_len);
 		return FALSE;
 	}
-	ret = g_usb_device_interrupt_transfer (usb_device,
-					       0x81, /* EP1 IN */
-					       data,
-					       sizeof(data),
-					       &actual_len,
-					       STEELSERIES_TRANSACTION_TIMEOUT,
-					       NULL,
-					       error);
+	ret = fu_usb_device_interrupt_transfer (FU_USB_DEVICE (device),
+						0x81, /* EP1 IN */
+						data,
+						sizeof(data),
+						&actual_len,
+						STEELSERIES_TRANSACTION_TIMEOUT,
+						NULL,
+						error);
 	if (!ret) {
 		g_prefix_error (error, "failed to do EP1 transfer: ");
 		return FALSE;
@@ -99,6 +102,10 @@ fu_steelseries_device_close (FuUsbDevice *device, GError **error)
 	GUsbDevice *usb_device = fu_usb_device_get_dev (device);
 	const guint8 iface_idx = 0x00;
 
+	/* nothing was claimed */
+	if (fu_device_is_replay (FU_DEVICE (device)))
+		return TRUE;
+
 	/* we're done here */
 	if (!g_usb_device_release_interface (usb_device, iface_idx,
 					     G_USB_DEVICE_CLAIM_INTERFACE_BIND_KERNEL_DRIVER,
@@ -703,23 +703,56 @@ fu_synaptics_rmi_device_poll (FuSynapticsRmiDevice *self, GError **error)
 	return TRUE;
 }
 
-gboolean
-fu_synaptics_rmi_device_poll_wait (FuSynapticsRmiDevice *self, GError **error)
+/* discard any attention reports that woke the poller, otherwise the next
+ * register read would get them rather than the response */
+static void
+fu_synaptics_rmi_device_drain (FuSynapticsRmiDevice *self)
+{
+	FuSynapticsRmiDevicePrivate *priv = GET_PRIVATE (self);
+	for (guint i = 0; i < 0xff; i++) {
+		g_autoptr(GByteArray) res = NULL;
+		g_autoptr(GError) error_local = NULL;
+		res = fu_io_channel_read_byte_array (priv->io_channel, -1, 0,
+						     FU_IO_CHANNEL_FLAG_SINGLE_SHOT,
+						     &error_local);
+		if (res == NULL)
+			break;
+		if (g_getenv ("FWUPD_SYNAPTICS_RMI_VERBOSE") != NULL) {
+			fu_common_dump_full (G_LOG_DOMAIN, "ReportDrain",
+					     res->data, res->len,
+					     80, FU_DUMP_FLAGS_NONE);
+		}
+	}
+}
+
+static gboolean
+fu_synaptics_rmi_device_poll_cb (FuDevice *device, gpointer user_data, GError **error)
 {
+	FuSynapticsRmiDevice *self = FU_SYNAPTICS_RMI_DEVICE (device);
 	g_autoptr(GError) error_local = NULL;
 
-	/* try to poll every 20ms for up to 400ms */
-	for (guint i = 0; i < 20; i++) {
-		g_usleep (1000 * 20);
-		g_clear_error (&error_local);
-		if (fu_synaptics_rmi_device_poll (self, &error_local))
-			return TRUE;
+	fu_synaptics_rmi_device_drain (self);
+	if (!fu_synaptics_rmi_device_poll (self, &error_local)) {
 		g_debug ("failed: %s", error_local->message);
+		g_set_error_literal (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_BUSY,
+				     error_local->message);
+		return FALSE;
 	}
+	return TRUE;
+}
 
-	/* proxy the last error */
-	g_propagate_error (error, g_steal_pointer (&error_local));
-	return FALSE;
+gboolean
+fu_synaptics_rmi_device_poll_wait (FuSynapticsRmiDevice *self, GError **error)
+{
+	/* the hardware needs time to settle before the first poll */
+	g_usleep (1000 * 20);
+
+	/* poll for up to 400ms */
+	return fu_device_wait_for_condition (FU_DEVICE (self), "poll",
+					     fu_synaptics_rmi_device_poll_cb,
+					     400, NULL, error);
 }
 
 static gboolean
@@ -11,6 +11,7 @@
 
 struct FuPluginData {
 	GMutex			 mutex;
+	guint			 security_attrs_cnt;
 };
 
 void
@@ -258,3 +259,23 @@ fu_plugin_composite_cleanup (FuPlugin *plugin,
 	}
 	return TRUE;
 }
+
+void
+fu_plugin_add_security_attrs (FuPlugin *plugin, FuSecurityAttrs *attrs)
+{
+	FuPluginData *data = fu_plugin_get_data (plugin);
+	g_autofree gchar *cnt = NULL;
+	g_autoptr(FwupdSecurityAttr) attr = NULL;
+
+	if (g_strcmp0 (g_getenv ("FWUPD_PLUGIN_TEST"), "security-attrs") != 0)
+		return;
+
+	/* record how many times the engine asked */
+	cnt = g_strdup_printf ("%u", ++data->security_attrs_cnt);
+	attr = fwupd_security_attr_new ("org.fwupd.hsi.Test");
+	fwupd_security_attr_set_plugin (attr, fu_plugin_get_name (plugin));
+	fwupd_security_attr_set_name (attr, "Test");
+	fwupd_security_attr_set_result (attr, FWUPD_SECURITY_ATTR_RESULT_VALID);
+	fwupd_security_attr_add_metadata (attr, "QueryCount", cnt);
+	fu_security_attrs_append (attrs, attr);
+}
@@ -6,16 +6,24 @@
 
 #include "config.h"
 
+#include <string.h>
+
+#include "fu-common.h"
+#include "fu-device-metadata.h"
 #include "fu-hash.h"
 #include "fu-plugin-vfuncs.h"
 
+#include "fu-tpm-eventlog-common.h"
 #include "fu-tpm-eventlog-device.h"
 
 struct FuPluginData {
 	GPtrArray		*pcr0s;
+	GPtrArray		*pcrs;		/* of GPtrArray, indexed by PCR */
 	gboolean		 has_tpm_device;
 	gboolean		 has_uefi_device;
 	gboolean		 reconstructed;
+	guint			 pcrs_checked;
+	guint32			 pcrs_invalid;	/* bitmask */
 };
 
 void
@@ -33,35 +41,35 @@ fu_plugin_destroy (FuPlugin *plugin)
 	FuPluginData *data = fu_plugin_get_data (plugin);
 	if (data->pcr0s != NULL)
 		g_ptr_array_unref (data->pcr0s);
+	if (data->pcrs != NULL)
+		g_ptr_array_unref (data->pcrs);
 }
 
 gboolean
 fu_plugin_coldplug (FuPlugin *plugin, GError **error)
 {
 	FuPluginData *data = fu_plugin_get_data (plugin);
-	gsize bufsz = 0;
 	const gchar *fn = "/sys/kernel/security/tpm0/binary_bios_measurements";
 	g_autofree gchar *str = NULL;
-	g_autofree guint8 *buf = NULL;
 	g_autoptr(FuTpmEventlogDevice) dev = NULL;
+	g_autoptr(GBytes) blob = NULL;
 
-	if (!g_file_get_contents (fn, (gchar **) &buf, &bufsz, error))
-		return FALSE;
-	if (bufsz == 0) {
-		g_set_error (error,
-			     FWUPD_ERROR,
-			     FWUPD_ERROR_INVALID_FILE,
-			     "failed to read data from %s", fn);
+	blob = fu_tpm_eventlog_load_file (fn, error);
+	if (blob == NULL)
 		return FALSE;
-	}
-	dev = fu_tpm_eventlog_device_new (buf, bufsz, error);
+	dev = fu_tpm_eventlog_device_new (blob, error);
 	if (dev == NULL)
 		return FALSE;
 	if (!fu_device_setup (FU_DEVICE (dev), error))
 		return FALSE;
 
+	/* save every bank of every PCR to compare against the TPM */
+	data->pcrs = fu_tpm_eventlog_device_replay (dev, error);
+	if (data->pcrs == NULL)
+		return FALSE;
+
 	/* save this so we can compare against system-firmware */
-	data->pcr0s = fu_tpm_eventlog_device_get_checksums (dev, 0, error);
+	data->pcr0s = fu_tpm_eventlog_pcrs_get_checksums (data->pcrs, 0, error);
 	if (data->pcr0s == NULL)
 		return FALSE;
 	for (guint i = 0; i < data->pcr0s->len; i++) {
@@ -114,11 +122,31 @@ fu_plugin_device_registered_uefi (FuPlugin *plugin, FuDevice *device)
 	}
 }
 
+static void
+fu_plugin_device_registered_uefi_pcrs (FuPlugin *plugin, FuDevice *device)
+{
+	FuPluginData *data = fu_plugin_get_data (plugin);
+	const gchar *tmp;
+
+	/* only the system-firmware device gets the PCR values */
+	tmp = fu_device_get_metadata (device, FU_DEVICE_METADATA_TPM_PCRS);
+	if (tmp == NULL || data->pcrs == NULL)
+		return;
+
+	/* the device may be registered again, e.g. after an update */
+	data->pcrs_checked = 0;
+	data->pcrs_invalid = 0;
+	fu_tpm_eventlog_pcrs_compare (data->pcrs, tmp,
+				      &data->pcrs_checked,
+				      &data->pcrs_invalid);
+}
+
 void
 fu_plugin_device_registered (FuPlugin *plugin, FuDevice *device)
 {
 	/* only care about UEFI devices from ESRT */
 	if (g_strcmp0 (fu_device_get_plugin (device), "uefi") == 0) {
+		fu_plugin_device_registered_uefi_pcrs (plugin, device);
 		fu_plugin_device_registered_uefi (plugin, device);
 		return;
 	}
@@ -130,6 +158,42 @@ fu_plugin_device_registered (FuPlugin *plugin, FuDevice *device)
 	}
 }
 
+static void
+fu_plugin_add_security_attrs_pcrs (FuPlugin *plugin, FuSecurityAttrs *attrs)
+{
+	FuPluginData *data = fu_plugin_get_data (plugin);
+	g_autoptr(FwupdSecurityAttr) attr = NULL;
+	g_autoptr(GString) str = g_string_new (NULL);
+
+	/* create attr */
+	attr = fwupd_security_attr_new (FWUPD_SECURITY_ATTR_ID_TPM_RECONSTRUCTION_ALL);
+	fwupd_security_attr_set_plugin (attr, fu_plugin_get_name (plugin));
+	fwupd_security_attr_set_level (attr, FWUPD_SECURITY_ATTR_LEVEL_THEORETICAL);
+	fu_security_attrs_append (attrs, attr);
+
+	/* check reconstructed to each firmware PCR */
+	if (!fu_plugin_get_enabled (plugin) || data->pcrs_checked == 0) {
+		fwupd_security_attr_set_result (attr, FWUPD_SECURITY_ATTR_RESULT_NOT_FOUND);
+		return;
+	}
+	if (data->pcrs_invalid != 0) {
+		for (guint i = 0; i < FU_TPM_EVENTLOG_PCR_FIRMWARE_MAX; i++) {
+			if ((data->pcrs_invalid & (1u << i)) == 0)
+				continue;
+			if (str->len > 0)
+				g_string_append (str, ",");
+			g_string_append_printf (str, "%u", i);
+		}
+		fwupd_security_attr_add_metadata (attr, "pcrs", str->str);
+		fwupd_security_attr_set_result (attr, FWUPD_SECURITY_ATTR_RESULT_NOT_VALID);
+		return;
+	}
+
+	/* success */
+	fwupd_security_attr_add_flag (attr, FWUPD_SECURITY_ATTR_FLAG_SUCCESS);
+	fwupd_security_attr_set_result (attr, FWUPD_SECURITY_ATTR_RESULT_VALID);
+}
+
 void
 fu_plugin_add_security_attrs (FuPlugin *plugin, FuSecurityAttrs *attrs)
 {
@@ -139,6 +203,7 @@ fu_plugin_add_security_attrs (FuPlugin *plugin, FuSecurityAttrs *attrs)
 	/* no TPM device */
 	if (!data->has_tpm_device)
 		return;
+	fu_plugin_add_security_attrs_pcrs (plugin, attrs);
 
 	/* create attr */
 	attr = fwupd_security_attr_new (FWUPD_SECURITY_ATTR_ID_TPM_RECONSTRUCTION_PCR0);
@@ -7,6 +7,7 @@
 #include "config.h"
 
 #include <fwupd.h>
+#include <string.h>
 
 #include "fu-tpm-eventlog-common.h"
 #include "fu-tpm-eventlog-device.h"
@@ -16,11 +17,9 @@ fu_test_tpm_eventlog_parse_v1_func (void)
 {
 	const gchar *ci = g_getenv ("CI_NETWORK");
 	const gchar *tmp;
-	gboolean ret;
-	gsize bufsz = 0;
 	g_autofree gchar *fn = NULL;
-	g_autofree guint8 *buf = NULL;
 	g_autofree gchar *str = NULL;
+	g_autoptr(GBytes) blob = NULL;
 	g_autoptr(FuTpmEventlogDevice) dev = NULL;
 	g_autoptr(GError) error = NULL;
 	g_autoptr(GPtrArray) pcr0s = NULL;
@@ -30,11 +29,11 @@ fu_test_tpm_eventlog_parse_v1_func (void)
 		g_test_skip ("Missing binary_bios_measurements-v1");
 		return;
 	}
-	ret = g_file_get_contents (fn, (gchar **) &buf, &bufsz, &error);
+	blob = fu_tpm_eventlog_load_file (fn, &error);
 	g_assert_no_error (error);
-	g_assert_true (ret);
+	g_assert_nonnull (blob);
 
-	dev = fu_tpm_eventlog_device_new (buf, bufsz, &error);
+	dev = fu_tpm_eventlog_device_new (blob, &error);
 	g_assert_no_error (error);
 	g_assert_nonnull (dev);
 	str = fu_device_to_string (FU_DEVICE (dev));
@@ -55,25 +54,25 @@ fu_test_tpm_eventlog_parse_v2_func (void)
 {
 	const gchar *ci = g_getenv ("CI_NETWORK");
 	const gchar *tmp;
-	gboolean ret;
-	gsize bufsz = 0;
 	g_autofree gchar *fn = NULL;
-	g_autofree guint8 *buf = NULL;
 	g_autofree gchar *str = NULL;
+	g_autoptr(GBytes) blob = NULL;
 	g_autoptr(FuTpmEventlogDevice) dev = NULL;
 	g_autoptr(GError) error = NULL;
+	GPtrArray *pcr0s_replay;
 	g_autoptr(GPtrArray) pcr0s = NULL;
+	g_autoptr(GPtrArray) pcrs = NULL;
 
 	fn = g_test_build_filename (G_TEST_DIST, "tests", "binary_bios_measurements-v2", NULL);
 	if (!g_file_test (fn, G_FILE_TEST_EXISTS) && ci == NULL) {
 		g_test_skip ("Missing binary_bios_measurements-v2");
 		return;
 	}
-	ret = g_file_get_contents (fn, (gchar **) &buf, &bufsz, &error);
+	blob = fu_tpm_eventlog_load_file (fn, &error);
 	g_assert_no_error (error);
-	g_assert_true (ret);
+	g_assert_nonnull (blob);
 
-	dev = fu_tpm_eventlog_device_new (buf, bufsz, &error);
+	dev = fu_tpm_eventlog_device_new (blob, &error);
 	g_assert_no_error (error);
 	g_assert_nonnull (dev);
 	str = fu_device_to_string (FU_DEVICE (dev));
@@ -90,6 +89,153 @@ fu_test_tpm_eventlog_parse_v2_func (void)
 	g_assert_cmpstr (tmp, ==, "ebead4b31c7c49e193c440cd6ee90bc1b61a3ca6");
 	tmp = g_ptr_array_index (pcr0s, 1);
 	g_assert_cmpstr (tmp, ==, "6d9fed68092cfb91c9552bcb7879e75e1df36efd407af67690dc3389a5722fab");
+
+	/* replay every PCR in a single pass */
+	pcrs = fu_tpm_eventlog_device_replay (dev, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (pcrs);
+	g_assert_cmpint (pcrs->len, ==, FU_TPM_EVENTLOG_PCR_MAX);
+	pcr0s_replay = g_ptr_array_index (pcrs, 0);
+	g_assert_cmpint (pcr0s_replay->len, ==, 2);
+	tmp = g_ptr_array_index (pcr0s_replay, 1);
+	g_assert_cmpstr (tmp, ==, "6d9fed68092cfb91c9552bcb7879e75e1df36efd407af67690dc3389a5722fab");
+}
+
+static void
+fu_test_tpm_eventlog_item_free (FuTpmEventlogItem *item)
+{
+	if (item->checksum_sha1 != NULL)
+		g_bytes_unref (item->checksum_sha1);
+	if (item->checksum_sha256 != NULL)
+		g_bytes_unref (item->checksum_sha256);
+	if (item->checksum_sha384 != NULL)
+		g_bytes_unref (item->checksum_sha384);
+	g_free (item);
+}
+
+static GBytes *
+fu_test_tpm_eventlog_digest_new (guint8 value, gsize digestsz)
+{
+	guint8 *buf = g_malloc (digestsz);
+	memset (buf, value, digestsz);
+	return g_bytes_new_take (buf, digestsz);
+}
+
+static GPtrArray *
+fu_test_tpm_eventlog_items_new (void)
+{
+	GPtrArray *items = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_test_tpm_eventlog_item_free);
+	FuTpmEventlogItem *item;
+
+	item = g_new0 (FuTpmEventlogItem, 1);
+	item->pcr = 0;
+	item->checksum_sha1 = fu_test_tpm_eventlog_digest_new (0x11, TPM2_SHA1_DIGEST_SIZE);
+	g_ptr_array_add (items, item);
+	item = g_new0 (FuTpmEventlogItem, 1);
+	item->pcr = 3;
+	item->checksum_sha384 = fu_test_tpm_eventlog_digest_new (0x22, TPM2_SHA384_DIGEST_SIZE);
+	g_ptr_array_add (items, item);
+	item = g_new0 (FuTpmEventlogItem, 1);
+	item->pcr = 7;
+	item->checksum_sha256 = fu_test_tpm_eventlog_digest_new (0x44, TPM2_SHA256_DIGEST_SIZE);
+	g_ptr_array_add (items, item);
+	item = g_new0 (FuTpmEventlogItem, 1);
+	item->pcr = 3;
+	item->checksum_sha384 = fu_test_tpm_eventlog_digest_new (0x33, TPM2_SHA384_DIGEST_SIZE);
+	g_ptr_array_add (items, item);
+	return items;
+}
+
+static void
+fu_test_tpm_eventlog_replay_func (void)
+{
+	GPtrArray *csums;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) items = fu_test_tpm_eventlog_items_new ();
+	g_autoptr(GPtrArray) pcrs = NULL;
+	g_autoptr(GPtrArray) pcr3s = NULL;
+	g_autoptr(GPtrArray) pcr5s = NULL;
+
+	pcrs = fu_tpm_eventlog_replay (items, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (pcrs);
+	g_assert_cmpint (pcrs->len, ==, FU_TPM_EVENTLOG_PCR_MAX);
+
+	/* SHA1 only */
+	csums = g_ptr_array_index (pcrs, 0);
+	g_assert_cmpint (csums->len, ==, 1);
+	g_assert_cmpstr (g_ptr_array_index (csums, 0), ==,
+			 "b3e26c6ca6785f04dd7187293d802d5b16dad8c1");
+
+	/* SHA384 extended twice, in the order measured */
+	pcr3s = fu_tpm_eventlog_pcrs_get_checksums (pcrs, 3, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (pcr3s);
+	g_assert_cmpint (pcr3s->len, ==, 1);
+	g_assert_cmpstr (g_ptr_array_index (pcr3s, 0), ==,
+			 "8d4f5dae587258a142d010c28d041bab06a5d4fe"
+			 "d60be9a8dbb69673800e55dfc60e068ed94bc77a"
+			 "aa1bfe9c49a79882");
+
+	/* SHA256 on a PCR other than 0 */
+	csums = g_ptr_array_index (pcrs, 7);
+	g_assert_cmpint (csums->len, ==, 1);
+	g_assert_cmpstr (g_ptr_array_index (csums, 0), ==,
+			 "105c2393ee071304893e2992acbf55e5de591ae162bae0ac5f3a2d2de0f5f4c3");
+
+	/* nothing measured */
+	pcr5s = fu_tpm_eventlog_pcrs_get_checksums (pcrs, 5, &error);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+	g_assert_null (pcr5s);
+	g_clear_error (&error);
+	g_assert_null (fu_tpm_eventlog_pcrs_get_checksums (pcrs, FU_TPM_EVENTLOG_PCR_MAX, &error));
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+}
+
+static void
+fu_test_tpm_eventlog_compare_func (void)
+{
+	guint pcrs_checked = 0;
+	guint32 pcrs_invalid = 0;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) items = fu_test_tpm_eventlog_items_new ();
+	g_autoptr(GPtrArray) pcrs = NULL;
+
+	pcrs = fu_tpm_eventlog_replay (items, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (pcrs);
+
+	/* all reconstructed, PCR1 has no events and was never extended, and
+	 * PCR9 is not firmware */
+	fu_tpm_eventlog_pcrs_compare (pcrs,
+				      "0:b3e26c6ca6785f04dd7187293d802d5b16dad8c1\n"
+				      "1:0000000000000000000000000000000000000000\n"
+				      "7:105c2393ee071304893e2992acbf55e5de591ae162bae0ac5f3a2d2de0f5f4c3\n"
+				      "9:0000000000000000000000000000000000000000\n"
+				      "invalid\n",
+				      &pcrs_checked, &pcrs_invalid);
+	g_assert_cmpint (pcrs_checked, ==, 3);
+	g_assert_cmpint (pcrs_invalid, ==, 0);
+
+	/* PCR1 was extended but there are no events to reconstruct it */
+	pcrs_checked = 0;
+	fu_tpm_eventlog_pcrs_compare (pcrs,
+				      "0:b3e26c6ca6785f04dd7187293d802d5b16dad8c1\n"
+				      "1:2a1c3e1b5e4d1f0e7a3b8c6d9e0f1a2b3c4d5e6f\n",
+				      &pcrs_checked, &pcrs_invalid);
+	g_assert_cmpint (pcrs_checked, ==, 2);
+	g_assert_cmpint (pcrs_invalid, ==, 1u << 1);
+
+	/* SHA384 bank does not match */
+	pcrs_checked = 0;
+	pcrs_invalid = 0;
+	fu_tpm_eventlog_pcrs_compare (pcrs,
+				      "0:b3e26c6ca6785f04dd7187293d802d5b16dad8c1\n"
+				      "3:000000000000000000000000000000000000000000000000"
+				      "000000000000000000000000000000000000000000000000",
+				      &pcrs_checked, &pcrs_invalid);
+	g_assert_cmpint (pcrs_checked, ==, 2);
+	g_assert_cmpint (pcrs_invalid, ==, 1u << 3);
 }
 
 int
@@ -99,5 +245,7 @@ main (int argc, char **argv)
 	g_log_set_fatal_mask (NULL, G_LOG_LEVEL_ERROR | G_LOG_LEVEL_CRITICAL);
 	g_test_add_func ("/tpm-eventlog/parse{v1}", fu_test_tpm_eventlog_parse_v1_func);
 	g_test_add_func ("/tpm-eventlog/parse{v2}", fu_test_tpm_eventlog_parse_v2_func);
+	g_test_add_func ("/tpm-eventlog/replay", fu_test_tpm_eventlog_replay_func);
+	g_test_add_func ("/tpm-eventlog/compare", fu_test_tpm_eventlog_compare_func);
 	return g_test_run ();
 }
@@ -6,6 +6,10 @@
 
 #include "config.h"
 
+#include <string.h>
+
+#include "fu-common.h"
+
 #include "fu-tpm-eventlog-common.h"
 
 const gchar *
@@ -163,16 +167,69 @@ fu_tpm_eventlog_blobstr (GBytes *blob)
 	return g_string_free (g_steal_pointer (&str), FALSE);
 }
 
+GBytes *
+fu_tpm_eventlog_load_file (const gchar *fn, GError **error)
+{
+	gsize bufsz = 0;
+	g_autofree gchar *buf = NULL;
+	g_autoptr(GMappedFile) mapped = NULL;
+
+	/* map regular files so the event data is never copied, but securityfs
+	 * files report a zero size and cannot be mapped */
+	mapped = g_mapped_file_new (fn, FALSE, NULL);
+	if (mapped != NULL && g_mapped_file_get_length (mapped) > 0)
+		return g_mapped_file_get_bytes (mapped);
+	if (!g_file_get_contents (fn, &buf, &bufsz, error))
+		return NULL;
+	if (bufsz == 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "failed to read data from %s", fn);
+		return NULL;
+	}
+	return g_bytes_new_take (g_steal_pointer (&buf), bufsz);
+}
+
+typedef struct {
+	guint8		 sha1[TPM2_SHA1_DIGEST_SIZE];
+	guint8		 sha256[TPM2_SHA256_DIGEST_SIZE];
+	guint8		 sha384[TPM2_SHA384_DIGEST_SIZE];
+	guint		 cnt_sha1;
+	guint		 cnt_sha256;
+	guint		 cnt_sha384;
+} FuTpmEventlogPcrBanks;
+
+/* take existing PCR hash, append new measurement to that,
+ * hash that with the same algorithm */
+static void
+fu_tpm_eventlog_extend (GChecksum *csum, guint8 *digest, gsize digestsz, GBytes *measurement)
+{
+	g_checksum_reset (csum);
+	g_checksum_update (csum, (const guchar *) digest, digestsz);
+	g_checksum_update (csum,
+			   (const guchar *) g_bytes_get_data (measurement, NULL),
+			   g_bytes_get_size (measurement));
+	g_checksum_get_digest (csum, digest, &digestsz);
+}
+
+static gchar *
+fu_tpm_eventlog_digest_to_string (const guint8 *digest, gsize digestsz)
+{
+	g_autoptr(GBytes) blob = g_bytes_new_static (digest, digestsz);
+	return fu_tpm_eventlog_strhex (blob);
+}
+
+/* replays the event log in a single pass, returning an array of checksum
+ * arrays indexed by PCR */
 GPtrArray *
-fu_tpm_eventlog_calc_checksums (GPtrArray *items, guint8 pcr, GError **error)
+fu_tpm_eventlog_replay (GPtrArray *items, GError **error)
 {
-	guint cnt_sha1 = 0;
-	guint cnt_sha256 = 0;
-	guint8 digest_sha1[TPM2_SHA1_DIGEST_SIZE] = { 0x0 };
-	guint8 digest_sha256[TPM2_SHA256_DIGEST_SIZE] = { 0x0 };
-	gsize digest_sha1_len = sizeof(digest_sha1);
-	gsize digest_sha256_len = sizeof(digest_sha256);
-	g_autoptr(GPtrArray) csums = g_ptr_array_new_with_free_func (g_free);
+	FuTpmEventlogPcrBanks banks[FU_TPM_EVENTLOG_PCR_MAX] = { 0x0 };
+	g_autoptr(GChecksum) csum_sha1 = g_checksum_new (G_CHECKSUM_SHA1);
+	g_autoptr(GChecksum) csum_sha256 = g_checksum_new (G_CHECKSUM_SHA256);
+	g_autoptr(GChecksum) csum_sha384 = g_checksum_new (G_CHECKSUM_SHA384);
+	g_autoptr(GPtrArray) pcrs = NULL;
 
 	/* sanity check */
 	if (items->len == 0) {
@@ -183,51 +240,160 @@ fu_tpm_eventlog_calc_checksums (GPtrArray *items, guint8 pcr, GError **error)
 		return NULL;
 	}
 
-	/* take existing PCR hash, append new measurement to that,
-	 * hash that with the same algorithm */
+	/* extend each bank in the order the events were measured */
 	for (guint i = 0; i < items->len; i++) {
 		FuTpmEventlogItem *item = g_ptr_array_index (items, i);
-		if (item->pcr != pcr)
+		FuTpmEventlogPcrBanks *bank;
+		if (item->pcr >= FU_TPM_EVENTLOG_PCR_MAX)
 			continue;
+		bank = &banks[item->pcr];
 		if (item->checksum_sha1 != NULL) {
-			g_autoptr(GChecksum) csum_sha1 = g_checksum_new (G_CHECKSUM_SHA1);
-			g_checksum_update (csum_sha1,
-					   (const guchar *) digest_sha1,
-					   digest_sha1_len);
-			g_checksum_update (csum_sha1,
-					   (const guchar *) g_bytes_get_data (item->checksum_sha1, NULL),
-					   g_bytes_get_size (item->checksum_sha1));
-			g_checksum_get_digest (csum_sha1, digest_sha1, &digest_sha1_len);
-			cnt_sha1++;
+			fu_tpm_eventlog_extend (csum_sha1, bank->sha1,
+						sizeof(bank->sha1),
+						item->checksum_sha1);
+			bank->cnt_sha1++;
 		}
 		if (item->checksum_sha256 != NULL) {
-			g_autoptr(GChecksum) csum_sha256 = g_checksum_new (G_CHECKSUM_SHA256);
-			g_checksum_update (csum_sha256,
-					   (const guchar *) digest_sha256,
-					   digest_sha256_len);
-			g_checksum_update (csum_sha256,
-					   (const guchar *) g_bytes_get_data (item->checksum_sha256, NULL),
-					   g_bytes_get_size (item->checksum_sha256));
-			g_checksum_get_digest (csum_sha256, digest_sha256, &digest_sha256_len);
-			cnt_sha256++;
+			fu_tpm_eventlog_extend (csum_sha256, bank->sha256,
+						sizeof(bank->sha256),
+						item->checksum_sha256);
+			bank->cnt_sha256++;
+		}
+		if (item->checksum_sha384 != NULL) {
+			fu_tpm_eventlog_extend (csum_sha384, bank->sha384,
+						sizeof(bank->sha384),
+						item->checksum_sha384);
+			bank->cnt_sha384++;
+		}
+	}
+
+	/* convert to strings */
+	pcrs = g_ptr_array_new_with_free_func ((GDestroyNotify) g_ptr_array_unref);
+	for (guint i = 0; i < FU_TPM_EVENTLOG_PCR_MAX; i++) {
+		FuTpmEventlogPcrBanks *bank = &banks[i];
+		GPtrArray *csums = g_ptr_array_new_with_free_func (g_free);
+		if (bank->cnt_sha1 > 0) {
+			g_ptr_array_add (csums,
+					 fu_tpm_eventlog_digest_to_string (bank->sha1,
+									   sizeof(bank->sha1)));
+		}
+		if (bank->cnt_sha256 > 0) {
+			g_ptr_array_add (csums,
+					 fu_tpm_eventlog_digest_to_string (bank->sha256,
+									   sizeof(bank->sha256)));
 		}
+		if (bank->cnt_sha384 > 0) {
+			g_ptr_array_add (csums,
+					 fu_tpm_eventlog_digest_to_string (bank->sha384,
+									   sizeof(bank->sha384)));
+		}
+		g_ptr_array_add (pcrs, csums);
+	}
+	return g_steal_pointer (&pcrs);
+}
+
+/* gets the checksums for one PCR from the result of fu_tpm_eventlog_replay() */
+GPtrArray *
+fu_tpm_eventlog_pcrs_get_checksums (GPtrArray *pcrs, guint8 pcr, GError **error)
+{
+	GPtrArray *csums;
+
+	/* sanity check */
+	if (pcr >= pcrs->len) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_INVALID_DATA,
+			     "invalid PCR %u", pcr);
+		return NULL;
 	}
-	if (cnt_sha1 == 0 && cnt_sha256 == 0) {
+	csums = g_ptr_array_index (pcrs, pcr);
+	if (csums->len == 0) {
 		g_set_error_literal (error,
 				     G_IO_ERROR,
 				     G_IO_ERROR_INVALID_DATA,
-				     "no SHA1 or SHA256 data");
+				     "no SHA1, SHA256 or SHA384 data");
+		return NULL;
+	}
+	return g_ptr_array_ref (csums);
+}
+
+GPtrArray *
+fu_tpm_eventlog_calc_checksums (GPtrArray *items, guint8 pcr, GError **error)
+{
+	g_autoptr(GPtrArray) pcrs = NULL;
+
+	/* sanity check */
+	if (pcr >= FU_TPM_EVENTLOG_PCR_MAX) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_INVALID_DATA,
+			     "invalid PCR %u", pcr);
 		return NULL;
 	}
-	if (cnt_sha1 > 0) {
-		g_autoptr(GBytes) blob_sha1 = NULL;
-		blob_sha1 = g_bytes_new_static (digest_sha1, sizeof(digest_sha1));
-		g_ptr_array_add (csums, fu_tpm_eventlog_strhex (blob_sha1));
+	pcrs = fu_tpm_eventlog_replay (items, error);
+	if (pcrs == NULL)
+		return NULL;
+	return fu_tpm_eventlog_pcrs_get_checksums (pcrs, pcr, error);
+}
+
+static gboolean
+fu_tpm_eventlog_checksum_is_reset (const gchar *checksum)
+{
+	if (checksum[0] == '\0')
+		return FALSE;
+	for (guint i = 0; checksum[i] != '\0'; i++) {
+		if (checksum[i] != '0')
+			return FALSE;
 	}
-	if (cnt_sha256 > 0) {
-		g_autoptr(GBytes) blob_sha256 = NULL;
-		blob_sha256 = g_bytes_new_static (digest_sha256, sizeof(digest_sha256));
-		g_ptr_array_add (csums, fu_tpm_eventlog_strhex (blob_sha256));
+	return TRUE;
+}
+
+/* compares the replayed @pcrs with the TpmPcrs metadata, which is one
+ * `idx:checksum` per line, only considering the platform firmware PCRs;
+ * a PCR with no events in the log can only match if it was never extended */
+void
+fu_tpm_eventlog_pcrs_compare (GPtrArray *pcrs,
+			      const gchar *tpm_pcrs,
+			      guint *pcrs_checked,
+			      guint32 *pcrs_invalid)
+{
+	g_auto(GStrv) lines = g_strsplit (tpm_pcrs, "\n", -1);
+
+	for (guint i = 0; lines[i] != NULL; i++) {
+		GPtrArray *checksums;
+		gboolean compared = FALSE;
+		gboolean matched = FALSE;
+		guint64 idx;
+		g_auto(GStrv) split = g_strsplit (lines[i], ":", 2);
+
+		if (g_strv_length (split) != 2)
+			continue;
+		idx = fu_common_strtoull (split[0]);
+		if (idx >= FU_TPM_EVENTLOG_PCR_FIRMWARE_MAX || idx >= pcrs->len)
+			continue;
+		checksums = g_ptr_array_index (pcrs, idx);
+		if (checksums->len == 0) {
+			compared = TRUE;
+			matched = fu_tpm_eventlog_checksum_is_reset (split[1]);
+		}
+		for (guint j = 0; j < checksums->len; j++) {
+			const gchar *checksum_tmp = g_ptr_array_index (checksums, j);
+			/* skip unless same algorithm */
+			if (strlen (split[1]) != strlen (checksum_tmp))
+				continue;
+			compared = TRUE;
+			if (g_strcmp0 (split[1], checksum_tmp) == 0) {
+				matched = TRUE;
+				break;
+			}
+		}
+		if (!compared)
+			continue;
+		(*pcrs_checked)++;
+		if (!matched) {
+			g_debug ("PCR%u %s not reconstructed%s", (guint) idx, split[1],
+				 checksums->len == 0 ? " as no events were logged" : "");
+			*pcrs_invalid |= 1u << idx;
+		}
 	}
-	return g_steal_pointer (&csums);
 }
@@ -11,6 +11,11 @@
 
 #include "fu-plugin.h"
 
+#define FU_TPM_EVENTLOG_PCR_MAX			24
+
+/* only the platform firmware PCRs are not extended after boot */
+#define FU_TPM_EVENTLOG_PCR_FIRMWARE_MAX	8
+
 typedef enum {
 	EV_PREBOOT_CERT				= 0x00000000,
 	EV_POST_CODE				= 0x00000001,
@@ -47,6 +52,7 @@ typedef struct {
 	FuTpmEventlogItemKind	 kind;
 	GBytes			*checksum_sha1;
 	GBytes			*checksum_sha256;
+	GBytes			*checksum_sha384;
 	GBytes			*blob;
 } FuTpmEventlogItem;
 
@@ -56,6 +62,17 @@ guint32		 fu_tpm_eventlog_hash_get_size		(TPM2_ALG_ID	 hash_kind);
 const gchar	*fu_tpm_eventlog_item_kind_to_string	(FuTpmEventlogItemKind	 event_type);
 gchar		*fu_tpm_eventlog_strhex			(GBytes		*blob);
 gchar		*fu_tpm_eventlog_blobstr		(GBytes		*blob);
+GBytes		*fu_tpm_eventlog_load_file		(const gchar	*fn,
+							 GError		**error);
+GPtrArray	*fu_tpm_eventlog_replay			(GPtrArray	*items,
+							 GError		**error);
+GPtrArray	*fu_tpm_eventlog_pcrs_get_checksums	(GPtrArray	*pcrs,
+							 guint8		 pcr,
+							 GError		**error);
 GPtrArray	*fu_tpm_eventlog_calc_checksums		(GPtrArray	*items,
 							 guint8		 pcr,
 							 GError		**error);
+void		 fu_tpm_eventlog_pcrs_compare		(GPtrArray	*pcrs,
+							 const gchar	*tpm_pcrs,
+							 guint		*pcrs_checked,
+							 guint32	*pcrs_invalid);
@@ -16,14 +16,30 @@
 struct _FuTpmEventlogDevice {
 	FuDevice		 parent_instance;
 	GPtrArray		*items;
+	GPtrArray		*pcrs;		/* (nullable): of GPtrArray, replayed once */
 };
 
 G_DEFINE_TYPE (FuTpmEventlogDevice, fu_tpm_eventlog_device, FU_TYPE_DEVICE)
 
+GPtrArray *
+fu_tpm_eventlog_device_replay (FuTpmEventlogDevice *self, GError **error)
+{
+	/* the event log does not change once parsed */
+	if (self->pcrs == NULL) {
+		self->pcrs = fu_tpm_eventlog_replay (self->items, error);
+		if (self->pcrs == NULL)
+			return NULL;
+	}
+	return g_ptr_array_ref (self->pcrs);
+}
+
 GPtrArray *
 fu_tpm_eventlog_device_get_checksums (FuTpmEventlogDevice *self, guint8 pcr, GError **error)
 {
-	return fu_tpm_eventlog_calc_checksums (self->items, pcr, error);
+	g_autoptr(GPtrArray) pcrs = fu_tpm_eventlog_device_replay (self, error);
+	if (pcrs == NULL)
+		return NULL;
+	return fu_tpm_eventlog_pcrs_get_checksums (pcrs, pcr, error);
 }
 
 static void
@@ -47,14 +63,18 @@ fu_tpm_eventlog_device_report_metadata (FuTpmEventlogDevice *self)
 
 	for (guint i = 0; i < self->items->len; i++) {
 		FuTpmEventlogItem *item = g_ptr_array_index (self->items, i);
-		g_autofree gchar *blobstr = fu_tpm_eventlog_blobstr (item->blob);
-		g_autofree gchar *checksum = fu_tpm_eventlog_strhex (item->checksum_sha1);
+		g_autofree gchar *blobstr = NULL;
+		g_autofree gchar *checksum = NULL;
+		if (item->pcr != 0)
+			continue;
+		blobstr = fu_tpm_eventlog_blobstr (item->blob);
+		checksum = fu_tpm_eventlog_strhex (item->checksum_sha1);
 		g_string_append_printf (str, "0x%08x %s", item->kind, checksum);
 		if (blobstr != NULL)
 			g_string_append_printf (str, " [%s]", blobstr);
 		g_string_append (str, "\n");
 	}
-	pcrs = fu_tpm_eventlog_calc_checksums (self->items, 0, NULL);
+	pcrs = fu_tpm_eventlog_device_get_checksums (self, 0, NULL);
 	if (pcrs != NULL) {
 		for (guint j = 0; j < pcrs->len; j++) {
 			const gchar *csum = g_ptr_array_index (pcrs, j);
@@ -83,6 +103,8 @@ fu_tpm_eventlog_device_finalize (GObject *object)
 	FuTpmEventlogDevice *self = FU_TPM_EVENTLOG_DEVICE (object);
 
 	g_ptr_array_unref (self->items);
+	if (self->pcrs != NULL)
+		g_ptr_array_unref (self->pcrs);
 
 	G_OBJECT_CLASS (fu_tpm_eventlog_device_parent_class)->finalize (object);
 }
@@ -97,17 +119,17 @@ fu_tpm_eventlog_device_class_init (FuTpmEventlogDeviceClass *klass)
 }
 
 FuTpmEventlogDevice *
-fu_tpm_eventlog_device_new (const guint8 *buf, gsize bufsz, GError **error)
+fu_tpm_eventlog_device_new (GBytes *blob, GError **error)
 {
 	g_autoptr(FuTpmEventlogDevice) self = NULL;
 
-	g_return_val_if_fail (buf != NULL, NULL);
+	g_return_val_if_fail (blob != NULL, NULL);
 
 	/* create object */
 	self = g_object_new (FU_TYPE_TPM_EVENTLOG_DEVICE, NULL);
-	self->items = fu_tpm_eventlog_parser_new (buf, bufsz,
-						  FU_TPM_EVENTLOG_PARSER_FLAG_NONE,
-						  error);
+	self->items = fu_tpm_eventlog_parser_new_bytes (blob,
+							FU_TPM_EVENTLOG_PARSER_FLAG_ALL_PCRS,
+							error);
 	if (self->items == NULL)
 		return NULL;
 	return FU_TPM_EVENTLOG_DEVICE (g_steal_pointer (&self));
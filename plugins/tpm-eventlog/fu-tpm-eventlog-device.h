@@ -11,10 +11,11 @@
 #define FU_TYPE_TPM_EVENTLOG_DEVICE (fu_tpm_eventlog_device_get_type ())
 G_DECLARE_FINAL_TYPE (FuTpmEventlogDevice, fu_tpm_eventlog_device, FU, TPM_EVENTLOG_DEVICE, FuDevice)
 
-FuTpmEventlogDevice *fu_tpm_eventlog_device_new		(const guint8	*buf,
-							 gsize		 bufsz,
+FuTpmEventlogDevice *fu_tpm_eventlog_device_new		(GBytes		*blob,
 							 GError		**error);
 gchar		*fu_tpm_eventlog_device_report_metadata	(FuTpmEventlogDevice *self);
 GPtrArray	*fu_tpm_eventlog_device_get_checksums	(FuTpmEventlogDevice *self,
 							 guint8		 pcr,
 							 GError		**error);
+GPtrArray	*fu_tpm_eventlog_device_replay		(FuTpmEventlogDevice *self,
+							 GError		**error);
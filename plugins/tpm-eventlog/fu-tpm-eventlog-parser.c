@@ -41,9 +41,27 @@ fu_tpm_eventlog_parser_item_free (FuTpmEventlogItem *item)
 		g_bytes_unref (item->checksum_sha1);
 	if (item->checksum_sha256 != NULL)
 		g_bytes_unref (item->checksum_sha256);
+	if (item->checksum_sha384 != NULL)
+		g_bytes_unref (item->checksum_sha384);
 	g_free (item);
 }
 
+/* returns a reference into @blob rather than copying the data */
+static GBytes *
+fu_tpm_eventlog_parser_slice (GBytes *blob, gsize offset, gsize length, GError **error)
+{
+	gsize bufsz = g_bytes_get_size (blob);
+	if (offset > bufsz || length > bufsz - offset) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_READ,
+			     "attempted to read 0x%02x bytes at offset 0x%02x from buffer of 0x%02x",
+			     (guint) length, (guint) offset, (guint) bufsz);
+		return NULL;
+	}
+	return g_bytes_new_from_bytes (blob, offset, length);
+}
+
 void
 fu_tpm_eventlog_item_to_string (FuTpmEventlogItem *item, guint idt, GString *str)
 {
@@ -65,15 +83,21 @@ fu_tpm_eventlog_item_to_string (FuTpmEventlogItem *item, guint idt, GString *str
 		g_autofree gchar *csum = fu_tpm_eventlog_strhex (item->checksum_sha256);
 		fu_common_string_append_kv (str, idt, "ChecksumSha256", csum);
 	}
+	if (item->checksum_sha384 != NULL) {
+		g_autofree gchar *csum = fu_tpm_eventlog_strhex (item->checksum_sha384);
+		fu_common_string_append_kv (str, idt, "ChecksumSha384", csum);
+	}
 	if (blobstr != NULL)
 		fu_common_string_append_kv (str, idt, "BlobStr", blobstr);
 }
 
 static GPtrArray *
-fu_tpm_eventlog_parser_parse_blob_v2 (const guint8 *buf, gsize bufsz,
+fu_tpm_eventlog_parser_parse_blob_v2 (GBytes *blob,
 				      FuTpmEventlogParserFlags flags,
 				      GError **error)
 {
+	gsize bufsz = 0;
+	const guint8 *buf = g_bytes_get_data (blob, &bufsz);
 	guint32 hdrsz = 0x0;
 	g_autoptr(GPtrArray) items = NULL;
 
@@ -90,6 +114,7 @@ fu_tpm_eventlog_parser_parse_blob_v2 (const guint8 *buf, gsize bufsz,
 		guint32 datasz = 0;
 		g_autoptr(GBytes) checksum_sha1 = NULL;
 		g_autoptr(GBytes) checksum_sha256 = NULL;
+		g_autoptr(GBytes) checksum_sha384 = NULL;
 
 		/* read entry */
 		if (!fu_common_read_uint32_safe	(buf, bufsz,
@@ -110,7 +135,7 @@ fu_tpm_eventlog_parser_parse_blob_v2 (const guint8 *buf, gsize bufsz,
 		for (guint i = 0; i < digestcnt; i++) {
 			guint16 alg_type = 0;
 			guint32 alg_size = 0;
-			g_autofree guint8 *digest = NULL;
+			g_autoptr(GBytes) digest = NULL;
 
 			/* get checksum type */
 			if (!fu_common_read_uint16_safe	(buf, bufsz, idx,
@@ -129,18 +154,18 @@ fu_tpm_eventlog_parser_parse_blob_v2 (const guint8 *buf, gsize bufsz,
 			/* build checksum */
 			idx += sizeof(alg_type);
 
-			/* copy hash */
-			digest = g_malloc0 (alg_size);
-			if (!fu_memcpy_safe (digest, alg_size, 0x0,	/* dst */
-					     buf, bufsz, idx,		/* src */
-					     alg_size, error))
+			/* reference hash */
+			digest = fu_tpm_eventlog_parser_slice (blob, idx, alg_size, error);
+			if (digest == NULL)
 				return NULL;
 
 			/* save this for analysis */
 			if (alg_type == TPM2_ALG_SHA1)
-				checksum_sha1 = g_bytes_new_take (g_steal_pointer (&digest), alg_size);
+				checksum_sha1 = g_steal_pointer (&digest);
 			else if (alg_type == TPM2_ALG_SHA256)
-				checksum_sha256 = g_bytes_new_take (g_steal_pointer (&digest), alg_size);
+				checksum_sha256 = g_steal_pointer (&digest);
+			else if (alg_type == TPM2_ALG_SHA384)
+				checksum_sha384 = g_steal_pointer (&digest);
 
 			/* next block */
 			idx += alg_size;
@@ -163,19 +188,18 @@ fu_tpm_eventlog_parser_parse_blob_v2 (const guint8 *buf, gsize bufsz,
 		if (pcr == ESYS_TR_PCR0 ||
 		    flags & FU_TPM_EVENTLOG_PARSER_FLAG_ALL_PCRS) {
 			FuTpmEventlogItem *item;
-			g_autofree guint8 *data = NULL;
+			g_autoptr(GBytes) data = NULL;
 
 			/* build item */
-			data = g_malloc0 (datasz);
-			if (!fu_memcpy_safe (data, datasz, 0x0,		/* dst */
-					     buf, bufsz, idx, datasz,	/* src */
-					     error))
+			data = fu_tpm_eventlog_parser_slice (blob, idx, datasz, error);
+			if (data == NULL)
 				return NULL;
 
 			/* not normally required */
 			if (g_getenv ("FWUPD_TPM_EVENTLOG_VERBOSE") != NULL) {
 				fu_common_dump_full (G_LOG_DOMAIN, "Event Data",
-						     data, datasz, 20,
+						     g_bytes_get_data (data, NULL),
+						     datasz, 20,
 						     FU_DUMP_FLAGS_SHOW_ASCII);
 			}
 			item = g_new0 (FuTpmEventlogItem, 1);
@@ -183,7 +207,8 @@ fu_tpm_eventlog_parser_parse_blob_v2 (const guint8 *buf, gsize bufsz,
 			item->kind = event_type;
 			item->checksum_sha1 = g_steal_pointer (&checksum_sha1);
 			item->checksum_sha256 = g_steal_pointer (&checksum_sha256);
-			item->blob = g_bytes_new_take (g_steal_pointer (&data), datasz);
+			item->checksum_sha384 = g_steal_pointer (&checksum_sha384);
+			item->blob = g_steal_pointer (&data);
 			g_ptr_array_add (items, item);
 		}
 
@@ -195,15 +220,31 @@ fu_tpm_eventlog_parser_parse_blob_v2 (const guint8 *buf, gsize bufsz,
 	return g_steal_pointer (&items);
 }
 
+/* the items point into @buf, which must outlive them */
 GPtrArray *
 fu_tpm_eventlog_parser_new (const guint8 *buf, gsize bufsz,
 			    FuTpmEventlogParserFlags flags,
 			    GError **error)
 {
+	g_autoptr(GBytes) blob = NULL;
+	g_return_val_if_fail (buf != NULL, NULL);
+	blob = g_bytes_new_static (buf, bufsz);
+	return fu_tpm_eventlog_parser_new_bytes (blob, flags, error);
+}
+
+/* the items reference @blob, so a mapped file stays mapped while in use */
+GPtrArray *
+fu_tpm_eventlog_parser_new_bytes (GBytes *blob,
+				  FuTpmEventlogParserFlags flags,
+				  GError **error)
+{
+	gsize bufsz = 0;
+	const guint8 *buf;
 	gchar sig[] = FU_TPM_EVENTLOG_V2_HDR_SIGNATURE;
 	g_autoptr(GPtrArray) items = NULL;
 
-	g_return_val_if_fail (buf != NULL, NULL);
+	g_return_val_if_fail (blob != NULL, NULL);
+	buf = g_bytes_get_data (blob, &bufsz);
 
 	/* look for TCG v2 signature */
 	if (!fu_memcpy_safe ((guint8 *) sig, sizeof(sig), 0x0,		/* dst */
@@ -211,7 +252,7 @@ fu_tpm_eventlog_parser_new (const guint8 *buf, gsize bufsz,
 			     sizeof(sig), error))
 		return NULL;
 	if (g_strcmp0 (sig, FU_TPM_EVENTLOG_V2_HDR_SIGNATURE) == 0)
-		return fu_tpm_eventlog_parser_parse_blob_v2 (buf, bufsz, flags, error);
+		return fu_tpm_eventlog_parser_parse_blob_v2 (blob, flags, error);
 
 	/* assume v1 structure */
 	items = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_tpm_eventlog_parser_item_free);
@@ -241,26 +282,28 @@ fu_tpm_eventlog_parser_new (const guint8 *buf, gsize bufsz,
 		if (pcr == ESYS_TR_PCR0 ||
 		    flags & FU_TPM_EVENTLOG_PARSER_FLAG_ALL_PCRS) {
 			FuTpmEventlogItem *item;
-			guint8 digest[TPM2_SHA1_DIGEST_SIZE] = { 0x0 };
-			g_autofree guint8 *data = NULL;
-
-			/* copy hash */
-			if (!fu_memcpy_safe (digest, sizeof(digest), 0x0,			/* dst */
-					     buf, bufsz, idx + FU_TPM_EVENTLOG_V1_IDX_DIGEST,	/* src */
-					     sizeof(digest), error))
+			g_autoptr(GBytes) digest = NULL;
+			g_autoptr(GBytes) data = NULL;
+
+			/* reference hash */
+			digest = fu_tpm_eventlog_parser_slice (blob,
+							       idx + FU_TPM_EVENTLOG_V1_IDX_DIGEST,
+							       TPM2_SHA1_DIGEST_SIZE,
+							       error);
+			if (digest == NULL)
 				return NULL;
 
 			/* build item */
-			data = g_malloc0 (datasz);
-			if (!fu_memcpy_safe (data, datasz, 0x0,					/* dst */
-					     buf, bufsz, idx + FU_TPM_EVENTLOG_V1_SIZE,		/* src */
-					     datasz, error))
+			data = fu_tpm_eventlog_parser_slice (blob,
+							     idx + FU_TPM_EVENTLOG_V1_SIZE,
+							     datasz, error);
+			if (data == NULL)
 				return NULL;
 			item = g_new0 (FuTpmEventlogItem, 1);
 			item->pcr = pcr;
 			item->kind = event_type;
-			item->checksum_sha1 = g_bytes_new (digest, sizeof(digest));
-			item->blob = g_bytes_new_take (g_steal_pointer (&data), datasz);
+			item->checksum_sha1 = g_steal_pointer (&digest);
+			item->blob = g_steal_pointer (&data);
 			g_ptr_array_add (items, item);
 
 			/* not normally required */
@@ -33,20 +33,26 @@ fu_tmp_eventlog_sort_cb (gconstpointer a, gconstpointer b)
 static gboolean
 fu_tmp_eventlog_process (const gchar *fn, gint pcr, GError **error)
 {
-	gsize bufsz = 0;
-	g_autofree guint8 *buf = NULL;
+	g_autoptr(GBytes) blob = NULL;
 	g_autoptr(GPtrArray) items = NULL;
+	g_autoptr(GPtrArray) pcrs = NULL;
 	g_autoptr(GString) str = g_string_new (NULL);
 	gint max_pcr = 0;
 
 	/* parse this */
-	if (!g_file_get_contents (fn, (gchar **) &buf, &bufsz, error))
+	blob = fu_tpm_eventlog_load_file (fn, error);
+	if (blob == NULL)
 		return FALSE;
-	items = fu_tpm_eventlog_parser_new (buf, bufsz,
-					    FU_TPM_EVENTLOG_PARSER_FLAG_ALL_PCRS,
-					    error);
+	items = fu_tpm_eventlog_parser_new_bytes (blob,
+						  FU_TPM_EVENTLOG_PARSER_FLAG_ALL_PCRS,
+						  error);
 	if (items == NULL)
 		return FALSE;
+
+	/* replay in measurement order before sorting for display */
+	pcrs = fu_tpm_eventlog_replay (items, error);
+	if (pcrs == NULL)
+		return FALSE;
 	g_ptr_array_sort (items, fu_tmp_eventlog_sort_cb);
 
 	for (guint i = 0; i < items->len; i++) {
@@ -64,12 +70,10 @@ fu_tmp_eventlog_process (const gchar *fn, gint pcr, GError **error)
 		return FALSE;
 	}
 	fu_common_string_append_kv (str, 0, "Reconstructed PCRs", NULL);
-	for (guint8 i = 0; i <= max_pcr; i++) {
-		g_autoptr(GPtrArray) pcrs = fu_tpm_eventlog_calc_checksums (items, i, NULL);
-		if (pcrs == NULL)
-			continue;
-		for (guint j = 0; j < pcrs->len; j++) {
-			const gchar *csum = g_ptr_array_index (pcrs, j);
+	for (guint8 i = 0; i <= max_pcr && i < pcrs->len; i++) {
+		GPtrArray *csums = g_ptr_array_index (pcrs, i);
+		for (guint j = 0; j < csums->len; j++) {
+			const gchar *csum = g_ptr_array_index (csums, j);
 			g_autofree gchar *title = NULL;
 			g_autofree gchar *pretty = NULL;
 			if (pcr >= 0 && i != (guint) pcr)
@@ -609,6 +609,7 @@ fu_uefi_device_add_system_checksum (FuDevice *device, GError **error)
 	g_autoptr(FuUefiPcrs) pcrs = fu_uefi_pcrs_new ();
 	g_autoptr(GError) error_local = NULL;
 	g_autoptr(GPtrArray) pcr0s = NULL;
+	g_autoptr(GString) str = g_string_new (NULL);
 
 	/* get all the PCRs */
 	if (!fu_uefi_pcrs_setup (pcrs, &error_local)) {
@@ -639,6 +640,16 @@ fu_uefi_device_add_system_checksum (FuDevice *device, GError **error)
 		fu_device_add_checksum (device, checksum);
 	}
 
+	/* allow the event log to be checked against every PCR */
+	for (guint idx = 0; idx < FU_UEFI_PCRS_MAX; idx++) {
+		g_autoptr(GPtrArray) checksums = fu_uefi_pcrs_get_checksums (pcrs, idx);
+		for (guint i = 0; i < checksums->len; i++) {
+			const gchar *checksum = g_ptr_array_index (checksums, i);
+			g_string_append_printf (str, "%u:%s\n", idx, checksum);
+		}
+	}
+	fu_device_set_metadata (device, FU_DEVICE_METADATA_TPM_PCRS, str->str);
+
 	/* success */
 	return TRUE;
 }
@@ -74,8 +74,9 @@ fu_uefi_pcrs_parse_line (const gchar *line, gpointer user_data)
 	/* parse hash */
 	str = g_string_new (split[1]);
 	fu_common_string_replace (str, " ", "");
-	if ((str->len != 40 && str->len != 64) || !_g_string_isxdigit (str)) {
-		g_debug ("not SHA-1 or SHA-256, skipping: %s", split[1]);
+	if ((str->len != 40 && str->len != 64 && str->len != 96) ||
+	    !_g_string_isxdigit (str)) {
+		g_debug ("not SHA-1, SHA-256 or SHA-384, skipping: %s", split[1]);
 		return;
 	}
 	g_string_ascii_down (str);
@@ -112,8 +113,6 @@ fu_uefi_pcrs_setup_tpm20 (FuUefiPcrs *self, GError **error)
 	TSS2_RC rc;
 	g_autoptr(ESYS_CONTEXT) ctx = NULL;
 	g_autofree TPMS_CAPABILITY_DATA *capability_data = NULL;
-	TPML_PCR_SELECTION pcr_selection_in = { 0, };
-	g_autofree TPML_DIGEST *pcr_values = NULL;
 
 	/* suppress warning messages about missing TCTI libraries for tpm2-tss <2.3 */
 	if (g_getenv ("FWUPD_UEFI_VERBOSE") == NULL) {
@@ -142,42 +141,46 @@ fu_uefi_pcrs_setup_tpm20 (FuUefiPcrs *self, GError **error)
 		return FALSE;
 	}
 
-	/* fetch PCR 0 for every supported hash algorithm */
-	pcr_selection_in.count = capability_data->data.assignedPCR.count;
-	for (guint i = 0; i < pcr_selection_in.count; i++) {
-		pcr_selection_in.pcrSelections[i].hash =
-			capability_data->data.assignedPCR.pcrSelections[i].hash;
-		pcr_selection_in.pcrSelections[i].sizeofSelect =
-			capability_data->data.assignedPCR.pcrSelections[i].sizeofSelect;
-		pcr_selection_in.pcrSelections[i].pcrSelect[0] = 0b00000001;
-	}
-
-	rc = Esys_PCR_Read (ctx, ESYS_TR_NONE, ESYS_TR_NONE, ESYS_TR_NONE,
-	                    &pcr_selection_in, NULL, NULL, &pcr_values);
-	if (rc != TSS2_RC_SUCCESS) {
-		g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
-		                     "failed to read PCR values from TPM");
-		return FALSE;
-	}
-
-	for (guint i = 0; i < pcr_values->count; i++) {
-		FuUefiPcrItem *item;
-		g_autoptr(GString) str = NULL;
-		gboolean valid = FALSE;
-
-		str = g_string_new (NULL);
-		for (guint j = 0; j < pcr_values->digests[i].size; j++) {
-			gint64 val = pcr_values->digests[i].buffer[j];
-			if (val > 0)
-				valid = TRUE;
-			g_string_append_printf (str, "%02x", pcr_values->digests[i].buffer[j]);
+	/* fetch each PCR for every supported hash algorithm */
+	for (guint idx = 0; idx < FU_UEFI_PCRS_MAX; idx++) {
+		TPML_PCR_SELECTION pcr_selection_in = { 0, };
+		g_autofree TPML_DIGEST *pcr_values = NULL;
+
+		pcr_selection_in.count = capability_data->data.assignedPCR.count;
+		for (guint i = 0; i < pcr_selection_in.count; i++) {
+			pcr_selection_in.pcrSelections[i].hash =
+				capability_data->data.assignedPCR.pcrSelections[i].hash;
+			pcr_selection_in.pcrSelections[i].sizeofSelect =
+				capability_data->data.assignedPCR.pcrSelections[i].sizeofSelect;
+			pcr_selection_in.pcrSelections[i].pcrSelect[idx / 8] = 1 << (idx % 8);
 		}
-		if (valid) {
-			item = g_new0 (FuUefiPcrItem, 1);
-			item->idx = 0; /* constant PCR index 0, since we only read this single PCR */
-			item->checksum = g_string_free (g_steal_pointer (&str), FALSE);
-			g_ptr_array_add (self->items, item);
-			g_debug ("added PCR-%02u=%s", item->idx, item->checksum);
+		rc = Esys_PCR_Read (ctx, ESYS_TR_NONE, ESYS_TR_NONE, ESYS_TR_NONE,
+				    &pcr_selection_in, NULL, NULL, &pcr_values);
+		if (rc != TSS2_RC_SUCCESS) {
+			g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+					     "failed to read PCR values from TPM");
+			return FALSE;
+		}
+
+		for (guint i = 0; i < pcr_values->count; i++) {
+			FuUefiPcrItem *item;
+			g_autoptr(GString) str = NULL;
+			gboolean valid = FALSE;
+
+			str = g_string_new (NULL);
+			for (guint j = 0; j < pcr_values->digests[i].size; j++) {
+				gint64 val = pcr_values->digests[i].buffer[j];
+				if (val > 0)
+					valid = TRUE;
+				g_string_append_printf (str, "%02x", pcr_values->digests[i].buffer[j]);
+			}
+			if (valid) {
+				item = g_new0 (FuUefiPcrItem, 1);
+				item->idx = idx;
+				item->checksum = g_string_free (g_steal_pointer (&str), FALSE);
+				g_ptr_array_add (self->items, item);
+				g_debug ("added PCR-%02u=%s", item->idx, item->checksum);
+			}
 		}
 	}
 #endif
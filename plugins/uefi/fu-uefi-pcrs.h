@@ -7,6 +7,7 @@
 #pragma once
 
 #define FU_TYPE_UEFI_PCRS (fu_uefi_pcrs_get_type ())
+#define FU_UEFI_PCRS_MAX	24
 G_DECLARE_FINAL_TYPE (FuUefiPcrs, fu_uefi_pcrs, FU, UEFI_PCRS, GObject)
 
 FuUefiPcrs	*fu_uefi_pcrs_new		(void);
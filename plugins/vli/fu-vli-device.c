@@ -172,33 +172,55 @@ fu_vli_device_spi_write_data (FuVliDevice *self, guint32 addr,
 	return TRUE;
 }
 
+typedef struct {
+	guint32		 cnt;
+	gint64		 last_idle;	/* us */
+} FuVliDeviceSpiWaitHelper;
+
 static gboolean
-fu_vli_device_spi_wait_finish (FuVliDevice *self, GError **error)
+fu_vli_device_spi_wait_finish_cb (FuDevice *device, gpointer user_data, GError **error)
 {
+	FuVliDevice *self = FU_VLI_DEVICE (device);
+	FuVliDeviceSpiWaitHelper *helper = (FuVliDeviceSpiWaitHelper *) user_data;
 	const guint32 rdy_cnt = 2;
-	guint32 cnt = 0;
+	guint8 status = 0x7f;
 
-	for (guint32 idx = 0; idx < 1000; idx++) {
-		guint8 status = 0x7f;
-
-		/* must get bit[1:0] == 0 twice in a row for success */
-		if (!fu_vli_device_spi_read_status (self, &status, error))
-			return FALSE;
-		if ((status & 0x03) == 0x00) {
-			if (cnt++ >= rdy_cnt)
+	/* must get bit[1:0] == 0 twice in a row, 500ms apart, for success */
+	if (!fu_vli_device_spi_read_status (self, &status, error))
+		return FALSE;
+	if ((status & 0x03) == 0x00) {
+		gint64 now = g_get_monotonic_time ();
+		if (helper->cnt == 0 || now - helper->last_idle >= 500 * 1000) {
+			helper->last_idle = now;
+			if (helper->cnt++ >= rdy_cnt)
 				return TRUE;
-		} else {
-			cnt = 0;
 		}
-		g_usleep (500 * 1000);
+	} else {
+		helper->cnt = 0;
 	}
 	g_set_error (error,
 		     G_IO_ERROR,
-		     G_IO_ERROR_FAILED,
-		     "failed to wait for SPI");
+		     G_IO_ERROR_BUSY,
+		     "SPI status 0x%02x", status);
 	return FALSE;
 }
 
+static gboolean
+fu_vli_device_spi_wait_finish (FuVliDevice *self, GError **error)
+{
+	FuVliDeviceSpiWaitHelper helper = { 0 };
+
+	/* no step name: the idle samples have to be spread over 1s anyway, so
+	 * a learned sleep up front would only delay the first sample */
+	if (!fu_device_wait_for_condition (FU_DEVICE (self), NULL,
+					   fu_vli_device_spi_wait_finish_cb,
+					   500 * 1000, &helper, error)) {
+		g_prefix_error (error, "failed to wait for SPI: ");
+		return FALSE;
+	}
+	return TRUE;
+}
+
 gboolean
 fu_vli_device_spi_erase_sector (FuVliDevice *self, guint32 addr, GError **error)
 {
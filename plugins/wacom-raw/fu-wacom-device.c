@@ -280,6 +280,38 @@ fu_wacom_device_get_feature (FuWacomDevice *self,
 	return TRUE;
 }
 
+typedef struct {
+	FuWacomRawRequest	*req;
+	FuWacomRawResponse	*rsp;
+	guint			 cnt;
+} FuWacomDeviceCmdHelper;
+
+static gboolean
+fu_wacom_device_cmd_poll_cb (FuDevice *device, gpointer user_data, GError **error)
+{
+	FuWacomDevice *self = FU_WACOM_DEVICE (device);
+	FuWacomDeviceCmdHelper *helper = (FuWacomDeviceCmdHelper *) user_data;
+
+	if (!fu_wacom_device_get_feature (self, (guint8 *) helper->rsp,
+					  sizeof(*helper->rsp), error))
+		return FALSE;
+	if (!fu_wacom_common_check_reply (helper->req, helper->rsp, error))
+		return FALSE;
+	if (helper->rsp->resp == FU_WACOM_RAW_RC_IN_PROGRESS ||
+	    helper->rsp->resp == FU_WACOM_RAW_RC_BUSY) {
+		/* give up, and let the caller report the busy response */
+		if (++helper->cnt >= FU_WACOM_RAW_CMD_RETRIES)
+			return TRUE;
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_BUSY,
+			     "command 0x%02x still in progress",
+			     helper->req->cmd);
+		return FALSE;
+	}
+	return TRUE;
+}
+
 gboolean
 fu_wacom_device_cmd (FuWacomDevice *self,
 		     FuWacomRawRequest *req, FuWacomRawResponse *rsp,
@@ -306,17 +338,19 @@ fu_wacom_device_cmd (FuWacomDevice *self,
 	/* wait for the command to complete */
 	if (flags & FU_WACOM_DEVICE_CMD_FLAG_POLL_ON_WAITING &&
 	    rsp->resp != FU_WACOM_RAW_RC_OK) {
-		for (guint i = 0; i < FU_WACOM_RAW_CMD_RETRIES; i++) {
-			if (delay_us > 0)
-				g_usleep (delay_us);
-			if (!fu_wacom_device_get_feature (self, (guint8 *)rsp, sizeof(*rsp), error))
-				return FALSE;
-			if (!fu_wacom_common_check_reply (req, rsp, error))
-				return FALSE;
-			if (rsp->resp != FU_WACOM_RAW_RC_IN_PROGRESS &&
-			    rsp->resp != FU_WACOM_RAW_RC_BUSY)
-				break;
-		}
+		FuWacomDeviceCmdHelper helper = {
+			.req = req,
+			.rsp = rsp,
+			.cnt = 0,
+		};
+		g_autofree gchar *step = g_strdup_printf ("cmd-0x%02x", req->cmd);
+
+		/* like before, this is bounded by the number of polls rather
+		 * than by time as each GetFeature takes an unknown duration */
+		if (!fu_device_wait_for_condition (FU_DEVICE (self), step,
+						   fu_wacom_device_cmd_poll_cb,
+						   G_MAXUINT, &helper, error))
+			return FALSE;
 	}
 	return fu_wacom_common_rc_set_error (rsp, error);
 }
@@ -33,6 +33,7 @@ struct _FuConfig
 	GPtrArray		*blocked_firmware;	/* (element-type utf-8) */
 	guint64			 archive_size_max;
 	guint			 idle_timeout;
+	guint			 progress_max_rate;
 	gchar			*config_file;
 	gboolean		 update_motd;
 	gboolean		 enumerate_all_devices;
@@ -52,6 +53,7 @@ fu_config_reload (FuConfig *self, GError **error)
 {
 	guint64 archive_size_max;
 	guint idle_timeout;
+	guint progress_max_rate;
 	g_auto(GStrv) approved_firmware = NULL;
 	g_auto(GStrv) blocked_firmware = NULL;
 	g_auto(GStrv) devices = NULL;
@@ -60,6 +62,7 @@ fu_config_reload (FuConfig *self, GError **error)
 	g_autoptr(GKeyFile) keyfile = g_key_file_new ();
 	g_autoptr(GError) error_update_motd = NULL;
 	g_autoptr(GError) error_enumerate_all = NULL;
+	g_autoptr(GError) error_progress_max_rate = NULL;
 
 	g_debug ("loading config values from %s", self->config_file);
 	if (!g_key_file_load_from_file (keyfile, self->config_file,
@@ -138,6 +141,14 @@ fu_config_reload (FuConfig *self, GError **error)
 	if (idle_timeout > 0)
 		self->idle_timeout = idle_timeout;
 
+	/* get the maximum progress update rate, where 0 is unlimited */
+	progress_max_rate = g_key_file_get_uint64 (keyfile,
+						   "fwupd",
+						   "ProgressMaxRate",
+						   &error_progress_max_rate);
+	if (error_progress_max_rate == NULL)
+		self->progress_max_rate = progress_max_rate;
+
 	/* get the domains to run in verbose */
 	domains = g_key_file_get_string (keyfile,
 					 "fwupd",
@@ -236,6 +247,13 @@ fu_config_get_idle_timeout (FuConfig *self)
 	return self->idle_timeout;
 }
 
+guint
+fu_config_get_progress_max_rate (FuConfig *self)
+{
+	g_return_val_if_fail (FU_IS_CONFIG (self), 0);
+	return self->progress_max_rate;
+}
+
 GPtrArray *
 fu_config_get_disabled_devices (FuConfig *self)
 {
@@ -302,6 +320,7 @@ static void
 fu_config_init (FuConfig *self)
 {
 	self->archive_size_max = 512 * 0x100000;
+	self->progress_max_rate = 10;
 	self->disabled_devices = g_ptr_array_new_with_free_func (g_free);
 	self->disabled_plugins = g_ptr_array_new_with_free_func (g_free);
 	self->approved_firmware = g_ptr_array_new_with_free_func (g_free);
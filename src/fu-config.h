@@ -23,6 +23,7 @@ gboolean	 fu_config_set_key_value		(FuConfig	*self,
 
 guint64		 fu_config_get_archive_size_max		(FuConfig	*self);
 guint		 fu_config_get_idle_timeout		(FuConfig	*self);
+guint		 fu_config_get_progress_max_rate	(FuConfig	*self);
 GPtrArray	*fu_config_get_disabled_devices		(FuConfig	*self);
 GPtrArray	*fu_config_get_disabled_plugins		(FuConfig	*self);
 GPtrArray	*fu_config_get_approved_firmware	(FuConfig	*self);
@@ -38,8 +38,7 @@ struct _FuDeviceList
 	GObject			 parent_instance;
 	GPtrArray		*devices;	/* of FuDeviceItem */
 	GRWLock			 devices_mutex;
-	GMainLoop		*replug_loop;	/* block waiting for replug */
-	guint			 replug_id;	/* timeout the loop */
+	GPtrArray		*waiters;	/* of FuDeviceListWaiter */
 };
 
 enum {
@@ -58,6 +57,15 @@ typedef struct {
 	guint			 remove_id;
 } FuDeviceItem;
 
+typedef struct {
+	FuDeviceList		*self;		/* no ref */
+	FuDevice		*device;
+	GTask			*task;
+	GCancellable		*cancellable;
+	gulong			 cancellable_id;
+	guint			 timeout_id;
+} FuDeviceListWaiter;
+
 G_DEFINE_TYPE (FuDeviceList, fu_device_list, G_TYPE_OBJECT)
 
 static void
@@ -567,19 +575,54 @@ fu_device_list_item_set_device (FuDeviceItem *item, FuDevice *device)
 	g_set_object (&item->device, device);
 }
 
-static gboolean
-fu_device_list_replug_loop_quit_cb (gpointer user_data)
+static void
+fu_device_list_waiter_free (FuDeviceListWaiter *waiter)
 {
-	FuDeviceList *self = FU_DEVICE_LIST (user_data);
-	g_debug ("quitting replug loop");
-	g_main_loop_quit (self->replug_loop);
-	return G_SOURCE_REMOVE;
+	if (waiter->timeout_id != 0)
+		g_source_remove (waiter->timeout_id);
+	if (waiter->cancellable != NULL) {
+		g_cancellable_disconnect (waiter->cancellable, waiter->cancellable_id);
+		g_object_unref (waiter->cancellable);
+	}
+	if (waiter->task != NULL)
+		g_object_unref (waiter->task);
+	g_object_unref (waiter->device);
+	g_free (waiter);
+}
+
+/* takes ownership of @error */
+static void
+fu_device_list_waiter_complete (FuDeviceListWaiter *waiter, GError *error)
+{
+	FuDeviceList *self = waiter->self;
+	g_autoptr(GTask) task = g_steal_pointer (&waiter->task);
+
+	g_ptr_array_remove (self->waiters, waiter);
+	fu_device_list_waiter_free (waiter);
+	if (error != NULL) {
+		g_task_return_error (task, error);
+		return;
+	}
+	g_task_return_boolean (task, TRUE);
+}
+
+static void
+fu_device_list_waiters_complete_for_device (FuDeviceList *self, FuDevice *device)
+{
+	for (guint i = self->waiters->len; i > 0; i--) {
+		FuDeviceListWaiter *waiter = g_ptr_array_index (self->waiters, i - 1);
+		if (waiter->device != device)
+			continue;
+		g_debug ("%s replugged", fu_device_get_id (device));
+		fu_device_list_waiter_complete (waiter, NULL);
+	}
 }
 
 static void
 fu_device_list_replace (FuDeviceList *self, FuDeviceItem *item, FuDevice *device)
 {
 	const gchar *custom_flags;
+	g_autoptr(GHashTable) wait_profile = NULL;
 
 	/* clear timeout if scheduled */
 	if (item->remove_id != 0) {
@@ -598,6 +641,14 @@ fu_device_list_replace (FuDeviceList *self, FuDeviceItem *item, FuDevice *device
 		fu_device_set_vendor_id (device, vendor_id);
 	}
 
+	/* keep recording or replaying across the replug */
+	if (fu_device_get_transport_trace (item->device) != NULL &&
+	    fu_device_get_transport_trace (device) == NULL) {
+		g_debug ("copying transport trace to new device");
+		fu_device_set_transport_trace (device,
+					       fu_device_get_transport_trace (item->device));
+	}
+
 	/* copy over custom flags */
 	custom_flags = fu_device_get_custom_flags (item->device);
 	if (custom_flags != NULL) {
@@ -635,6 +686,11 @@ fu_device_list_replace (FuDeviceList *self, FuDeviceItem *item, FuDevice *device
 		fu_device_add_flag (device, FWUPD_DEVICE_FLAG_WILL_DISAPPEAR);
 	}
 
+	/* copy over the learned completion timings */
+	wait_profile = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	fu_device_wait_profile_to_metadata (item->device, wait_profile);
+	fu_device_wait_profile_from_metadata (device, wait_profile);
+
 	/* copy the parent if not already set */
 	if (fu_device_get_parent (item->device) != NULL &&
 	    fu_device_get_parent (item->device) != device &&
@@ -652,10 +708,9 @@ fu_device_list_replace (FuDeviceList *self, FuDeviceItem *item, FuDevice *device
 
 	/* we were waiting for this... */
 	if (fu_device_has_flag (item->device_old, FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG) &&
-	    g_main_loop_is_running (self->replug_loop)) {
-		g_debug ("schedule quit replug loop in idle");
+	    self->waiters->len > 0) {
 		fu_device_remove_flag (item->device_old, FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG);
-		g_idle_add (fu_device_list_replug_loop_quit_cb, self);
+		fu_device_list_waiters_complete_for_device (self, item->device_old);
 	}
 }
 
@@ -819,66 +874,108 @@ fu_device_list_get_by_guid (FuDeviceList *self, const gchar *guid, GError **erro
 }
 
 static gboolean
-fu_device_list_replug_cb (gpointer user_data)
+fu_device_list_waiter_timeout_cb (gpointer user_data)
 {
-	FuDeviceList *self = FU_DEVICE_LIST (user_data);
+	FuDeviceListWaiter *waiter = (FuDeviceListWaiter *) user_data;
+	FuDeviceItem *item;
 
 	/* no longer valid */
-	self->replug_id = 0;
+	waiter->timeout_id = 0;
+
+	/* device was not added back to the device list */
+	item = fu_device_list_find_by_device (waiter->self, waiter->device);
+	if (item == NULL ||
+	    fu_device_has_flag (item->device, FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG)) {
+		g_debug ("device did not replug");
+		if (item != NULL)
+			fu_device_remove_flag (item->device, FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG);
+		fu_device_list_waiter_complete (waiter,
+						g_error_new (FWUPD_ERROR,
+							     FWUPD_ERROR_NOT_FOUND,
+							     "device %s did not come back",
+							     fu_device_get_id (waiter->device)));
+		return G_SOURCE_REMOVE;
+	}
 
-	/* quit loop */
-	g_debug ("device did not replug");
-	g_main_loop_quit (self->replug_loop);
-	return FALSE;
+	/* the flag was cleared some other way */
+	fu_device_list_waiter_complete (waiter, NULL);
+	return G_SOURCE_REMOVE;
+}
+
+static gboolean
+fu_device_list_waiter_cancelled_idle_cb (gpointer user_data)
+{
+	FuDeviceListWaiter *waiter = (FuDeviceListWaiter *) user_data;
+	waiter->timeout_id = 0;
+	fu_device_list_waiter_complete (waiter,
+					g_error_new_literal (G_IO_ERROR,
+							     G_IO_ERROR_CANCELLED,
+							     "cancelled waiting for replug"));
+	return G_SOURCE_REMOVE;
+}
+
+static void
+fu_device_list_waiter_cancelled_cb (GCancellable *cancellable, FuDeviceListWaiter *waiter)
+{
+	/* cannot disconnect from inside the handler */
+	if (waiter->timeout_id != 0)
+		g_source_remove (waiter->timeout_id);
+	waiter->timeout_id = g_idle_add (fu_device_list_waiter_cancelled_idle_cb, waiter);
 }
 
 /**
- * fu_device_list_wait_for_replug:
+ * fu_device_list_wait_for_replug_async:
  * @self: A #FuDeviceList
  * @device: A #FuDevice
- * @error: A #GError, or %NULL
+ * @cancellable: (nullable): optional #GCancellable
+ * @callback: the function to run on completion
+ * @user_data: the data to pass to @callback
  *
  * Waits for a specific device to replug if %FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG
- * is set.
+ * is set, using the remove delay of the device as the deadline.
  *
- * If the device does not exist this function returns without an error.
+ * Any number of devices can be waited for at the same time.
  *
- * Returns: %TRUE for success
- *
- * Since: 1.1.2
+ * Since: 1.5.0
  **/
-gboolean
-fu_device_list_wait_for_replug (FuDeviceList *self, FuDevice *device, GError **error)
+void
+fu_device_list_wait_for_replug_async (FuDeviceList *self,
+				      FuDevice *device,
+				      GCancellable *cancellable,
+				      GAsyncReadyCallback callback,
+				      gpointer user_data)
 {
 	FuDeviceItem *item;
+	FuDeviceListWaiter *waiter;
 	guint remove_delay;
+	g_autoptr(GTask) task = NULL;
 
-	g_return_val_if_fail (FU_IS_DEVICE_LIST (self), FALSE);
-	g_return_val_if_fail (FU_IS_DEVICE (device), FALSE);
-	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
-	g_return_val_if_fail (self->replug_id == 0, FALSE);
+	g_return_if_fail (FU_IS_DEVICE_LIST (self));
+	g_return_if_fail (FU_IS_DEVICE (device));
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+	task = g_task_new (self, cancellable, callback, user_data);
 
 	/* not found */
 	item = fu_device_list_find_by_device (self, device);
-	if (item == NULL)
-		return TRUE;
+	if (item == NULL) {
+		g_task_return_boolean (task, TRUE);
+		return;
+	}
 
 	/* not required, or possibly literally just happened */
 	if (!fu_device_has_flag (item->device, FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG)) {
 		g_debug ("no replug or re-enumerate required");
-		return TRUE;
+		g_task_return_boolean (task, TRUE);
+		return;
 	}
 
-	/* check that no other devices are waiting for replug too */
-	for (guint i = 0; i < self->devices->len; i++) {
-		FuDeviceItem *item_tmp = g_ptr_array_index (self->devices, i);
-		if (item_tmp->device != device &&
-		    fu_device_has_flag (item_tmp->device, FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG)) {
-			g_warning ("%s is wait-for-replug when %s scheduled, unsetting",
-				   fu_device_get_id (item_tmp->device),
-				   fu_device_get_id (device));
-			fu_device_remove_flag (item_tmp->device, FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG);
-		}
+	/* nothing is going to be unplugged, so pretend it just happened */
+	if (fu_device_is_replay (item->device)) {
+		g_debug ("simulating replug of %s", fu_device_get_id (item->device));
+		fu_device_remove_flag (item->device, FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG);
+		g_task_return_boolean (task, TRUE);
+		return;
 	}
 
 	/* plugin did not specify */
@@ -891,42 +988,95 @@ fu_device_list_wait_for_replug (FuDeviceList *self, FuDevice *device, GError **e
 			   fu_device_get_id (device),
 			   remove_delay);
 	} else {
-		g_debug ("waiting %ums for replug", remove_delay);
+		g_debug ("waiting %ums for %s to replug",
+			 remove_delay, fu_device_get_id (device));
 	}
 
 	/* time to unplug and then re-plug */
-	self->replug_id = g_timeout_add (remove_delay, fu_device_list_replug_cb, self);
-	g_main_loop_run (self->replug_loop);
-
-	/* cancel timeout if still pending */
-	if (self->replug_id != 0) {
-		g_source_remove (self->replug_id);
-		self->replug_id = 0;
+	waiter = g_new0 (FuDeviceListWaiter, 1);
+	waiter->self = self;
+	waiter->device = g_object_ref (item->device);
+	waiter->task = g_steal_pointer (&task);
+	waiter->timeout_id = g_timeout_add (remove_delay,
+					    fu_device_list_waiter_timeout_cb,
+					    waiter);
+	if (cancellable != NULL) {
+		waiter->cancellable = g_object_ref (cancellable);
+		waiter->cancellable_id = g_cancellable_connect (cancellable,
+								G_CALLBACK (fu_device_list_waiter_cancelled_cb),
+								waiter, NULL);
 	}
+	g_ptr_array_add (self->waiters, waiter);
+}
 
-	/* device was not added back to the device list */
-	if (fu_device_has_flag (item->device, FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG)) {
-		g_set_error (error,
-			     FWUPD_ERROR,
-			     FWUPD_ERROR_NOT_FOUND,
-			     "device %s did not come back",
-			     fu_device_get_id (device));
-		fu_device_remove_flag (item->device, FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG);
-		return FALSE;
-	}
+/**
+ * fu_device_list_wait_for_replug_finish:
+ * @self: A #FuDeviceList
+ * @res: the #GAsyncResult
+ * @error: A #GError, or %NULL
+ *
+ * Gets the result of fu_device_list_wait_for_replug_async().
+ *
+ * Returns: %TRUE if the device came back, or did not need to replug
+ *
+ * Since: 1.5.0
+ **/
+gboolean
+fu_device_list_wait_for_replug_finish (FuDeviceList *self, GAsyncResult *res, GError **error)
+{
+	g_return_val_if_fail (FU_IS_DEVICE_LIST (self), FALSE);
+	g_return_val_if_fail (g_task_is_valid (res, self), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+	return g_task_propagate_boolean (G_TASK (res), error);
+}
 
-	/* check that no other devices are waiting for replug instead */
-	for (guint i = 0; i < self->devices->len; i++) {
-		FuDeviceItem *item_tmp = g_ptr_array_index (self->devices, i);
-		if (fu_device_has_flag (item_tmp->device, FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG)) {
-			g_warning ("%s is wait-for-replug when %s performed",
-				   fu_device_get_id (item_tmp->device),
-				   fu_device_get_id (device));
-		}
-	}
+typedef struct {
+	GMainLoop		*loop;
+	GError			*error;
+} FuDeviceListWaitHelper;
 
-	/* the loop was quit without the timer */
-	g_debug ("waited for replug");
+static void
+fu_device_list_wait_for_replug_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	FuDeviceListWaitHelper *helper = (FuDeviceListWaitHelper *) user_data;
+	fu_device_list_wait_for_replug_finish (FU_DEVICE_LIST (source), res, &helper->error);
+	g_main_loop_quit (helper->loop);
+}
+
+/**
+ * fu_device_list_wait_for_replug:
+ * @self: A #FuDeviceList
+ * @device: A #FuDevice
+ * @error: A #GError, or %NULL
+ *
+ * Waits for a specific device to replug if %FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG
+ * is set.
+ *
+ * If the device does not exist this function returns without an error.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.1.2
+ **/
+gboolean
+fu_device_list_wait_for_replug (FuDeviceList *self, FuDevice *device, GError **error)
+{
+	FuDeviceListWaitHelper helper = { NULL };
+
+	g_return_val_if_fail (FU_IS_DEVICE_LIST (self), FALSE);
+	g_return_val_if_fail (FU_IS_DEVICE (device), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	helper.loop = g_main_loop_new (NULL, FALSE);
+	fu_device_list_wait_for_replug_async (self, device, NULL,
+					      fu_device_list_wait_for_replug_cb,
+					      &helper);
+	g_main_loop_run (helper.loop);
+	g_main_loop_unref (helper.loop);
+	if (helper.error != NULL) {
+		g_propagate_error (error, helper.error);
+		return FALSE;
+	}
 	return TRUE;
 }
 
@@ -1016,7 +1166,7 @@ static void
 fu_device_list_init (FuDeviceList *self)
 {
 	self->devices = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_device_list_item_free);
-	self->replug_loop = g_main_loop_new (NULL, FALSE);
+	self->waiters = g_ptr_array_new ();
 	g_rw_lock_init (&self->devices_mutex);
 }
 
@@ -1027,10 +1177,12 @@ fu_device_list_finalize (GObject *obj)
 
 	g_rw_lock_clear (&self->devices_mutex);
 
-	if (self->replug_id != 0)
-		g_source_remove (self->replug_id);
+	for (guint i = 0; i < self->waiters->len; i++) {
+		FuDeviceListWaiter *waiter = g_ptr_array_index (self->waiters, i);
+		fu_device_list_waiter_free (waiter);
+	}
+	g_ptr_array_unref (self->waiters);
 	g_ptr_array_unref (self->devices);
-	g_main_loop_unref (self->replug_loop);
 
 	G_OBJECT_CLASS (fu_device_list_parent_class)->finalize (obj);
 }
@@ -31,5 +31,13 @@ FuDevice	*fu_device_list_get_by_guid		(FuDeviceList	*self,
 gboolean	 fu_device_list_wait_for_replug		(FuDeviceList	*self,
 							 FuDevice	*device,
 							 GError		**error);
+void		 fu_device_list_wait_for_replug_async	(FuDeviceList	*self,
+							 FuDevice	*device,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 user_data);
+gboolean	 fu_device_list_wait_for_replug_finish	(FuDeviceList	*self,
+							 GAsyncResult	*res,
+							 GError		**error);
 void		 fu_device_list_depsolve_order		(FuDeviceList	*self,
 							 FuDevice	*device);
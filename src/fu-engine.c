@@ -23,6 +23,7 @@
 #include <errno.h>
 
 #include "fwupd-common-private.h"
+#include "fwupd-device-private.h"
 #include "fwupd-enums-private.h"
 #include "fwupd-error.h"
 #include "fwupd-release-private.h"
@@ -41,6 +42,7 @@
 #include "fu-engine-request.h"
 #include "fu-hwids.h"
 #include "fu-idle.h"
+#include "fu-jcat-cache.h"
 #include "fu-keyring-utils.h"
 #include "fu-hash.h"
 #include "fu-history.h"
@@ -55,21 +57,21 @@
 #include "fu-smbios-private.h"
 #include "fu-udev-device-private.h"
 #include "fu-usb-device-private.h"
+#include "fu-version-key.h"
 
 #include "fu-dfu-firmware.h"
 #include "fu-fmap-firmware.h"
 #include "fu-ihex-firmware.h"
 #include "fu-srec-firmware.h"
 
-/* only needed until we hard depend on jcat 0.1.3 */
-#include <libjcat/jcat-version.h>
-
 #ifdef HAVE_SYSTEMD
 #include "fu-systemd.h"
 #endif
 
 static void fu_engine_finalize	 (GObject *obj);
 static void fu_engine_ensure_security_attrs	(FuEngine *self);
+static void fu_engine_save_wait_profile	(FuEngine *self,
+					 FuDevice *device);
 
 struct _FuEngine
 {
@@ -85,12 +87,21 @@ struct _FuEngine
 	FwupdStatus		 status;
 	gboolean		 tainted;
 	guint			 percentage;
+	gint64			 percentage_emitted;	/* monotonic time in µs */
+	guint			 percentage_id;
+	GPtrArray		*percentage_devices;	/* of FuDevice, pending emit */
+	GOutputStream		*progress_stream;	/* (nullable) */
 	FuHistory		*history;
 	FuIdle			*idle;
 	XbSilo			*silo;
+	GHashTable		*checksum_remote_ids;	/* (nullable): csum:remote-id */
 	gboolean		 coldplug_running;
 	guint			 coldplug_id;
 	guint			 coldplug_delay;
+	guint			 enumerate_id;
+	guint			 enumerate_step;
+	guint			 enumerate_idx;
+	GPtrArray		*snapshot_devices;	/* (nullable) (element-type FuDevice) */
 	FuPluginList		*plugin_list;
 	GPtrArray		*plugin_filter;
 	GPtrArray		*udev_subsystems;
@@ -99,6 +110,7 @@ struct _FuEngine
 #endif
 	FuSmbios		*smbios;
 	FuHwids			*hwids;
+	FuMsrSnapshot		*msr_snapshot;
 	FuQuirks		*quirks;
 	GHashTable		*runtime_versions;
 	GHashTable		*compile_versions;
@@ -107,11 +119,30 @@ struct _FuEngine
 	GHashTable		*firmware_gtypes;
 	gchar			*host_machine_id;
 	JcatContext		*jcat_context;
+	FuJcatCache		*jcat_cache;
 	gboolean		 loaded;
 	gchar			*host_security_id;
 	FuSecurityAttrs		*host_security_attrs;
+	GHashTable		*security_attrs_plugin;	/* plugin-name:FuSecurityAttrs */
+	guint64			 generation;
+	GHashTable		*releases_cache;	/* device-state:FuEngineReleasesItem */
+#if LIBXMLB_CHECK_VERSION(0,2,0)
+	XbQuery			*query_releases;	/* (nullable) */
+#endif
 };
 
+typedef enum {
+	FU_ENGINE_ENUMERATE_STEP_PREPARE,
+	FU_ENGINE_ENUMERATE_STEP_COLDPLUG,
+	FU_ENGINE_ENUMERATE_STEP_USB,
+	FU_ENGINE_ENUMERATE_STEP_UDEV,
+} FuEngineEnumerateStep;
+
+typedef struct {
+	GPtrArray		*releases;		/* (nullable) (element-type FwupdRelease) */
+	GError			*error;			/* (nullable) */
+} FuEngineReleasesItem;
+
 enum {
 	SIGNAL_CHANGED,
 	SIGNAL_DEVICE_ADDED,
@@ -124,11 +155,41 @@ enum {
 
 static guint signals[SIGNAL_LAST] = { 0 };
 
+static void
+fu_engine_releases_item_free (FuEngineReleasesItem *item)
+{
+	if (item->releases != NULL)
+		g_ptr_array_unref (item->releases);
+	if (item->error != NULL)
+		g_error_free (item->error);
+	g_free (item);
+}
+
+/* called when anything the devices or releases depend on has changed */
+static void
+fu_engine_invalidate (FuEngine *self)
+{
+	g_hash_table_remove_all (self->releases_cache);
+	self->generation++;
+}
+
+/* drop the cached attributes for one plugin, or for all plugins if %NULL */
+static void
+fu_engine_invalidate_security_attrs (FuEngine *self, const gchar *plugin_name)
+{
+	if (plugin_name != NULL)
+		g_hash_table_remove (self->security_attrs_plugin, plugin_name);
+	else
+		g_hash_table_remove_all (self->security_attrs_plugin);
+	g_clear_pointer (&self->host_security_id, g_free);
+}
+
 G_DEFINE_TYPE (FuEngine, fu_engine, G_TYPE_OBJECT)
 
 static void
 fu_engine_emit_changed (FuEngine *self)
 {
+	fu_engine_invalidate (self);
 	g_signal_emit (self, signals[SIGNAL_CHANGED], 0);
 	fu_engine_idle_reset (self);
 
@@ -145,8 +206,9 @@ fu_engine_emit_changed (FuEngine *self)
 static void
 fu_engine_emit_device_changed (FuEngine *self, FuDevice *device)
 {
-	/* invalidate host security attributes */
-	g_clear_pointer (&self->host_security_id, g_free);
+	/* invalidate host security attributes and cached releases */
+	fu_engine_invalidate_security_attrs (self, fu_device_get_plugin (device));
+	fu_engine_invalidate (self);
 	g_signal_emit (self, signals[SIGNAL_DEVICE_CHANGED], 0, device);
 }
 
@@ -223,21 +285,141 @@ fu_engine_set_percentage (FuEngine *self, guint percentage)
 }
 
 static void
-fu_engine_progress_notify_cb (FuDevice *device, GParamSpec *pspec, FuEngine *self)
+fu_engine_progress_stream_write (FuEngine *self, FuDevice *device)
 {
-	if (fu_device_get_status (device) == FWUPD_STATUS_UNKNOWN)
+	g_autofree gchar *str = NULL;
+	g_autoptr(GError) error_local = NULL;
+
+	if (self->progress_stream == NULL)
 		return;
+
+	/* never block the update on a slow reader, just drop the line */
+	str = g_strdup_printf ("%s %s %u\n",
+			       fu_device_get_id (device),
+			       fwupd_status_to_string (fu_device_get_status (device)),
+			       fu_device_get_progress (device));
+	if (g_pollable_output_stream_write_nonblocking (G_POLLABLE_OUTPUT_STREAM (self->progress_stream),
+							str, strlen (str),
+							NULL, &error_local) < 0) {
+		if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK))
+			return;
+		g_debug ("failed to write progress, closing: %s", error_local->message);
+		g_clear_object (&self->progress_stream);
+	}
+}
+
+static void
+fu_engine_emit_percentage (FuEngine *self, FuDevice *device)
+{
+	self->percentage_emitted = g_get_monotonic_time ();
 	fu_engine_set_percentage (self, fu_device_get_progress (device));
 	fu_engine_emit_device_changed (self, device);
 }
 
+/* send any progress held back by the rate limit, for every device */
+static void
+fu_engine_flush_percentage (FuEngine *self)
+{
+	g_autoptr(GPtrArray) devices = NULL;
+	if (self->percentage_id != 0) {
+		g_source_remove (self->percentage_id);
+		self->percentage_id = 0;
+	}
+	if (self->percentage_devices->len == 0)
+		return;
+	devices = g_steal_pointer (&self->percentage_devices);
+	self->percentage_devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	for (guint i = 0; i < devices->len; i++) {
+		FuDevice *device = g_ptr_array_index (devices, i);
+		fu_engine_emit_percentage (self, device);
+	}
+}
+
+/* the most recent last, so that it sets the Percentage property */
+static void
+fu_engine_add_percentage_device (FuEngine *self, FuDevice *device)
+{
+	g_ptr_array_add (self->percentage_devices, g_object_ref (device));
+	for (guint i = 0; i < self->percentage_devices->len - 1; i++) {
+		if (g_ptr_array_index (self->percentage_devices, i) == device) {
+			g_ptr_array_remove_index (self->percentage_devices, i);
+			break;
+		}
+	}
+}
+
+static gboolean
+fu_engine_emit_percentage_cb (gpointer user_data)
+{
+	FuEngine *self = FU_ENGINE (user_data);
+	self->percentage_id = 0;
+	fu_engine_flush_percentage (self);
+	return G_SOURCE_REMOVE;
+}
+
+static void
+fu_engine_progress_notify_cb (FuDevice *device, GParamSpec *pspec, FuEngine *self)
+{
+	guint progress = fu_device_get_progress (device);
+	guint rate = fu_config_get_progress_max_rate (self->config);
+	gint64 interval;
+	gint64 elapsed;
+
+	if (fu_device_get_status (device) == FWUPD_STATUS_UNKNOWN)
+		return;
+	fu_engine_progress_stream_write (self, device);
+
+	/* always emit the start and end of each phase */
+	if (rate == 0 || progress == 0 || progress == 100) {
+		g_ptr_array_remove (self->percentage_devices, device);
+		fu_engine_emit_percentage (self, device);
+		return;
+	}
+
+	/* the install may not return to the mainloop for some time, so send
+	 * straight away if allowed and only use the timeout for the trailing
+	 * values; every device gets its own DeviceChanged */
+	interval = G_USEC_PER_SEC / rate;
+	elapsed = g_get_monotonic_time () - self->percentage_emitted;
+	if (elapsed >= interval) {
+		fu_engine_add_percentage_device (self, device);
+		fu_engine_flush_percentage (self);
+		return;
+	}
+	fu_engine_add_percentage_device (self, device);
+	if (self->percentage_id == 0) {
+		self->percentage_id = g_timeout_add ((interval - elapsed) / 1000 + 1,
+						     fu_engine_emit_percentage_cb,
+						     self);
+	}
+}
+
 static void
 fu_engine_status_notify_cb (FuDevice *device, GParamSpec *pspec, FuEngine *self)
 {
+	fu_engine_flush_percentage (self);
+	fu_engine_progress_stream_write (self, device);
 	fu_engine_set_status (self, fu_device_get_status (device));
 	fu_engine_emit_device_changed (self, device);
 }
 
+/**
+ * fu_engine_set_progress_stream:
+ * @self: A #FuEngine
+ * @stream: (nullable): A #GPollableOutputStream, or %NULL
+ *
+ * Sets a stream that receives every progress and status change without any
+ * rate limiting, as lines of `device-id status percentage`. Lines are dropped
+ * rather than blocking the update if the reader falls behind.
+ **/
+void
+fu_engine_set_progress_stream (FuEngine *self, GOutputStream *stream)
+{
+	g_return_if_fail (FU_IS_ENGINE (self));
+	g_return_if_fail (stream == NULL || G_IS_POLLABLE_OUTPUT_STREAM (stream));
+	g_set_object (&self->progress_stream, stream);
+}
+
 static void
 fu_engine_watch_device (FuEngine *self, FuDevice *device)
 {
@@ -256,10 +438,31 @@ fu_engine_watch_device (FuEngine *self, FuDevice *device)
 			  G_CALLBACK (fu_engine_status_notify_cb), self);
 }
 
+/* clients were already told about devices in the snapshot */
+static gboolean
+fu_engine_snapshot_has_device (FuEngine *self, FuDevice *device)
+{
+	if (self->snapshot_devices == NULL)
+		return FALSE;
+	for (guint i = 0; i < self->snapshot_devices->len; i++) {
+		FuDevice *device_tmp = g_ptr_array_index (self->snapshot_devices, i);
+		if (g_strcmp0 (fu_device_get_id (device_tmp),
+			       fu_device_get_id (device)) == 0)
+			return TRUE;
+	}
+	return FALSE;
+}
+
 static void
 fu_engine_device_added_cb (FuDeviceList *device_list, FuDevice *device, FuEngine *self)
 {
+	fu_engine_invalidate (self);
+	fu_engine_invalidate_security_attrs (self, NULL);
 	fu_engine_watch_device (self, device);
+	if (fu_engine_snapshot_has_device (self, device)) {
+		g_signal_emit (self, signals[SIGNAL_DEVICE_CHANGED], 0, device);
+		return;
+	}
 	g_signal_emit (self, signals[SIGNAL_DEVICE_ADDED], 0, device);
 }
 
@@ -276,6 +479,8 @@ fu_engine_device_runner_device_removed (FuEngine *self, FuDevice *device)
 static void
 fu_engine_device_removed_cb (FuDeviceList *device_list, FuDevice *device, FuEngine *self)
 {
+	fu_engine_invalidate (self);
+	fu_engine_invalidate_security_attrs (self, NULL);
 	fu_engine_device_runner_device_removed (self, device);
 	g_signal_handlers_disconnect_by_data (device, self);
 	g_signal_emit (self, signals[SIGNAL_DEVICE_REMOVED], 0, device);
@@ -468,20 +673,54 @@ fu_engine_set_release_from_appstream (FuEngine *self,
 	return TRUE;
 }
 
+/* index every container checksum in the silo, keeping the first remote
+ * when the same firmware is in more than one */
+static GHashTable *
+fu_engine_build_checksum_remote_ids (FuEngine *self)
+{
+	GHashTable *hash = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	g_autoptr(GPtrArray) stores = NULL;
+
+	if (self->silo == NULL)
+		return hash;
+	stores = xb_silo_query (self->silo, "components", 0, NULL);
+	if (stores == NULL)
+		return hash;
+	for (guint i = 0; i < stores->len; i++) {
+		XbNode *store = g_ptr_array_index (stores, i);
+		const gchar *remote_id;
+		g_autoptr(GPtrArray) csums = NULL;
+
+		remote_id = xb_node_query_text (store, "custom/value[@key='fwupd::RemoteId']", NULL);
+		if (remote_id == NULL)
+			continue;
+		csums = xb_node_query (store,
+				       "component/releases/release/checksum[@target='container']",
+				       0, NULL);
+		if (csums == NULL)
+			continue;
+		for (guint j = 0; j < csums->len; j++) {
+			XbNode *csum = g_ptr_array_index (csums, j);
+			const gchar *tmp = xb_node_get_text (csum);
+			if (tmp == NULL || g_hash_table_contains (hash, tmp))
+				continue;
+			g_hash_table_insert (hash, g_strdup (tmp), g_strdup (remote_id));
+		}
+	}
+	g_debug ("indexed %u container checksums", g_hash_table_size (hash));
+	return hash;
+}
+
 /* finds the remote-id for the first firmware in the silo that matches this
  * container checksum */
 static const gchar *
 fu_engine_get_remote_id_for_checksum (FuEngine *self, const gchar *csum)
 {
-	g_autofree gchar *xpath = NULL;
-	g_autoptr(XbNode) key = NULL;
-	xpath = g_strdup_printf ("components/component/releases/release/"
-				 "checksum[@target='container'][text()='%s']/../../"
-				 "../../custom/value[@key='fwupd::RemoteId']", csum);
-	key = xb_silo_query_first (self->silo, xpath, NULL);
-	if (key == NULL)
+	if (csum == NULL)
 		return NULL;
-	return xb_node_get_text (key);
+	if (self->checksum_remote_ids == NULL)
+		self->checksum_remote_ids = fu_engine_build_checksum_remote_ids (self);
+	return g_hash_table_lookup (self->checksum_remote_ids, csum);
 }
 
 /**
@@ -535,6 +774,7 @@ fu_engine_modify_config (FuEngine *self, const gchar *key, const gchar *value, G
 		"BlockedFirmware",
 		"DisabledPlugins",
 		"IdleTimeout",
+		"ProgressMaxRate",
 		"VerboseDomains",
 		"UpdateMotd",
 		"EnumerateAllDevices",
@@ -1047,45 +1287,231 @@ fu_engine_verify (FuEngine *self, const gchar *device_id, GError **error)
 	return TRUE;
 }
 
+typedef enum {
+	FU_ENGINE_REQUIREMENT_KIND_UNKNOWN,
+	FU_ENGINE_REQUIREMENT_KIND_ID,
+	FU_ENGINE_REQUIREMENT_KIND_FIRMWARE,
+	FU_ENGINE_REQUIREMENT_KIND_HARDWARE,
+	FU_ENGINE_REQUIREMENT_KIND_CLIENT,
+} FuEngineRequirementKind;
+
+typedef enum {
+	FU_ENGINE_REQUIREMENT_TARGET_UNKNOWN,
+	FU_ENGINE_REQUIREMENT_TARGET_VERSION,
+	FU_ENGINE_REQUIREMENT_TARGET_BOOTLOADER,
+	FU_ENGINE_REQUIREMENT_TARGET_VENDOR_ID,
+	FU_ENGINE_REQUIREMENT_TARGET_NOT_CHILD,
+	FU_ENGINE_REQUIREMENT_TARGET_GUID,
+} FuEngineRequirementTarget;
+
+typedef enum {
+	FU_ENGINE_COMPARE_NONE,
+	FU_ENGINE_COMPARE_UNKNOWN,
+	FU_ENGINE_COMPARE_EQ,
+	FU_ENGINE_COMPARE_NE,
+	FU_ENGINE_COMPARE_LT,
+	FU_ENGINE_COMPARE_GT,
+	FU_ENGINE_COMPARE_LE,
+	FU_ENGINE_COMPARE_GE,
+	FU_ENGINE_COMPARE_GLOB,
+	FU_ENGINE_COMPARE_REGEX,
+} FuEngineCompare;
+
+/* one <requires> child, parsed once per silo */
+typedef struct {
+	FuEngineRequirementKind	 kind;
+	FuEngineRequirementTarget target;
+	FuEngineCompare		 compare;
+	gchar			*element;
+	gchar			*compare_str;		/* (nullable) */
+	gchar			*version;		/* (nullable) */
+	gchar			*text;			/* (nullable) */
+	guint64			 depth;
+	gchar			**values;		/* (nullable): split on '|' */
+	FwupdFeatureFlags	*feature_flags;		/* (nullable): one per value */
+	GRegex			*regex;			/* (nullable) */
+	FuVersionKey		*version_keys[FWUPD_VERSION_FORMAT_LAST]; /* (nullable) */
+} FuEngineRequirement;
+
+static void
+fu_engine_requirement_free (FuEngineRequirement *req)
+{
+	if (req->regex != NULL)
+		g_regex_unref (req->regex);
+	for (guint i = 0; i < FWUPD_VERSION_FORMAT_LAST; i++)
+		fu_version_key_free (req->version_keys[i]);
+	g_free (req->element);
+	g_free (req->compare_str);
+	g_free (req->version);
+	g_free (req->text);
+	g_free (req->feature_flags);
+	g_strfreev (req->values);
+	g_free (req);
+}
+
+static FuEngineCompare
+fu_engine_compare_from_string (const gchar *compare)
+{
+	if (compare == NULL)
+		return FU_ENGINE_COMPARE_NONE;
+	if (g_strcmp0 (compare, "eq") == 0)
+		return FU_ENGINE_COMPARE_EQ;
+	if (g_strcmp0 (compare, "ne") == 0)
+		return FU_ENGINE_COMPARE_NE;
+	if (g_strcmp0 (compare, "lt") == 0)
+		return FU_ENGINE_COMPARE_LT;
+	if (g_strcmp0 (compare, "gt") == 0)
+		return FU_ENGINE_COMPARE_GT;
+	if (g_strcmp0 (compare, "le") == 0)
+		return FU_ENGINE_COMPARE_LE;
+	if (g_strcmp0 (compare, "ge") == 0)
+		return FU_ENGINE_COMPARE_GE;
+	if (g_strcmp0 (compare, "glob") == 0)
+		return FU_ENGINE_COMPARE_GLOB;
+	if (g_strcmp0 (compare, "regex") == 0)
+		return FU_ENGINE_COMPARE_REGEX;
+	return FU_ENGINE_COMPARE_UNKNOWN;
+}
+
+static FuEngineRequirement *
+fu_engine_requirement_new_from_node (XbNode *n)
+{
+	FuEngineRequirement *req = g_new0 (FuEngineRequirement, 1);
+	const gchar *element = xb_node_get_element (n);
+
+	req->element = g_strdup (element);
+	req->text = g_strdup (xb_node_get_text (n));
+	req->version = g_strdup (xb_node_get_attr (n, "version"));
+	req->compare_str = g_strdup (xb_node_get_attr (n, "compare"));
+	req->compare = fu_engine_compare_from_string (req->compare_str);
+	req->depth = xb_node_get_attr_as_uint (n, "depth");
+	if (req->compare == FU_ENGINE_COMPARE_REGEX && req->version != NULL)
+		req->regex = g_regex_new (req->version, G_REGEX_OPTIMIZE, 0, NULL);
+
+	if (g_strcmp0 (element, "id") == 0) {
+		req->kind = FU_ENGINE_REQUIREMENT_KIND_ID;
+	} else if (g_strcmp0 (element, "firmware") == 0) {
+		req->kind = FU_ENGINE_REQUIREMENT_KIND_FIRMWARE;
+		if (req->text == NULL)
+			req->target = FU_ENGINE_REQUIREMENT_TARGET_VERSION;
+		else if (g_strcmp0 (req->text, "bootloader") == 0)
+			req->target = FU_ENGINE_REQUIREMENT_TARGET_BOOTLOADER;
+		else if (g_strcmp0 (req->text, "vendor-id") == 0)
+			req->target = FU_ENGINE_REQUIREMENT_TARGET_VENDOR_ID;
+		else if (g_strcmp0 (req->text, "not-child") == 0)
+			req->target = FU_ENGINE_REQUIREMENT_TARGET_NOT_CHILD;
+		else if (fwupd_guid_is_valid (req->text))
+			req->target = FU_ENGINE_REQUIREMENT_TARGET_GUID;
+	} else if (g_strcmp0 (element, "hardware") == 0) {
+		req->kind = FU_ENGINE_REQUIREMENT_KIND_HARDWARE;
+		req->values = g_strsplit (req->text != NULL ? req->text : "", "|", -1);
+	} else if (g_strcmp0 (element, "client") == 0) {
+		guint len;
+		req->kind = FU_ENGINE_REQUIREMENT_KIND_CLIENT;
+		req->values = g_strsplit (req->text != NULL ? req->text : "", "|", -1);
+		len = g_strv_length (req->values);
+		req->feature_flags = g_new0 (FwupdFeatureFlags, len + 1);
+		for (guint i = 0; i < len; i++)
+			req->feature_flags[i] = fwupd_feature_flag_from_string (req->values[i]);
+	}
+	return req;
+}
+
+/* returns the compiled requirements, which are cached in the silo */
+static GPtrArray *
+fu_engine_get_requirements (XbNode *component, GError **error)
+{
+	GBytes *blob;
+	g_autoptr(GBytes) blob_new = NULL;
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GPtrArray) nodes = NULL;
+	g_autoptr(GPtrArray) reqs = NULL;
+
+	/* already compiled */
+	blob = xb_node_get_data (component, "fwupd::Requirements");
+	if (blob != NULL)
+		return g_ptr_array_ref ((GPtrArray *) g_bytes_get_data (blob, NULL));
+
+	/* parse each node */
+	reqs = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_engine_requirement_free);
+	nodes = xb_node_query (component, "requires/*", 0, &error_local);
+	if (nodes == NULL) {
+		if (!g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND) &&
+		    !g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT)) {
+			g_propagate_error (error, g_steal_pointer (&error_local));
+			return NULL;
+		}
+	} else {
+		for (guint i = 0; i < nodes->len; i++) {
+			XbNode *n = g_ptr_array_index (nodes, i);
+			g_ptr_array_add (reqs, fu_engine_requirement_new_from_node (n));
+		}
+	}
+
+	/* the silo owns a reference for as long as it is alive */
+	blob_new = g_bytes_new_with_free_func (reqs, sizeof(GPtrArray),
+					       (GDestroyNotify) g_ptr_array_unref,
+					       g_ptr_array_ref (reqs));
+	xb_node_set_data (component, "fwupd::Requirements", blob_new);
+	return g_steal_pointer (&reqs);
+}
+
+/* the required version is parsed once for each format it is compared with */
+static gint
+fu_engine_requirement_vercmp (FuEngineRequirement *req,
+			      const gchar *version,
+			      FwupdVersionFormat fmt)
+{
+	g_autoptr(FuVersionKey) key = fu_version_key_new (version, fmt);
+	if (fmt >= FWUPD_VERSION_FORMAT_LAST) {
+		g_autoptr(FuVersionKey) key_req = fu_version_key_new (req->version, fmt);
+		return fu_version_key_compare (key, key_req);
+	}
+	if (req->version_keys[fmt] == NULL)
+		req->version_keys[fmt] = fu_version_key_new (req->version, fmt);
+	return fu_version_key_compare (key, req->version_keys[fmt]);
+}
+
 static gboolean
-fu_engine_require_vercmp (XbNode *req,
+fu_engine_require_vercmp (FuEngineRequirement *req,
 			  const gchar *version,
 			  FwupdVersionFormat fmt,
 			  GError **error)
 {
 	gboolean ret = FALSE;
-	gint rc = 0;
-	const gchar *tmp = xb_node_get_attr (req, "compare");
-	const gchar *version_req = xb_node_get_attr (req, "version");
-
-	if (g_strcmp0 (tmp, "eq") == 0) {
-		rc = fu_common_vercmp_full (version, version_req, fmt);
-		ret = rc == 0;
-	} else if (g_strcmp0 (tmp, "ne") == 0) {
-		rc = fu_common_vercmp_full (version, version_req, fmt);
-		ret = rc != 0;
-	} else if (g_strcmp0 (tmp, "lt") == 0) {
-		rc = fu_common_vercmp_full (version, version_req, fmt);
-		ret = rc < 0;
-	} else if (g_strcmp0 (tmp, "gt") == 0) {
-		rc = fu_common_vercmp_full (version, version_req, fmt);
-		ret = rc > 0;
-	} else if (g_strcmp0 (tmp, "le") == 0) {
-		rc = fu_common_vercmp_full (version, version_req, fmt);
-		ret = rc <= 0;
-	} else if (g_strcmp0 (tmp, "ge") == 0) {
-		rc = fu_common_vercmp_full (version, version_req, fmt);
-		ret = rc >= 0;
-	} else if (g_strcmp0 (tmp, "glob") == 0) {
-		ret = fu_common_fnmatch (version_req, version);
-	} else if (g_strcmp0 (tmp, "regex") == 0) {
-		ret = g_regex_match_simple (version_req, version, 0, 0);
-	} else {
+
+	switch (req->compare) {
+	case FU_ENGINE_COMPARE_EQ:
+		ret = fu_engine_requirement_vercmp (req, version, fmt) == 0;
+		break;
+	case FU_ENGINE_COMPARE_NE:
+		ret = fu_engine_requirement_vercmp (req, version, fmt) != 0;
+		break;
+	case FU_ENGINE_COMPARE_LT:
+		ret = fu_engine_requirement_vercmp (req, version, fmt) < 0;
+		break;
+	case FU_ENGINE_COMPARE_GT:
+		ret = fu_engine_requirement_vercmp (req, version, fmt) > 0;
+		break;
+	case FU_ENGINE_COMPARE_LE:
+		ret = fu_engine_requirement_vercmp (req, version, fmt) <= 0;
+		break;
+	case FU_ENGINE_COMPARE_GE:
+		ret = fu_engine_requirement_vercmp (req, version, fmt) >= 0;
+		break;
+	case FU_ENGINE_COMPARE_GLOB:
+		ret = fu_common_fnmatch (req->version, version);
+		break;
+	case FU_ENGINE_COMPARE_REGEX:
+		ret = req->regex != NULL && version != NULL &&
+		      g_regex_match (req->regex, version, 0, NULL);
+		break;
+	default:
 		g_set_error (error,
 			     FWUPD_ERROR,
 			     FWUPD_ERROR_NOT_SUPPORTED,
 			     "failed to compare [%s] and [%s]",
-			     version_req,
+			     req->version,
 			     version);
 		return FALSE;
 	}
@@ -1096,27 +1522,17 @@ fu_engine_require_vercmp (XbNode *req,
 			     FWUPD_ERROR,
 			     FWUPD_ERROR_INTERNAL,
 			     "failed predicate [%s %s %s]",
-			     version_req, tmp, version);
+			     req->version, req->compare_str, version);
 	}
 	return ret;
 }
 
 static gboolean
-fu_engine_check_requirement_not_child (FuEngine *self, XbNode *req,
+fu_engine_check_requirement_not_child (FuEngine *self, FuEngineRequirement *req,
 				       FuDevice *device, GError **error)
 {
 	GPtrArray *children = fu_device_get_children (device);
 
-	/* only <firmware> supported */
-	if (g_strcmp0 (xb_node_get_element (req), "firmware") != 0) {
-		g_set_error (error,
-			     FWUPD_ERROR,
-			     FWUPD_ERROR_NOT_SUPPORTED,
-			     "cannot handle not-child %s requirement",
-			     xb_node_get_element (req));
-		return FALSE;
-	}
-
 	/* check each child */
 	for (guint i = 0; i < children->len; i++) {
 		FuDevice *child = g_ptr_array_index (children, i);
@@ -1145,15 +1561,14 @@ fu_engine_check_requirement_not_child (FuEngine *self, XbNode *req,
 }
 
 static gboolean
-fu_engine_check_requirement_firmware (FuEngine *self, XbNode *req,
+fu_engine_check_requirement_firmware (FuEngine *self, FuEngineRequirement *req,
 				      FuDevice *device, GError **error)
 {
-	guint64 depth;
+	guint64 depth = req->depth;
 	g_autoptr(FuDevice) device_actual = g_object_ref (device);
 	g_autoptr(GError) error_local = NULL;
 
 	/* look at the parent device */
-	depth = xb_node_get_attr_as_uint (req, "depth");
 	if (depth != G_MAXUINT64) {
 		for (guint64 i = 0; i < depth; i++) {
 			FuDevice *device_tmp = fu_device_get_parent (device_actual);
@@ -1171,17 +1586,17 @@ fu_engine_check_requirement_firmware (FuEngine *self, XbNode *req,
 	}
 
 	/* old firmware version */
-	if (xb_node_get_text (req) == NULL) {
+	if (req->target == FU_ENGINE_REQUIREMENT_TARGET_VERSION) {
 		const gchar *version = fu_device_get_version (device_actual);
 		if (!fu_engine_require_vercmp (req, version,
 					       fu_device_get_version_format (device_actual),
 					       &error_local)) {
-			if (g_strcmp0 (xb_node_get_attr (req, "compare"), "ge") == 0) {
+			if (req->compare == FU_ENGINE_COMPARE_GE) {
 				g_set_error (error,
 					     FWUPD_ERROR,
 					     FWUPD_ERROR_INVALID_FILE,
 					     "Not compatible with firmware version %s, requires >= %s",
-					     version, xb_node_get_attr (req, "version"));
+					     version, req->version);
 			} else {
 				g_set_error (error,
 					     FWUPD_ERROR,
@@ -1195,17 +1610,17 @@ fu_engine_check_requirement_firmware (FuEngine *self, XbNode *req,
 	}
 
 	/* bootloader version */
-	if (g_strcmp0 (xb_node_get_text (req), "bootloader") == 0) {
+	if (req->target == FU_ENGINE_REQUIREMENT_TARGET_BOOTLOADER) {
 		const gchar *version = fu_device_get_version_bootloader (device_actual);
 		if (!fu_engine_require_vercmp (req, version,
 					       fu_device_get_version_format (device_actual),
 					       &error_local)) {
-			if (g_strcmp0 (xb_node_get_attr (req, "compare"), "ge") == 0) {
+			if (req->compare == FU_ENGINE_COMPARE_GE) {
 				g_set_error (error,
 					     FWUPD_ERROR,
 					     FWUPD_ERROR_NOT_SUPPORTED,
 					     "Not compatible with bootloader version %s, requires >= %s",
-                                             version, xb_node_get_attr (req, "version"));
+					     version, req->version);
 
 			} else {
 				g_debug ("Bootloader is not compatible: %s", error_local->message);
@@ -1220,7 +1635,7 @@ fu_engine_check_requirement_firmware (FuEngine *self, XbNode *req,
 	}
 
 	/* vendor ID */
-	if (g_strcmp0 (xb_node_get_text (req), "vendor-id") == 0 &&
+	if (req->target == FU_ENGINE_REQUIREMENT_TARGET_VENDOR_ID &&
 	    fu_device_get_vendor_id (device_actual) != NULL) {
 		const gchar *version = fu_device_get_vendor_id (device_actual);
 		if (!fu_engine_require_vercmp (req, version,
@@ -1237,12 +1652,12 @@ fu_engine_check_requirement_firmware (FuEngine *self, XbNode *req,
 	}
 
 	/* child version */
-	if (g_strcmp0 (xb_node_get_text (req), "not-child") == 0)
+	if (req->target == FU_ENGINE_REQUIREMENT_TARGET_NOT_CHILD)
 		return fu_engine_check_requirement_not_child (self, req, device_actual, error);
 
 	/* another device */
-	if (fwupd_guid_is_valid (xb_node_get_text (req))) {
-		const gchar *guid = xb_node_get_text (req);
+	if (req->target == FU_ENGINE_REQUIREMENT_TARGET_GUID) {
+		const gchar *guid = req->text;
 		const gchar *version;
 
 		/* find if the other device exists */
@@ -1268,18 +1683,18 @@ fu_engine_check_requirement_firmware (FuEngine *self, XbNode *req,
 		/* get the version of the other device */
 		version = fu_device_get_version (device_actual);
 		if (version != NULL &&
-		    xb_node_get_attr (req, "compare") != NULL &&
+		    req->compare != FU_ENGINE_COMPARE_NONE &&
 		    !fu_engine_require_vercmp (req, version,
 					       fu_device_get_version_format (device_actual),
 					       &error_local)) {
-			if (g_strcmp0 (xb_node_get_attr (req, "compare"), "ge") == 0) {
+			if (req->compare == FU_ENGINE_COMPARE_GE) {
 				g_set_error (error,
 					     FWUPD_ERROR,
 					     FWUPD_ERROR_INVALID_FILE,
 					     "Not compatible with %s version %s, requires >= %s",
 					     fu_device_get_name (device_actual),
 					     version,
-					     xb_node_get_attr (req, "version"));
+					     req->version);
 			} else {
 				g_set_error (error,
 					     FWUPD_ERROR,
@@ -1299,59 +1714,55 @@ fu_engine_check_requirement_firmware (FuEngine *self, XbNode *req,
 		     FWUPD_ERROR,
 		     FWUPD_ERROR_NOT_SUPPORTED,
 		     "cannot handle firmware requirement '%s'",
-		     xb_node_get_text (req));
+		     req->text);
 	return FALSE;
 }
 
 static gboolean
-fu_engine_check_requirement_id (FuEngine *self, XbNode *req, GError **error)
+fu_engine_check_requirement_id (FuEngine *self, FuEngineRequirement *req, GError **error)
 {
 	g_autoptr(GError) error_local = NULL;
-	const gchar *version = g_hash_table_lookup (self->runtime_versions,
-						    xb_node_get_text (req));
+	const gchar *version = NULL;
+
+	if (req->text != NULL)
+		version = g_hash_table_lookup (self->runtime_versions, req->text);
 	if (version == NULL) {
 		g_set_error (error,
 			     FWUPD_ERROR,
 			     FWUPD_ERROR_NOT_FOUND,
 			     "no version available for %s",
-			     xb_node_get_text (req));
+			     req->text);
 		return FALSE;
 	}
 	if (!fu_engine_require_vercmp (req, version, FWUPD_VERSION_FORMAT_UNKNOWN, &error_local)) {
-		if (g_strcmp0 (xb_node_get_attr (req, "compare"), "ge") == 0) {
+		if (req->compare == FU_ENGINE_COMPARE_GE) {
 			g_set_error (error,
 				     FWUPD_ERROR,
 				     FWUPD_ERROR_INVALID_FILE,
 				     "Not compatible with %s version %s, requires >= %s",
-				     xb_node_get_text (req), version,
-				     xb_node_get_attr (req, "version"));
+				     req->text, version, req->version);
 		} else {
 			g_set_error (error,
 				     FWUPD_ERROR,
 				     FWUPD_ERROR_INVALID_FILE,
 				     "Not compatible with %s version: %s",
-				     xb_node_get_text (req), error_local->message);
+				     req->text, error_local->message);
 		}
 		return FALSE;
 	}
 
 	g_debug ("requirement %s %s %s -> %s passed",
-		 xb_node_get_attr (req, "version"),
-		 xb_node_get_attr (req, "compare"),
-		 version, xb_node_get_text (req));
+		 req->version, req->compare_str, version, req->text);
 	return TRUE;
 }
 
 static gboolean
-fu_engine_check_requirement_hardware (FuEngine *self, XbNode *req, GError **error)
+fu_engine_check_requirement_hardware (FuEngine *self, FuEngineRequirement *req, GError **error)
 {
-	g_auto(GStrv) hwid_split = NULL;
-
-	/* split and treat as OR */
-	hwid_split = g_strsplit (xb_node_get_text (req), "|", -1);
-	for (guint i = 0; hwid_split[i] != NULL; i++) {
-		if (fu_hwids_has_guid (self->hwids, hwid_split[i])) {
-			g_debug ("HWID provided %s", hwid_split[i]);
+	/* treat as OR */
+	for (guint i = 0; req->values[i] != NULL; i++) {
+		if (fu_hwids_has_guid (self->hwids, req->values[i])) {
+			g_debug ("HWID provided %s", req->values[i]);
 			return TRUE;
 		}
 	}
@@ -1361,24 +1772,21 @@ fu_engine_check_requirement_hardware (FuEngine *self, XbNode *req, GError **erro
 		     FWUPD_ERROR,
 		     FWUPD_ERROR_INVALID_FILE,
 		     "no HWIDs matched %s",
-		     xb_node_get_text (req));
+		     req->text);
 	return FALSE;
 }
 
 static gboolean
 fu_engine_check_requirement_client (FuEngine *self,
 				    FuEngineRequest *request,
-				    XbNode *req,
+				    FuEngineRequirement *req,
 				    GError **error)
 {
-	FwupdFeatureFlags flags;
-	g_auto(GStrv) feature_split = NULL;
+	FwupdFeatureFlags flags = fu_engine_request_get_feature_flags (request);
 
-	/* split and treat as AND */
-	feature_split = g_strsplit (xb_node_get_text (req), "|", -1);
-	flags = fu_engine_request_get_feature_flags (request);
-	for (guint i = 0; feature_split[i] != NULL; i++) {
-		FwupdFeatureFlags flag = fwupd_feature_flag_from_string (feature_split[i]);
+	/* treat as AND */
+	for (guint i = 0; req->values[i] != NULL; i++) {
+		FwupdFeatureFlags flag = req->feature_flags[i];
 
 		/* not recognised */
 		if (flag == FWUPD_FEATURE_FLAG_LAST) {
@@ -1386,7 +1794,7 @@ fu_engine_check_requirement_client (FuEngine *self,
 				     FWUPD_ERROR,
 				     FWUPD_ERROR_NOT_FOUND,
 				     "client requirement %s unknown",
-				     feature_split[i]);
+				     req->values[i]);
 			return FALSE;
 		}
 
@@ -1396,7 +1804,7 @@ fu_engine_check_requirement_client (FuEngine *self,
 				     FWUPD_ERROR,
 				     FWUPD_ERROR_NOT_SUPPORTED,
 				     "client requirement %s not supported",
-				     feature_split[i]);
+				     req->values[i]);
 			return FALSE;
 		}
 	}
@@ -1408,35 +1816,31 @@ fu_engine_check_requirement_client (FuEngine *self,
 static gboolean
 fu_engine_check_requirement (FuEngine *self,
 			     FuEngineRequest *request,
-			     XbNode *req,
+			     FuEngineRequirement *req,
 			     FuDevice *device,
 			     GError **error)
 {
-	/* ensure component requirement */
-	if (g_strcmp0 (xb_node_get_element (req), "id") == 0)
+	switch (req->kind) {
+	case FU_ENGINE_REQUIREMENT_KIND_ID:
 		return fu_engine_check_requirement_id (self, req, error);
-
-	/* ensure firmware requirement */
-	if (g_strcmp0 (xb_node_get_element (req), "firmware") == 0) {
+	case FU_ENGINE_REQUIREMENT_KIND_FIRMWARE:
 		if (device == NULL)
 			return TRUE;
 		return fu_engine_check_requirement_firmware (self, req, device, error);
-	}
-
-	/* ensure hardware requirement */
-	if (g_strcmp0 (xb_node_get_element (req), "hardware") == 0)
+	case FU_ENGINE_REQUIREMENT_KIND_HARDWARE:
 		return fu_engine_check_requirement_hardware (self, req, error);
-
-	/* ensure client requirement */
-	if (g_strcmp0 (xb_node_get_element (req), "client") == 0)
+	case FU_ENGINE_REQUIREMENT_KIND_CLIENT:
 		return fu_engine_check_requirement_client (self, request, req, error);
+	default:
+		break;
+	}
 
 	/* not supported */
 	g_set_error (error,
 		     FWUPD_ERROR,
 		     FWUPD_ERROR_NOT_SUPPORTED,
 		     "cannot handle requirement type %s",
-		     xb_node_get_element (req));
+		     req->element);
 	return FALSE;
 }
 
@@ -1448,7 +1852,6 @@ fu_engine_check_requirements (FuEngine *self,
 			      GError **error)
 {
 	FuDevice *device = fu_install_task_get_device (task);
-	g_autoptr(GError) error_local = NULL;
 	g_autoptr(GPtrArray) reqs = NULL;
 
 	/* all install task checks require a device */
@@ -1458,18 +1861,11 @@ fu_engine_check_requirements (FuEngine *self,
 	}
 
 	/* do engine checks */
-	reqs = xb_node_query (fu_install_task_get_component (task),
-			      "requires/*", 0, &error_local);
-	if (reqs == NULL) {
-		if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
-			return TRUE;
-		if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT))
-			return TRUE;
-		g_propagate_error (error, g_steal_pointer (&error_local));
+	reqs = fu_engine_get_requirements (fu_install_task_get_component (task), error);
+	if (reqs == NULL)
 		return FALSE;
-	}
 	for (guint i = 0; i < reqs->len; i++) {
-		XbNode *req = g_ptr_array_index (reqs, i);
+		FuEngineRequirement *req = g_ptr_array_index (reqs, i);
 		if (!fu_engine_check_requirement (self, request, req, device, error))
 			return FALSE;
 	}
@@ -1731,6 +2127,85 @@ fu_engine_composite_cleanup (FuEngine *self, GPtrArray *devices, GError **error)
 	return TRUE;
 }
 
+typedef struct {
+	GMainLoop		*loop;
+	GError			*error;
+	guint			 pending;
+} FuEngineReplugHelper;
+
+static void
+fu_engine_wait_for_replug_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	FuEngineReplugHelper *helper = (FuEngineReplugHelper *) user_data;
+	g_autoptr(GError) error_local = NULL;
+
+	if (!fu_device_list_wait_for_replug_finish (FU_DEVICE_LIST (source), res, &error_local)) {
+		if (helper->error == NULL)
+			helper->error = g_steal_pointer (&error_local);
+	}
+	if (--helper->pending == 0)
+		g_main_loop_quit (helper->loop);
+}
+
+static void
+fu_engine_wait_for_replug_add (GPtrArray *devices_replug, GHashTable *devices_seen, FuDevice *device)
+{
+	if (!fu_device_has_flag (device, FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG))
+		return;
+	if (g_hash_table_contains (devices_seen, device))
+		return;
+	g_hash_table_add (devices_seen, device);
+	g_ptr_array_add (devices_replug, g_object_ref (device));
+}
+
+/* all the devices, and their root devices, that are replugging are waited for
+ * at the same time so that each is allowed its own remove delay in parallel */
+static gboolean
+fu_engine_wait_for_replug (FuEngine *self, GPtrArray *devices, GError **error)
+{
+	FuEngineReplugHelper helper = { NULL };
+	g_autoptr(GHashTable) devices_seen = g_hash_table_new (g_direct_hash, g_direct_equal);
+	g_autoptr(GPtrArray) devices_replug = NULL;
+
+	devices_replug = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	for (guint i = 0; i < devices->len; i++) {
+		FuDevice *device = g_ptr_array_index (devices, i);
+		g_autoptr(FuDevice) root = fu_device_get_root (device);
+		fu_engine_wait_for_replug_add (devices_replug, devices_seen, device);
+		fu_engine_wait_for_replug_add (devices_replug, devices_seen, root);
+	}
+	if (devices_replug->len == 0)
+		return TRUE;
+
+	/* the callers are synchronous, so iterate the context just once for
+	 * the whole set rather than for each device */
+	helper.loop = g_main_loop_new (NULL, FALSE);
+	helper.pending = devices_replug->len;
+	for (guint i = 0; i < devices_replug->len; i++) {
+		FuDevice *device = g_ptr_array_index (devices_replug, i);
+		fu_device_list_wait_for_replug_async (self->device_list, device, NULL,
+						      fu_engine_wait_for_replug_cb,
+						      &helper);
+	}
+	if (helper.pending > 0)
+		g_main_loop_run (helper.loop);
+	g_main_loop_unref (helper.loop);
+	if (helper.error != NULL) {
+		g_propagate_error (error, helper.error);
+		return FALSE;
+	}
+	g_debug ("waited for %u devices to replug", devices_replug->len);
+	return TRUE;
+}
+
+static gboolean
+fu_engine_wait_for_replug_device (FuEngine *self, FuDevice *device, GError **error)
+{
+	g_autoptr(GPtrArray) devices = g_ptr_array_new ();
+	g_ptr_array_add (devices, device);
+	return fu_engine_wait_for_replug (self, devices, error);
+}
+
 /**
  * fu_engine_install_tasks:
  * @self: A #FuEngine
@@ -1776,6 +2251,10 @@ fu_engine_install_tasks (FuEngine *self,
 		g_prefix_error (error, "failed to prepare composite action: ");
 		return FALSE;
 	}
+	if (!fu_engine_wait_for_replug (self, devices, error)) {
+		g_prefix_error (error, "failed to wait for composite prepare replug: ");
+		return FALSE;
+	}
 
 	/* all authenticated, so install all the things */
 	for (guint i = 0; i < install_tasks->len; i++) {
@@ -1798,6 +2277,10 @@ fu_engine_install_tasks (FuEngine *self,
 	}
 
 	/* get a new list of devices in case they replugged */
+	if (!fu_engine_wait_for_replug (self, devices, error)) {
+		g_prefix_error (error, "failed to wait for composite replug: ");
+		return FALSE;
+	}
 	devices_new = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 	for (guint i = 0; i < devices->len; i++) {
 		FuDevice *device;
@@ -2036,6 +2519,40 @@ fu_engine_schedule_update (FuEngine *self,
 	return fu_engine_offline_setup (error);
 }
 
+typedef struct {
+	GMainLoop	*loop;
+	GAsyncResult	*res;
+} FuEngineBuilderHelper;
+
+static void
+fu_engine_firmware_builder_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	FuEngineBuilderHelper *helper = (FuEngineBuilderHelper *) user_data;
+	helper->res = g_object_ref (res);
+	g_main_loop_quit (helper->loop);
+}
+
+/* the build runs on a worker, and D-Bus requests are still processed in the
+ * same way as when a plugin uses fu_common_spawn_sync() */
+static GBytes *
+fu_engine_firmware_builder (GBytes *blob_fw,
+			    const gchar *script_fn,
+			    const gchar *output_fn,
+			    GError **error)
+{
+	FuEngineBuilderHelper helper = { NULL };
+	GBytes *blob;
+
+	helper.loop = g_main_loop_new (g_main_context_get_thread_default (), FALSE);
+	fu_common_firmware_builder_async (blob_fw, script_fn, output_fn, NULL,
+					  fu_engine_firmware_builder_cb, &helper);
+	g_main_loop_run (helper.loop);
+	blob = fu_common_firmware_builder_finish (helper.res, error);
+	g_object_unref (helper.res);
+	g_main_loop_unref (helper.loop);
+	return blob;
+}
+
 static gboolean
 fu_engine_install_release (FuEngine *self,
 			   FuDevice *device_orig,
@@ -2071,7 +2588,7 @@ fu_engine_install_release (FuEngine *self,
 		const gchar *tmp2 = g_object_get_data (G_OBJECT (component), "fwupd::BuilderOutput");
 		if (tmp2 == NULL)
 			tmp2 = "firmware.bin";
-		blob_fw2 = fu_common_firmware_builder (blob_fw, tmp, tmp2, error);
+		blob_fw2 = fu_engine_firmware_builder (blob_fw, tmp, tmp2, error);
 		if (blob_fw2 == NULL)
 			return FALSE;
 	} else {
@@ -2131,9 +2648,10 @@ fu_engine_install_release (FuEngine *self,
 			fu_device_set_update_state (device, FWUPD_UPDATE_STATE_FAILED);
 		}
 		fu_device_set_update_error (device, error_local->message);
-		if ((flags & FWUPD_INSTALL_FLAG_NO_HISTORY) == 0 &&
-		    !fu_history_modify_device (self->history, device, error)) {
-			return FALSE;
+		if ((flags & FWUPD_INSTALL_FLAG_NO_HISTORY) == 0) {
+			if (!fu_history_modify_device (self->history, device, error))
+				return FALSE;
+			fu_engine_save_wait_profile (self, device);
 		}
 		g_propagate_error (error, g_steal_pointer (&error_local));
 		return FALSE;
@@ -2148,6 +2666,8 @@ fu_engine_install_release (FuEngine *self,
 		return FALSE;
 	}
 	g_set_object (&device, device_tmp);
+	if ((flags & FWUPD_INSTALL_FLAG_NO_HISTORY) == 0)
+		fu_engine_save_wait_profile (self, device);
 
 	/* update database */
 	if (fu_device_has_flag (device, FWUPD_DEVICE_FLAG_NEEDS_REBOOT) ||
@@ -2197,51 +2717,137 @@ fu_engine_install_release (FuEngine *self,
 	return TRUE;
 }
 
+/* save the completion timings learned by the plugin for the next update */
+static void
+fu_engine_save_wait_profile (FuEngine *self, FuDevice *device)
+{
+	FwupdRelease *release;
+	g_autoptr(FuDevice) device_history = NULL;
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GHashTable) metadata = NULL;
+
+	metadata = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	fu_device_wait_profile_to_metadata (device, metadata);
+	if (g_hash_table_size (metadata) == 0)
+		return;
+	device_history = fu_history_get_device_by_id (self->history,
+						      fu_device_get_id (device),
+						      NULL);
+	if (device_history == NULL)
+		return;
+	release = fu_device_get_release_default (device_history);
+	if (release == NULL)
+		return;
+	fwupd_release_add_metadata (release, metadata);
+	if (!fu_history_set_device_metadata (self->history,
+					     fu_device_get_id (device),
+					     fwupd_release_get_metadata (release),
+					     &error_local))
+		g_warning ("failed to save wait profile: %s", error_local->message);
+}
+
+/* a pointer array item decorated with a pre-parsed version for sorting */
 typedef struct {
-	gboolean	 ret;
-	GError		**error;
-	FuEngine	*self;
-	FuDevice	*device;
-} FuEngineSortHelper;
+	gpointer	 item;
+	const gchar	*branch;
+	FuVersionKey	*key;
+} FuEngineSortItem;
+
+static gint
+fu_engine_sort_items_cb (gconstpointer a, gconstpointer b)
+{
+	const FuEngineSortItem *item_a = a;
+	const FuEngineSortItem *item_b = b;
+	return fu_version_key_compare (item_a->key, item_b->key);
+}
 
 static gint
-fu_engine_sort_release_versions_cb (gconstpointer a, gconstpointer b, gpointer user_data)
+fu_engine_sort_items_branch_cb (gconstpointer a, gconstpointer b)
 {
-	FuEngineSortHelper *helper = (FuEngineSortHelper *) user_data;
-	XbNode *na = *((XbNode **) a);
-	XbNode *nb = *((XbNode **) b);
-	g_autofree gchar *va = NULL;
-	g_autofree gchar *vb = NULL;
+	const FuEngineSortItem *item_a = a;
+	const FuEngineSortItem *item_b = b;
+	gint rc;
 
-	/* already failed */
-	if (!helper->ret)
-		return 0;
+	/* first by branch */
+	rc = g_strcmp0 (item_b->branch, item_a->branch);
+	if (rc != 0)
+		return rc;
 
-	/* get the semver from the release */
-	va = fu_engine_get_release_version (helper->self, helper->device, na, helper->error);
-	if (va == NULL) {
-		g_prefix_error (helper->error, "failed to get release version: ");
-		return 0;
-	}
-	vb = fu_engine_get_release_version (helper->self, helper->device, nb, helper->error);
-	if (vb == NULL) {
-		g_prefix_error (helper->error, "failed to get release version: ");
-		return 0;
+	/* then by version */
+	return fu_version_key_compare (item_b->key, item_a->key);
+}
+
+static void
+fu_engine_sort_item_clear (gpointer data)
+{
+	FuEngineSortItem *item = data;
+	fu_version_key_free (item->key);
+}
+
+static GArray *
+fu_engine_sort_items_new (guint len)
+{
+	GArray *items = g_array_sized_new (FALSE, FALSE, sizeof(FuEngineSortItem), len);
+	g_array_set_clear_func (items, fu_engine_sort_item_clear);
+	return items;
+}
+
+/* reorder the pointer array to match the sorted items */
+static void
+fu_engine_sort_items_apply (GArray *items, GPtrArray *array)
+{
+	for (guint i = 0; i < items->len; i++) {
+		FuEngineSortItem *item = &g_array_index (items, FuEngineSortItem, i);
+		array->pdata[i] = item->item;
 	}
-	return fu_common_vercmp_full (va, vb, fu_device_get_version_format (helper->device));
 }
 
+/* sorts <release> nodes by version, oldest first */
 static gboolean
 fu_engine_sort_releases (FuEngine *self, FuDevice *device, GPtrArray *rels, GError **error)
 {
-	FuEngineSortHelper helper = {
-		.ret = TRUE,
-		.self = self,
-		.device = device,
-		.error = error,
-	};
-	g_ptr_array_sort_with_data (rels, fu_engine_sort_release_versions_cb, &helper);
-	return helper.ret;
+	FwupdVersionFormat fmt = fu_device_get_version_format (device);
+	g_autoptr(GArray) items = NULL;
+
+	/* parse each version exactly once */
+	items = fu_engine_sort_items_new (rels->len);
+	for (guint i = 0; i < rels->len; i++) {
+		XbNode *rel = g_ptr_array_index (rels, i);
+		FuEngineSortItem item = { .item = rel };
+		g_autofree gchar *version = NULL;
+
+		version = fu_engine_get_release_version (self, device, rel, error);
+		if (version == NULL) {
+			g_prefix_error (error, "failed to get release version: ");
+			return FALSE;
+		}
+		item.key = fu_version_key_new (version, fmt);
+		g_array_append_val (items, item);
+	}
+	g_array_sort (items, fu_engine_sort_items_cb);
+	fu_engine_sort_items_apply (items, rels);
+	return TRUE;
+}
+
+/* sorts FwupdReleases by branch and then by version, newest first */
+static void
+fu_engine_sort_releases_by_version (FuDevice *device, GPtrArray *releases)
+{
+	FwupdVersionFormat fmt = fu_device_get_version_format (device);
+	g_autoptr(GArray) items = NULL;
+
+	items = fu_engine_sort_items_new (releases->len);
+	for (guint i = 0; i < releases->len; i++) {
+		FwupdRelease *rel = g_ptr_array_index (releases, i);
+		FuEngineSortItem item = {
+			.item = rel,
+			.branch = fwupd_release_get_branch (rel),
+			.key = fu_version_key_new (fwupd_release_get_version (rel), fmt),
+		};
+		g_array_append_val (items, item);
+	}
+	g_array_sort (items, fu_engine_sort_items_branch_cb);
+	fu_engine_sort_items_apply (items, releases);
 }
 
 /**
@@ -2424,21 +3030,16 @@ fu_engine_get_device (FuEngine *self, const gchar *device_id, GError **error)
 	if (device1 == NULL)
 		return NULL;
 
-	/* wait for device to disconnect and reconnect */
+	/* no replug required */
 	root = fu_device_get_root (device1);
-	if (fu_device_has_flag (device1, FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG)) {
-		if (!fu_device_list_wait_for_replug (self->device_list, device1, error)) {
-			g_prefix_error (error, "failed to wait for detach replug: ");
-			return NULL;
-		}
-	} else if (fu_device_has_flag (root, FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG)) {
-		if (!fu_device_list_wait_for_replug (self->device_list, root, error)) {
-			g_prefix_error (error, "failed to wait for detach replug: ");
-			return NULL;
-		}
-	} else {
-		/* no replug required */
+	if (!fu_device_has_flag (device1, FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG) &&
+	    !fu_device_has_flag (root, FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG))
 		return g_steal_pointer (&device1);
+
+	/* wait for device and the root device to disconnect and reconnect */
+	if (!fu_engine_wait_for_replug_device (self, device1, error)) {
+		g_prefix_error (error, "failed to wait for detach replug: ");
+		return NULL;
 	}
 
 	/* get the new device */
@@ -2518,11 +3119,9 @@ fu_engine_update_prepare (FuEngine *self,
 	}
 
 	/* wait for device to disconnect and reconnect */
-	if (fu_device_has_flag (device, FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG)) {
-		if (!fu_device_list_wait_for_replug (self->device_list, device, error)) {
-			g_prefix_error (error, "failed to wait for prepare replug: ");
-			return FALSE;
-		}
+	if (!fu_engine_wait_for_replug_device (self, device, error)) {
+		g_prefix_error (error, "failed to wait for prepare replug: ");
+		return FALSE;
 	}
 	return TRUE;
 }
@@ -2552,11 +3151,9 @@ fu_engine_update_cleanup (FuEngine *self,
 	}
 
 	/* wait for device to disconnect and reconnect */
-	if (fu_device_has_flag (device, FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG)) {
-		if (!fu_device_list_wait_for_replug (self->device_list, device, error)) {
-			g_prefix_error (error, "failed to wait for cleanup replug: ");
-			return FALSE;
-		}
+	if (!fu_engine_wait_for_replug_device (self, device, error)) {
+		g_prefix_error (error, "failed to wait for cleanup replug: ");
+		return FALSE;
 	}
 	return TRUE;
 }
@@ -2910,6 +3507,11 @@ fu_engine_set_silo (FuEngine *self, XbSilo *silo)
 {
 	g_return_if_fail (FU_IS_ENGINE (self));
 	g_return_if_fail (XB_IS_SILO (silo));
+	fu_engine_invalidate (self);
+#if LIBXMLB_CHECK_VERSION(0,2,0)
+	g_clear_object (&self->query_releases);
+#endif
+	g_clear_pointer (&self->checksum_remote_ids, g_hash_table_unref);
 	g_set_object (&self->silo, silo);
 }
 
@@ -3215,6 +3817,11 @@ fu_engine_load_metadata_store (FuEngine *self, FuEngineLoadFlags flags, GError *
 	g_autoptr(XbBuilder) builder = xb_builder_new ();
 
 	/* clear existing silo */
+	fu_engine_invalidate (self);
+#if LIBXMLB_CHECK_VERSION(0,2,0)
+	g_clear_object (&self->query_releases);
+#endif
+	g_clear_pointer (&self->checksum_remote_ids, g_hash_table_unref);
 	g_clear_object (&self->silo);
 
 	/* verbose profiling */
@@ -3321,6 +3928,7 @@ fu_engine_load_metadata_store (FuEngine *self, FuEngineLoadFlags flags, GError *
 static void
 fu_engine_config_changed_cb (FuConfig *config, FuEngine *self)
 {
+	fu_engine_invalidate (self);
 	fu_idle_set_timeout (self->idle, fu_config_get_idle_timeout (config));
 }
 
@@ -3336,112 +3944,65 @@ fu_engine_remote_list_changed_cb (FuRemoteList *remote_list, FuEngine *self)
 	/* set device properties from the metadata */
 	fu_engine_md_refresh_devices (self);
 
-	/* invalidate host security attributes */
+	/* invalidate the built-in host security attributes */
 	g_clear_pointer (&self->host_security_id, g_free);
 
 	/* make the UI update */
 	fu_engine_emit_changed (self);
 }
 
-static gint
-fu_engine_sort_jcat_results_timestamp_cb (gconstpointer a, gconstpointer b)
-{
-	JcatResult *ra = *((JcatResult **) a);
-	JcatResult *rb = *((JcatResult **) b);
-	if (jcat_result_get_timestamp (ra) < jcat_result_get_timestamp (rb))
-		return 1;
-	if (jcat_result_get_timestamp (ra) > jcat_result_get_timestamp (rb))
-		return -1;
-	return 0;
-}
-
-static JcatResult *
-fu_engine_get_newest_signature_jcat_result (GPtrArray *results, GError **error)
-{
-	/* sort by timestamp, newest first */
-	g_ptr_array_sort (results, fu_engine_sort_jcat_results_timestamp_cb);
-
-	/* get the first signature, ignoring the checksums */
-	for (guint i = 0; i < results->len; i++) {
-		JcatResult *result = g_ptr_array_index (results, i);
-#if LIBJCAT_CHECK_VERSION(0, 1, 3)
-		if (jcat_result_get_method (result) == JCAT_BLOB_METHOD_SIGNATURE)
-			return g_object_ref (result);
-#else
-		guint verify_kind = 0;
-		g_autoptr(JcatEngine) engine = NULL;
-		g_object_get (result, "engine", &engine, NULL);
-		g_object_get (engine, "verify-kind", &verify_kind, NULL);
-		if (verify_kind == 2) /* SIGNATURE */
-			return g_object_ref (result);
-#endif
-	}
-
-	/* should never happen due to %JCAT_VERIFY_FLAG_REQUIRE_SIGNATURE */
-	g_set_error_literal (error,
-			     FWUPD_ERROR,
-			     FWUPD_ERROR_INVALID_FILE,
-			     "no signature method in results");
-	return NULL;
-}
-
-static JcatResult *
-fu_engine_get_system_jcat_result (FuEngine *self, FwupdRemote *remote, GError **error)
+static gboolean
+fu_engine_get_system_jcat_timestamp (FuEngine *self,
+				     FwupdRemote *remote,
+				     gint64 *timestamp,
+				     GError **error)
 {
 	g_autoptr(GBytes) blob = NULL;
 	g_autoptr(GBytes) blob_sig = NULL;
 	g_autoptr(GInputStream) istream = NULL;
-	g_autoptr(GPtrArray) results = NULL;
 	g_autoptr(JcatItem) jcat_item = NULL;
 	g_autoptr(JcatFile) jcat_file = jcat_file_new ();
 
 	blob = fu_common_get_contents_bytes (fwupd_remote_get_filename_cache (remote), error);
 	if (blob == NULL)
-		return NULL;
+		return FALSE;
 	blob_sig = fu_common_get_contents_bytes (fwupd_remote_get_filename_cache_sig (remote), error);
 	if (blob_sig == NULL)
-		return NULL;
+		return FALSE;
 	istream = g_memory_input_stream_new_from_bytes (blob_sig);
 	if (!jcat_file_import_stream (jcat_file, istream,
 				      JCAT_IMPORT_FLAG_NONE,
 				      NULL, error))
-		return NULL;
+		return FALSE;
 	jcat_item = jcat_file_get_item_default (jcat_file, error);
 	if (jcat_item == NULL)
-		return NULL;
-	results = jcat_context_verify_item (self->jcat_context,
-					    blob, jcat_item,
-					    JCAT_VERIFY_FLAG_REQUIRE_CHECKSUM |
-					    JCAT_VERIFY_FLAG_REQUIRE_SIGNATURE,
-					    error);
-	if (results == NULL)
-		return NULL;
+		return FALSE;
 
-	/* return the newest signature */
-	return fu_engine_get_newest_signature_jcat_result (results, error);
+	/* this was verified when it was saved, so is normally cached */
+	return fu_jcat_cache_verify_item (self->jcat_cache,
+					  self->jcat_context,
+					  blob, jcat_item,
+					  JCAT_VERIFY_FLAG_REQUIRE_CHECKSUM |
+					  JCAT_VERIFY_FLAG_REQUIRE_SIGNATURE,
+					  timestamp, error);
 }
 
 static gboolean
-fu_engine_validate_result_timestamp (JcatResult *jcat_result,
-				     JcatResult *jcat_result_old,
+fu_engine_validate_result_timestamp (gint64 timestamp,
+				     gint64 timestamp_old,
 				     GError **error)
 {
 	gint64 delta = 0;
 
-	g_return_val_if_fail (JCAT_IS_RESULT (jcat_result), FALSE);
-	g_return_val_if_fail (JCAT_IS_RESULT (jcat_result_old), FALSE);
-
-	if (jcat_result_get_timestamp (jcat_result) == 0) {
+	if (timestamp == 0) {
 		g_set_error (error,
 			     FWUPD_ERROR,
 			     FWUPD_ERROR_INVALID_FILE,
 			     "no signing timestamp");
 		return FALSE;
 	}
-	if (jcat_result_get_timestamp (jcat_result_old) > 0) {
-		delta = jcat_result_get_timestamp (jcat_result) -
-			jcat_result_get_timestamp (jcat_result_old);
-	}
+	if (timestamp_old > 0)
+		delta = timestamp - timestamp_old;
 	if (delta < 0) {
 		g_set_error (error,
 			     FWUPD_ERROR,
@@ -3501,13 +4062,12 @@ fu_engine_update_metadata_bytes (FuEngine *self, const gchar *remote_id,
 	/* verify file */
 	keyring_kind = fwupd_remote_get_keyring_kind (remote);
 	if (keyring_kind != FWUPD_KEYRING_KIND_NONE) {
+		gint64 timestamp = 0;
+		gint64 timestamp_old = 0;
 		g_autoptr(GError) error_local = NULL;
 		g_autoptr(GInputStream) istream = NULL;
-		g_autoptr(GPtrArray) results = NULL;
 		g_autoptr(JcatFile) jcat_file = jcat_file_new ();
 		g_autoptr(JcatItem) jcat_item = NULL;
-		g_autoptr(JcatResult) jcat_result = NULL;
-		g_autoptr(JcatResult) jcat_result_old = NULL;
 
 		/* load Jcat file */
 		istream = g_memory_input_stream_new_from_bytes (bytes_sig);
@@ -3520,23 +4080,19 @@ fu_engine_update_metadata_bytes (FuEngine *self, const gchar *remote_id,
 		jcat_item = jcat_file_get_item_default (jcat_file, error);
 		if (jcat_item == NULL)
 			return FALSE;
-		results = jcat_context_verify_item (self->jcat_context,
-						    bytes_raw, jcat_item,
-						    JCAT_VERIFY_FLAG_REQUIRE_CHECKSUM |
-						    JCAT_VERIFY_FLAG_REQUIRE_SIGNATURE,
-						    error);
-		if (results == NULL)
-			return FALSE;
-
-		/* return the newest signature */
-		jcat_result = fu_engine_get_newest_signature_jcat_result (results, error);
-		if (jcat_result == NULL)
+		if (!fu_jcat_cache_verify_item (self->jcat_cache,
+						self->jcat_context,
+						bytes_raw, jcat_item,
+						JCAT_VERIFY_FLAG_REQUIRE_CHECKSUM |
+						JCAT_VERIFY_FLAG_REQUIRE_SIGNATURE,
+						&timestamp, error))
 			return FALSE;
 
 		/* verify the metadata was signed later than the existing
 		 * metadata for this remote to mitigate a rollback attack */
-		jcat_result_old = fu_engine_get_system_jcat_result (self, remote, &error_local);
-		if (jcat_result_old == NULL) {
+		if (!fu_engine_get_system_jcat_timestamp (self, remote,
+							  &timestamp_old,
+							  &error_local)) {
 			if (g_error_matches (error_local,
 					     G_FILE_ERROR,
 					     G_FILE_ERROR_NOENT)) {
@@ -3547,8 +4103,8 @@ fu_engine_update_metadata_bytes (FuEngine *self, const gchar *remote_id,
 					   error_local->message);
 			}
 		} else {
-			if (!fu_engine_validate_result_timestamp (jcat_result,
-								  jcat_result_old,
+			if (!fu_engine_validate_result_timestamp (timestamp,
+								  timestamp_old,
 								  error))
 				return FALSE;
 		}
@@ -3569,7 +4125,7 @@ fu_engine_update_metadata_bytes (FuEngine *self, const gchar *remote_id,
 	/* refresh SUPPORTED flag on devices */
 	fu_engine_md_refresh_devices (self);
 
-	/* invalidate host security attributes */
+	/* invalidate the built-in host security attributes */
 	g_clear_pointer (&self->host_security_id, g_free);
 
 	/* make the UI update */
@@ -3634,6 +4190,22 @@ fu_engine_update_metadata (FuEngine *self, const gchar *remote_id,
 #endif
 }
 
+static FuCabinet *
+fu_engine_get_cabinet_from_blob (FuEngine *self, GBytes *blob_cab, GError **error)
+{
+	g_autoptr(FuCabinet) cabinet = fu_cabinet_new ();
+
+	/* load file */
+	fu_engine_set_status (self, FWUPD_STATUS_DECOMPRESSING);
+	fu_cabinet_set_size_max (cabinet, fu_engine_get_archive_size_max (self));
+	fu_cabinet_set_jcat_context (cabinet, self->jcat_context);
+	fu_cabinet_set_jcat_cache (cabinet, self->jcat_cache);
+	if (!fu_cabinet_parse (cabinet, blob_cab, FU_CABINET_PARSE_FLAG_NONE, error))
+		return NULL;
+	fu_engine_set_status (self, FWUPD_STATUS_IDLE);
+	return g_steal_pointer (&cabinet);
+}
+
 /**
  * fu_engine_get_silo_from_blob:
  * @self: A #FuEngine
@@ -3647,22 +4219,16 @@ fu_engine_update_metadata (FuEngine *self, const gchar *remote_id,
 XbSilo *
 fu_engine_get_silo_from_blob (FuEngine *self, GBytes *blob_cab, GError **error)
 {
-	g_autoptr(FuCabinet) cabinet = fu_cabinet_new ();
-	g_autoptr(XbSilo) silo = NULL;
+	g_autoptr(FuCabinet) cabinet = NULL;
 
 	g_return_val_if_fail (FU_IS_ENGINE (self), NULL);
 	g_return_val_if_fail (blob_cab != NULL, NULL);
 	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
-	/* load file */
-	fu_engine_set_status (self, FWUPD_STATUS_DECOMPRESSING);
-	fu_cabinet_set_size_max (cabinet, fu_engine_get_archive_size_max (self));
-	fu_cabinet_set_jcat_context (cabinet, self->jcat_context);
-	if (!fu_cabinet_parse (cabinet, blob_cab, FU_CABINET_PARSE_FLAG_NONE, error))
+	cabinet = fu_engine_get_cabinet_from_blob (self, blob_cab, error);
+	if (cabinet == NULL)
 		return NULL;
-	silo = fu_cabinet_get_silo (cabinet);
-	fu_engine_set_status (self, FWUPD_STATUS_IDLE);
-	return g_steal_pointer (&silo);
+	return fu_cabinet_get_silo (cabinet);
 }
 
 static FuDevice *
@@ -3817,7 +4383,7 @@ GPtrArray *
 fu_engine_get_details (FuEngine *self, FuEngineRequest *request, gint fd, GError **error)
 {
 	const gchar *remote_id;
-	g_autofree gchar *csum = NULL;
+	g_autoptr(FuCabinet) cabinet = NULL;
 	g_autoptr(GBytes) blob = NULL;
 	g_autoptr(GError) error_local = NULL;
 	g_autoptr(GPtrArray) components = NULL;
@@ -3834,9 +4400,10 @@ fu_engine_get_details (FuEngine *self, FuEngineRequest *request, gint fd, GError
 					  error);
 	if (blob == NULL)
 		return NULL;
-	silo = fu_engine_get_silo_from_blob (self, blob, error);
-	if (silo == NULL)
+	cabinet = fu_engine_get_cabinet_from_blob (self, blob, error);
+	if (cabinet == NULL)
 		return NULL;
+	silo = fu_cabinet_get_silo (cabinet);
 	components = xb_silo_query (silo, "components/component", 0, &error_local);
 	if (components == NULL) {
 		g_set_error (error,
@@ -3855,9 +4422,14 @@ fu_engine_get_details (FuEngine *self, FuEngineRequest *request, gint fd, GError
 					NULL, error))
 		return NULL;
 
-	/* does this exist in any enabled remote */
-	csum = g_compute_checksum_for_bytes (G_CHECKSUM_SHA1, blob);
-	remote_id = fu_engine_get_remote_id_for_checksum (self, csum);
+	/* does this exist in any enabled remote, reusing the container
+	 * checksums computed when the cabinet was parsed */
+	remote_id = fu_engine_get_remote_id_for_checksum (self,
+							  fu_cabinet_get_container_checksum (cabinet, G_CHECKSUM_SHA256));
+	if (remote_id == NULL) {
+		remote_id = fu_engine_get_remote_id_for_checksum (self,
+								  fu_cabinet_get_container_checksum (cabinet, G_CHECKSUM_SHA1));
+	}
 
 	/* create results with all the metadata in */
 	details = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
@@ -3932,7 +4504,8 @@ fu_engine_sort_devices_by_priority_name (gconstpointer a, gconstpointer b)
  * @self: A #FuEngine
  * @error: A #GError, or %NULL
  *
- * Gets the list of devices.
+ * Gets the list of devices. While enumerating from the main loop without a
+ * snapshot this may be empty rather than an error.
  *
  * Returns: (transfer container) (element-type FwupdDevice): results
  **/
@@ -3944,8 +4517,12 @@ fu_engine_get_devices (FuEngine *self, GError **error)
 	g_return_val_if_fail (FU_IS_ENGINE (self), NULL);
 	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
+	/* still enumerating, so use what we had last time */
+	if (self->snapshot_devices != NULL)
+		return g_ptr_array_ref (self->snapshot_devices);
+
 	devices = fu_device_list_get_active (self->device_list);
-	if (devices->len == 0) {
+	if (devices->len == 0 && !fu_engine_is_enumerating (self)) {
 		g_set_error_literal (error,
 				     FWUPD_ERROR,
 				     FWUPD_ERROR_NOTHING_TO_DO,
@@ -4120,6 +4697,22 @@ fu_engine_get_remotes (FuEngine *self, GError **error)
 	return g_ptr_array_copy (remotes, (GCopyFunc) g_object_ref, NULL);
 }
 
+/**
+ * fu_engine_get_generation:
+ * @self: A #FuEngine
+ *
+ * Gets a counter that is incremented every time a device is added, removed or
+ * changed, or the metadata or configuration is reloaded.
+ *
+ * Returns: integer, where a different value means cached results are invalid
+ **/
+guint64
+fu_engine_get_generation (FuEngine *self)
+{
+	g_return_val_if_fail (FU_IS_ENGINE (self), 0);
+	return self->generation;
+}
+
 /**
  * fu_engine_get_remote_by_id:
  * @self: A #FuEngine
@@ -4133,17 +4726,14 @@ fu_engine_get_remotes (FuEngine *self, GError **error)
 FwupdRemote *
 fu_engine_get_remote_by_id (FuEngine *self, const gchar *remote_id, GError **error)
 {
-	g_autoptr(GPtrArray) remotes = NULL;
+	FwupdRemote *remote;
 
-	remotes = fu_engine_get_remotes (self, error);
-	if (remotes == NULL)
-		return NULL;
+	g_return_val_if_fail (FU_IS_ENGINE (self), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
-	for (guint i = 0; i < remotes->len; i++) {
-		FwupdRemote *remote = g_ptr_array_index (remotes, i);
-		if (g_strcmp0 (remote_id, fwupd_remote_get_id (remote)) == 0)
-			return remote;
-	}
+	remote = fu_remote_list_get_by_id (self->remote_list, remote_id);
+	if (remote != NULL)
+		return remote;
 
 	g_set_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL,
 		     "Couldn't find remote %s", remote_id);
@@ -4152,25 +4742,6 @@ fu_engine_get_remote_by_id (FuEngine *self, const gchar *remote_id, GError **err
 }
 
 
-static gint
-fu_engine_sort_releases_cb (gconstpointer a, gconstpointer b, gpointer user_data)
-{
-	FuDevice *device = FU_DEVICE (user_data);
-	FwupdRelease *rel_a = FWUPD_RELEASE (*((FwupdRelease **) a));
-	FwupdRelease *rel_b = FWUPD_RELEASE (*((FwupdRelease **) b));
-	gint rc;
-
-	/* first by branch */
-	rc = g_strcmp0 (fwupd_release_get_branch (rel_b), fwupd_release_get_branch (rel_a));
-	if (rc != 0)
-		return rc;
-
-	/* then by version */
-	return fu_common_vercmp_full (fwupd_release_get_version (rel_b),
-				      fwupd_release_get_version (rel_a),
-				      fu_device_get_version_format (device));
-}
-
 static gboolean
 fu_engine_check_release_is_approved (FuEngine *self, FwupdRelease *rel)
 {
@@ -4212,6 +4783,8 @@ fu_engine_add_releases_for_device_component (FuEngine *self,
 	FwupdVersionFormat fmt = fu_device_get_version_format (device);
 	g_autoptr(GError) error_local = NULL;
 	g_autoptr(FuInstallTask) task = fu_install_task_new (device, component);
+	g_autoptr(FuVersionKey) key_device = NULL;
+	g_autoptr(FuVersionKey) key_lowest = NULL;
 	g_autoptr(GPtrArray) releases_tmp = NULL;
 
 	if (!fu_engine_check_requirements (self, request, task,
@@ -4222,8 +4795,20 @@ fu_engine_add_releases_for_device_component (FuEngine *self,
 					   error))
 		return FALSE;
 
-	/* get all releases */
+	/* get all releases, reusing the query for every component in the silo */
+#if LIBXMLB_CHECK_VERSION(0,2,0)
+	if (self->query_releases == NULL) {
+		self->query_releases = xb_query_new_full (xb_node_get_silo (component),
+							  "releases/release",
+							  XB_QUERY_FLAG_FORCE_NODE_CACHE,
+							  error);
+		if (self->query_releases == NULL)
+			return FALSE;
+	}
+	releases_tmp = xb_node_query_full (component, self->query_releases, &error_local);
+#else
 	releases_tmp = xb_node_query (component, "releases/release", 0, &error_local);
+#endif
 	if (releases_tmp == NULL) {
 		if (g_error_matches (error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
 			return TRUE;
@@ -4233,6 +4818,9 @@ fu_engine_add_releases_for_device_component (FuEngine *self,
 		return FALSE;
 	}
 	feature_flags = fu_engine_request_get_feature_flags (request);
+	key_device = fu_version_key_new (fu_device_get_version (device), fmt);
+	if (fu_device_get_version_lowest (device) != NULL)
+		key_lowest = fu_version_key_new (fu_device_get_version_lowest (device), fmt);
 	for (guint i = 0; i < releases_tmp->len; i++) {
 		XbNode *release = g_ptr_array_index (releases_tmp, i);
 		const gchar *remote_id;
@@ -4241,6 +4829,7 @@ fu_engine_add_releases_for_device_component (FuEngine *self,
 		gint vercmp;
 		GPtrArray *checksums;
 		g_autoptr(FwupdRelease) rel = fwupd_release_new ();
+		g_autoptr(FuVersionKey) key_release = NULL;
 		g_autoptr(GError) error_loop = NULL;
 
 		/* create new FwupdRelease for the XbNode */
@@ -4279,19 +4868,16 @@ fu_engine_add_releases_for_device_component (FuEngine *self,
 		}
 
 		/* test for upgrade or downgrade */
-		vercmp = fu_common_vercmp_full (fwupd_release_get_version (rel),
-						fu_device_get_version (device),
-						fmt);
+		key_release = fu_version_key_new (fwupd_release_get_version (rel), fmt);
+		vercmp = fu_version_key_compare (key_release, key_device);
 		if (vercmp > 0)
 			fwupd_release_add_flag (rel, FWUPD_RELEASE_FLAG_IS_UPGRADE);
 		else if (vercmp < 0)
 			fwupd_release_add_flag (rel, FWUPD_RELEASE_FLAG_IS_DOWNGRADE);
 
 		/* lower than allowed to downgrade to */
-		if (fu_device_get_version_lowest (device) != NULL &&
-		    fu_common_vercmp_full (fwupd_release_get_version (rel),
-					   fu_device_get_version_lowest (device),
-					   fmt) < 0) {
+		if (key_lowest != NULL &&
+		    fu_version_key_compare (key_release, key_lowest) < 0) {
 			fwupd_release_add_flag (rel, FWUPD_RELEASE_FLAG_BLOCKED_VERSION);
 		}
 
@@ -4302,7 +4888,7 @@ fu_engine_add_releases_for_device_component (FuEngine *self,
 		/* check if remote is filtering firmware */
 		remote_id = fwupd_release_get_remote_id (rel);
 		if (remote_id != NULL) {
-			FwupdRemote *remote = fu_engine_get_remote_by_id (self, remote_id, NULL);
+			FwupdRemote *remote = fu_remote_list_get_by_id (self->remote_list, remote_id);
 			if (remote != NULL &&
 			    fwupd_remote_get_approval_required (remote) &&
 			    !fu_engine_check_release_is_approved (self, rel)) {
@@ -4329,11 +4915,11 @@ fu_engine_add_releases_for_device_component (FuEngine *self,
 	return TRUE;
 }
 
-GPtrArray *
-fu_engine_get_releases_for_device (FuEngine *self,
-				   FuEngineRequest *request,
-				   FuDevice *device,
-				   GError **error)
+static GPtrArray *
+fu_engine_build_releases_for_device (FuEngine *self,
+				     FuEngineRequest *request,
+				     FuDevice *device,
+				     GError **error)
 {
 	GPtrArray *device_guids;
 	GPtrArray *releases;
@@ -4438,6 +5024,69 @@ fu_engine_get_releases_for_device (FuEngine *self,
 	return releases;
 }
 
+/* everything about the device and client that the releases depend on */
+static gchar *
+fu_engine_get_releases_cache_key (FuEngine *self, FuEngineRequest *request, FuDevice *device)
+{
+	const gchar *version = fu_device_get_version (device);
+	const gchar *version_lowest = fu_device_get_version_lowest (device);
+	const gchar *branch = fu_device_get_branch (device);
+	return g_strdup_printf ("%s|%s|%s|%s|%u|%" G_GUINT64_FORMAT "|%" G_GUINT64_FORMAT,
+				fu_device_get_id (device),
+				version != NULL ? version : "",
+				version_lowest != NULL ? version_lowest : "",
+				branch != NULL ? branch : "",
+				(guint) fu_device_get_version_format (device),
+				fu_device_get_flags (device),
+				(guint64) fu_engine_request_get_feature_flags (request));
+}
+
+/* the cached releases are shared, so callers get their own copy to modify */
+static FwupdRelease *
+fu_engine_release_copy (FwupdRelease *rel)
+{
+	g_autoptr(GVariant) value = fwupd_release_to_variant (rel);
+	FwupdRelease *rel_new = fwupd_release_from_variant (value);
+	fwupd_release_set_update_message (rel_new, fwupd_release_get_update_message (rel));
+	fwupd_release_set_update_image (rel_new, fwupd_release_get_update_image (rel));
+	return rel_new;
+}
+
+GPtrArray *
+fu_engine_get_releases_for_device (FuEngine *self,
+				   FuEngineRequest *request,
+				   FuDevice *device,
+				   GError **error)
+{
+	FuEngineReleasesItem *item;
+	g_autofree gchar *key = NULL;
+
+	/* the requirements and releases only change when the device, the
+	 * silo or the approved and blocked lists do */
+	key = fu_engine_get_releases_cache_key (self, request, device);
+	item = g_hash_table_lookup (self->releases_cache, key);
+	if (item == NULL) {
+		g_autoptr(GError) error_local = NULL;
+		item = g_new0 (FuEngineReleasesItem, 1);
+		item->releases = fu_engine_build_releases_for_device (self,
+								      request,
+								      device,
+								      &error_local);
+		if (item->releases == NULL)
+			item->error = g_steal_pointer (&error_local);
+
+		/* the device flags may have changed when adding releases */
+		g_free (key);
+		key = fu_engine_get_releases_cache_key (self, request, device);
+		g_hash_table_insert (self->releases_cache, g_steal_pointer (&key), item);
+	}
+	if (item->releases == NULL) {
+		g_propagate_error (error, g_error_copy (item->error));
+		return NULL;
+	}
+	return g_ptr_array_copy (item->releases, (GCopyFunc) fu_engine_release_copy, NULL);
+}
+
 /**
  * fu_engine_get_releases:
  * @self: A #FuEngine
@@ -4478,7 +5127,7 @@ fu_engine_get_releases (FuEngine *self,
 				     "No releases for device");
 		return NULL;
 	}
-	g_ptr_array_sort_with_data (releases, fu_engine_sort_releases_cb, device);
+	fu_engine_sort_releases_by_version (device, releases);
 	return g_steal_pointer (&releases);
 }
 
@@ -4582,7 +5231,7 @@ fu_engine_get_downgrades (FuEngine *self,
 		}
 		return NULL;
 	}
-	g_ptr_array_sort_with_data (releases, fu_engine_sort_releases_cb, device);
+	fu_engine_sort_releases_by_version (device, releases);
 	return g_steal_pointer (&releases);
 }
 
@@ -4610,6 +5259,7 @@ fu_engine_add_approved_firmware (FuEngine *self, const gchar *checksum)
 								 NULL);
 	}
 	g_hash_table_add (self->approved_firmware, g_strdup (checksum));
+	fu_engine_invalidate (self);
 }
 
 GPtrArray *
@@ -4636,6 +5286,7 @@ fu_engine_add_blocked_firmware (FuEngine *self, const gchar *checksum)
 								NULL);
 	}
 	g_hash_table_add (self->blocked_firmware, g_strdup (checksum));
+	fu_engine_invalidate (self);
 }
 
 gboolean
@@ -4646,6 +5297,7 @@ fu_engine_set_blocked_firmware (FuEngine *self, GPtrArray *checksums, GError **e
 		g_hash_table_unref (self->blocked_firmware);
 		self->blocked_firmware = NULL;
 	}
+	fu_engine_invalidate (self);
 	for (guint i = 0; i < checksums->len; i++) {
 		const gchar *csum = g_ptr_array_index (checksums, i);
 		fu_engine_add_blocked_firmware (self, csum);
@@ -4800,7 +5452,7 @@ fu_engine_get_upgrades (FuEngine *self,
 		}
 		return NULL;
 	}
-	g_ptr_array_sort_with_data (releases, fu_engine_sort_releases_cb, device);
+	fu_engine_sort_releases_by_version (device, releases);
 	return g_steal_pointer (&releases);
 }
 
@@ -4906,16 +5558,14 @@ fu_engine_plugins_setup (FuEngine *self)
 }
 
 static void
-fu_engine_plugins_coldplug (FuEngine *self, gboolean is_recoldplug)
+fu_engine_plugins_coldplug_prepare (FuEngine *self)
 {
-	GPtrArray *plugins;
-	g_autoptr(GString) str = g_string_new (NULL);
+	GPtrArray *plugins = fu_plugin_list_get_all (self->plugin_list);
 
 	/* don't allow coldplug to be scheduled when in coldplug */
 	self->coldplug_running = TRUE;
 
 	/* prepare */
-	plugins = fu_plugin_list_get_all (self->plugin_list);
 	for (guint i = 0; i < plugins->len; i++) {
 		g_autoptr(GError) error = NULL;
 		FuPlugin *plugin = g_ptr_array_index (plugins, i);
@@ -4928,22 +5578,29 @@ fu_engine_plugins_coldplug (FuEngine *self, gboolean is_recoldplug)
 		g_debug ("sleeping for %ums", self->coldplug_delay);
 		g_usleep (self->coldplug_delay * 1000);
 	}
+}
 
-	/* exec */
-	for (guint i = 0; i < plugins->len; i++) {
-		g_autoptr(GError) error = NULL;
-		FuPlugin *plugin = g_ptr_array_index (plugins, i);
-		if (is_recoldplug) {
-			if (!fu_plugin_runner_recoldplug (plugin, &error))
-				g_message ("failed recoldplug: %s", error->message);
-		} else {
-			if (!fu_plugin_runner_coldplug (plugin, &error)) {
-				fu_plugin_set_enabled (plugin, FALSE);
-				g_message ("disabling plugin because: %s",
-					   error->message);
-			}
+static void
+fu_engine_plugin_coldplug (FuEngine *self, FuPlugin *plugin, gboolean is_recoldplug)
+{
+	g_autoptr(GError) error = NULL;
+	if (is_recoldplug) {
+		if (!fu_plugin_runner_recoldplug (plugin, &error))
+			g_message ("failed recoldplug: %s", error->message);
+	} else {
+		if (!fu_plugin_runner_coldplug (plugin, &error)) {
+			fu_plugin_set_enabled (plugin, FALSE);
+			g_message ("disabling plugin because: %s",
+				   error->message);
 		}
 	}
+}
+
+static void
+fu_engine_plugins_coldplug_cleanup (FuEngine *self)
+{
+	GPtrArray *plugins = fu_plugin_list_get_all (self->plugin_list);
+	g_autoptr(GString) str = g_string_new (NULL);
 
 	/* cleanup */
 	for (guint i = 0; i < plugins->len; i++) {
@@ -4969,6 +5626,18 @@ fu_engine_plugins_coldplug (FuEngine *self, gboolean is_recoldplug)
 	self->coldplug_running = FALSE;
 }
 
+static void
+fu_engine_plugins_coldplug (FuEngine *self, gboolean is_recoldplug)
+{
+	GPtrArray *plugins = fu_plugin_list_get_all (self->plugin_list);
+	fu_engine_plugins_coldplug_prepare (self);
+	for (guint i = 0; i < plugins->len; i++) {
+		FuPlugin *plugin = g_ptr_array_index (plugins, i);
+		fu_engine_plugin_coldplug (self, plugin, is_recoldplug);
+	}
+	fu_engine_plugins_coldplug_cleanup (self);
+}
+
 static void
 fu_engine_plugin_device_register (FuEngine *self, FuDevice *device)
 {
@@ -5111,6 +5780,7 @@ fu_engine_set_proxy_device (FuEngine *self, FuDevice *device)
 static void
 fu_engine_device_inherit_history (FuEngine *self, FuDevice *device)
 {
+	FwupdRelease *release_history;
 	g_autoptr(FuDevice) device_history = NULL;
 
 	/* any success or failed update? */
@@ -5120,6 +5790,13 @@ fu_engine_device_inherit_history (FuEngine *self, FuDevice *device)
 	if (device_history == NULL)
 		return;
 
+	/* reuse the completion timings from the last update */
+	release_history = fu_device_get_release_default (device_history);
+	if (release_history != NULL) {
+		fu_device_wait_profile_from_metadata (device,
+						      fwupd_release_get_metadata (release_history));
+	}
+
 	/* the device is still running the old firmware version and so if it
 	 * required activation before, it still requires it now -- note:
 	 * we can't just check for version_new=version to allow for re-installs */
@@ -5292,8 +5969,8 @@ fu_engine_plugin_security_changed_cb (FuPlugin *plugin, gpointer user_data)
 {
 	FuEngine *self = FU_ENGINE (user_data);
 
-	/* invalidate host security attributes */
-	g_clear_pointer (&self->host_security_id, g_free);
+	/* only this plugin needs to be asked again */
+	fu_engine_invalidate_security_attrs (self, fu_plugin_get_name (plugin));
 
 	/* make UI refresh */
 	fu_engine_emit_changed (self);
@@ -5400,6 +6077,9 @@ fu_engine_udev_device_add (FuEngine *self, GUdevDevice *udev_device)
 				   error->message);
 			continue;
 		}
+
+		/* the plugin may have read new hardware state */
+		fu_engine_invalidate_security_attrs (self, plugin_name);
 	}
 }
 
@@ -5475,7 +6155,10 @@ fu_engine_udev_changed_cb (gpointer user_data)
 				   fu_plugin_get_name (plugin_tmp),
 				   g_udev_device_get_sysfs_path (helper->udev_device),
 				   error->message);
+			continue;
 		}
+		fu_engine_invalidate_security_attrs (helper->self,
+						     fu_plugin_get_name (plugin_tmp));
 	}
 
 	/* device done, so remove ref */
@@ -5585,6 +6268,10 @@ fu_engine_add_plugin (FuEngine *self, FuPlugin *plugin)
 		}
 	}
 
+	/* only re-query this plugin for host security attributes */
+	g_signal_connect (plugin, "security-changed",
+			  G_CALLBACK (fu_engine_plugin_security_changed_cb),
+			  self);
 	fu_plugin_list_add (self->plugin_list, plugin);
 }
 
@@ -5772,6 +6459,83 @@ fu_engine_ensure_security_attrs_supported (FuEngine *self)
 	}
 }
 
+typedef struct {
+	FuPlugin		*plugin;
+	FuSecurityAttrs		*attrs;
+} FuEngineSecurityAttrsHelper;
+
+static void
+fu_engine_security_attrs_helper_free (FuEngineSecurityAttrsHelper *helper)
+{
+	g_object_unref (helper->plugin);
+	g_object_unref (helper->attrs);
+	g_free (helper);
+}
+
+static void
+fu_engine_security_attrs_thread_cb (gpointer data, gpointer user_data)
+{
+	FuEngineSecurityAttrsHelper *helper = (FuEngineSecurityAttrsHelper *) data;
+	fu_plugin_runner_add_security_attrs (helper->plugin, helper->attrs);
+}
+
+/* ask each plugin without cached attributes, using threads if there are many */
+static void
+fu_engine_ensure_security_attrs_plugins (FuEngine *self)
+{
+	GPtrArray *plugins = fu_plugin_list_get_all (self->plugin_list);
+	GThreadPool *pool = NULL;
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GPtrArray) helpers = NULL;
+
+	helpers = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_engine_security_attrs_helper_free);
+	for (guint j = 0; j < plugins->len; j++) {
+		FuPlugin *plugin_tmp = g_ptr_array_index (plugins, j);
+		FuEngineSecurityAttrsHelper *helper;
+		if (g_hash_table_contains (self->security_attrs_plugin,
+					   fu_plugin_get_name (plugin_tmp)))
+			continue;
+		helper = g_new0 (FuEngineSecurityAttrsHelper, 1);
+		helper->plugin = g_object_ref (plugin_tmp);
+		helper->attrs = fu_security_attrs_new ();
+		g_ptr_array_add (helpers, helper);
+	}
+	if (helpers->len == 0)
+		return;
+
+	/* the plugins only read hardware state into their own attrs, and the
+	 * main loop is not running until the pool is drained */
+	if (helpers->len > 1) {
+		pool = g_thread_pool_new (fu_engine_security_attrs_thread_cb, NULL,
+					  (gint) g_get_num_processors (),
+					  TRUE, &error_local);
+		if (pool == NULL)
+			g_warning ("failed to create thread pool: %s", error_local->message);
+	}
+	for (guint i = 0; i < helpers->len; i++) {
+		FuEngineSecurityAttrsHelper *helper = g_ptr_array_index (helpers, i);
+		if (pool != NULL) {
+			g_autoptr(GError) error_push = NULL;
+			if (g_thread_pool_push (pool, helper, &error_push))
+				continue;
+			g_warning ("failed to push %s: %s",
+				   fu_plugin_get_name (helper->plugin),
+				   error_push->message);
+		}
+		fu_engine_security_attrs_thread_cb (helper, NULL);
+	}
+	if (pool != NULL)
+		g_thread_pool_free (pool, FALSE, TRUE);
+
+	/* save for next time */
+	for (guint i = 0; i < helpers->len; i++) {
+		FuEngineSecurityAttrsHelper *helper = g_ptr_array_index (helpers, i);
+		g_hash_table_insert (self->security_attrs_plugin,
+				     g_strdup (fu_plugin_get_name (helper->plugin)),
+				     g_object_ref (helper->attrs));
+	}
+}
+
 static void
 fu_engine_ensure_security_attrs (FuEngine *self)
 {
@@ -5789,10 +6553,22 @@ fu_engine_ensure_security_attrs (FuEngine *self)
 	fu_engine_ensure_security_attrs_tainted (self);
 	fu_engine_ensure_security_attrs_supported (self);
 
-	/* call into plugins */
+	/* call into plugins, reusing the attributes that have not changed */
+	fu_engine_ensure_security_attrs_plugins (self);
 	for (guint j = 0; j < plugins->len; j++) {
 		FuPlugin *plugin_tmp = g_ptr_array_index (plugins, j);
-		fu_plugin_runner_add_security_attrs (plugin_tmp, self->host_security_attrs);
+		FuSecurityAttrs *attrs_tmp;
+		g_autoptr(GPtrArray) items_tmp = NULL;
+
+		attrs_tmp = g_hash_table_lookup (self->security_attrs_plugin,
+						 fu_plugin_get_name (plugin_tmp));
+		if (attrs_tmp == NULL)
+			continue;
+		items_tmp = fu_security_attrs_get_all (attrs_tmp);
+		for (guint i = 0; i < items_tmp->len; i++) {
+			FwupdSecurityAttr *attr = g_ptr_array_index (items_tmp, i);
+			fu_security_attrs_append (self->host_security_attrs, attr);
+		}
 	}
 
 	/* set the fallback names for clients without native translations */
@@ -5881,6 +6657,7 @@ fu_engine_load_plugins (FuEngine *self, GError **error)
 		fu_plugin_set_usb_context (plugin, self->usb_ctx);
 		fu_plugin_set_hwids (plugin, self->hwids);
 		fu_plugin_set_smbios (plugin, self->smbios);
+		fu_plugin_set_msr_snapshot (plugin, self->msr_snapshot);
 		fu_plugin_set_udev_subsystems (plugin, self->udev_subsystems);
 		fu_plugin_set_quirks (plugin, self->quirks);
 		fu_plugin_set_runtime_versions (plugin, self->runtime_versions);
@@ -5925,9 +6702,6 @@ fu_engine_load_plugins (FuEngine *self, GError **error)
 		g_signal_connect (plugin, "rules-changed",
 				  G_CALLBACK (fu_engine_plugin_rules_changed_cb),
 				  self);
-		g_signal_connect (plugin, "security-changed",
-				  G_CALLBACK (fu_engine_plugin_security_changed_cb),
-				  self);
 
 		/* add */
 		fu_engine_add_plugin (self, plugin);
@@ -6257,6 +7031,300 @@ fu_engine_ensure_client_certificate (FuEngine *self)
 	g_debug ("client certificate exists and working");
 }
 
+static gboolean
+fu_engine_load_finish (FuEngine *self, GError **error)
+{
+	/* set device properties from the metadata */
+	fu_engine_md_refresh_devices (self);
+
+	/* update the db for devices that were updated during the reboot */
+	if (!fu_engine_update_history_database (self, error))
+		return FALSE;
+
+	fu_engine_set_status (self, FWUPD_STATUS_IDLE);
+	self->loaded = TRUE;
+
+	/* let clients know engine finished starting up */
+	fu_engine_emit_changed (self);
+
+	/* success */
+	return TRUE;
+}
+
+static gchar *
+fu_engine_get_boot_id (void)
+{
+	g_autofree gchar *procfs = fu_common_get_path (FU_PATH_KIND_PROCFS);
+	g_autofree gchar *fn = NULL;
+	g_autofree gchar *buf = NULL;
+
+	fn = g_build_filename (procfs, "sys", "kernel", "random", "boot_id", NULL);
+	if (!g_file_get_contents (fn, &buf, NULL, NULL))
+		return NULL;
+	return g_strdup (g_strstrip (buf));
+}
+
+static gchar *
+fu_engine_get_snapshot_filename (void)
+{
+	g_autofree gchar *cachedir = fu_common_get_path (FU_PATH_KIND_CACHEDIR_PKG);
+	return g_build_filename (cachedir, "devices.snapshot", NULL);
+}
+
+static GVariant *
+fu_engine_plugin_names_to_variant (FuEngine *self)
+{
+	GPtrArray *plugins = fu_plugin_list_get_all (self->plugin_list);
+	GVariantBuilder builder;
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("as"));
+	for (guint i = 0; i < plugins->len; i++) {
+		FuPlugin *plugin = g_ptr_array_index (plugins, i);
+		g_variant_builder_add (&builder, "s", fu_plugin_get_name (plugin));
+	}
+	return g_variant_builder_end (&builder);
+}
+
+/**
+ * fu_engine_save_snapshot:
+ * @self: A #FuEngine
+ * @error: A #GError, or %NULL
+ *
+ * Saves the device list so that the next daemon instance started in the same
+ * boot can answer requests before the hardware has been enumerated.
+ *
+ * Returns: %TRUE for success
+ **/
+gboolean
+fu_engine_save_snapshot (FuEngine *self, GError **error)
+{
+	GVariantBuilder builder;
+	GVariantBuilder builder_devices;
+	g_autofree gchar *boot_id = fu_engine_get_boot_id ();
+	g_autofree gchar *fn = fu_engine_get_snapshot_filename ();
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GPtrArray) devices = NULL;
+	g_autoptr(GVariant) val = NULL;
+
+	g_return_val_if_fail (FU_IS_ENGINE (self), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	/* the device list is not complete */
+	if (!self->loaded || self->enumerate_id != 0) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INTERNAL,
+				     "engine has not finished loading");
+		return FALSE;
+	}
+	if (boot_id == NULL) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_NOT_SUPPORTED,
+				     "no boot ID");
+		return FALSE;
+	}
+
+	/* no serial numbers as this is not a trusted client */
+	g_variant_builder_init (&builder_devices, G_VARIANT_TYPE ("aa{sv}"));
+	devices = fu_device_list_get_active (self->device_list);
+	g_ptr_array_sort (devices, fu_engine_sort_devices_by_priority_name);
+	for (guint i = 0; i < devices->len; i++) {
+		FuDevice *device = g_ptr_array_index (devices, i);
+		g_variant_builder_add_value (&builder_devices,
+					     fwupd_device_to_variant (FWUPD_DEVICE (device)));
+	}
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+	g_variant_builder_add (&builder, "{sv}", "Version",
+			       g_variant_new_string (PACKAGE_VERSION));
+	g_variant_builder_add (&builder, "{sv}", "BootId",
+			       g_variant_new_string (boot_id));
+	g_variant_builder_add (&builder, "{sv}", "Plugins",
+			       fu_engine_plugin_names_to_variant (self));
+	g_variant_builder_add (&builder, "{sv}", "Devices",
+			       g_variant_builder_end (&builder_devices));
+	val = g_variant_ref_sink (g_variant_builder_end (&builder));
+	blob = g_variant_get_data_as_bytes (val);
+	g_debug ("saving snapshot of %u devices to %s", devices->len, fn);
+	if (!fu_common_mkdir_parent (fn, error))
+		return FALSE;
+	return fu_common_set_contents_bytes (fn, blob, error);
+}
+
+/* only valid for the same boot, daemon version and set of plugins */
+static GPtrArray *
+fu_engine_load_snapshot (FuEngine *self, GError **error)
+{
+	const gchar *tmp = NULL;
+	gsize bufsz = 0;
+	g_autofree gchar *boot_id = fu_engine_get_boot_id ();
+	g_autofree gchar *buf = NULL;
+	g_autofree gchar *fn = fu_engine_get_snapshot_filename ();
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GPtrArray) devices = NULL;
+	g_autoptr(GPtrArray) devices_tmp = NULL;
+	g_autoptr(GVariant) val = NULL;
+	g_autoptr(GVariant) val_devices = NULL;
+	g_autoptr(GVariant) val_plugins = NULL;
+	g_autoptr(GVariant) val_plugins_now = NULL;
+	g_autoptr(GVariant) val_tuple = NULL;
+
+	if (!g_file_get_contents (fn, &buf, &bufsz, error))
+		return NULL;
+	blob = g_bytes_new_take (g_steal_pointer (&buf), bufsz);
+	val = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE_VARDICT,
+							    blob, FALSE));
+	if (!g_variant_lookup (val, "Version", "&s", &tmp) ||
+	    g_strcmp0 (tmp, PACKAGE_VERSION) != 0) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "saved by a different version");
+		return NULL;
+	}
+	if (!g_variant_lookup (val, "BootId", "&s", &tmp) ||
+	    boot_id == NULL || g_strcmp0 (tmp, boot_id) != 0) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "saved in a different boot");
+		return NULL;
+	}
+	val_plugins = g_variant_lookup_value (val, "Plugins", G_VARIANT_TYPE ("as"));
+	val_plugins_now = g_variant_ref_sink (fu_engine_plugin_names_to_variant (self));
+	if (val_plugins == NULL || !g_variant_equal (val_plugins, val_plugins_now)) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "saved with different plugins");
+		return NULL;
+	}
+	val_devices = g_variant_lookup_value (val, "Devices", G_VARIANT_TYPE ("aa{sv}"));
+	if (val_devices == NULL || g_variant_n_children (val_devices) == 0) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_NOTHING_TO_DO,
+				     "no devices saved");
+		return NULL;
+	}
+
+	/* clients expect FuDevice objects */
+	devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	val_tuple = g_variant_ref_sink (g_variant_new_tuple (&val_devices, 1));
+	devices_tmp = fwupd_device_array_from_variant (val_tuple);
+	for (guint i = 0; i < devices_tmp->len; i++) {
+		FwupdDevice *device_tmp = g_ptr_array_index (devices_tmp, i);
+		FuDevice *device = fu_device_new ();
+		fwupd_device_incorporate (FWUPD_DEVICE (device), device_tmp);
+		g_ptr_array_add (devices, device);
+	}
+	return g_steal_pointer (&devices);
+}
+
+/* anything in the snapshot that was not found again has gone away */
+static void
+fu_engine_snapshot_reconcile (FuEngine *self)
+{
+	g_autoptr(GPtrArray) devices = g_steal_pointer (&self->snapshot_devices);
+	if (devices == NULL)
+		return;
+	for (guint i = 0; i < devices->len; i++) {
+		FuDevice *device = g_ptr_array_index (devices, i);
+		g_autoptr(FuDevice) device_tmp = NULL;
+		device_tmp = fu_device_list_get_by_id (self->device_list,
+						       fu_device_get_id (device),
+						       NULL);
+		if (device_tmp != NULL)
+			continue;
+		g_debug ("snapshot device %s no longer exists",
+			 fu_device_get_id (device));
+		g_signal_emit (self, signals[SIGNAL_DEVICE_REMOVED], 0, device);
+	}
+	fu_engine_invalidate (self);
+}
+
+/* one plugin at a time so that D-Bus requests get answered in between */
+static gboolean
+fu_engine_enumerate_cb (gpointer user_data)
+{
+	FuEngine *self = FU_ENGINE (user_data);
+	GPtrArray *plugins = fu_plugin_list_get_all (self->plugin_list);
+	g_autoptr(GError) error_local = NULL;
+
+	switch (self->enumerate_step) {
+	case FU_ENGINE_ENUMERATE_STEP_PREPARE:
+		fu_engine_plugins_coldplug_prepare (self);
+		self->enumerate_step = FU_ENGINE_ENUMERATE_STEP_COLDPLUG;
+		return G_SOURCE_CONTINUE;
+	case FU_ENGINE_ENUMERATE_STEP_COLDPLUG:
+		if (self->enumerate_idx < plugins->len) {
+			FuPlugin *plugin = g_ptr_array_index (plugins, self->enumerate_idx++);
+			fu_engine_plugin_coldplug (self, plugin, FALSE);
+			return G_SOURCE_CONTINUE;
+		}
+		fu_engine_plugins_coldplug_cleanup (self);
+		self->enumerate_step = FU_ENGINE_ENUMERATE_STEP_USB;
+		return G_SOURCE_CONTINUE;
+	case FU_ENGINE_ENUMERATE_STEP_USB:
+		g_usb_context_enumerate (self->usb_ctx);
+		self->enumerate_step = FU_ENGINE_ENUMERATE_STEP_UDEV;
+		return G_SOURCE_CONTINUE;
+	case FU_ENGINE_ENUMERATE_STEP_UDEV:
+#ifdef HAVE_GUDEV
+		fu_engine_enumerate_udev (self);
+#endif
+		break;
+	default:
+		break;
+	}
+
+	/* done */
+	self->enumerate_id = 0;
+	fu_engine_snapshot_reconcile (self);
+
+	/* the HSI may have been calculated with only some of the devices */
+	g_clear_pointer (&self->host_security_id, g_free);
+	if (!fu_engine_load_finish (self, &error_local)) {
+		g_warning ("failed to finish loading: %s", error_local->message);
+
+		/* the daemon is waiting for this to answer deferred requests */
+		fu_engine_set_status (self, FWUPD_STATUS_IDLE);
+		fu_engine_emit_changed (self);
+	}
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * fu_engine_is_enumerating:
+ * @self: A #FuEngine
+ *
+ * Gets if the engine is still enumerating hardware from the main loop, in
+ * which case the devices returned may be incomplete or from a snapshot.
+ *
+ * Returns: %TRUE if not all devices have been added
+ **/
+gboolean
+fu_engine_is_enumerating (FuEngine *self)
+{
+	g_return_val_if_fail (FU_IS_ENGINE (self), FALSE);
+	return self->enumerate_id != 0;
+}
+
+/**
+ * fu_engine_has_snapshot:
+ * @self: A #FuEngine
+ *
+ * Gets if the devices are being returned from the last snapshot while the
+ * engine is enumerating hardware.
+ *
+ * Returns: %TRUE if a snapshot is in use
+ **/
+gboolean
+fu_engine_has_snapshot (FuEngine *self)
+{
+	g_return_val_if_fail (FU_IS_ENGINE (self), FALSE);
+	return self->snapshot_devices != NULL;
+}
+
 /**
  * fu_engine_load:
  * @self: A #FuEngine
@@ -6410,40 +7478,45 @@ fu_engine_load (FuEngine *self, FuEngineLoadFlags flags, GError **error)
 
 	/* add devices */
 	fu_engine_plugins_setup (self);
-	if ((flags & FU_ENGINE_LOAD_FLAG_NO_ENUMERATE) == 0)
-		fu_engine_plugins_coldplug (self, FALSE);
-
-	/* coldplug USB devices */
 	g_signal_connect (self->usb_ctx, "device-added",
 			  G_CALLBACK (fu_engine_usb_device_added_cb),
 			  self);
 	g_signal_connect (self->usb_ctx, "device-removed",
 			  G_CALLBACK (fu_engine_usb_device_removed_cb),
 			  self);
-	if ((flags & FU_ENGINE_LOAD_FLAG_NO_ENUMERATE) == 0)
-		g_usb_context_enumerate (self->usb_ctx);
 
+	/* answer from the last snapshot while the hardware is enumerated */
+	if ((flags & FU_ENGINE_LOAD_FLAG_SNAPSHOT) > 0 &&
+	    (flags & FU_ENGINE_LOAD_FLAG_NO_ENUMERATE) == 0) {
+		g_autoptr(GError) error_local = NULL;
+		self->snapshot_devices = fu_engine_load_snapshot (self, &error_local);
+		if (self->snapshot_devices != NULL) {
+			g_debug ("using snapshot of %u devices while enumerating",
+				 self->snapshot_devices->len);
+			flags |= FU_ENGINE_LOAD_FLAG_ENUMERATE_IDLE;
+		} else {
+			g_debug ("not using snapshot: %s", error_local->message);
+		}
+	}
+
+	/* devices get published as they are added */
+	if ((flags & FU_ENGINE_LOAD_FLAG_ENUMERATE_IDLE) > 0 &&
+	    (flags & FU_ENGINE_LOAD_FLAG_NO_ENUMERATE) == 0) {
+		self->enumerate_step = FU_ENGINE_ENUMERATE_STEP_PREPARE;
+		self->enumerate_idx = 0;
+		self->enumerate_id = g_idle_add (fu_engine_enumerate_cb, self);
+		return TRUE;
+	}
+
+	/* coldplug plugins, then USB and udev devices */
+	if ((flags & FU_ENGINE_LOAD_FLAG_NO_ENUMERATE) == 0) {
+		fu_engine_plugins_coldplug (self, FALSE);
+		g_usb_context_enumerate (self->usb_ctx);
 #ifdef HAVE_GUDEV
-	/* coldplug udev devices */
-	if ((flags & FU_ENGINE_LOAD_FLAG_NO_ENUMERATE) == 0)
 		fu_engine_enumerate_udev (self);
 #endif
-
-	/* set device properties from the metadata */
-	fu_engine_md_refresh_devices (self);
-
-	/* update the db for devices that were updated during the reboot */
-	if (!fu_engine_update_history_database (self, error))
-		return FALSE;
-
-	fu_engine_set_status (self, FWUPD_STATUS_IDLE);
-	self->loaded = TRUE;
-
-	/* let clients know engine finished starting up */
-	fu_engine_emit_changed (self);
-
-	/* success */
-	return TRUE;
+	}
+	return fu_engine_load_finish (self, error);
 }
 
 static void
@@ -6519,7 +7592,10 @@ fu_engine_init (FuEngine *self)
 	g_autofree gchar *pkidir_fw = NULL;
 	g_autofree gchar *pkidir_md = NULL;
 	g_autofree gchar *sysconfdir = NULL;
+	g_autofree gchar *cachedir = NULL;
+	g_autofree gchar *jcat_cache_fn = NULL;
 	self->percentage = 0;
+	self->percentage_devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 	self->status = FWUPD_STATUS_IDLE;
 	self->config = fu_config_new ();
 	self->remote_list = fu_remote_list_new ();
@@ -6532,6 +7608,9 @@ fu_engine_init (FuEngine *self)
 	self->plugin_list = fu_plugin_list_new ();
 	self->plugin_filter = g_ptr_array_new_with_free_func (g_free);
 	self->host_security_attrs = fu_security_attrs_new ();
+	self->msr_snapshot = fu_msr_snapshot_new ();
+	self->security_attrs_plugin = g_hash_table_new_full (g_str_hash, g_str_equal,
+							     g_free, (GDestroyNotify) g_object_unref);
 	self->udev_subsystems = g_ptr_array_new_with_free_func (g_free);
 #ifdef HAVE_GUDEV
 	self->udev_changed_ids = g_hash_table_new_full (g_str_hash, g_str_equal,
@@ -6540,6 +7619,8 @@ fu_engine_init (FuEngine *self)
 	self->runtime_versions = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
 	self->compile_versions = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
 	self->firmware_gtypes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	self->releases_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+						      (GDestroyNotify) fu_engine_releases_item_free);
 
 	g_signal_connect (self->config, "changed",
 			  G_CALLBACK (fu_engine_config_changed_cb),
@@ -6561,6 +7642,14 @@ fu_engine_init (FuEngine *self)
 	pkidir_md = g_build_filename (sysconfdir, "pki", "fwupd-metadata", NULL);
 	jcat_context_add_public_keys (self->jcat_context, pkidir_md);
 
+	/* verification results are only valid for the same public keys */
+	self->jcat_cache = fu_jcat_cache_new ();
+	cachedir = fu_common_get_path (FU_PATH_KIND_CACHEDIR_PKG);
+	jcat_cache_fn = g_build_filename (cachedir, "jcat.cache", NULL);
+	fu_jcat_cache_set_filename (self->jcat_cache, jcat_cache_fn);
+	fu_jcat_cache_add_keyring_path (self->jcat_cache, pkidir_fw);
+	fu_jcat_cache_add_keyring_path (self->jcat_cache, pkidir_md);
+
 	/* add some runtime versions of things the daemon depends on */
 	fu_engine_add_runtime_version (self, "org.freedesktop.fwupd", VERSION);
 	fu_engine_add_runtime_version (self, "com.redhat.fwupdate", "12");
@@ -6600,12 +7689,23 @@ fu_engine_finalize (GObject *obj)
 		g_object_unref (self->usb_ctx);
 	if (self->silo != NULL)
 		g_object_unref (self->silo);
+	if (self->checksum_remote_ids != NULL)
+		g_hash_table_unref (self->checksum_remote_ids);
 #ifdef HAVE_GUDEV
 	if (self->gudev_client != NULL)
 		g_object_unref (self->gudev_client);
 #endif
 	if (self->coldplug_id != 0)
 		g_source_remove (self->coldplug_id);
+	if (self->percentage_id != 0)
+		g_source_remove (self->percentage_id);
+	g_ptr_array_unref (self->percentage_devices);
+	if (self->progress_stream != NULL)
+		g_object_unref (self->progress_stream);
+	if (self->enumerate_id != 0)
+		g_source_remove (self->enumerate_id);
+	if (self->snapshot_devices != NULL)
+		g_ptr_array_unref (self->snapshot_devices);
 	if (self->approved_firmware != NULL)
 		g_hash_table_unref (self->approved_firmware);
 	if (self->blocked_firmware != NULL)
@@ -6614,6 +7714,8 @@ fu_engine_finalize (GObject *obj)
 	g_free (self->host_machine_id);
 	g_free (self->host_security_id);
 	g_object_unref (self->host_security_attrs);
+	g_object_unref (self->msr_snapshot);
+	g_hash_table_unref (self->security_attrs_plugin);
 	g_object_unref (self->idle);
 	g_object_unref (self->config);
 	g_object_unref (self->remote_list);
@@ -6623,6 +7725,7 @@ fu_engine_finalize (GObject *obj)
 	g_object_unref (self->history);
 	g_object_unref (self->device_list);
 	g_object_unref (self->jcat_context);
+	g_object_unref (self->jcat_cache);
 	g_ptr_array_unref (self->plugin_filter);
 	g_ptr_array_unref (self->udev_subsystems);
 #ifdef HAVE_GUDEV
@@ -6631,8 +7734,16 @@ fu_engine_finalize (GObject *obj)
 	g_hash_table_unref (self->runtime_versions);
 	g_hash_table_unref (self->compile_versions);
 	g_hash_table_unref (self->firmware_gtypes);
+	g_hash_table_unref (self->releases_cache);
+#if LIBXMLB_CHECK_VERSION(0,2,0)
+	if (self->query_releases != NULL)
+		g_object_unref (self->query_releases);
+#endif
 	g_object_unref (self->plugin_list);
 
+	/* created on demand when the plugins looked for volumes */
+	fu_common_udisks_shutdown ();
+
 	G_OBJECT_CLASS (fu_engine_parent_class)->finalize (obj);
 }
 
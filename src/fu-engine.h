@@ -26,6 +26,9 @@ G_DECLARE_FINAL_TYPE (FuEngine, fu_engine, FU, ENGINE, GObject)
  * FuEngineLoadFlags:
  * @FU_ENGINE_LOAD_FLAG_NONE:		No flags set
  * @FU_ENGINE_LOAD_FLAG_READONLY_FS:	Ignore readonly filesystem errors
+ * @FU_ENGINE_LOAD_FLAG_NO_ENUMERATE:	Do not enumerate any hardware
+ * @FU_ENGINE_LOAD_FLAG_SNAPSHOT:	Return devices from the last snapshot while enumerating
+ * @FU_ENGINE_LOAD_FLAG_ENUMERATE_IDLE:	Enumerate from the main loop after returning
  *
  * The flags to use when loading the engine.
  **/
@@ -33,6 +36,8 @@ typedef enum {
 	FU_ENGINE_LOAD_FLAG_NONE		= 0,
 	FU_ENGINE_LOAD_FLAG_READONLY_FS		= 1 << 0,
 	FU_ENGINE_LOAD_FLAG_NO_ENUMERATE	= 1 << 1,
+	FU_ENGINE_LOAD_FLAG_SNAPSHOT		= 1 << 2,
+	FU_ENGINE_LOAD_FLAG_ENUMERATE_IDLE	= 1 << 3,
 	/*< private >*/
 	FU_ENGINE_LOAD_FLAG_LAST
 } FuEngineLoadFlags;
@@ -52,11 +57,18 @@ gboolean	 fu_engine_get_tainted			(FuEngine	*self);
 const gchar	*fu_engine_get_host_product		(FuEngine *self);
 const gchar	*fu_engine_get_host_machine_id		(FuEngine *self);
 const gchar	*fu_engine_get_host_security_id		(FuEngine	*self);
+guint64		 fu_engine_get_generation		(FuEngine	*self);
+gboolean	 fu_engine_is_enumerating		(FuEngine	*self);
+gboolean	 fu_engine_has_snapshot			(FuEngine	*self);
+gboolean	 fu_engine_save_snapshot		(FuEngine	*self,
+							 GError		**error);
 FwupdStatus	 fu_engine_get_status			(FuEngine	*self);
 XbSilo		*fu_engine_get_silo_from_blob		(FuEngine	*self,
 							 GBytes		*blob_cab,
 							 GError		**error);
 guint64		 fu_engine_get_archive_size_max		(FuEngine	*self);
+void		 fu_engine_set_progress_stream		(FuEngine	*self,
+							 GOutputStream	*stream);
 GPtrArray	*fu_engine_get_plugins			(FuEngine	*self);
 GPtrArray	*fu_engine_get_devices			(FuEngine	*self,
 							 GError		**error);
@@ -11,7 +11,9 @@
 #include <xmlb.h>
 #include <fwupd.h>
 #include <gio/gunixfdlist.h>
+#include <gio/gunixoutputstream.h>
 #include <glib/gi18n.h>
+#include <glib/gstdio.h>
 #include <glib-unix.h>
 #include <locale.h>
 #include <polkit/polkit.h>
@@ -40,6 +42,10 @@ G_DEFINE_AUTOPTR_CLEANUP_FUNC(PolkitSubject, g_object_unref)
 #pragma clang diagnostic pop
 #endif
 
+/* one entry per method, caller and argument, so this only matters for
+ * clients asking about lots of different device IDs */
+#define FU_MAIN_REPLY_CACHE_MAX			64
+
 typedef enum {
 	FU_MAIN_MACHINE_KIND_PHYSICAL,
 	FU_MAIN_MACHINE_KIND_VIRTUAL,
@@ -53,6 +59,10 @@ typedef struct {
 	GMainLoop		*loop;
 	GFileMonitor		*argv0_monitor;
 	GHashTable		*sender_features;	/* sender:FwupdFeatureFlags */
+	GHashTable		*reply_cache;		/* key:FuMainReplyItem */
+	GQueue			 reply_cache_lru;	/* of key, most recent first */
+	GPtrArray		*pending_calls;		/* of FuMainMethodCall */
+	guint64			 reply_cache_generation;
 #if GLIB_CHECK_VERSION(2,63,3)
 	GMemoryMonitor		*memory_monitor;
 #endif
@@ -61,9 +71,119 @@ typedef struct {
 	FuEngine		*engine;
 	gboolean		 update_in_progress;
 	gboolean		 pending_sigterm;
+	gboolean		 enumerating;
 	FuMainMachineKind	 machine_kind;
 } FuMainPrivate;
 
+typedef struct {
+	GVariant		*val;			/* (nullable) */
+	GError			*error;			/* (nullable) */
+	GList			*link;			/* in reply_cache_lru */
+} FuMainReplyItem;
+
+typedef struct {
+	GDBusConnection		*connection;
+	gchar			*sender;
+	gchar			*object_path;
+	gchar			*interface_name;
+	gchar			*method_name;
+	GVariant		*parameters;
+	GDBusMethodInvocation	*invocation;
+} FuMainMethodCall;
+
+static void
+fu_main_reply_item_free (FuMainReplyItem *item)
+{
+	if (item->val != NULL)
+		g_variant_unref (item->val);
+	if (item->error != NULL)
+		g_error_free (item->error);
+	g_free (item);
+}
+
+static void
+fu_main_method_call_free (FuMainMethodCall *call)
+{
+	g_object_unref (call->connection);
+	g_free (call->sender);
+	g_free (call->object_path);
+	g_free (call->interface_name);
+	g_free (call->method_name);
+	g_variant_unref (call->parameters);
+	g_object_unref (call->invocation);
+	g_free (call);
+}
+
+static void fu_main_daemon_method_call (GDBusConnection *connection,
+					const gchar *sender,
+					const gchar *object_path,
+					const gchar *interface_name,
+					const gchar *method_name,
+					GVariant *parameters,
+					GDBusMethodInvocation *invocation,
+					gpointer user_data);
+
+static void fu_main_emit_property_changed (FuMainPrivate *priv,
+					   const gchar *property_name,
+					   GVariant *property_value);
+
+/* the device list is only complete when from a snapshot, so a partial list
+ * is only returned to clients that can show devices as they are added */
+static gboolean
+fu_main_method_is_devices_safe (FuMainPrivate *priv, const gchar *sender)
+{
+	FwupdFeatureFlags *feature_flags;
+
+	if (fu_engine_has_snapshot (priv->engine))
+		return TRUE;
+	feature_flags = g_hash_table_lookup (priv->sender_features, sender);
+	if (feature_flags == NULL)
+		return FALSE;
+	return (*feature_flags & FWUPD_FEATURE_FLAG_PARTIAL_DEVICES) > 0;
+}
+
+/* these do not need the hardware to have been enumerated */
+static gboolean
+fu_main_method_is_snapshot_safe (FuMainPrivate *priv,
+				 const gchar *sender,
+				 const gchar *method_name)
+{
+	const gchar *method_names[] = {
+		"GetRemotes",
+		"GetHistory",
+		"GetApprovedFirmware",
+		"GetBlockedFirmware",
+		"SetFeatureFlags",
+		NULL };
+	if (g_strcmp0 (method_name, "GetDevices") == 0 ||
+	    g_strcmp0 (method_name, "GetDevicesWithKeys") == 0)
+		return fu_main_method_is_devices_safe (priv, sender);
+	return g_strv_contains (method_names, method_name);
+}
+
+static void
+fu_main_replay_pending_calls (FuMainPrivate *priv)
+{
+	g_autoptr(GPtrArray) pending_calls = NULL;
+
+	if (priv->pending_calls->len == 0)
+		return;
+	pending_calls = g_steal_pointer (&priv->pending_calls);
+	priv->pending_calls = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_main_method_call_free);
+	for (guint i = 0; i < pending_calls->len; i++) {
+		FuMainMethodCall *call = g_ptr_array_index (pending_calls, i);
+		g_debug ("replaying deferred %s()", call->method_name);
+		fu_main_daemon_method_call (call->connection,
+					    call->sender,
+					    call->object_path,
+					    call->interface_name,
+					    call->method_name,
+					    call->parameters,
+					    g_object_ref (call->invocation),
+					    priv);
+	}
+}
+
 static gboolean
 fu_main_sigterm_cb (gpointer user_data)
 {
@@ -80,6 +200,17 @@ fu_main_sigterm_cb (gpointer user_data)
 static void
 fu_main_engine_changed_cb (FuEngine *engine, FuMainPrivate *priv)
 {
+	/* finished enumerating, so the HSI can now include all the devices */
+	if (priv->enumerating && !fu_engine_is_enumerating (engine)) {
+		const gchar *host_security_id = fu_engine_get_host_security_id (engine);
+		priv->enumerating = FALSE;
+		fu_main_emit_property_changed (priv, "Enumerating",
+					       g_variant_new_boolean (FALSE));
+		fu_main_emit_property_changed (priv, "HostSecurityId",
+					       g_variant_new_string (host_security_id));
+		fu_main_replay_pending_calls (priv);
+	}
+
 	/* not yet connected */
 	if (priv->connection == NULL)
 		return;
@@ -253,22 +384,111 @@ fu_main_create_request (FuMainPrivate *priv, const gchar *sender, GError **error
 
 static GVariant *
 fu_main_device_array_to_variant (FuMainPrivate *priv, FuEngineRequest *request,
-				 GPtrArray *devices, GError **error)
+				 GPtrArray *devices, gboolean compact,
+				 const gchar * const *keys, GError **error)
 {
+	FwupdDeviceFlags flags = fu_engine_request_get_device_flags (request);
 	GVariantBuilder builder;
 
-	g_return_val_if_fail (devices->len > 0, NULL);
-	g_variant_builder_init (&builder, G_VARIANT_TYPE_ARRAY);
+	/* empty while the hardware is still being enumerated */
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("aa{sv}"));
 
+	/* only use the packed format if the client can parse it */
+	if (fu_engine_request_get_feature_flags (request) & FWUPD_FEATURE_FLAG_COMPACT_VARIANT)
+		compact = TRUE;
 	for (guint i = 0; i < devices->len; i++) {
 		FuDevice *device = g_ptr_array_index (devices, i);
-		GVariant *tmp = fwupd_device_to_variant_full (FWUPD_DEVICE (device),
-							      fu_engine_request_get_device_flags (request));
+		GVariant *tmp;
+		if (compact)
+			tmp = fwupd_device_to_variant_projection (FWUPD_DEVICE (device), flags, keys);
+		else
+			tmp = fwupd_device_to_variant_full (FWUPD_DEVICE (device), flags);
 		g_variant_builder_add_value (&builder, tmp);
 	}
 	return g_variant_new ("(aa{sv})", &builder);
 }
 
+/* replies only depend on the method, the arguments and who is asking */
+static gchar *
+fu_main_reply_cache_key (const gchar *method_name,
+			 const gchar *device_id,
+			 FuEngineRequest *request)
+{
+	FwupdDeviceFlags device_flags = fu_engine_request_get_device_flags (request);
+	return g_strdup_printf ("%s|%s|%" G_GUINT64_FORMAT "|%i",
+				method_name,
+				device_id != NULL ? device_id : "",
+				(guint64) fu_engine_request_get_feature_flags (request),
+				(device_flags & FWUPD_DEVICE_FLAG_TRUSTED) > 0);
+}
+
+static gboolean
+fu_main_reply_cache_return (FuMainPrivate *priv,
+			    GDBusMethodInvocation *invocation,
+			    const gchar *key)
+{
+	FuMainReplyItem *item;
+	guint64 generation = fu_engine_get_generation (priv->engine);
+
+	/* something changed since the replies were built */
+	if (priv->reply_cache_generation != generation) {
+		g_queue_clear (&priv->reply_cache_lru);
+		g_hash_table_remove_all (priv->reply_cache);
+		priv->reply_cache_generation = generation;
+		return FALSE;
+	}
+	item = g_hash_table_lookup (priv->reply_cache, key);
+	if (item == NULL)
+		return FALSE;
+
+	/* most recently used */
+	g_queue_unlink (&priv->reply_cache_lru, item->link);
+	g_queue_push_head_link (&priv->reply_cache_lru, item->link);
+	if (item->error != NULL) {
+		g_dbus_method_invocation_return_gerror (invocation, item->error);
+		return TRUE;
+	}
+	g_dbus_method_invocation_return_value (invocation, item->val);
+	return TRUE;
+}
+
+static void
+fu_main_reply_cache_add (FuMainPrivate *priv,
+			 const gchar *key,
+			 GVariant *val,
+			 const GError *error)
+{
+	FuMainReplyItem *item;
+	gchar *key_tmp;
+
+	/* the engine changed while the reply was being built */
+	if (priv->reply_cache_generation != fu_engine_get_generation (priv->engine))
+		return;
+
+	/* replaced, e.g. when two callers raced to build the same reply */
+	item = g_hash_table_lookup (priv->reply_cache, key);
+	if (item != NULL) {
+		g_queue_delete_link (&priv->reply_cache_lru, item->link);
+		g_hash_table_remove (priv->reply_cache, key);
+	}
+
+	/* drop the least recently used reply */
+	if (g_queue_get_length (&priv->reply_cache_lru) >= FU_MAIN_REPLY_CACHE_MAX) {
+		gchar *key_lru = g_queue_pop_tail (&priv->reply_cache_lru);
+		g_hash_table_remove (priv->reply_cache, key_lru);
+	}
+
+	item = g_new0 (FuMainReplyItem, 1);
+	if (val != NULL)
+		item->val = g_variant_ref_sink (val);
+	if (error != NULL)
+		item->error = g_error_copy (error);
+	key_tmp = g_strdup (key);
+	g_queue_push_head (&priv->reply_cache_lru, key_tmp);
+	item->link = priv->reply_cache_lru.head;
+	g_hash_table_insert (priv->reply_cache, key_tmp, item);
+}
+
 static GVariant *
 fu_main_release_array_to_variant (GPtrArray *results)
 {
@@ -320,6 +540,7 @@ typedef struct {
 	GPtrArray		*checksums;
 	guint64			 flags;
 	GBytes			*blob_cab;
+	GOutputStream		*progress_stream;
 	FuMainPrivate		*priv;
 	gchar			*device_id;
 	gchar			*remote_id;
@@ -333,6 +554,8 @@ fu_main_auth_helper_free (FuMainAuthHelper *helper)
 {
 	if (helper->blob_cab != NULL)
 		g_bytes_unref (helper->blob_cab);
+	if (helper->progress_stream != NULL)
+		g_object_unref (helper->progress_stream);
 	if (helper->subject != NULL)
 		g_object_unref (helper->subject);
 	if (helper->silo != NULL)
@@ -641,12 +864,14 @@ fu_main_authorize_install_queue (FuMainAuthHelper *helper_ref)
 
 	/* all authenticated, so install all the things */
 	priv->update_in_progress = TRUE;
+	fu_engine_set_progress_stream (priv->engine, helper->progress_stream);
 	ret = fu_engine_install_tasks (helper->priv->engine,
 				       helper->request,
 				       helper->install_tasks,
 				       helper->blob_cab,
 				       helper->flags,
 				       &error);
+	fu_engine_set_progress_stream (priv->engine, NULL);
 	priv->update_in_progress = FALSE;
 	if (priv->pending_sigterm)
 		g_main_loop_quit (priv->loop);
@@ -856,6 +1081,22 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 	g_autoptr(FuEngineRequest) request = NULL;
 	g_autoptr(GError) error = NULL;
 
+	/* the devices may only be from the snapshot */
+	if (fu_engine_is_enumerating (priv->engine) &&
+	    !fu_main_method_is_snapshot_safe (priv, sender, method_name)) {
+		FuMainMethodCall *call = g_new0 (FuMainMethodCall, 1);
+		g_debug ("deferring %s() until enumerated", method_name);
+		call->connection = g_object_ref (connection);
+		call->sender = g_strdup (sender);
+		call->object_path = g_strdup (object_path);
+		call->interface_name = g_strdup (interface_name);
+		call->method_name = g_strdup (method_name);
+		call->parameters = g_variant_ref (parameters);
+		call->invocation = invocation;
+		g_ptr_array_add (priv->pending_calls, call);
+		return;
+	}
+
 	/* build request */
 	request = fu_main_create_request (priv, sender, &error);
 	if (request == NULL) {
@@ -867,18 +1108,55 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 	fu_engine_idle_reset (priv->engine);
 
 	if (g_strcmp0 (method_name, "GetDevices") == 0) {
+		g_autofree gchar *key = NULL;
 		g_autoptr(GPtrArray) devices = NULL;
 		g_debug ("Called %s()", method_name);
+		key = fu_main_reply_cache_key (method_name, NULL, request);
+		if (fu_main_reply_cache_return (priv, invocation, key))
+			return;
+		devices = fu_engine_get_devices (priv->engine, &error);
+		if (devices == NULL) {
+			fu_main_reply_cache_add (priv, key, NULL, error);
+			g_dbus_method_invocation_return_gerror (invocation, error);
+			return;
+		}
+		val = fu_main_device_array_to_variant (priv, request, devices,
+						       FALSE, NULL, &error);
+		if (val == NULL) {
+			g_dbus_method_invocation_return_gerror (invocation, error);
+			return;
+		}
+		if (devices->len > 0)
+			fu_main_reply_cache_add (priv, key, val, NULL);
+		g_dbus_method_invocation_return_value (invocation, val);
+		return;
+	}
+	if (g_strcmp0 (method_name, "GetDevicesWithKeys") == 0) {
+		g_autofree const gchar **keys = NULL;
+		g_autofree gchar *keys_str = NULL;
+		g_autofree gchar *key = NULL;
+		g_autoptr(GPtrArray) devices = NULL;
+		g_variant_get (parameters, "(^a&s)", &keys);
+		keys_str = g_strjoinv (",", (gchar **) keys);
+		g_debug ("Called %s(%s)", method_name, keys_str);
+		key = fu_main_reply_cache_key (method_name, keys_str, request);
+		if (fu_main_reply_cache_return (priv, invocation, key))
+			return;
 		devices = fu_engine_get_devices (priv->engine, &error);
 		if (devices == NULL) {
+			fu_main_reply_cache_add (priv, key, NULL, error);
 			g_dbus_method_invocation_return_gerror (invocation, error);
 			return;
 		}
-		val = fu_main_device_array_to_variant (priv, request, devices, &error);
+		val = fu_main_device_array_to_variant (priv, request, devices, TRUE,
+						       keys[0] != NULL ? keys : NULL,
+						       &error);
 		if (val == NULL) {
 			g_dbus_method_invocation_return_gerror (invocation, error);
 			return;
 		}
+		if (devices->len > 0)
+			fu_main_reply_cache_add (priv, key, val, NULL);
 		g_dbus_method_invocation_return_value (invocation, val);
 		return;
 	}
@@ -1069,6 +1347,7 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 	}
 	if (g_strcmp0 (method_name, "GetUpgrades") == 0) {
 		const gchar *device_id;
+		g_autofree gchar *key = NULL;
 		g_autoptr(GPtrArray) releases = NULL;
 		g_variant_get (parameters, "(&s)", &device_id);
 		g_debug ("Called %s(%s)", method_name, device_id);
@@ -1076,12 +1355,17 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 			g_dbus_method_invocation_return_gerror (invocation, error);
 			return;
 		}
+		key = fu_main_reply_cache_key (method_name, device_id, request);
+		if (fu_main_reply_cache_return (priv, invocation, key))
+			return;
 		releases = fu_engine_get_upgrades (priv->engine, request, device_id, &error);
 		if (releases == NULL) {
+			fu_main_reply_cache_add (priv, key, NULL, error);
 			g_dbus_method_invocation_return_gerror (invocation, error);
 			return;
 		}
 		val = fu_main_release_array_to_variant (releases);
+		fu_main_reply_cache_add (priv, key, val, NULL);
 		g_dbus_method_invocation_return_value (invocation, val);
 		return;
 	}
@@ -1105,7 +1389,8 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 			g_dbus_method_invocation_return_gerror (invocation, error);
 			return;
 		}
-		val = fu_main_device_array_to_variant (priv, request, devices, &error);
+		val = fu_main_device_array_to_variant (priv, request, devices,
+						       FALSE, NULL, &error);
 		if (val == NULL) {
 			g_dbus_method_invocation_return_gerror (invocation, error);
 			return;
@@ -1395,6 +1680,7 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 		const gchar *device_id = NULL;
 		gchar *prop_key;
 		gint32 fd_handle = 0;
+		gint32 progress_fd_handle = -1;
 		gint fd;
 		guint64 archive_size_max;
 		GDBusMessage *message;
@@ -1443,6 +1729,9 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 			if (g_strcmp0 (prop_key, "no-history") == 0 &&
 			    g_variant_get_boolean (prop_value) == TRUE)
 				helper->flags |= FWUPD_INSTALL_FLAG_NO_HISTORY;
+			if (g_strcmp0 (prop_key, "progress-fd") == 0 &&
+			    g_variant_is_of_type (prop_value, G_VARIANT_TYPE_HANDLE))
+				progress_fd_handle = g_variant_get_handle (prop_value);
 			g_variant_unref (prop_value);
 		}
 
@@ -1450,7 +1739,9 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 		/* get the fd */
 		message = g_dbus_method_invocation_get_message (invocation);
 		fd_list = g_dbus_message_get_unix_fd_list (message);
-		if (fd_list == NULL || g_unix_fd_list_get_length (fd_list) != 1) {
+		if (fd_list == NULL ||
+		    g_unix_fd_list_get_length (fd_list) != (progress_fd_handle >= 0 ? 2 : 1) ||
+		    progress_fd_handle == 0) {
 			g_set_error (&error,
 				     FWUPD_ERROR,
 				     FWUPD_ERROR_INTERNAL,
@@ -1458,6 +1749,24 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 			g_dbus_method_invocation_return_gerror (invocation, error);
 			return;
 		}
+
+		/* optional unthrottled progress for this install */
+		if (progress_fd_handle >= 0) {
+			gint progress_fd = g_unix_fd_list_get (fd_list, progress_fd_handle, &error);
+			if (progress_fd < 0) {
+				g_dbus_method_invocation_return_gerror (invocation, error);
+				return;
+			}
+
+			/* a client that stops reading must not stall the install */
+			if (!g_unix_set_fd_nonblocking (progress_fd, TRUE, &error)) {
+				g_close (progress_fd, NULL);
+				g_dbus_method_invocation_return_gerror (invocation, error);
+				return;
+			}
+			helper->progress_stream = g_unix_output_stream_new (progress_fd, TRUE);
+		}
+
 		fd = g_unix_fd_list_get (fd_list, 0, &error);
 		if (fd < 0) {
 			g_dbus_method_invocation_return_gerror (invocation, error);
@@ -1555,12 +1864,19 @@ fu_main_daemon_get_property (GDBusConnection *connection_, const gchar *sender,
 	if (g_strcmp0 (property_name, "HostMachineId") == 0)
 		return g_variant_new_string (fu_engine_get_host_machine_id (priv->engine));
 
-	if (g_strcmp0 (property_name, "HostSecurityId") == 0)
+	if (g_strcmp0 (property_name, "HostSecurityId") == 0) {
+		/* changed to the real value when enumeration is complete */
+		if (fu_engine_is_enumerating (priv->engine))
+			return g_variant_new_string ("");
 		return g_variant_new_string (fu_engine_get_host_security_id (priv->engine));
+	}
 
 	if (g_strcmp0 (property_name, "Interactive") == 0)
 		return g_variant_new_boolean (isatty (fileno (stdout)) != 0);
 
+	if (g_strcmp0 (property_name, "Enumerating") == 0)
+		return g_variant_new_boolean (fu_engine_is_enumerating (priv->engine));
+
 	/* return an error */
 	g_set_error (error,
 		     G_DBUS_ERROR,
@@ -1716,6 +2032,9 @@ static void
 fu_main_private_free (FuMainPrivate *priv)
 {
 	g_hash_table_unref (priv->sender_features);
+	g_queue_clear (&priv->reply_cache_lru);
+	g_hash_table_unref (priv->reply_cache);
+	g_ptr_array_unref (priv->pending_calls);
 	if (priv->loop != NULL)
 		g_main_loop_unref (priv->loop);
 	if (priv->owner_id > 0)
@@ -1786,6 +2105,10 @@ main (int argc, char *argv[])
 	/* create new objects */
 	priv = g_new0 (FuMainPrivate, 1);
 	priv->sender_features = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	priv->reply_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+						   (GDestroyNotify) fu_main_reply_item_free);
+	g_queue_init (&priv->reply_cache_lru);
+	priv->pending_calls = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_main_method_call_free);
 	priv->loop = g_main_loop_new (NULL, FALSE);
 
 	/* load engine */
@@ -1808,10 +2131,14 @@ main (int argc, char *argv[])
 	g_signal_connect (priv->engine, "percentage-changed",
 			  G_CALLBACK (fu_main_engine_percentage_changed_cb),
 			  priv);
-	if (!fu_engine_load (priv->engine, FU_ENGINE_LOAD_FLAG_NONE, &error)) {
+	if (!fu_engine_load (priv->engine,
+			     FU_ENGINE_LOAD_FLAG_SNAPSHOT |
+			     FU_ENGINE_LOAD_FLAG_ENUMERATE_IDLE,
+			     &error)) {
 		g_printerr ("Failed to load engine: %s\n", error->message);
 		return EXIT_FAILURE;
 	}
+	priv->enumerating = fu_engine_is_enumerating (priv->engine);
 
 	g_unix_signal_add_full (G_PRIORITY_DEFAULT,
 				SIGTERM, fu_main_sigterm_cb,
@@ -1873,6 +2200,13 @@ main (int argc, char *argv[])
 	g_message ("Daemon ready for requests (locale %s)", g_getenv ("LANG"));
 	g_main_loop_run (priv->loop);
 
+	/* so the next activation can answer before enumerating */
+	if (!priv->update_in_progress) {
+		g_autoptr(GError) error_local = NULL;
+		if (!fu_engine_save_snapshot (priv->engine, &error_local))
+			g_debug ("failed to save snapshot: %s", error_local->message);
+	}
+
 	/* success */
 	return EXIT_SUCCESS;
 }
@@ -35,6 +35,7 @@ struct _FuRemoteList
 	GPtrArray		*array;			/* (element-type FwupdRemote) */
 	GPtrArray		*monitors;		/* (element-type GFileMonitor) */
 	GHashTable		*hash_unfound;		/* utf8 : NULL */
+	GHashTable		*hash_id;		/* utf8 : FwupdRemote */
 	XbSilo			*silo;
 };
 
@@ -228,6 +229,11 @@ fu_remote_list_add_for_path (FuRemoteList *self, const gchar *path, GError **err
 
 		/* set mtime */
 		fwupd_remote_set_mtime (remote, _fwupd_remote_get_mtime (remote));
+		if (!g_hash_table_contains (self->hash_id, fwupd_remote_get_id (remote))) {
+			g_hash_table_insert (self->hash_id,
+					     g_strdup (fwupd_remote_get_id (remote)),
+					     remote);
+		}
 		g_ptr_array_add (self->array, g_steal_pointer (&remote));
 	}
 	return TRUE;
@@ -341,6 +347,7 @@ fu_remote_list_reload (FuRemoteList *self, GError **error)
 	g_autofree gchar *remotesdir = NULL;
 
 	/* clear */
+	g_hash_table_remove_all (self->hash_id);
 	g_ptr_array_set_size (self->array, 0);
 	g_ptr_array_set_size (self->monitors, 0);
 
@@ -460,12 +467,9 @@ FwupdRemote *
 fu_remote_list_get_by_id (FuRemoteList *self, const gchar *remote_id)
 {
 	g_return_val_if_fail (FU_IS_REMOTE_LIST (self), NULL);
-	for (guint i = 0; i < self->array->len; i++) {
-		FwupdRemote *remote = g_ptr_array_index (self->array, i);
-		if (g_strcmp0 (remote_id, fwupd_remote_get_id (remote)) == 0)
-			return remote;
-	}
-	return NULL;
+	if (remote_id == NULL)
+		return NULL;
+	return g_hash_table_lookup (self->hash_id, remote_id);
 }
 
 static void
@@ -494,6 +498,7 @@ fu_remote_list_init (FuRemoteList *self)
 	self->array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 	self->monitors = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_remote_list_monitor_unref);
 	self->hash_unfound = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	self->hash_id = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 }
 
 static void
@@ -505,6 +510,7 @@ fu_remote_list_finalize (GObject *obj)
 	g_ptr_array_unref (self->array);
 	g_ptr_array_unref (self->monitors);
 	g_hash_table_unref (self->hash_unfound);
+	g_hash_table_unref (self->hash_id);
 	G_OBJECT_CLASS (fu_remote_list_parent_class)->finalize (obj);
 }
 
@@ -105,6 +105,10 @@ fu_security_attr_get_name (FwupdSecurityAttr *attr)
 		/* TRANSLATORS: Title: the PCR is rebuilt from the TPM event log */
 		return g_strdup (_("TPM PCR0 reconstruction"));
 	}
+	if (g_strcmp0 (appstream_id, FWUPD_SECURITY_ATTR_ID_TPM_RECONSTRUCTION_ALL) == 0) {
+		/* TRANSLATORS: Title: every PCR is rebuilt from the TPM event log */
+		return g_strdup (_("TPM PCR reconstruction"));
+	}
 	if (g_strcmp0 (appstream_id, FWUPD_SECURITY_ATTR_ID_TPM_VERSION_20) == 0) {
 		/* TRANSLATORS: Title: TPM = Trusted Platform Module */
 		return g_strdup (_("TPM v2.0"));
@@ -11,6 +11,7 @@
 #include <fwupdplugin.h>
 #include <glib-object.h>
 #include <glib/gstdio.h>
+#include <fcntl.h>
 #include <libgcab.h>
 #include <stdlib.h>
 #include <string.h>
@@ -115,11 +116,16 @@ fu_engine_generate_md_func (gconstpointer user_data)
 {
 	const gchar *tmp;
 	gboolean ret;
+	gint fd;
+	FwupdRelease *rel;
+	g_autofree gchar *csum_sha256 = NULL;
 	g_autofree gchar *filename = NULL;
 	g_autoptr(FuDevice) device = fu_device_new ();
 	g_autoptr(FuEngine) engine = fu_engine_new (FU_APP_FLAGS_NONE);
+	g_autoptr(FuEngineRequest) request = fu_engine_request_new ();
 	g_autoptr(GBytes) data = NULL;
 	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) details = NULL;
 	g_autoptr(XbNode) component = NULL;
 
 	/* put cab file somewhere we can parse it */
@@ -149,8 +155,22 @@ fu_engine_generate_md_func (gconstpointer user_data)
 	/* verify checksums */
 	tmp = xb_node_query_text (component, "releases/release/checksum[@target='container']", NULL);
 	g_assert_cmpstr (tmp, !=, NULL);
+	csum_sha256 = g_compute_checksum_for_bytes (G_CHECKSUM_SHA256, data);
+	tmp = xb_node_query_text (component, "releases/release/checksum[@target='container'][@type='sha256']", NULL);
+	g_assert_cmpstr (tmp, ==, csum_sha256);
 	tmp = xb_node_query_text (component, "releases/release/checksum[@target='content']", NULL);
 	g_assert_cmpstr (tmp, ==, NULL);
+
+	/* the same archive is found in the remote by container checksum */
+	fd = g_open (filename, O_RDONLY, 0);
+	g_assert_cmpint (fd, >=, 0);
+	details = fu_engine_get_details (engine, request, fd, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (details);
+	g_assert_cmpint (details->len, >=, 1);
+	rel = fu_device_get_release_default (g_ptr_array_index (details, 0));
+	g_assert_nonnull (rel);
+	g_assert_cmpstr (fwupd_release_get_remote_id (rel), ==, "directory");
 }
 
 static void
@@ -185,6 +205,499 @@ fu_plugin_hash_func (gconstpointer user_data)
 	g_assert_true (ret);
 }
 
+static const gchar *
+fu_engine_security_attrs_get_count (FuEngine *engine, const gchar *plugin_name)
+{
+	g_autoptr(FuSecurityAttrs) attrs = fu_engine_get_host_security_attrs (engine);
+	g_autoptr(GPtrArray) items = fu_security_attrs_get_all (attrs);
+	for (guint i = 0; i < items->len; i++) {
+		FwupdSecurityAttr *attr = g_ptr_array_index (items, i);
+		if (g_strcmp0 (fwupd_security_attr_get_plugin (attr), plugin_name) == 0)
+			return fwupd_security_attr_get_metadata (attr, "QueryCount");
+	}
+	return NULL;
+}
+
+static void
+fu_engine_security_attrs_cache_func (gconstpointer user_data)
+{
+	gboolean ret;
+	g_autofree gchar *pluginfn = NULL;
+	g_autoptr(FuEngine) engine = fu_engine_new (FU_APP_FLAGS_NONE);
+	g_autoptr(FuPlugin) plugin1 = fu_plugin_new ();
+	g_autoptr(FuPlugin) plugin2 = fu_plugin_new ();
+	g_autoptr(GError) error = NULL;
+
+	/* two instances of the test plugin that count each query */
+	g_setenv ("FWUPD_PLUGIN_TEST", "security-attrs", TRUE);
+	pluginfn = g_build_filename (PLUGINBUILDDIR,
+				     "libfu_plugin_test." G_MODULE_SUFFIX,
+				     NULL);
+	ret = fu_plugin_open (plugin1, pluginfn, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	fu_plugin_set_name (plugin1, "test1");
+	ret = fu_plugin_open (plugin2, pluginfn, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	fu_plugin_set_name (plugin2, "test2");
+	fu_engine_add_plugin (engine, plugin1);
+	fu_engine_add_plugin (engine, plugin2);
+
+	/* both are asked the first time */
+	g_assert_cmpstr (fu_engine_security_attrs_get_count (engine, "test1"), ==, "1");
+	g_assert_cmpstr (fu_engine_security_attrs_get_count (engine, "test2"), ==, "1");
+
+	/* cached */
+	g_assert_cmpstr (fu_engine_security_attrs_get_count (engine, "test1"), ==, "1");
+	g_assert_cmpstr (fu_engine_security_attrs_get_count (engine, "test2"), ==, "1");
+
+	/* only the plugin that changed is asked again */
+	fu_plugin_security_changed (plugin1);
+	g_assert_cmpstr (fu_engine_security_attrs_get_count (engine, "test1"), ==, "2");
+	g_assert_cmpstr (fu_engine_security_attrs_get_count (engine, "test2"), ==, "1");
+	fu_plugin_security_changed (plugin2);
+	g_assert_cmpstr (fu_engine_security_attrs_get_count (engine, "test1"), ==, "2");
+	g_assert_cmpstr (fu_engine_security_attrs_get_count (engine, "test2"), ==, "2");
+	g_unsetenv ("FWUPD_PLUGIN_TEST");
+}
+
+typedef struct {
+	guint		 added;
+	guint		 removed;
+	guint		 changed;
+	guint		 engine_changed;
+} FuEngineSnapshotHelper;
+
+static void
+fu_engine_snapshot_device_added_cb (FuEngine *engine, FuDevice *device, gpointer user_data)
+{
+	FuEngineSnapshotHelper *helper = (FuEngineSnapshotHelper *) user_data;
+	helper->added++;
+}
+
+static void
+fu_engine_snapshot_device_removed_cb (FuEngine *engine, FuDevice *device, gpointer user_data)
+{
+	FuEngineSnapshotHelper *helper = (FuEngineSnapshotHelper *) user_data;
+	helper->removed++;
+}
+
+static void
+fu_engine_snapshot_device_changed_cb (FuEngine *engine, FuDevice *device, gpointer user_data)
+{
+	FuEngineSnapshotHelper *helper = (FuEngineSnapshotHelper *) user_data;
+	helper->changed++;
+}
+
+static void
+fu_engine_snapshot_changed_cb (FuEngine *engine, gpointer user_data)
+{
+	FuEngineSnapshotHelper *helper = (FuEngineSnapshotHelper *) user_data;
+	/* deferred daemon requests are answered from the first of these */
+	if (!fu_engine_is_enumerating (engine))
+		helper->engine_changed++;
+}
+
+static void
+fu_engine_snapshot_plugin_device_added_cb (FuPlugin *plugin, FuDevice *device, gpointer user_data)
+{
+	FuEngine *engine = FU_ENGINE (user_data);
+	fu_engine_add_device (engine, device);
+}
+
+static FuPlugin *
+fu_engine_snapshot_plugin_new (FuEngine *engine, const gchar *name)
+{
+	gboolean ret;
+	g_autofree gchar *pluginfn = NULL;
+	g_autoptr(FuPlugin) plugin = fu_plugin_new ();
+	g_autoptr(GError) error = NULL;
+
+	pluginfn = g_build_filename (PLUGINBUILDDIR,
+				     "libfu_plugin_test." G_MODULE_SUFFIX,
+				     NULL);
+	ret = fu_plugin_open (plugin, pluginfn, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	fu_plugin_set_name (plugin, name);
+	g_signal_connect (plugin, "device-added",
+			  G_CALLBACK (fu_engine_snapshot_plugin_device_added_cb),
+			  engine);
+	fu_engine_add_plugin (engine, plugin);
+	return g_steal_pointer (&plugin);
+}
+
+static void
+fu_engine_snapshot_set_boot_id (const gchar *boot_id)
+{
+	gboolean ret;
+	g_autofree gchar *fn = NULL;
+	g_autoptr(GError) error = NULL;
+
+	fn = g_build_filename ("/tmp/fwupd-self-test/proc",
+			       "sys", "kernel", "random", "boot_id", NULL);
+	ret = fu_common_mkdir_parent (fn, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = g_file_set_contents (fn, boot_id, -1, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_setenv ("FWUPD_PROCFS", "/tmp/fwupd-self-test/proc", TRUE);
+}
+
+/* saves a snapshot of FakeDevice, which the test plugin coldplugs, and
+ * GoneDevice, which nothing will find again */
+static void
+fu_engine_snapshot_save (void)
+{
+	gboolean ret;
+	const gchar *ids[] = { "FakeDevice", "GoneDevice", NULL };
+	g_autoptr(FuEngine) engine = fu_engine_new (FU_APP_FLAGS_NONE);
+	g_autoptr(FuPlugin) plugin = NULL;
+	g_autoptr(GError) error = NULL;
+
+	/* not loaded, so the device list is not complete */
+	ret = fu_engine_save_snapshot (engine, &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL);
+	g_assert_false (ret);
+	g_clear_error (&error);
+
+	plugin = fu_engine_snapshot_plugin_new (engine, "test");
+	ret = fu_engine_load (engine, FU_ENGINE_LOAD_FLAG_NO_ENUMERATE, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	for (guint i = 0; ids[i] != NULL; i++) {
+		g_autoptr(FuDevice) device = fu_device_new ();
+		fu_device_set_id (device, ids[i]);
+		fu_device_set_name (device, ids[i]);
+		fu_device_set_plugin (device, "test");
+		fu_device_add_guid (device, "b585990a-003e-5270-89d5-3705a17f9a43");
+		fu_engine_add_device (engine, device);
+	}
+	ret = fu_engine_save_snapshot (engine, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+}
+
+/* rewrites one key of the saved snapshot */
+static void
+fu_engine_snapshot_set_key (const gchar *key, GVariant *value)
+{
+	gboolean ret;
+	const gchar *key_tmp;
+	GVariant *value_tmp;
+	GVariantBuilder builder;
+	GVariantIter iter;
+	g_autofree gchar *cachedir = fu_common_get_path (FU_PATH_KIND_CACHEDIR_PKG);
+	g_autofree gchar *fn = g_build_filename (cachedir, "devices.snapshot", NULL);
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GBytes) blob_new = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GVariant) val = NULL;
+	g_autoptr(GVariant) val_new = NULL;
+
+	blob = fu_common_get_contents_bytes (fn, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (blob);
+	val = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE_VARDICT,
+							    blob, FALSE));
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+	g_variant_iter_init (&iter, val);
+	while (g_variant_iter_next (&iter, "{&sv}", &key_tmp, &value_tmp)) {
+		if (g_strcmp0 (key_tmp, key) == 0)
+			g_variant_builder_add (&builder, "{sv}", key_tmp, value);
+		else
+			g_variant_builder_add (&builder, "{sv}", key_tmp, value_tmp);
+		g_variant_unref (value_tmp);
+	}
+	val_new = g_variant_ref_sink (g_variant_builder_end (&builder));
+	blob_new = g_variant_get_data_as_bytes (val_new);
+	ret = fu_common_set_contents_bytes (fn, blob_new, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+}
+
+/* the snapshot is only used when the key matches */
+static void
+fu_engine_snapshot_assert_unused (const gchar *plugin_name)
+{
+	gboolean ret;
+	g_autoptr(FuEngine) engine = fu_engine_new (FU_APP_FLAGS_NONE);
+	g_autoptr(FuPlugin) plugin = NULL;
+	g_autoptr(GError) error = NULL;
+
+	plugin = fu_engine_snapshot_plugin_new (engine, plugin_name);
+	ret = fu_engine_load (engine, FU_ENGINE_LOAD_FLAG_SNAPSHOT, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_false (fu_engine_is_enumerating (engine));
+}
+
+static void
+fu_engine_snapshot_key_func (gconstpointer user_data)
+{
+	/* different boot */
+	fu_engine_snapshot_set_boot_id ("11111111-1111-1111-1111-111111111111");
+	fu_engine_snapshot_save ();
+	fu_engine_snapshot_set_boot_id ("22222222-2222-2222-2222-222222222222");
+	fu_engine_snapshot_assert_unused ("test");
+
+	/* different daemon version */
+	fu_engine_snapshot_save ();
+	fu_engine_snapshot_set_key ("Version", g_variant_new_string ("0.0.1"));
+	fu_engine_snapshot_assert_unused ("test");
+
+	/* different set of plugins */
+	fu_engine_snapshot_save ();
+	fu_engine_snapshot_assert_unused ("test2");
+
+	/* missing key */
+	fu_engine_snapshot_save ();
+	fu_engine_snapshot_set_key ("BootId", g_variant_new_uint32 (0));
+	fu_engine_snapshot_assert_unused ("test");
+	g_unsetenv ("FWUPD_PROCFS");
+}
+
+static void
+fu_engine_snapshot_func (gconstpointer user_data)
+{
+	gboolean ret;
+	FuDevice *device;
+	FuEngineSnapshotHelper helper = { 0 };
+	g_autoptr(FuEngine) engine = fu_engine_new (FU_APP_FLAGS_NONE);
+	g_autoptr(FuPlugin) plugin = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) devices = NULL;
+	g_autoptr(GPtrArray) devices_found = NULL;
+
+	fu_engine_snapshot_set_boot_id ("11111111-1111-1111-1111-111111111111");
+	fu_engine_snapshot_save ();
+
+	/* answered from the snapshot while enumerating */
+	g_signal_connect (engine, "device-added",
+			  G_CALLBACK (fu_engine_snapshot_device_added_cb), &helper);
+	g_signal_connect (engine, "device-removed",
+			  G_CALLBACK (fu_engine_snapshot_device_removed_cb), &helper);
+	g_signal_connect (engine, "device-changed",
+			  G_CALLBACK (fu_engine_snapshot_device_changed_cb), &helper);
+	g_signal_connect (engine, "changed",
+			  G_CALLBACK (fu_engine_snapshot_changed_cb), &helper);
+	plugin = fu_engine_snapshot_plugin_new (engine, "test");
+	ret = fu_engine_load (engine, FU_ENGINE_LOAD_FLAG_SNAPSHOT, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_true (fu_engine_is_enumerating (engine));
+	devices = fu_engine_get_devices (engine, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (devices);
+	g_assert_cmpint (devices->len, ==, 2);
+	device = g_ptr_array_index (devices, 0);
+	g_assert_cmpstr (fu_device_get_name (device), ==, "FakeDevice");
+	device = g_ptr_array_index (devices, 1);
+	g_assert_cmpstr (fu_device_get_name (device), ==, "GoneDevice");
+	g_assert_cmpint (helper.engine_changed, ==, 0);
+
+	/* FakeDevice is found again, GoneDevice is not */
+	while (fu_engine_is_enumerating (engine))
+		g_main_context_iteration (NULL, TRUE);
+	g_assert_cmpint (helper.added, ==, 0);
+	g_assert_cmpint (helper.changed, >=, 1);
+	g_assert_cmpint (helper.removed, ==, 1);
+	g_assert_cmpint (helper.engine_changed, ==, 1);
+	devices_found = fu_engine_get_devices (engine, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (devices_found);
+	g_assert_cmpint (devices_found->len, ==, 1);
+	device = g_ptr_array_index (devices_found, 0);
+	g_assert_cmpstr (fu_device_get_name (device), ==, "Integrated_Webcam(TM)");
+	g_unsetenv ("FWUPD_PROCFS");
+}
+
+typedef struct {
+	FuDevice	*device1;
+	FuDevice	*device2;
+	guint		 changed1;
+	guint		 changed2;
+	guint		 percentage;
+	guint		 percentage_cnt;
+	guint		 status_percentage;
+} FuEngineProgressHelper;
+
+static void
+fu_engine_progress_percentage_changed_cb (FuEngine *engine, guint percentage, gpointer user_data)
+{
+	FuEngineProgressHelper *helper = (FuEngineProgressHelper *) user_data;
+	helper->percentage = percentage;
+	helper->percentage_cnt++;
+}
+
+static void
+fu_engine_progress_status_changed_cb (FuEngine *engine, guint status, gpointer user_data)
+{
+	FuEngineProgressHelper *helper = (FuEngineProgressHelper *) user_data;
+	helper->status_percentage = helper->percentage;
+}
+
+static void
+fu_engine_progress_device_changed_cb (FuEngine *engine, FuDevice *device, gpointer user_data)
+{
+	FuEngineProgressHelper *helper = (FuEngineProgressHelper *) user_data;
+	if (device == helper->device1)
+		helper->changed1++;
+	if (device == helper->device2)
+		helper->changed2++;
+}
+
+/* loads an engine with ProgressMaxRate set and two devices that are writing */
+static FuEngine *
+fu_engine_progress_engine_new (FuEngineProgressHelper *helper, guint rate)
+{
+	gboolean ret;
+	g_autofree gchar *conf = g_strdup_printf ("[fwupd]\nProgressMaxRate=%u\n", rate);
+	g_autoptr(FuEngine) engine = fu_engine_new (FU_APP_FLAGS_NONE);
+	g_autoptr(GError) error = NULL;
+
+	ret = fu_common_mkdir_parent ("/tmp/fwupd-self-test/progress/daemon.conf", &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = g_file_set_contents ("/tmp/fwupd-self-test/progress/daemon.conf", conf, -1, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_setenv ("CONFIGURATION_DIRECTORY", "/tmp/fwupd-self-test/progress", TRUE);
+	ret = fu_engine_load (engine, FU_ENGINE_LOAD_FLAG_NO_ENUMERATE, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_unsetenv ("CONFIGURATION_DIRECTORY");
+
+	helper->device1 = fu_device_new ();
+	fu_device_set_id (helper->device1, "device1");
+	fu_device_set_plugin (helper->device1, "test");
+	fu_device_add_guid (helper->device1, "12345678-1234-1234-1234-123456789012");
+	fu_engine_add_device (engine, helper->device1);
+	fu_device_set_status (helper->device1, FWUPD_STATUS_DEVICE_WRITE);
+	helper->device2 = fu_device_new ();
+	fu_device_set_id (helper->device2, "device2");
+	fu_device_set_plugin (helper->device2, "test");
+	fu_device_add_guid (helper->device2, "b585990a-003e-5270-89d5-3705a17f9a43");
+	fu_engine_add_device (engine, helper->device2);
+	fu_device_set_status (helper->device2, FWUPD_STATUS_DEVICE_WRITE);
+
+	g_signal_connect (engine, "percentage-changed",
+			  G_CALLBACK (fu_engine_progress_percentage_changed_cb), helper);
+	g_signal_connect (engine, "status-changed",
+			  G_CALLBACK (fu_engine_progress_status_changed_cb), helper);
+	g_signal_connect (engine, "device-changed",
+			  G_CALLBACK (fu_engine_progress_device_changed_cb), helper);
+	return g_steal_pointer (&engine);
+}
+
+static void
+fu_engine_progress_rate_func (gconstpointer user_data)
+{
+	FuEngineProgressHelper helper = { NULL };
+	g_autoptr(FuEngine) engine = fu_engine_progress_engine_new (&helper, 10);
+
+	/* nothing sent in the last interval */
+	fu_device_set_progress (helper.device1, 10);
+	g_assert_cmpint (helper.percentage_cnt, ==, 1);
+	g_assert_cmpint (helper.percentage, ==, 10);
+	g_assert_cmpint (helper.changed1, ==, 1);
+
+	/* coalesced into one update by the timeout */
+	fu_device_set_progress (helper.device1, 20);
+	fu_device_set_progress (helper.device1, 30);
+	g_assert_cmpint (helper.percentage_cnt, ==, 1);
+	g_assert_cmpint (helper.changed1, ==, 1);
+	while (helper.percentage_cnt == 1)
+		g_main_context_iteration (NULL, TRUE);
+	g_assert_cmpint (helper.percentage_cnt, ==, 2);
+	g_assert_cmpint (helper.percentage, ==, 30);
+	g_assert_cmpint (helper.changed1, ==, 2);
+
+	/* the end and start of each phase are sent straight away */
+	fu_device_set_progress (helper.device1, 100);
+	g_assert_cmpint (helper.percentage_cnt, ==, 3);
+	g_assert_cmpint (helper.percentage, ==, 100);
+	fu_device_set_progress (helper.device1, 0);
+	g_assert_cmpint (helper.percentage_cnt, ==, 4);
+	g_assert_cmpint (helper.percentage, ==, 0);
+
+	/* held back progress is sent before the status changes */
+	fu_device_set_progress (helper.device1, 40);
+	g_assert_cmpint (helper.percentage_cnt, ==, 4);
+	fu_device_set_status (helper.device1, FWUPD_STATUS_DEVICE_VERIFY);
+	g_assert_cmpint (helper.status_percentage, ==, 40);
+
+	/* both devices reporting in the same interval get DeviceChanged */
+	helper.changed1 = 0;
+	helper.changed2 = 0;
+	fu_device_set_progress (helper.device1, 50);
+	fu_device_set_progress (helper.device2, 60);
+	g_assert_cmpint (helper.changed1, ==, 0);
+	g_assert_cmpint (helper.changed2, ==, 0);
+	while (helper.changed2 == 0)
+		g_main_context_iteration (NULL, TRUE);
+	g_assert_cmpint (helper.changed1, ==, 1);
+	g_assert_cmpint (helper.changed2, ==, 1);
+	g_assert_cmpint (helper.percentage, ==, 60);
+
+	g_object_unref (helper.device1);
+	g_object_unref (helper.device2);
+}
+
+static void
+fu_engine_progress_unlimited_func (gconstpointer user_data)
+{
+	FuEngineProgressHelper helper = { NULL };
+	g_autoptr(FuEngine) engine = fu_engine_progress_engine_new (&helper, 0);
+
+	/* a rate of zero sends everything */
+	fu_device_set_progress (helper.device1, 10);
+	fu_device_set_progress (helper.device1, 20);
+	fu_device_set_progress (helper.device1, 30);
+	g_assert_cmpint (helper.percentage_cnt, ==, 3);
+	g_assert_cmpint (helper.percentage, ==, 30);
+	g_assert_cmpint (helper.changed1, ==, 3);
+
+	g_object_unref (helper.device1);
+	g_object_unref (helper.device2);
+}
+
+static void
+fu_engine_progress_stream_func (gconstpointer user_data)
+{
+	FuEngineProgressHelper helper = { NULL };
+	g_autofree gchar *str = NULL;
+	g_autofree gchar *str_expected = NULL;
+	g_autoptr(FuEngine) engine = fu_engine_progress_engine_new (&helper, 10);
+	g_autoptr(GOutputStream) stream = g_memory_output_stream_new_resizable ();
+
+	/* every change is written, even when the signals are rate limited */
+	fu_engine_set_progress_stream (engine, stream);
+	fu_device_set_progress (helper.device1, 10);
+	fu_device_set_progress (helper.device1, 20);
+	fu_device_set_progress (helper.device1, 30);
+	fu_device_set_status (helper.device1, FWUPD_STATUS_DEVICE_VERIFY);
+	fu_engine_set_progress_stream (engine, NULL);
+	fu_device_set_progress (helper.device1, 40);
+	g_assert_cmpint (helper.percentage_cnt, ==, 2);
+	str = g_strndup (g_memory_output_stream_get_data (G_MEMORY_OUTPUT_STREAM (stream)),
+			 g_memory_output_stream_get_data_size (G_MEMORY_OUTPUT_STREAM (stream)));
+	str_expected = g_strdup_printf ("%s device-write 10\n"
+					"%s device-write 20\n"
+					"%s device-write 30\n"
+					"%s device-verify 30\n",
+					fu_device_get_id (helper.device1),
+					fu_device_get_id (helper.device1),
+					fu_device_get_id (helper.device1),
+					fu_device_get_id (helper.device1));
+	g_assert_cmpstr (str, ==, str_expected);
+
+	g_object_unref (helper.device1);
+	g_object_unref (helper.device2);
+}
+
 static void
 fu_engine_requirements_missing_func (gconstpointer user_data)
 {
@@ -621,6 +1134,78 @@ fu_engine_requirements_device_func (gconstpointer user_data)
 	g_assert (ret);
 }
 
+static void
+fu_engine_requirements_reuse_func (gconstpointer user_data)
+{
+	gboolean ret;
+	g_autoptr(FuDevice) device1 = fu_device_new ();
+	g_autoptr(FuDevice) device2 = fu_device_new ();
+	g_autoptr(FuEngine) engine = fu_engine_new (FU_APP_FLAGS_NONE);
+	g_autoptr(FuEngineRequest) request = fu_engine_request_new ();
+	g_autoptr(FuInstallTask) task1 = NULL;
+	g_autoptr(FuInstallTask) task2 = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(XbNode) component = NULL;
+	g_autoptr(XbSilo) silo = NULL;
+	const gchar *xml =
+		"<component>"
+		"  <requires>"
+		"    <firmware compare=\"regex\" version=\"^1\\.2\\.[0-9]$\"/>"
+		"    <firmware compare=\"ge\" version=\"4.5.6\">bootloader</firmware>"
+		"  </requires>"
+		"  <provides>"
+		"    <firmware type=\"flashed\">12345678-1234-1234-1234-123456789012</firmware>"
+		"  </provides>"
+		"  <releases>"
+		"    <release version=\"1.2.4\">"
+		"      <checksum type=\"sha1\" filename=\"bios.bin\" target=\"content\"/>"
+		"    </release>"
+		"  </releases>"
+		"</component>";
+
+	/* set up two dummy devices with different versions */
+	fu_device_set_version_format (device1, FWUPD_VERSION_FORMAT_TRIPLET);
+	fu_device_set_version (device1, "1.2.3");
+	fu_device_set_version_bootloader (device1, "4.5.6");
+	fu_device_add_flag (device1, FWUPD_DEVICE_FLAG_UPDATABLE);
+	fu_device_add_guid (device1, "12345678-1234-1234-1234-123456789012");
+	fu_device_set_version_format (device2, FWUPD_VERSION_FORMAT_TRIPLET);
+	fu_device_set_version (device2, "1.2.3");
+	fu_device_set_version_bootloader (device2, "4.5.5");
+	fu_device_add_flag (device2, FWUPD_DEVICE_FLAG_UPDATABLE);
+	fu_device_add_guid (device2, "12345678-1234-1234-1234-123456789012");
+
+	silo = xb_silo_new_from_xml (xml, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (silo);
+	component = xb_silo_query_first (silo, "component", &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (component);
+
+	/* the same component is checked against each device */
+	task1 = fu_install_task_new (device1, component);
+	task2 = fu_install_task_new (device2, component);
+	ret = fu_engine_check_requirements (engine, request, task1,
+					    FWUPD_INSTALL_FLAG_NONE,
+					    &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	ret = fu_engine_check_requirements (engine, request, task2,
+					    FWUPD_INSTALL_FLAG_NONE,
+					    &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_NOT_SUPPORTED);
+	g_assert (!ret);
+	g_clear_error (&error);
+
+	/* a new device state is used for the next check */
+	fu_device_set_version (device1, "1.2.10");
+	ret = fu_engine_check_requirements (engine, request, task1,
+					    FWUPD_INSTALL_FLAG_NONE,
+					    &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_INVALID_FILE);
+	g_assert (!ret);
+}
+
 static void
 fu_engine_requirements_device_plain_func (gconstpointer user_data)
 {
@@ -1282,6 +1867,7 @@ fu_engine_downgrade_func (gconstpointer user_data)
 	g_autoptr(GPtrArray) releases_dg = NULL;
 	g_autoptr(GPtrArray) releases = NULL;
 	g_autoptr(GPtrArray) releases_up = NULL;
+	g_autoptr(GPtrArray) releases_up2 = NULL;
 	g_autoptr(GPtrArray) remotes = NULL;
 	g_autoptr(XbSilo) silo_empty = xb_silo_new ();
 
@@ -1430,6 +2016,16 @@ fu_engine_downgrade_func (gconstpointer user_data)
 	rel = FWUPD_RELEASE (g_ptr_array_index (releases_up, 1));
 	g_assert_cmpstr (fwupd_release_get_version (rel), ==, "1.2.4");
 
+	/* the releases are reused until the device or silo changes */
+	releases_up2 = fu_engine_get_upgrades (engine,
+					       request,
+					       fu_device_get_id (device),
+					       &error);
+	g_assert_no_error (error);
+	g_assert (releases_up2 != NULL);
+	g_assert_cmpint (releases_up2->len, ==, 2);
+	g_assert (g_ptr_array_index (releases_up2, 1) == (gpointer) rel);
+
 	/* downgrades */
 	releases_dg = fu_engine_get_downgrades (engine,
 						request,
@@ -2130,6 +2726,72 @@ fu_device_list_replug_user_func (gconstpointer user_data)
 	g_assert_false (fu_device_has_flag (device1, FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG));
 }
 
+static void
+fu_device_list_replug_concurrent_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	guint *pending = (guint *) user_data;
+	gboolean ret;
+	g_autoptr(GError) error = NULL;
+
+	ret = fu_device_list_wait_for_replug_finish (FU_DEVICE_LIST (source), res, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	if (--(*pending) == 0)
+		fu_test_loop_quit ();
+}
+
+static void
+fu_device_list_replug_concurrent_func (gconstpointer user_data)
+{
+	guint pending = 2;
+	g_autoptr(FuDevice) device1 = fu_device_new ();
+	g_autoptr(FuDevice) device2 = fu_device_new ();
+	g_autoptr(FuDevice) device3 = fu_device_new ();
+	g_autoptr(FuDevice) device4 = fu_device_new ();
+	g_autoptr(FuDeviceList) device_list = fu_device_list_new ();
+	FuDeviceListReplugHelper helper1;
+	FuDeviceListReplugHelper helper2;
+
+	/* two independent devices, each replaced with the same ID */
+	fu_device_set_id (device1, "device1");
+	fu_device_set_plugin (device1, "self-test");
+	fu_device_set_remove_delay (device1, 1000);
+	fu_device_set_id (device2, "device1");
+	fu_device_set_plugin (device2, "self-test");
+	fu_device_set_id (device3, "device3");
+	fu_device_set_plugin (device3, "self-test");
+	fu_device_set_remove_delay (device3, 2000);
+	fu_device_set_id (device4, "device3");
+	fu_device_set_plugin (device4, "self-test");
+	fu_device_list_add (device_list, device1);
+	fu_device_list_add (device_list, device3);
+
+	/* both detach at the same time */
+	helper1.device_old = device1;
+	helper1.device_new = device2;
+	helper1.device_list = device_list;
+	helper2.device_old = device3;
+	helper2.device_new = device4;
+	helper2.device_list = device_list;
+	g_timeout_add (50, fu_device_list_remove_cb, &helper1);
+	g_timeout_add (60, fu_device_list_remove_cb, &helper2);
+	g_timeout_add (100, fu_device_list_add_cb, &helper2);
+	g_timeout_add (150, fu_device_list_add_cb, &helper1);
+	fu_device_add_flag (device1, FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG);
+	fu_device_add_flag (device3, FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG);
+	fu_device_list_wait_for_replug_async (device_list, device1, NULL,
+					      fu_device_list_replug_concurrent_cb,
+					      &pending);
+	fu_device_list_wait_for_replug_async (device_list, device3, NULL,
+					      fu_device_list_replug_concurrent_cb,
+					      &pending);
+	fu_test_loop_run_with_timeout (5000);
+	fu_test_loop_quit ();
+	g_assert_cmpint (pending, ==, 0);
+	g_assert_false (fu_device_has_flag (device1, FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG));
+	g_assert_false (fu_device_has_flag (device3, FWUPD_DEVICE_FLAG_WAIT_FOR_REPLUG));
+}
+
 static void
 fu_device_list_compatible_func (gconstpointer user_data)
 {
@@ -3137,6 +3799,18 @@ main (int argc, char **argv)
 	}
 	g_test_add_data_func ("/fwupd/plugin{build-hash}", self,
 			      fu_plugin_hash_func);
+	g_test_add_data_func ("/fwupd/engine{security-attrs-cache}", self,
+			      fu_engine_security_attrs_cache_func);
+	g_test_add_data_func ("/fwupd/engine{snapshot}", self,
+			      fu_engine_snapshot_func);
+	g_test_add_data_func ("/fwupd/engine{snapshot-key}", self,
+			      fu_engine_snapshot_key_func);
+	g_test_add_data_func ("/fwupd/engine{progress-rate}", self,
+			      fu_engine_progress_rate_func);
+	g_test_add_data_func ("/fwupd/engine{progress-unlimited}", self,
+			      fu_engine_progress_unlimited_func);
+	g_test_add_data_func ("/fwupd/engine{progress-stream}", self,
+			      fu_engine_progress_stream_func);
 	g_test_add_data_func ("/fwupd/plugin{module}", self,
 			      fu_plugin_module_func);
 	g_test_add_data_func ("/fwupd/memcpy", self,
@@ -3167,6 +3841,8 @@ main (int argc, char **argv)
 	}
 	g_test_add_data_func ("/fwupd/device-list{replug-user}", self,
 			      fu_device_list_replug_user_func);
+	g_test_add_data_func ("/fwupd/device-list{replug-concurrent}", self,
+			      fu_device_list_replug_concurrent_func);
 	g_test_add_data_func ("/fwupd/engine{require-hwid}", self,
 			      fu_engine_require_hwid_func);
 	g_test_add_data_func ("/fwupd/engine{history-inherit}", self,
@@ -3199,6 +3875,8 @@ main (int argc, char **argv)
 			      fu_engine_requirements_unsupported_func);
 	g_test_add_data_func ("/fwupd/engine{requirements-device}", self,
 			      fu_engine_requirements_device_func);
+	g_test_add_data_func ("/fwupd/engine{requirements-reuse}", self,
+			      fu_engine_requirements_reuse_func);
 	g_test_add_data_func ("/fwupd/engine{requirements-device-plain}", self,
 			      fu_engine_requirements_device_plain_func);
 	g_test_add_data_func ("/fwupd/engine{requirements-version-format}", self,
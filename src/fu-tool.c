@@ -63,6 +63,9 @@ struct FuUtilPrivate {
 	FwupdInstallFlags	 flags;
 	gboolean		 show_all;
 	gboolean		 disable_ssl_strict;
+	gchar			*record_trace;
+	gchar			*replay_trace;
+	gint			 trace_latency;
 	/* only valid in update and downgrade */
 	FuUtilOperation		 current_operation;
 	FwupdDevice		*current_device;
@@ -70,6 +73,8 @@ struct FuUtilPrivate {
 	FwupdDeviceFlags	 completion_flags;
 	FwupdDeviceFlags	 filter_include;
 	FwupdDeviceFlags	 filter_exclude;
+	FuUtilJsonFormat	 json_format;
+	gchar			**json_fields;
 };
 
 static gboolean
@@ -207,6 +212,9 @@ fu_util_private_free (FuUtilPrivate *priv)
 	if (priv->context != NULL)
 		g_option_context_free (priv->context);
 	g_free (priv->current_message);
+	g_strfreev (priv->json_fields);
+	g_free (priv->record_trace);
+	g_free (priv->replay_trace);
 	g_free (priv);
 }
 
@@ -597,6 +605,21 @@ fu_util_build_device_tree (FuUtilPrivate *priv, GNode *root, GPtrArray *devs, Fu
 	}
 }
 
+static void
+fu_util_devices_to_json_stream (FuUtilPrivate *priv, GPtrArray *devs)
+{
+	g_autoptr(FuUtilJsonStream) stream = NULL;
+	stream = fu_util_json_stream_new (priv->json_format, "Devices", priv->json_fields);
+	for (guint i = 0; i < devs->len; i++) {
+		FwupdDevice *dev = g_ptr_array_index (devs, i);
+		if (!priv->show_all && !fu_util_is_interesting_device (dev))
+			continue;
+		if (!fu_util_filter_device (priv, dev))
+			continue;
+		fu_util_json_stream_add_device (stream, dev);
+	}
+}
+
 static gboolean
 fu_util_get_devices (FuUtilPrivate *priv, gchar **values, GError **error)
 {
@@ -614,13 +637,18 @@ fu_util_get_devices (FuUtilPrivate *priv, gchar **values, GError **error)
 	if (devs == NULL)
 		return FALSE;
 
+	fwupd_device_array_ensure_parents (devs);
+	if (priv->json_format != FU_UTIL_JSON_FORMAT_NONE) {
+		fu_util_devices_to_json_stream (priv, devs);
+		return fu_util_save_current_state (priv, error);
+	}
+
 	/* print */
 	if (devs->len == 0) {
 		/* TRANSLATORS: nothing attached that can be upgraded */
 		g_print ("%s\n", _("No hardware detected with firmware update capability"));
 		return TRUE;
 	}
-	fwupd_device_array_ensure_parents (devs);
 	fu_util_build_device_tree (priv, root, devs, NULL);
 	fu_util_print_tree (root, title);
 
@@ -695,8 +723,11 @@ fu_util_display_current_message (FuUtilPrivate *priv)
 static gboolean
 fu_util_install_blob (FuUtilPrivate *priv, gchar **values, GError **error)
 {
+	gboolean ret;
 	g_autoptr(FuDevice) device = NULL;
+	g_autoptr(FuTransportTrace) trace = NULL;
 	g_autoptr(GBytes) blob_fw = NULL;
+	g_autoptr(GTimer) timer = NULL;
 
 	/* invalid args */
 	if (g_strv_length (values) == 0) {
@@ -706,6 +737,13 @@ fu_util_install_blob (FuUtilPrivate *priv, gchar **values, GError **error)
 				     "Invalid arguments");
 		return FALSE;
 	}
+	if (priv->record_trace != NULL && priv->replay_trace != NULL) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_ARGS,
+				     "Cannot record and replay a trace at the same time");
+		return FALSE;
+	}
 
 	/* parse blob */
 	blob_fw = fu_common_get_contents_bytes (values[0], error);
@@ -714,12 +752,35 @@ fu_util_install_blob (FuUtilPrivate *priv, gchar **values, GError **error)
 		return FALSE;
 	}
 
+	/* replay a previous recording without touching the hardware */
+	if (priv->replay_trace != NULL) {
+		trace = fu_transport_trace_new (FU_TRANSPORT_TRACE_MODE_REPLAY);
+		if (!fu_transport_trace_load_file (trace, priv->replay_trace, error))
+			return FALSE;
+		if (priv->trace_latency > 0)
+			fu_transport_trace_set_latency (trace, priv->trace_latency);
+
+		/* the plugins are only needed to register the device types */
+		if (!fu_util_start_engine (priv, FU_ENGINE_LOAD_FLAG_NO_ENUMERATE, error))
+			return FALSE;
+		device = fu_device_new_from_transport_trace (trace, error);
+		if (device == NULL) {
+			g_prefix_error (error, "failed to create device from %s: ",
+					priv->replay_trace);
+			return FALSE;
+		}
+		fu_engine_add_device (priv->engine, device);
+
 	/* load engine */
-	if (!fu_util_start_engine (priv, FU_ENGINE_LOAD_FLAG_NONE, error))
-		return FALSE;
+	} else {
+		if (!fu_util_start_engine (priv, FU_ENGINE_LOAD_FLAG_NONE, error))
+			return FALSE;
+	}
 
 	/* get device */
-	if (g_strv_length (values) >= 2) {
+	if (device != NULL) {
+		g_debug ("using %s from the trace", fu_device_get_id (device));
+	} else if (g_strv_length (values) >= 2) {
 		device = fu_util_get_device (priv, values[1], error);
 		if (device == NULL)
 			return FALSE;
@@ -743,8 +804,33 @@ fu_util_install_blob (FuUtilPrivate *priv, gchar **values, GError **error)
 			return FALSE;
 		}
 	}
+	/* record every transfer made to the hardware */
+	if (priv->record_trace != NULL) {
+		trace = fu_transport_trace_new (FU_TRANSPORT_TRACE_MODE_RECORD);
+		fu_device_set_transport_trace (device, trace);
+	}
 	priv->flags |= FWUPD_INSTALL_FLAG_NO_HISTORY;
-	if (!fu_engine_install_blob (priv->engine, device, blob_fw, priv->flags, error))
+	timer = g_timer_new ();
+	ret = fu_engine_install_blob (priv->engine, device, blob_fw, priv->flags, error);
+	if (trace != NULL && priv->record_trace != NULL) {
+		g_autoptr(GError) error_local = NULL;
+		g_debug ("recorded %u round-trips of %" G_GUINT64_FORMAT " bytes",
+			 fu_transport_trace_get_roundtrips (trace),
+			 fu_transport_trace_get_bytes (trace));
+		if (!fu_transport_trace_save_file (trace, priv->record_trace, &error_local))
+			g_warning ("failed to save trace: %s", error_local->message);
+	}
+	if (trace != NULL && priv->replay_trace != NULL) {
+		g_print ("Replayed %u round-trips of %" G_GUINT64_FORMAT " bytes in %.2fms\n",
+			 fu_transport_trace_get_roundtrips (trace),
+			 fu_transport_trace_get_bytes (trace),
+			 g_timer_elapsed (timer, NULL) * 1000.f);
+		if (ret && fu_transport_trace_get_remaining (trace) > 0) {
+			g_warning ("%u recorded transfers were not replayed",
+				   fu_transport_trace_get_remaining (trace));
+		}
+	}
+	if (!ret)
 		return FALSE;
 	if (priv->cleanup_blob) {
 		g_autoptr(FuDevice) device_new = NULL;
@@ -1799,6 +1885,19 @@ fu_util_firmware_parse (FuUtilPrivate *priv, gchar **values, GError **error)
 	return TRUE;
 }
 
+/* use a suitable filename for an image extracted from a container */
+static gchar *
+fu_util_firmware_image_get_filename (FuFirmwareImage *img, guint idx)
+{
+	if (fu_firmware_image_get_filename (img) != NULL)
+		return g_strdup (fu_firmware_image_get_filename (img));
+	if (fu_firmware_image_get_id (img) != NULL)
+		return g_strdup_printf ("id-%s.fw", fu_firmware_image_get_id (img));
+	if (fu_firmware_image_get_idx (img) != 0x0)
+		return g_strdup_printf ("idx-0x%x.fw", (guint) fu_firmware_image_get_idx (img));
+	return g_strdup_printf ("img-0x%x.fw", idx);
+}
+
 static gboolean
 fu_util_firmware_extract (FuUtilPrivate *priv, gchar **values, GError **error)
 {
@@ -1857,17 +1956,8 @@ fu_util_firmware_extract (FuUtilPrivate *priv, gchar **values, GError **error)
 		blob_img = fu_firmware_image_get_bytes (img);
 		if (blob_img == NULL || g_bytes_get_size (blob_img) == 0)
 			continue;
+		fn = fu_util_firmware_image_get_filename (img, i);
 
-		/* use suitable filename */
-		if (fu_firmware_image_get_filename (img) != NULL) {
-			fn = g_strdup (fu_firmware_image_get_filename (img));
-		} else if (fu_firmware_image_get_id (img) != NULL) {
-			fn = g_strdup_printf ("id-%s.fw", fu_firmware_image_get_id (img));
-		} else if (fu_firmware_image_get_idx (img) != 0x0) {
-			fn = g_strdup_printf ("idx-0x%x.fw", (guint) fu_firmware_image_get_idx (img));
-		} else {
-			fn = g_strdup_printf ("img-0x%x.fw", i);
-		}
 		/* TRANSLATORS: decompressing images from a container firmware */
 		g_print ("%s : %s\n", _("Writing file:"), fn);
 		if (!fu_common_set_contents_bytes (fn, blob_img, error))
@@ -2061,6 +2151,472 @@ fu_util_firmware_convert (FuUtilPrivate *priv, gchar **values, GError **error)
 	return TRUE;
 }
 
+typedef enum {
+	FU_UTIL_BATCH_KIND_PARSE,
+	FU_UTIL_BATCH_KIND_CONVERT,
+	FU_UTIL_BATCH_KIND_EXTRACT,
+	FU_UTIL_BATCH_KIND_BUILD,
+} FuUtilBatchKind;
+
+typedef struct {
+	FuUtilBatchKind		 kind;
+	GType			 gtype_src;
+	GType			 gtype_dst;
+	FwupdInstallFlags	 flags;
+	GCancellable		*cancellable;
+	GMainLoop		*loop;		/* only for builds */
+	GTimer			*timer;		/* only for builds */
+	guint			 pending;	/* only for builds */
+} FuUtilBatchHelper;
+
+typedef struct {
+	FuUtilBatchHelper	*helper;
+	gchar			*filename;
+	gchar			*filename_dst;
+	gsize			 size;
+	gsize			 size_dst;
+	guint			 images;
+	gdouble			 elapsed;
+	GError			*error;
+} FuUtilBatchItem;
+
+static void
+fu_util_batch_item_free (FuUtilBatchItem *item)
+{
+	if (item->error != NULL)
+		g_error_free (item->error);
+	g_free (item->filename);
+	g_free (item->filename_dst);
+	g_free (item);
+}
+
+static gboolean
+fu_util_batch_item_process (FuUtilBatchItem *item, GError **error)
+{
+	FuUtilBatchHelper *helper = item->helper;
+	g_autoptr(FuFirmware) firmware_src = NULL;
+	g_autoptr(FuFirmware) firmware_dst = NULL;
+	g_autoptr(GBytes) blob_src = NULL;
+	g_autoptr(GBytes) blob_dst = NULL;
+	g_autoptr(GPtrArray) images = NULL;
+
+	if (g_cancellable_set_error_if_cancelled (helper->cancellable, error))
+		return FALSE;
+
+	/* parse */
+	blob_src = fu_common_get_contents_bytes (item->filename, error);
+	if (blob_src == NULL)
+		return FALSE;
+	item->size = g_bytes_get_size (blob_src);
+	firmware_src = g_object_new (helper->gtype_src, NULL);
+	if (!fu_firmware_parse (firmware_src, blob_src, helper->flags, error))
+		return FALSE;
+	images = fu_firmware_get_images (firmware_src);
+	item->images = images->len;
+	if (helper->kind == FU_UTIL_BATCH_KIND_PARSE)
+		return TRUE;
+
+	/* each file gets its own directory of raw images */
+	if (helper->kind == FU_UTIL_BATCH_KIND_EXTRACT) {
+		for (guint i = 0; i < images->len; i++) {
+			FuFirmwareImage *img = g_ptr_array_index (images, i);
+			g_autofree gchar *basename = NULL;
+			g_autofree gchar *fn = NULL;
+			g_autofree gchar *fn_img = NULL;
+			g_autoptr(GBytes) blob_img = fu_firmware_image_get_bytes (img);
+			if (blob_img == NULL || g_bytes_get_size (blob_img) == 0)
+				continue;
+			fn = fu_util_firmware_image_get_filename (img, i);
+			basename = g_path_get_basename (fn);
+			fn_img = g_build_filename (item->filename_dst, basename, NULL);
+			if (!fu_common_set_contents_bytes (fn_img, blob_img, error))
+				return FALSE;
+			item->size_dst += g_bytes_get_size (blob_img);
+		}
+		return TRUE;
+	}
+
+	/* copy images and write new file */
+	firmware_dst = g_object_new (helper->gtype_dst, NULL);
+	for (guint i = 0; i < images->len; i++) {
+		FuFirmwareImage *img = g_ptr_array_index (images, i);
+		fu_firmware_add_image (firmware_dst, img);
+	}
+	blob_dst = fu_firmware_write (firmware_dst, error);
+	if (blob_dst == NULL)
+		return FALSE;
+	item->size_dst = g_bytes_get_size (blob_dst);
+	return fu_common_set_contents_bytes (item->filename_dst, blob_dst, error);
+}
+
+static void
+fu_util_batch_item_run_cb (gpointer data, gpointer user_data)
+{
+	FuUtilBatchItem *item = (FuUtilBatchItem *) data;
+	g_autoptr(GTimer) timer = g_timer_new ();
+	if (item->error != NULL)
+		return;
+	fu_util_batch_item_process (item, &item->error);
+	item->elapsed = g_timer_elapsed (timer, NULL);
+}
+
+static void
+fu_util_batch_item_build_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	FuUtilBatchItem *item = (FuUtilBatchItem *) user_data;
+	FuUtilBatchHelper *helper = item->helper;
+	g_autoptr(GBytes) blob_dst = NULL;
+
+	item->elapsed = g_timer_elapsed (helper->timer, NULL);
+	blob_dst = fu_common_firmware_builder_finish (res, &item->error);
+	if (blob_dst != NULL) {
+		item->size_dst = g_bytes_get_size (blob_dst);
+		fu_common_set_contents_bytes (item->filename_dst, blob_dst, &item->error);
+	}
+	if (--helper->pending == 0)
+		g_main_loop_quit (helper->loop);
+}
+
+/* the builders are queued by libfwupdplugin so that no more than one per CPU
+ * runs at the same time, so just wait for them all to complete */
+static void
+fu_util_batch_build (FuUtilBatchHelper *helper, GPtrArray *items)
+{
+	g_autoptr(GMainLoop) loop = g_main_loop_new (NULL, FALSE);
+
+	helper->loop = loop;
+	for (guint i = 0; i < items->len; i++) {
+		FuUtilBatchItem *item = g_ptr_array_index (items, i);
+		g_autoptr(GBytes) blob_src = NULL;
+		if (item->error != NULL)
+			continue;
+		blob_src = fu_common_get_contents_bytes (item->filename, &item->error);
+		if (blob_src == NULL)
+			continue;
+		item->size = g_bytes_get_size (blob_src);
+		helper->pending++;
+		fu_common_firmware_builder_async (blob_src,
+						  "startup.sh",
+						  "firmware.bin",
+						  helper->cancellable,
+						  fu_util_batch_item_build_cb,
+						  item);
+	}
+	if (helper->pending > 0)
+		g_main_loop_run (loop);
+	helper->loop = NULL;
+}
+
+/* a FILENAME argument of @MANIFEST is a file with one filename per line */
+static gboolean
+fu_util_batch_add_filenames (GPtrArray *filenames, const gchar *value, GError **error)
+{
+	g_autofree gchar *data = NULL;
+	g_auto(GStrv) lines = NULL;
+
+	if (!g_str_has_prefix (value, "@")) {
+		g_ptr_array_add (filenames, g_strdup (value));
+		return TRUE;
+	}
+	if (!g_file_get_contents (value + 1, &data, NULL, error))
+		return FALSE;
+	lines = g_strsplit (data, "\n", -1);
+	for (guint i = 0; lines[i] != NULL; i++) {
+		g_strstrip (lines[i]);
+		if (lines[i][0] == '\0' || lines[i][0] == '#')
+			continue;
+		g_ptr_array_add (filenames, g_strdup (lines[i]));
+	}
+	return TRUE;
+}
+
+static GType
+fu_util_batch_get_gtype (FuUtilPrivate *priv, const gchar *firmware_type, GError **error)
+{
+	GType gtype = fu_engine_get_firmware_gtype_by_id (priv->engine, firmware_type);
+	if (gtype == G_TYPE_INVALID) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_NOT_FOUND,
+			     "GType %s not supported", firmware_type);
+	}
+	return gtype;
+}
+
+static gboolean
+fu_util_firmware_batch (FuUtilPrivate *priv,
+			FuUtilBatchKind kind,
+			const gchar *firmware_type_src,
+			const gchar *firmware_type_dst,
+			const gchar *directory,
+			gchar **values,
+			GError **error)
+{
+	FuUtilBatchHelper helper = {
+		.kind		= kind,
+		.gtype_dst	= G_TYPE_INVALID,
+		.flags		= priv->flags,
+		.cancellable	= priv->cancellable,
+	};
+	GThreadPool *pool;
+	guint failures = 0;
+	g_autofree gchar *directory_real = NULL;
+	g_autofree gchar *str = NULL;
+	g_autoptr(GHashTable) outputs = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL); /* path:FuUtilBatchItem */
+	g_autoptr(GPtrArray) filenames = g_ptr_array_new_with_free_func (g_free);
+	g_autoptr(GPtrArray) items = NULL;
+	g_autoptr(GTimer) timer = NULL;
+	g_autoptr(JsonBuilder) builder = json_builder_new ();
+	g_autoptr(JsonGenerator) json_generator = NULL;
+	g_autoptr(JsonNode) json_root = NULL;
+
+	for (guint i = 0; values[i] != NULL; i++) {
+		if (!fu_util_batch_add_filenames (filenames, values[i], error))
+			return FALSE;
+	}
+	if (filenames->len == 0) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_ARGS,
+				     "Invalid arguments: filename required");
+		return FALSE;
+	}
+
+	/* register the firmware GTypes once for all the files */
+	if (kind != FU_UTIL_BATCH_KIND_BUILD) {
+		if (!fu_engine_load (priv->engine, FU_ENGINE_LOAD_FLAG_NO_ENUMERATE, error))
+			return FALSE;
+		helper.gtype_src = fu_util_batch_get_gtype (priv, firmware_type_src, error);
+		if (helper.gtype_src == G_TYPE_INVALID)
+			return FALSE;
+	}
+	if (kind == FU_UTIL_BATCH_KIND_CONVERT) {
+		helper.gtype_dst = fu_util_batch_get_gtype (priv, firmware_type_dst, error);
+		if (helper.gtype_dst == G_TYPE_INVALID)
+			return FALSE;
+	}
+	if (kind != FU_UTIL_BATCH_KIND_PARSE) {
+		if (!g_file_test (directory, G_FILE_TEST_IS_DIR)) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_ARGS,
+				     "%s is not a directory", directory);
+			return FALSE;
+		}
+		directory_real = fu_common_realpath (directory, error);
+		if (directory_real == NULL)
+			return FALSE;
+	}
+
+	/* the output files must not collide with each other or the inputs, and
+	 * any file that would is reported as failed rather than aborting */
+	items = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_util_batch_item_free);
+	for (guint i = 0; i < filenames->len; i++) {
+		const gchar *fn = g_ptr_array_index (filenames, i);
+		FuUtilBatchItem *item = g_new0 (FuUtilBatchItem, 1);
+		item->helper = &helper;
+		item->filename = g_strdup (fn);
+		g_ptr_array_add (items, item);
+		if (kind != FU_UTIL_BATCH_KIND_PARSE) {
+			g_autofree gchar *basename = g_path_get_basename (fn);
+			g_autofree gchar *filename_dst_real = NULL;
+
+			/* builds write foo.bin for an archive of foo.tar, and
+			 * extracting foo.bin writes the images to foo/ */
+			if (kind == FU_UTIL_BATCH_KIND_BUILD ||
+			    kind == FU_UTIL_BATCH_KIND_EXTRACT) {
+				gchar *ext = g_strrstr (basename, ".");
+				g_autofree gchar *tmp = NULL;
+				if (ext != NULL && ext != basename)
+					*ext = '\0';
+				if (kind == FU_UTIL_BATCH_KIND_BUILD) {
+					tmp = g_strdup_printf ("%s.bin", basename);
+					g_free (basename);
+					basename = g_steal_pointer (&tmp);
+				}
+			}
+			item->filename_dst = g_build_filename (directory, basename, NULL);
+
+			/* compare canonical paths, e.g. ./a.hex and a.hex */
+			if (g_file_test (item->filename_dst, G_FILE_TEST_EXISTS)) {
+				filename_dst_real = fu_common_realpath (item->filename_dst,
+									&item->error);
+				if (filename_dst_real == NULL)
+					continue;
+			} else {
+				filename_dst_real = g_build_filename (directory_real, basename, NULL);
+			}
+			if (g_hash_table_contains (outputs, filename_dst_real)) {
+				item->error = g_error_new (FWUPD_ERROR,
+							   FWUPD_ERROR_INVALID_ARGS,
+							   "%s would be written more than once",
+							   item->filename_dst);
+				continue;
+			}
+			g_hash_table_insert (outputs, g_steal_pointer (&filename_dst_real), item);
+		}
+	}
+
+	/* parsing writes nothing, so the inputs do not need to be resolved */
+	for (guint i = 0; i < items->len && g_hash_table_size (outputs) > 0; i++) {
+		FuUtilBatchItem *item = g_ptr_array_index (items, i);
+		FuUtilBatchItem *item_dst;
+		g_autofree gchar *filename_real = NULL;
+
+		/* a missing input is reported when it is read */
+		if (!g_file_test (item->filename, G_FILE_TEST_EXISTS))
+			continue;
+		filename_real = fu_common_realpath (item->filename, NULL);
+		if (filename_real == NULL)
+			continue;
+		item_dst = g_hash_table_lookup (outputs, filename_real);
+		if (item_dst != NULL && item_dst->error == NULL) {
+			item_dst->error = g_error_new (FWUPD_ERROR,
+						       FWUPD_ERROR_INVALID_ARGS,
+						       "%s would overwrite the input file %s",
+						       item_dst->filename_dst,
+						       item->filename);
+		}
+	}
+
+	/* each file is independent, so use all the cores */
+	timer = g_timer_new ();
+	if (kind == FU_UTIL_BATCH_KIND_BUILD) {
+		helper.timer = timer;
+		fu_util_batch_build (&helper, items);
+	} else {
+		pool = g_thread_pool_new (fu_util_batch_item_run_cb, NULL,
+					  (gint) g_get_num_processors (), TRUE, error);
+		if (pool == NULL)
+			return FALSE;
+		for (guint i = 0; i < items->len; i++) {
+			if (!g_thread_pool_push (pool, g_ptr_array_index (items, i), error)) {
+				g_thread_pool_free (pool, TRUE, TRUE);
+				return FALSE;
+			}
+		}
+		g_thread_pool_free (pool, FALSE, TRUE);
+	}
+
+	/* report each file in the order given */
+	json_builder_begin_object (builder);
+	json_builder_set_member_name (builder, "Files");
+	json_builder_begin_array (builder);
+	for (guint i = 0; i < items->len; i++) {
+		FuUtilBatchItem *item = g_ptr_array_index (items, i);
+		json_builder_begin_object (builder);
+		json_builder_set_member_name (builder, "Filename");
+		json_builder_add_string_value (builder, item->filename);
+		if (item->filename_dst != NULL) {
+			json_builder_set_member_name (builder, "FilenameDst");
+			json_builder_add_string_value (builder, item->filename_dst);
+		}
+		json_builder_set_member_name (builder, "Size");
+		json_builder_add_int_value (builder, item->size);
+		if (item->size_dst > 0) {
+			json_builder_set_member_name (builder, "SizeDst");
+			json_builder_add_int_value (builder, item->size_dst);
+		}
+		if (kind != FU_UTIL_BATCH_KIND_BUILD && item->error == NULL) {
+			json_builder_set_member_name (builder, "Images");
+			json_builder_add_int_value (builder, item->images);
+		}
+		json_builder_set_member_name (builder, "Elapsed");
+		json_builder_add_double_value (builder, item->elapsed);
+		if (item->error != NULL) {
+			json_builder_set_member_name (builder, "Error");
+			json_builder_add_string_value (builder, item->error->message);
+			failures++;
+		}
+		json_builder_end_object (builder);
+	}
+	json_builder_end_array (builder);
+	json_builder_set_member_name (builder, "Failures");
+	json_builder_add_int_value (builder, failures);
+	json_builder_set_member_name (builder, "Elapsed");
+	json_builder_add_double_value (builder, g_timer_elapsed (timer, NULL));
+	json_builder_end_object (builder);
+
+	/* export as a string */
+	json_root = json_builder_get_root (builder);
+	json_generator = json_generator_new ();
+	json_generator_set_pretty (json_generator, TRUE);
+	json_generator_set_root (json_generator, json_root);
+	str = json_generator_to_data (json_generator, NULL);
+	g_print ("%s\n", str);
+
+	/* each failed file is in the report rather than failing the batch */
+	if (failures > 0)
+		g_debug ("%u of %u files failed", failures, items->len);
+
+	/* success */
+	return TRUE;
+}
+
+static gboolean
+fu_util_firmware_parse_batch (FuUtilPrivate *priv, gchar **values, GError **error)
+{
+	/* check args */
+	if (g_strv_length (values) < 2) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_ARGS,
+				     "Invalid arguments: firmware type and filename required");
+		return FALSE;
+	}
+	return fu_util_firmware_batch (priv, FU_UTIL_BATCH_KIND_PARSE,
+				       values[0], NULL, NULL,
+				       values + 1, error);
+}
+
+static gboolean
+fu_util_firmware_convert_batch (FuUtilPrivate *priv, gchar **values, GError **error)
+{
+	/* check args */
+	if (g_strv_length (values) < 4) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_ARGS,
+				     "Invalid arguments: firmware types, directory and filename required");
+		return FALSE;
+	}
+	return fu_util_firmware_batch (priv, FU_UTIL_BATCH_KIND_CONVERT,
+				       values[0], values[1], values[2],
+				       values + 3, error);
+}
+
+static gboolean
+fu_util_firmware_extract_batch (FuUtilPrivate *priv, gchar **values, GError **error)
+{
+	/* check args */
+	if (g_strv_length (values) < 3) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_ARGS,
+				     "Invalid arguments: firmware type, directory and filename required");
+		return FALSE;
+	}
+	return fu_util_firmware_batch (priv, FU_UTIL_BATCH_KIND_EXTRACT,
+				       values[0], NULL, values[1],
+				       values + 2, error);
+}
+
+static gboolean
+fu_util_firmware_builder_batch (FuUtilPrivate *priv, gchar **values, GError **error)
+{
+	/* check args */
+	if (g_strv_length (values) < 2) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_ARGS,
+				     "Invalid arguments: directory and filename required");
+		return FALSE;
+	}
+	return fu_util_firmware_batch (priv, FU_UTIL_BATCH_KIND_BUILD,
+				       NULL, NULL, values[0],
+				       values + 1, error);
+}
+
 static gboolean
 fu_util_verify_update (FuUtilPrivate *priv, gchar **values, GError **error)
 {
@@ -2109,6 +2665,19 @@ fu_util_get_history (FuUtilPrivate *priv, gchar **values, GError **error)
 	if (devices == NULL)
 		return FALSE;
 
+	/* stream each device with its release */
+	if (priv->json_format != FU_UTIL_JSON_FORMAT_NONE) {
+		g_autoptr(FuUtilJsonStream) stream = NULL;
+		stream = fu_util_json_stream_new (priv->json_format, "Devices", priv->json_fields);
+		for (guint i = 0; i < devices->len; i++) {
+			FwupdDevice *dev = g_ptr_array_index (devices, i);
+			if (!fu_util_filter_device (priv, dev))
+				continue;
+			fu_util_json_stream_add_device (stream, dev);
+		}
+		return TRUE;
+	}
+
 	/* show each device */
 	for (guint i = 0; i < devices->len; i++) {
 		g_autoptr(GPtrArray) rels = NULL;
@@ -2301,6 +2870,23 @@ fu_util_security (FuUtilPrivate *priv, gchar **values, GError **error)
 	if (!fu_util_start_engine (priv, FU_ENGINE_LOAD_FLAG_NONE, error))
 		return FALSE;
 
+	/* get the "why" */
+	attrs = fu_engine_get_host_security_attrs (priv->engine);
+	items = fu_security_attrs_get_all (attrs);
+
+	/* stream each attribute */
+	if (priv->json_format != FU_UTIL_JSON_FORMAT_NONE) {
+		g_autoptr(FuUtilJsonStream) stream = NULL;
+		stream = fu_util_json_stream_new (priv->json_format,
+						  "SecurityAttributes",
+						  priv->json_fields);
+		for (guint i = 0; i < items->len; i++) {
+			FwupdSecurityAttr *attr = g_ptr_array_index (items, i);
+			fu_util_json_stream_add_security_attr (stream, attr);
+		}
+		return TRUE;
+	}
+
 	/* TRANSLATORS: this is a string like 'HSI:2-U' */
 	g_print ("%s \033[1m%s\033[0m\n", _("Host Security ID:"),
 		 fu_engine_get_host_security_id (priv->engine));
@@ -2312,8 +2898,6 @@ fu_util_security (FuUtilPrivate *priv, gchar **values, GError **error)
 	}
 
 	/* print the "why" */
-	attrs = fu_engine_get_host_security_attrs (priv->engine);
-	items = fu_security_attrs_get_all (attrs);
 	str = fu_util_security_attrs_to_string (items, flags);
 	g_print ("%s\n", str);
 	return TRUE;
@@ -2421,7 +3005,10 @@ main (int argc, char *argv[])
 	g_autoptr(GError) error = NULL;
 	g_autoptr(GPtrArray) cmd_array = fu_util_cmd_array_new ();
 	g_autofree gchar *cmd_descriptions = NULL;
+	gboolean json = FALSE;
+	gboolean json_lines = FALSE;
 	g_autofree gchar *filter = NULL;
+	g_autofree gchar *json_fields = NULL;
 	const GOptionEntry options[] = {
 		{ "version", '\0', 0, G_OPTION_ARG_NONE, &version,
 			/* TRANSLATORS: command line option */
@@ -2477,6 +3064,24 @@ main (int argc, char *argv[])
 		{ "disable-ssl-strict", '\0', 0, G_OPTION_ARG_NONE, &priv->disable_ssl_strict,
 			/* TRANSLATORS: command line option */
 			_("Ignore SSL strict checks when downloading files"), NULL },
+		{ "record-trace", '\0', 0, G_OPTION_ARG_FILENAME, &priv->record_trace,
+			/* TRANSLATORS: command line option */
+			_("Record device transfers to a file when using install-blob"), NULL },
+		{ "replay-trace", '\0', 0, G_OPTION_ARG_FILENAME, &priv->replay_trace,
+			/* TRANSLATORS: command line option */
+			_("Replay recorded device transfers when using install-blob"), NULL },
+		{ "trace-latency", '\0', 0, G_OPTION_ARG_INT, &priv->trace_latency,
+			/* TRANSLATORS: command line option, in microseconds */
+			_("Simulated latency in us for each replayed transfer"), NULL },
+		{ "json", '\0', 0, G_OPTION_ARG_NONE, &json,
+			/* TRANSLATORS: command line option */
+			_("Output in JSON format"), NULL },
+		{ "json-lines", '\0', 0, G_OPTION_ARG_NONE, &json_lines,
+			/* TRANSLATORS: command line option */
+			_("Output one JSON object per line"), NULL },
+		{ "json-fields", '\0', 0, G_OPTION_ARG_STRING, &json_fields,
+			/* TRANSLATORS: command line option */
+			_("Only output the listed JSON fields, e.g. 'Name,DeviceId,Version'"), NULL },
 		{ "filter", '\0', 0, G_OPTION_ARG_STRING, &filter,
 			/* TRANSLATORS: command line option */
 			_("Filter with a set of device flags using a ~ prefix to "
@@ -2514,6 +3119,12 @@ main (int argc, char *argv[])
 		     /* TRANSLATORS: command description */
 		     _("Build firmware using a sandbox"),
 		     fu_util_firmware_builder);
+	fu_util_cmd_array_add (cmd_array,
+		     "build-firmware-batch",
+		     "DIRECTORY FILENAME|@MANIFEST...",
+		     /* TRANSLATORS: command description */
+		     _("Build many firmware files in parallel using a sandbox"),
+		     fu_util_firmware_builder_batch);
 	fu_util_cmd_array_add (cmd_array,
 		     "smbios-dump",
 		     "FILE",
@@ -2653,6 +3264,12 @@ main (int argc, char *argv[])
 		     /* TRANSLATORS: command description */
 		     _("Convert a firmware file"),
 		     fu_util_firmware_convert);
+	fu_util_cmd_array_add (cmd_array,
+		     "firmware-convert-batch",
+		     "FIRMWARE-TYPE-SRC FIRMWARE-TYPE-DST DIRECTORY FILENAME|@MANIFEST...",
+		     /* TRANSLATORS: command description */
+		     _("Convert many firmware files in parallel"),
+		     fu_util_firmware_convert_batch);
 	fu_util_cmd_array_add (cmd_array,
 		     "firmware-build",
 		     "BUILDER-XML FILENAME-DST",
@@ -2665,12 +3282,24 @@ main (int argc, char *argv[])
 		     /* TRANSLATORS: command description */
 		     _("Parse and show details about a firmware file"),
 		     fu_util_firmware_parse);
+	fu_util_cmd_array_add (cmd_array,
+		     "firmware-parse-batch",
+		     "FIRMWARE-TYPE FILENAME|@MANIFEST...",
+		     /* TRANSLATORS: command description */
+		     _("Parse many firmware files in parallel"),
+		     fu_util_firmware_parse_batch);
 	fu_util_cmd_array_add (cmd_array,
 		     "firmware-extract",
 		     "FILENAME [FIRMWARE-TYPE]",
 		     /* TRANSLATORS: command description */
 		     _("Extract a firmware blob to images"),
 		     fu_util_firmware_extract);
+	fu_util_cmd_array_add (cmd_array,
+		     "firmware-extract-batch",
+		     "FIRMWARE-TYPE DIRECTORY FILENAME|@MANIFEST...",
+		     /* TRANSLATORS: command description */
+		     _("Extract many firmware files to images in parallel"),
+		     fu_util_firmware_extract_batch);
 	fu_util_cmd_array_add (cmd_array,
 		     "get-firmware-types",
 		     NULL,
@@ -2768,6 +3397,14 @@ main (int argc, char *argv[])
 		g_setenv ("DISABLE_SSL_STRICT", "1", TRUE);
 	}
 
+	/* streaming JSON output */
+	if (json_lines)
+		priv->json_format = FU_UTIL_JSON_FORMAT_JSON_LINES;
+	else if (json)
+		priv->json_format = FU_UTIL_JSON_FORMAT_JSON;
+	if (json_fields != NULL)
+		priv->json_fields = g_strsplit (json_fields, ",", -1);
+
 	/* parse filter flags */
 	if (filter != NULL) {
 		if (!fu_util_parse_filter_flags (filter,
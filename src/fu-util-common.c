@@ -19,6 +19,9 @@
 #include "fu-device.h"
 #include "fu-security-attr.h"
 #include "fu-security-attrs.h"
+#include "fwupd-device-private.h"
+#include "fwupd-release-private.h"
+#include "fwupd-security-attr-private.h"
 
 #ifdef HAVE_SYSTEMD
 #include "fu-systemd.h"
@@ -1806,3 +1809,115 @@ fu_util_device_order_sort_cb (gconstpointer a, gconstpointer b)
 	FuDevice *device_b = *((FuDevice **) b);
 	return fu_util_device_order_compare (device_a, device_b);
 }
+
+struct FuUtilJsonStream {
+	FuUtilJsonFormat	 format;
+	gchar			**fields;
+	JsonBuilder		*builder;
+	JsonGenerator		*generator;
+	guint			 cnt;
+};
+
+/**
+ * fu_util_json_stream_new:
+ * @format: a #FuUtilJsonFormat, e.g. %FU_UTIL_JSON_FORMAT_JSON_LINES
+ * @member: the array name used for %FU_UTIL_JSON_FORMAT_JSON, e.g. "Devices"
+ * @fields: (nullable): members to include in each record, or %NULL for all;
+ *  any whitespace around each name is ignored
+ *
+ * Creates a JSON emitter that writes each record to stdout as soon as it is
+ * added, rather than building the entire document in memory first.
+ *
+ * Returns: a #FuUtilJsonStream
+ **/
+FuUtilJsonStream *
+fu_util_json_stream_new (FuUtilJsonFormat format, const gchar *member, gchar **fields)
+{
+	FuUtilJsonStream *self = g_new0 (FuUtilJsonStream, 1);
+	self->format = format;
+	self->fields = g_strdupv (fields);
+	for (guint i = 0; self->fields != NULL && self->fields[i] != NULL; i++)
+		g_strstrip (self->fields[i]);
+	self->builder = json_builder_new ();
+	self->generator = json_generator_new ();
+	json_generator_set_pretty (self->generator, FALSE);
+	if (self->format == FU_UTIL_JSON_FORMAT_JSON)
+		g_print ("{\"%s\":[\n", member);
+	return self;
+}
+
+static void
+fu_util_json_stream_emit (FuUtilJsonStream *self)
+{
+	g_autofree gchar *str = NULL;
+	g_autoptr(JsonNode) json_root = json_builder_get_root (self->builder);
+
+	/* only include the requested members */
+	if (self->fields != NULL) {
+		JsonObject *json_object = json_node_get_object (json_root);
+		JsonObject *json_object_new = json_object_new ();
+		for (guint i = 0; self->fields[i] != NULL; i++) {
+			JsonNode *json_node = json_object_get_member (json_object,
+								     self->fields[i]);
+			if (json_node == NULL)
+				continue;
+			json_object_set_member (json_object_new,
+						self->fields[i],
+						json_node_copy (json_node));
+		}
+		json_node_take_object (json_root, json_object_new);
+	}
+
+	/* write each record on its own line */
+	json_generator_set_root (self->generator, json_root);
+	str = json_generator_to_data (self->generator, NULL);
+	json_builder_reset (self->builder);
+	if (self->format == FU_UTIL_JSON_FORMAT_JSON && self->cnt > 0)
+		g_print (",\n");
+	g_print (self->format == FU_UTIL_JSON_FORMAT_JSON ? "%s" : "%s\n", str);
+	self->cnt++;
+}
+
+void
+fu_util_json_stream_add_device (FuUtilJsonStream *self, FwupdDevice *dev)
+{
+	json_builder_begin_object (self->builder);
+	fwupd_device_to_json (dev, self->builder);
+	json_builder_end_object (self->builder);
+	fu_util_json_stream_emit (self);
+}
+
+void
+fu_util_json_stream_add_release (FuUtilJsonStream *self, FwupdRelease *rel)
+{
+	json_builder_begin_object (self->builder);
+	fwupd_release_to_json (rel, self->builder);
+	json_builder_end_object (self->builder);
+	fu_util_json_stream_emit (self);
+}
+
+void
+fu_util_json_stream_add_security_attr (FuUtilJsonStream *self, FwupdSecurityAttr *attr)
+{
+	json_builder_begin_object (self->builder);
+	fwupd_security_attr_to_json (attr, self->builder);
+	json_builder_end_object (self->builder);
+	fu_util_json_stream_emit (self);
+}
+
+/**
+ * fu_util_json_stream_free:
+ * @self: a #FuUtilJsonStream
+ *
+ * Closes the document, if required, and frees the emitter.
+ **/
+void
+fu_util_json_stream_free (FuUtilJsonStream *self)
+{
+	if (self->format == FU_UTIL_JSON_FORMAT_JSON)
+		g_print ("%s]}\n", self->cnt > 0 ? "\n" : "");
+	g_strfreev (self->fields);
+	g_object_unref (self->builder);
+	g_object_unref (self->generator);
+	g_free (self);
+}
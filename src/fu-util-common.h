@@ -32,6 +32,16 @@ typedef enum {
 	FU_SECURITY_ATTR_TO_STRING_FLAG_LAST
 } FuSecurityAttrToStringFlags;
 
+typedef enum {
+	FU_UTIL_JSON_FORMAT_NONE,
+	FU_UTIL_JSON_FORMAT_JSON,
+	FU_UTIL_JSON_FORMAT_JSON_LINES,
+	/*< private >*/
+	FU_UTIL_JSON_FORMAT_LAST
+} FuUtilJsonFormat;
+
+typedef struct FuUtilJsonStream FuUtilJsonStream;
+
 void		 fu_util_print_data		(const gchar	*title,
 						 const gchar	*msg);
 guint		 fu_util_prompt_for_number	(guint		 maxnum);
@@ -96,3 +106,16 @@ gint		 fu_util_sort_devices_by_flags_cb	(gconstpointer	 a,
 						 gconstpointer	 b);
 gint		 fu_util_device_order_sort_cb	(gconstpointer a,
 						 gconstpointer b);
+
+FuUtilJsonStream *fu_util_json_stream_new	(FuUtilJsonFormat format,
+						 const gchar	*member,
+						 gchar		**fields);
+void		 fu_util_json_stream_add_device	(FuUtilJsonStream *self,
+						 FwupdDevice	*dev);
+void		 fu_util_json_stream_add_release (FuUtilJsonStream *self,
+						 FwupdRelease	*rel);
+void		 fu_util_json_stream_add_security_attr (FuUtilJsonStream *self,
+						 FwupdSecurityAttr *attr);
+void		 fu_util_json_stream_free	(FuUtilJsonStream *self);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(FuUtilJsonStream, fu_util_json_stream_free)
@@ -30,6 +30,7 @@
 #include "fu-security-attrs.h"
 #include "fu-util-common.h"
 #include "fwupd-common-private.h"
+#include "fwupd-enums-private.h"
 
 #ifdef HAVE_SYSTEMD
 #include "fu-systemd.h"
@@ -76,6 +77,12 @@ struct FuUtilPrivate {
 	FwupdDeviceFlags	 completion_flags;
 	FwupdDeviceFlags	 filter_include;
 	FwupdDeviceFlags	 filter_exclude;
+	FuUtilJsonFormat	 json_format;
+	gchar			**json_fields;
+	/* only valid in get-devices while the daemon is enumerating */
+	GHashTable		*devices_shown;
+	FuUtilJsonStream	*devices_stream;
+	FwupdFeatureFlags	 feature_flags;
 };
 
 static gboolean	fu_util_report_history (FuUtilPrivate *priv, gchar **values, GError **error);
@@ -526,20 +533,186 @@ fu_util_get_tree_title (FuUtilPrivate *priv)
 	return g_strdup (fwupd_client_get_host_product (priv->client));
 }
 
+/* the daemon also announces devices it had in the snapshot */
+static gboolean
+fu_util_get_devices_should_show (FuUtilPrivate *priv, FwupdDevice *dev)
+{
+	const gchar *device_id = fwupd_device_get_id (dev);
+	if (g_hash_table_contains (priv->devices_shown, device_id))
+		return FALSE;
+	g_hash_table_add (priv->devices_shown, g_strdup (device_id));
+	if (!fu_util_filter_device (priv, dev))
+		return FALSE;
+	if (!priv->show_all && !fu_util_is_interesting_device (dev))
+		return FALSE;
+	return TRUE;
+}
+
+static void
+fu_util_get_devices_added_cb (FwupdClient *client, FwupdDevice *device, FuUtilPrivate *priv)
+{
+	g_autofree gchar *tmp = NULL;
+	if (!fu_util_get_devices_should_show (priv, device))
+		return;
+	if (priv->devices_stream != NULL) {
+		fu_util_json_stream_add_device (priv->devices_stream, device);
+		return;
+	}
+	tmp = fu_util_device_to_string (device, 0);
+	g_print ("%s", tmp);
+}
+
+static void
+fu_util_get_devices_enumerating_cb (FwupdClient *client, GParamSpec *pspec, FuUtilPrivate *priv)
+{
+	if (!fwupd_client_get_enumerating (client))
+		g_main_loop_quit (priv->loop);
+}
+
+/* show the rest of the devices as the daemon finds them */
+static void
+fu_util_get_devices_wait (FuUtilPrivate *priv, GPtrArray *devs)
+{
+	if (!fwupd_client_get_enumerating (priv->client))
+		return;
+	priv->devices_shown = g_hash_table_new_full (g_str_hash, g_str_equal,
+						     g_free, NULL);
+	for (guint i = 0; i < devs->len; i++) {
+		FwupdDevice *dev = g_ptr_array_index (devs, i);
+		g_hash_table_add (priv->devices_shown,
+				  g_strdup (fwupd_device_get_id (dev)));
+	}
+	g_signal_connect (priv->client, "device-added",
+			  G_CALLBACK (fu_util_get_devices_added_cb), priv);
+	g_signal_connect (priv->client, "notify::enumerating",
+			  G_CALLBACK (fu_util_get_devices_enumerating_cb), priv);
+	g_main_loop_run (priv->loop);
+	g_signal_handlers_disconnect_by_func (priv->client,
+					      fu_util_get_devices_added_cb,
+					      priv);
+	g_signal_handlers_disconnect_by_func (priv->client,
+					      fu_util_get_devices_enumerating_cb,
+					      priv);
+	g_clear_pointer (&priv->devices_shown, g_hash_table_unref);
+}
+
+static void
+fu_util_devices_to_json_stream (FuUtilPrivate *priv, GPtrArray *devs)
+{
+	g_autoptr(FuUtilJsonStream) stream = NULL;
+	stream = fu_util_json_stream_new (priv->json_format, "Devices", priv->json_fields);
+	for (guint i = 0; i < devs->len; i++) {
+		FwupdDevice *dev = g_ptr_array_index (devs, i);
+		if (!priv->show_all && !fu_util_is_interesting_device (dev))
+			continue;
+		if (!fu_util_filter_device (priv, dev))
+			continue;
+		fu_util_json_stream_add_device (stream, dev);
+	}
+
+	/* keep the document open until the daemon has found everything */
+	priv->devices_stream = stream;
+	fu_util_get_devices_wait (priv, devs);
+	priv->devices_stream = NULL;
+}
+
+/* the daemon result keys needed to output just the --json-fields members */
+static gchar **
+fu_util_get_device_keys_for_json_fields (gchar **json_fields)
+{
+	GPtrArray *keys = g_ptr_array_new ();
+	const gchar *keys_required[] = {
+		FWUPD_RESULT_KEY_DEVICE_ID,		/* devices already shown */
+		FWUPD_RESULT_KEY_PARENT_DEVICE_ID,	/* interesting children */
+		FWUPD_RESULT_KEY_FLAGS,			/* --filter */
+		FWUPD_RESULT_KEY_UPDATE_ERROR,		/* interesting devices */
+		NULL };
+	struct {
+		const gchar *member;
+		const gchar *key;
+	} map[] = {
+		{ "Checksums",	FWUPD_RESULT_KEY_CHECKSUM },
+		{ "Icons",	FWUPD_RESULT_KEY_ICON },
+		{ "Releases",	FWUPD_RESULT_KEY_RELEASE },
+		{ NULL, NULL }
+	};
+
+	for (guint i = 0; keys_required[i] != NULL; i++)
+		g_ptr_array_add (keys, g_strdup (keys_required[i]));
+	for (guint i = 0; json_fields[i] != NULL; i++) {
+		g_autofree gchar *member = g_strstrip (g_strdup (json_fields[i]));
+		const gchar *key = member;
+
+		/* most of the JSON members are named the same as the keys */
+		for (guint j = 0; map[j].member != NULL; j++) {
+			if (g_strcmp0 (member, map[j].member) == 0) {
+				key = map[j].key;
+				break;
+			}
+		}
+		g_ptr_array_add (keys, g_strdup (key));
+	}
+	g_ptr_array_add (keys, NULL);
+	return (gchar **) g_ptr_array_free (keys, FALSE);
+}
+
+static GPtrArray *
+fu_util_get_devices_for_json (FuUtilPrivate *priv, GError **error)
+{
+	GPtrArray *devs;
+	g_auto(GStrv) keys = NULL;
+	g_autoptr(GError) error_local = NULL;
+
+	/* all the properties are required */
+	if (priv->json_fields == NULL)
+		return fwupd_client_get_devices (priv->client, NULL, error);
+
+	/* only ask the daemon for what is going to be shown */
+	keys = fu_util_get_device_keys_for_json_fields (priv->json_fields);
+	devs = fwupd_client_get_devices_with_keys (priv->client,
+						   (const gchar * const *) keys,
+						   NULL, &error_local);
+	if (devs != NULL)
+		return devs;
+
+	/* the daemon is older than the client */
+	g_debug ("failed to get devices with keys, falling back: %s",
+		 error_local->message);
+	return fwupd_client_get_devices (priv->client, NULL, error);
+}
+
 static gboolean
 fu_util_get_devices (FuUtilPrivate *priv, gchar **values, GError **error)
 {
 	g_autoptr(GNode) root = g_node_new (NULL);
 	g_autoptr(GPtrArray) devs = NULL;
+	g_autoptr(GError) error_local = NULL;
 	g_autofree gchar *title = fu_util_get_tree_title (priv);
 
+	/* the rest of the devices are shown as the daemon adds them, so there
+	 * is no need to wait for the daemon to finish enumerating */
+	if (!fwupd_client_set_feature_flags (priv->client,
+					     priv->feature_flags |
+					     FWUPD_FEATURE_FLAG_PARTIAL_DEVICES,
+					     priv->cancellable, &error_local)) {
+		g_debug ("failed to set front-end features: %s",
+			 error_local->message);
+	}
+
 	/* get results from daemon */
+	if (priv->json_format != FU_UTIL_JSON_FORMAT_NONE) {
+		devs = fu_util_get_devices_for_json (priv, error);
+		if (devs == NULL)
+			return FALSE;
+		fu_util_devices_to_json_stream (priv, devs);
+		return TRUE;
+	}
 	devs = fwupd_client_get_devices (priv->client, NULL, error);
 	if (devs == NULL)
 		return FALSE;
 
 	/* print */
-	if (devs->len == 0) {
+	if (devs->len == 0 && !fwupd_client_get_enumerating (priv->client)) {
 		/* TRANSLATORS: nothing attached that can be upgraded */
 		g_print ("%s\n", _("No hardware detected with firmware update capability"));
 		return TRUE;
@@ -547,6 +720,8 @@ fu_util_get_devices (FuUtilPrivate *priv, gchar **values, GError **error)
 	fu_util_build_device_tree (priv, root, devs, NULL);
 	fu_util_print_tree (root, title);
 
+	fu_util_get_devices_wait (priv, devs);
+
 	/* nag? */
 	if (!fu_util_perhaps_show_unreported (priv, error))
 		return FALSE;
@@ -856,6 +1031,19 @@ fu_util_get_history (FuUtilPrivate *priv, gchar **values, GError **error)
 	if (devices == NULL)
 		return FALSE;
 
+	/* stream each device with its release */
+	if (priv->json_format != FU_UTIL_JSON_FORMAT_NONE) {
+		g_autoptr(FuUtilJsonStream) stream = NULL;
+		stream = fu_util_json_stream_new (priv->json_format, "Devices", priv->json_fields);
+		for (guint i = 0; i < devices->len; i++) {
+			FwupdDevice *dev = g_ptr_array_index (devices, i);
+			if (!fu_util_filter_device (priv, dev))
+				continue;
+			fu_util_json_stream_add_device (stream, dev);
+		}
+		return TRUE;
+	}
+
 	/* show each device */
 	for (guint i = 0; i < devices->len; i++) {
 		g_autoptr(GPtrArray) rels = NULL;
@@ -1210,6 +1398,17 @@ fu_util_get_releases (FuUtilPrivate *priv, gchar **values, GError **error)
 	if (rels == NULL)
 		return FALSE;
 
+	/* stream each release */
+	if (priv->json_format != FU_UTIL_JSON_FORMAT_NONE) {
+		g_autoptr(FuUtilJsonStream) stream = NULL;
+		stream = fu_util_json_stream_new (priv->json_format, "Releases", priv->json_fields);
+		for (guint i = 0; i < rels->len; i++) {
+			FwupdRelease *rel = g_ptr_array_index (rels, i);
+			fu_util_json_stream_add_release (stream, rel);
+		}
+		return TRUE;
+	}
+
 	if (rels->len == 0) {
 		/* TRANSLATORS: no repositories to download from */
 		g_print ("%s\n", _("No releases available"));
@@ -2392,17 +2591,30 @@ fu_util_security (FuUtilPrivate *priv, gchar **values, GError **error)
 		return FALSE;
 	}
 
-	/* TRANSLATORS: this is a string like 'HSI:2-U' */
-	g_print ("%s \033[1m%s\033[0m\n", _("Host Security ID:"),
-		 fwupd_client_get_host_security_id (priv->client));
-
-	/* print the "why" */
+	/* get the "why" */
 	attrs = fwupd_client_get_host_security_attrs (priv->client,
 						      priv->cancellable,
 						      error);
 	if (attrs == NULL)
 		return FALSE;
 
+	/* stream each attribute */
+	if (priv->json_format != FU_UTIL_JSON_FORMAT_NONE) {
+		g_autoptr(FuUtilJsonStream) stream = NULL;
+		stream = fu_util_json_stream_new (priv->json_format,
+						  "SecurityAttributes",
+						  priv->json_fields);
+		for (guint i = 0; i < attrs->len; i++) {
+			FwupdSecurityAttr *attr = g_ptr_array_index (attrs, i);
+			fu_util_json_stream_add_security_attr (stream, attr);
+		}
+		return TRUE;
+	}
+
+	/* TRANSLATORS: this is a string like 'HSI:2-U' */
+	g_print ("%s \033[1m%s\033[0m\n", _("Host Security ID:"),
+		 fwupd_client_get_host_security_id (priv->client));
+
 	/* show or hide different elements */
 	if (priv->show_all) {
 		flags |= FU_SECURITY_ATTR_TO_STRING_FLAG_SHOW_OBSOLETES;
@@ -2444,6 +2656,9 @@ fu_util_private_free (FuUtilPrivate *priv)
 	if (priv->current_device != NULL)
 		g_object_unref (priv->current_device);
 	g_free (priv->current_message);
+	g_strfreev (priv->json_fields);
+	if (priv->devices_shown != NULL)
+		g_hash_table_unref (priv->devices_shown);
 	g_main_loop_unref (priv->loop);
 	g_object_unref (priv->cancellable);
 	g_object_unref (priv->progressbar);
@@ -2676,7 +2891,10 @@ main (int argc, char *argv[])
 	g_autoptr(GError) error_polkit = NULL;
 	g_autoptr(GPtrArray) cmd_array = fu_util_cmd_array_new ();
 	g_autofree gchar *cmd_descriptions = NULL;
+	gboolean json = FALSE;
+	gboolean json_lines = FALSE;
 	g_autofree gchar *filter = NULL;
+	g_autofree gchar *json_fields = NULL;
 	const GOptionEntry options[] = {
 		{ "verbose", 'v', 0, G_OPTION_ARG_NONE, &verbose,
 			/* TRANSLATORS: command line option */
@@ -2729,6 +2947,15 @@ main (int argc, char *argv[])
 		{ "disable-ssl-strict", '\0', 0, G_OPTION_ARG_NONE, &priv->disable_ssl_strict,
 			/* TRANSLATORS: command line option */
 			_("Ignore SSL strict checks when downloading files"), NULL },
+		{ "json", '\0', 0, G_OPTION_ARG_NONE, &json,
+			/* TRANSLATORS: command line option */
+			_("Output in JSON format"), NULL },
+		{ "json-lines", '\0', 0, G_OPTION_ARG_NONE, &json_lines,
+			/* TRANSLATORS: command line option */
+			_("Output one JSON object per line"), NULL },
+		{ "json-fields", '\0', 0, G_OPTION_ARG_STRING, &json_fields,
+			/* TRANSLATORS: command line option */
+			_("Only output the listed JSON fields, e.g. 'Name,DeviceId,Version'"), NULL },
 		{ "filter", '\0', 0, G_OPTION_ARG_STRING, &filter,
 			/* TRANSLATORS: command line option */
 			_("Filter with a set of device flags using a ~ prefix to "
@@ -2990,6 +3217,14 @@ main (int argc, char *argv[])
 		fu_progressbar_set_interactive (priv->progressbar, FALSE);
 	}
 
+	/* streaming JSON output */
+	if (json_lines)
+		priv->json_format = FU_UTIL_JSON_FORMAT_JSON_LINES;
+	else if (json)
+		priv->json_format = FU_UTIL_JSON_FORMAT_JSON;
+	if (json_fields != NULL)
+		priv->json_fields = g_strsplit (json_fields, ",", -1);
+
 	/* parse filter flags */
 	if (filter != NULL) {
 		if (!fu_util_parse_filter_flags (filter,
@@ -3098,16 +3333,27 @@ main (int argc, char *argv[])
 
 	/* send our implemented feature set */
 	if (is_interactive) {
+		priv->feature_flags = FWUPD_FEATURE_FLAG_CAN_REPORT |
+				      FWUPD_FEATURE_FLAG_SWITCH_BRANCH |
+				      FWUPD_FEATURE_FLAG_UPDATE_ACTION |
+				      FWUPD_FEATURE_FLAG_DETACH_ACTION |
+				      FWUPD_FEATURE_FLAG_COMPACT_VARIANT;
 		if (!fwupd_client_set_feature_flags (priv->client,
-						     FWUPD_FEATURE_FLAG_CAN_REPORT |
-						     FWUPD_FEATURE_FLAG_SWITCH_BRANCH |
-						     FWUPD_FEATURE_FLAG_UPDATE_ACTION |
-						     FWUPD_FEATURE_FLAG_DETACH_ACTION,
+						     priv->feature_flags,
 						     priv->cancellable, &error)) {
 			g_printerr ("Failed to set front-end features: %s\n",
 				    error->message);
 			return EXIT_FAILURE;
 		}
+	} else {
+		g_autoptr(GError) error_local = NULL;
+		priv->feature_flags = FWUPD_FEATURE_FLAG_COMPACT_VARIANT;
+		if (!fwupd_client_set_feature_flags (priv->client,
+						     priv->feature_flags,
+						     priv->cancellable, &error_local)) {
+			g_debug ("failed to set front-end features: %s",
+				 error_local->message);
+		}
 	}
 
 	/* run the specified command */